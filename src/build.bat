@@ -43,7 +43,7 @@ REM Include directories
 set IncludeFlags=
 
 REM Link libraries
-set LinkLibraries=user32.lib gdi32.lib msimg32.lib Comdlg32.lib
+set LinkLibraries=user32.lib gdi32.lib msimg32.lib Comdlg32.lib winmm.lib
 
 REM incrmenetal:no, turn incremental builds off
 REM opt:ref, try to remove functions from libs that are referenced at all
@@ -51,6 +51,32 @@ set LinkFlags=-incremental:no -opt:ref
 
 cl %CompileFlags% %CompileEntryPoint% %IncludeFlags% /link -subsystem:WINDOWS,5.1 %LinkLibraries% %LinkFlags% /nologo /OUT:"%ProjectName%.exe"
 
+REM Headless tools, each source file is its own unity build
+cl %CompileFlags% ..\src\fuzz_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"fuzz_dchip8.exe"
+cl %CompileFlags% ..\src\lockstep_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"lockstep_dchip8.exe"
+cl %CompileFlags% ..\src\debug_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"debug_dchip8.exe"
+cl %CompileFlags% ..\src\disasm_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"disasm_dchip8.exe"
+cl %CompileFlags% ..\src\explore_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"explore_dchip8.exe"
+cl %CompileFlags% ..\src\romdb_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"romdb_dchip8.exe"
+cl %CompileFlags% ..\src\capdecode_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"capdecode_dchip8.exe"
+cl %CompileFlags% ..\src\tracedecode_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"tracedecode_dchip8.exe"
+cl %CompileFlags% ..\src\env_bench_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"env_bench_dchip8.exe"
+cl %CompileFlags% ..\src\scalebench_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"scalebench_dchip8.exe"
+cl %CompileFlags% ..\src\conform_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"conform_dchip8.exe"
+cl %CompileFlags% ..\src\store_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"store_dchip8.exe"
+cl %CompileFlags% ..\src\mosaic_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"mosaic_dchip8.exe"
+
+REM Batched environment as a DLL for binding from training scripts
+cl %CompileFlags% /LD ..\src\env_dchip8.cpp %IncludeFlags% /link %LinkFlags% /nologo /OUT:"dchip8_env.dll"
+
+REM Conformance suite, a failing case fails the build
+conform_dchip8.exe ..\conformance\manifest.txt
+set TestResult=%errorlevel%
+
+REM Fuzzer smoke run from a fixed seed, the seed ROMs reach known faults
+fuzz_dchip8.exe -runs 20000 -seed 3 ..\conformance\fuzz\bnnn_out_of_bounds.ch8
+if errorlevel 1 set TestResult=1
+
 popd
 ctime -end %ProjectName%.ctm
-
+exit /b %TestResult%
@@ -0,0 +1,44 @@
+#!/bin/sh
+# Build for GCC or Clang on Linux, the counterpart of build.bat.
+
+set -e
+ScriptDir=$(cd "$(dirname "$0")" && pwd)
+CXX=${CXX:-g++}
+
+# -fno-exceptions -fno-rtti, we don't use exceptions or runtime type information
+# -Wno-unused-function, unreferenced local functions are removed anyway
+# -Wno-unused-parameter, ignore unused argument parameters
+CompileFlags="-std=c++11 -O2 -g -fno-exceptions -fno-rtti -Wall -Wno-unused-function -Wno-unused-parameter -Wno-sign-compare"
+LinkLibraries="-lpthread -lrt"
+
+# Drop compilation files into build folder
+mkdir -p "$ScriptDir/../bin"
+cd "$ScriptDir/../bin"
+
+# Headless platform layer, each source file is its own unity build
+$CXX $CompileFlags "$ScriptDir/linux_dchip8.cpp" -o linux_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/shmview_dchip8.cpp" -o shmview_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/capdecode_dchip8.cpp" -o capdecode_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/tracedecode_dchip8.cpp" -o tracedecode_dchip8 $LinkLibraries
+
+# Tools
+$CXX $CompileFlags "$ScriptDir/romdb_dchip8.cpp" -o romdb_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/fuzz_dchip8.cpp" -o fuzz_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/lockstep_dchip8.cpp" -o lockstep_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/debug_dchip8.cpp" -o debug_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/disasm_dchip8.cpp" -o disasm_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/explore_dchip8.cpp" -o explore_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/env_bench_dchip8.cpp" -o env_bench_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/scalebench_dchip8.cpp" -o scalebench_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/conform_dchip8.cpp" -o conform_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/store_dchip8.cpp" -o store_dchip8 $LinkLibraries
+$CXX $CompileFlags "$ScriptDir/mosaic_dchip8.cpp" -o mosaic_dchip8 $LinkLibraries
+
+# Batched environment as a shared library for binding from training scripts
+$CXX $CompileFlags -shared -fPIC -fvisibility=hidden "$ScriptDir/env_dchip8.cpp" -o libdchip8_env.so $LinkLibraries
+
+# Conformance suite, a failing case fails the build
+./conform_dchip8 "$ScriptDir/../conformance/manifest.txt"
+
+# Fuzzer smoke run from a fixed seed, the seed ROMs reach known faults
+./fuzz_dchip8 -runs 20000 -seed 3 "$ScriptDir/../conformance/fuzz/"*.ch8
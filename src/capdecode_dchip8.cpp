@@ -0,0 +1,159 @@
+// NOTE: Decoder for the capture stream written by linux_dchip8 -capture. Turns
+// the stream back into raw frames for other tools, one frame after another with
+// no header.
+//
+// Usage: capdecode_dchip8 [-argb] [-info] [in|-] [out|-]
+//
+// Frames are the packed 1bpp display, 256 bytes each (see dchip8_capture.h).
+// -argb expands them to 64x32 u32 pixels, top row first, 0xFFFFFFFF for on and
+// 0 for off. -info prints stream statistics instead of writing frames. Frames
+// the capture lost are written as repeats of the frame before them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8_capture.cpp"
+
+FILE_SCOPE bool capdecode_write_frame(FILE *file, const u8 *frame, bool argb)
+{
+	if (!argb)
+		return fwrite(frame, 1, DCHIP8_CAPTURE_FRAME_SIZE, file) ==
+		       DCHIP8_CAPTURE_FRAME_SIZE;
+
+	u32 pixels[CHIP8_DISPLAY_WIDTH * CHIP8_DISPLAY_HEIGHT];
+	for (i32 y = 0; y < CHIP8_DISPLAY_HEIGHT; y++)
+	{
+		u64 row;
+		memcpy(&row, frame + (y * sizeof(row)), sizeof(row));
+
+		u32 *dest = pixels + (y * CHIP8_DISPLAY_WIDTH);
+		for (i32 x = 0; x < CHIP8_DISPLAY_WIDTH; x++)
+		{
+			u32 pixelIsOn = (u32)((row >> ((CHIP8_DISPLAY_WIDTH - 1) - x)) & 1);
+			dest[x]       = (0 - pixelIsOn);
+		}
+	}
+
+	return fwrite(pixels, sizeof(pixels), 1, file) == 1;
+}
+
+int main(int argc, char **argv)
+{
+	bool argb           = false;
+	bool info           = false;
+	const char *inPath  = NULL;
+	const char *outPath = NULL;
+
+	for (i32 i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		if      (strcmp(arg, "-argb") == 0) argb = true;
+		else if (strcmp(arg, "-info") == 0) info = true;
+		else if (!inPath)                   inPath  = arg;
+		else if (!outPath)                  outPath = arg;
+	}
+
+	FILE *in  = (!inPath || strcmp(inPath, "-") == 0) ? stdin : fopen(inPath, "rb");
+	FILE *out = (!outPath || strcmp(outPath, "-") == 0) ? stdout : fopen(outPath, "wb");
+	if (!in || !out)
+	{
+		fprintf(stderr, "Usage: capdecode_dchip8 [-argb] [-info] [in|-] [out|-]\n");
+		return 1;
+	}
+
+	// NOTE: Stream through a fixed buffer so it works on pipes of any length,
+	// a partial record at the end of the buffer is moved to the front
+	u8 buffer[64 * 1024];
+	u32 bufferSize = (u32)fread(buffer, 1, DCHIP8_CAPTURE_HEADER_SIZE, in);
+	if (!dchip8_capture_read_header(buffer, bufferSize))
+	{
+		fprintf(stderr, "Not a dchip8 capture stream\n");
+		return 1;
+	}
+
+	Chip8CaptureDecoder decoder = {};
+	u64 numFrames               = 0;
+	u64 numDeltaRecords         = 0;
+	u64 numRepeatRecords        = 0;
+	u64 numGapRecords           = 0;
+	u64 numBytes                = DCHIP8_CAPTURE_HEADER_SIZE;
+
+	bool endOfInput = false;
+	bufferSize      = 0;
+	while (!endOfInput || bufferSize > 0)
+	{
+		if (!endOfInput)
+		{
+			u32 numRead = (u32)fread(buffer + bufferSize, 1,
+			                         sizeof(buffer) - bufferSize, in);
+			bufferSize += numRead;
+			numBytes += numRead;
+			endOfInput = (bufferSize < sizeof(buffer));
+		}
+
+		u32 pos = 0;
+		while (pos < bufferSize)
+		{
+			u32 numRecordFrames = 0;
+			i32 recordSize = dchip8_capture_decode_record(
+			    &decoder, buffer + pos, bufferSize - pos, &numRecordFrames);
+			if (recordSize == 0) break;
+			if (recordSize < 0)
+			{
+				fprintf(stderr, "Corrupt record at byte %llu\n",
+				        (unsigned long long)(numBytes - bufferSize + pos));
+				return 1;
+			}
+
+			if      (buffer[pos] == chip8capturerecord_delta)  numDeltaRecords++;
+			else if (buffer[pos] == chip8capturerecord_repeat) numRepeatRecords++;
+			else                                               numGapRecords++;
+			pos += recordSize;
+
+			numFrames += numRecordFrames;
+			if (info) continue;
+			for (u32 i = 0; i < numRecordFrames; i++)
+			{
+				if (!capdecode_write_frame(out, decoder.frame, argb))
+				{
+					fprintf(stderr, "Could not write frame\n");
+					return 1;
+				}
+			}
+		}
+
+		if (pos == 0 && endOfInput && bufferSize > 0)
+		{
+			fprintf(stderr, "Stream ends with a truncated record\n");
+			return 1;
+		}
+		memmove(buffer, buffer + pos, bufferSize - pos);
+		bufferSize -= pos;
+	}
+
+	if (info)
+	{
+		u64 rawBytes = numFrames * DCHIP8_CAPTURE_FRAME_SIZE;
+		printf("frames: %llu, delta records: %llu, repeat records: %llu\n",
+		       (unsigned long long)numFrames,
+		       (unsigned long long)numDeltaRecords,
+		       (unsigned long long)numRepeatRecords);
+		printf("lost frames: %llu in %llu gaps\n",
+		       (unsigned long long)decoder.numLost,
+		       (unsigned long long)numGapRecords);
+		printf("stream: %llu bytes, 1bpp raw: %llu bytes (%.1fx), ARGB raw: "
+		       "%llu bytes (%.1fx)\n",
+		       (unsigned long long)numBytes, (unsigned long long)rawBytes,
+		       numBytes ? (f64)rawBytes / numBytes : 0,
+		       (unsigned long long)(rawBytes * 32),
+		       numBytes ? (f64)rawBytes * 32 / numBytes : 0);
+	}
+
+	if (in != stdin) fclose(in);
+	if (out != stdout) fclose(out);
+	return 0;
+}
@@ -0,0 +1,610 @@
+// NOTE: Conformance suite. Runs every case in a manifest headlessly through
+// dchip8_update for a fixed number of frames with scripted input, hashes the
+// final display and memory and compares them with the golden values stored in
+// the manifest. Cases are spread over every core.
+//
+// Usage: conform_dchip8 [-threads N] [-record out] manifest
+//
+// The manifest is text, one case a line, '#' starts a comment
+//   <rom path> [frames=N] [cycles=N] [quirks=N] [keys=file] [input=F:MASK,..]
+//              [display=0xHASH] [memory=0xHASH] [name=text]
+//
+// A case runs frames frames (600 by default) of cycles instructions (the ROM
+// default otherwise) with 60hz timers, so every run executes the same
+// instructions. quirks is a Chip8Quirk mask. keys is a file of u16 little
+// endian key bitmasks, one per frame, input is a script where F:MASK holds the
+// keys in hex bitmask MASK down from frame F on, input wins where both are
+// given. Relative paths are relative to the manifest. name takes the rest of
+// the line.
+//
+// -record runs every case and writes the manifest to out with the golden
+// values from this run, comments and blank lines kept. A case without golden
+// values fails otherwise. Exit code 0 if every case passed.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "headless_dchip8.cpp"
+
+#define CONFORM_MAX_INPUTS     64
+#define CONFORM_DEFAULT_FRAMES 600
+
+enum ConformResult
+{
+	conformresult_pass,
+	conformresult_fail,
+	conformresult_unrecorded,
+	conformresult_error,
+};
+
+typedef struct ConformInput
+{
+	u32 frame;
+	u16 keys;
+} ConformInput;
+
+typedef struct ConformCase
+{
+	char          name[64];
+	char          romPath[260];
+	char          keysPath[260];
+	u32           frames;
+	u32           cycles;
+	u32           quirks;
+	bool          hasQuirks;
+	ConformInput  inputs[CONFORM_MAX_INPUTS];
+	u32           numInputs;
+
+	bool          hasGolden;
+	u64           goldenDisplay;
+	u64           goldenMemory;
+
+	// NOTE: The manifest line without the golden values or name, for -record
+	char          recordLine[1024];
+
+	enum ConformResult result;
+	u64           display;
+	u64           memory;
+	enum Chip8State state;
+	f64           timeInS;
+	char          error[300];
+} ConformCase;
+
+// NOTE: Lines that aren't cases, i.e. comments and blank lines, are kept with
+// a NULL test so -record can write the manifest back in order
+typedef struct ConformLine
+{
+	char        *text;
+	ConformCase *test;
+} ConformLine;
+
+typedef struct ConformSuite
+{
+	ConformCase *cases;
+	u32          numCases;
+	volatile u32 nextCase;
+} ConformSuite;
+
+////////////////////////////////////////////////////////////////////////////////
+// Manifest
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE void conform_resolve_path(const char *manifestDir, const char *path,
+                                     char *out, size_t outSize)
+{
+	bool absolute = (path[0] == '/' || path[0] == '\\' ||
+	                 (path[0] && path[1] == ':'));
+	if (absolute || manifestDir[0] == 0)
+		snprintf(out, outSize, "%s", path);
+	else
+		snprintf(out, outSize, "%s/%s", manifestDir, path);
+}
+
+FILE_SCOPE bool conform_parse_input(const char *text, ConformCase *test)
+{
+	char buffer[512];
+	snprintf(buffer, sizeof(buffer), "%s", text);
+
+	for (char *token = strtok(buffer, ","); token; token = strtok(NULL, ","))
+	{
+		char *separator = strchr(token, ':');
+		if (!separator || test->numInputs >= CONFORM_MAX_INPUTS) return false;
+
+		ConformInput *input = &test->inputs[test->numInputs++];
+		input->frame        = (u32)strtoul(token, NULL, 10);
+		input->keys         = (u16)strtoul(separator + 1, NULL, 16);
+		if (test->numInputs > 1 && input->frame < input[-1].frame) return false;
+	}
+
+	return true;
+}
+
+FILE_SCOPE void conform_append(char *dest, size_t destSize, const char *text)
+{
+	size_t length = strlen(dest);
+	if (length < destSize) snprintf(dest + length, destSize - length, "%s", text);
+}
+
+// Return false if the line is invalid, test->romPath stays empty when the line
+// has no case in it
+FILE_SCOPE bool conform_parse_line(const char *manifestPath,
+                                   const char *manifestDir, i32 lineNum,
+                                   char *line, ConformCase *test)
+{
+	*test        = {};
+	test->frames = CONFORM_DEFAULT_FRAMES;
+
+	char *comment = strchr(line, '#');
+	if (comment) *comment = 0;
+
+	char *cursor = line;
+	bool hasRom  = false;
+	for (;;)
+	{
+		while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' ||
+		       *cursor == '\n')
+			cursor++;
+		if (*cursor == 0) break;
+
+		// NOTE: name takes the rest of the line, trailing space trimmed
+		if (strncmp(cursor, "name=", 5) == 0)
+		{
+			char *end = cursor + strlen(cursor);
+			while (end > cursor + 5 && (end[-1] == ' ' || end[-1] == '\t' ||
+			                            end[-1] == '\r' || end[-1] == '\n'))
+				*--end = 0;
+			snprintf(test->name, sizeof(test->name), "%s", cursor + 5);
+			break;
+		}
+
+		char *token = cursor;
+		while (*cursor && *cursor != ' ' && *cursor != '\t' &&
+		       *cursor != '\r' && *cursor != '\n')
+			cursor++;
+		if (*cursor) *cursor++ = 0;
+
+		bool valid   = true;
+		bool isGolden = false;
+		if (!hasRom)
+		{
+			hasRom = true;
+			conform_resolve_path(manifestDir, token, test->romPath,
+			                     sizeof(test->romPath));
+			if (test->name[0] == 0)
+			{
+				// NOTE: Default the name to the file name
+				const char *fileName = token;
+				for (const char *c = token; *c; c++)
+					if (*c == '/' || *c == '\\') fileName = c + 1;
+				snprintf(test->name, sizeof(test->name), "%s", fileName);
+			}
+		}
+		else if (strncmp(token, "frames=", 7) == 0)
+		{
+			test->frames = (u32)strtoul(token + 7, NULL, 0);
+		}
+		else if (strncmp(token, "cycles=", 7) == 0)
+		{
+			test->cycles = (u32)strtoul(token + 7, NULL, 0);
+			valid        = test->cycles > 0;
+		}
+		else if (strncmp(token, "quirks=", 7) == 0)
+		{
+			test->quirks    = (u32)strtoul(token + 7, NULL, 0);
+			test->hasQuirks = true;
+			valid           = (test->quirks & ~chip8quirk_all) == 0;
+		}
+		else if (strncmp(token, "keys=", 5) == 0)
+		{
+			conform_resolve_path(manifestDir, token + 5, test->keysPath,
+			                     sizeof(test->keysPath));
+		}
+		else if (strncmp(token, "input=", 6) == 0)
+		{
+			valid = conform_parse_input(token + 6, test);
+		}
+		else if (strncmp(token, "display=", 8) == 0)
+		{
+			test->goldenDisplay = strtoull(token + 8, NULL, 16);
+			isGolden            = true;
+		}
+		else if (strncmp(token, "memory=", 7) == 0)
+		{
+			test->goldenMemory = strtoull(token + 7, NULL, 16);
+			isGolden           = true;
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if (!valid)
+		{
+			fprintf(stderr, "conform: %s:%d invalid field %s\n", manifestPath,
+			        lineNum, token);
+			return false;
+		}
+
+		if (!isGolden)
+		{
+			if (test->recordLine[0]) conform_append(test->recordLine,
+			                                        sizeof(test->recordLine), " ");
+			conform_append(test->recordLine, sizeof(test->recordLine), token);
+		}
+	}
+
+	test->hasGolden = (test->goldenDisplay != 0 || test->goldenMemory != 0);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Run
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Press the platform keys the ROM's keymap turns into the hex keys, the
+// input goes through the same mapping as a player's would
+FILE_SCOPE void conform_set_keys(PlatformInput *input, const u8 *keymap,
+                                 u16 keys)
+{
+	for (i32 hexKey = 0; hexKey < CHIP8_NUM_KEYS; hexKey++)
+	{
+		if (keymap[hexKey] >= key_count) continue;
+		KeyState *state  = &input->key[keymap[hexKey]];
+		state->endedDown = ((keys >> hexKey) & 1) != 0;
+	}
+}
+
+FILE_SCOPE void conform_run_case(ConformCase *test)
+{
+	f64 startInS = dqnt_time_now_s();
+	test->result = conformresult_error;
+
+	u32 romSize = 0;
+	u8 *rom     = headless_read_entire_file(test->romPath, &romSize);
+	if (!rom)
+	{
+		snprintf(test->error, sizeof(test->error), "could not read %s",
+		         test->romPath);
+		return;
+	}
+
+	u32 keysSize = 0;
+	u16 *keys    = NULL;
+	if (test->keysPath[0])
+	{
+		keys = (u16 *)headless_read_entire_file(test->keysPath, &keysSize);
+		if (!keys)
+		{
+			snprintf(test->error, sizeof(test->error), "could not read %s",
+			         test->keysPath);
+			free(rom);
+			return;
+		}
+	}
+	u32 numKeys = keysSize / sizeof(*keys);
+
+	PlatformMemory memory   = {};
+	memory.permanentMemSize = DCHIP8_MIN_PERMANENT_MEM_SIZE;
+	memory.permanentMem     = calloc(1, memory.permanentMemSize);
+	Chip8Session *session   = (Chip8Session *)memory.permanentMem;
+	if (!session || !dchip8_session_load_rom(session, NULL, rom, romSize))
+	{
+		snprintf(test->error, sizeof(test->error), "could not load %s",
+		         test->romPath);
+		free(session);
+		free(keys);
+		free(rom);
+		return;
+	}
+
+	if (test->cycles) session->settings.cyclesPerFrame = test->cycles;
+	if (test->hasQuirks)
+	{
+		session->settings.quirks = test->quirks;
+		session->vm.cpu.quirks   = test->quirks;
+	}
+
+	u32 pixels[CHIP8_DISPLAY_WIDTH * CHIP8_DISPLAY_HEIGHT];
+	PlatformRenderBuffer renderBuffer = {};
+	renderBuffer.memory               = pixels;
+	renderBuffer.width                = CHIP8_DISPLAY_WIDTH;
+	renderBuffer.height               = CHIP8_DISPLAY_HEIGHT;
+	renderBuffer.bytesPerPixel        = sizeof(pixels[0]);
+
+	PlatformInput input = {};
+	input.deltaForFrame = 1 / 60.0f;
+
+	u32 inputIndex = 0;
+	for (u32 frame = 0; frame < test->frames; frame++)
+	{
+		u16 frameKeys = (frame < numKeys) ? keys[frame] : 0;
+		while (inputIndex < test->numInputs &&
+		       test->inputs[inputIndex].frame <= frame)
+			inputIndex++;
+		if (inputIndex > 0) frameKeys = test->inputs[inputIndex - 1].keys;
+
+		conform_set_keys(&input, session->settings.keymap, frameKeys);
+		dchip8_update(renderBuffer, &input, memory, NULL, NULL);
+	}
+
+	const Chip8VM *vm = &session->vm;
+	test->display = dchip8_rom_hash((const u8 *)vm->display, sizeof(vm->display));
+	test->memory  = dchip8_rom_hash(vm->memory, sizeof(vm->memory));
+	test->state   = vm->cpu.state;
+
+	// NOTE: The incremental hashes are an optimisation everything else leans
+	// on, check them while the machine is at hand
+	if (dchip8_vm_hash(vm) != dchip8_vm_hash_full(vm))
+	{
+		snprintf(test->error, sizeof(test->error),
+		         "incremental hashes out of date");
+		test->result = conformresult_fail;
+	}
+	else if (!test->hasGolden)
+	{
+		test->result = conformresult_unrecorded;
+	}
+	else if (test->display != test->goldenDisplay ||
+	         test->memory != test->goldenMemory)
+	{
+		test->result = conformresult_fail;
+	}
+	else
+	{
+		test->result = conformresult_pass;
+	}
+
+	free(session);
+	free(keys);
+	free(rom);
+	test->timeInS = dqnt_time_now_s() - startInS;
+}
+
+FILE_SCOPE u32 conform_worker(void *userData)
+{
+	ConformSuite *suite = (ConformSuite *)userData;
+	for (;;)
+	{
+		u32 index = dqnt_atomic_add_u32(&suite->nextCase, 1) - 1;
+		if (index >= suite->numCases) break;
+		conform_run_case(&suite->cases[index]);
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Report
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE void conform_print_case(const ConformCase *test)
+{
+	switch (test->result)
+	{
+		case conformresult_pass:
+		{
+			printf("PASS  %-32s %7.2f ms\n", test->name, test->timeInS * 1000.0);
+		}
+		break;
+
+		case conformresult_fail:
+		{
+			printf("FAIL  %-32s", test->name);
+			if (test->error[0])
+			{
+				printf(" %s\n", test->error);
+				break;
+			}
+
+			if (test->display != test->goldenDisplay)
+				printf(" display %016llX expected %016llX",
+				       (unsigned long long)test->display,
+				       (unsigned long long)test->goldenDisplay);
+			if (test->memory != test->goldenMemory)
+				printf(" memory %016llX expected %016llX",
+				       (unsigned long long)test->memory,
+				       (unsigned long long)test->goldenMemory);
+			if (test->state == chip8state_fault) printf(" (faulted)");
+			printf("\n");
+		}
+		break;
+
+		case conformresult_unrecorded:
+		{
+			printf("NEW   %-32s display %016llX memory %016llX\n", test->name,
+			       (unsigned long long)test->display,
+			       (unsigned long long)test->memory);
+		}
+		break;
+
+		default:
+		{
+			printf("ERROR %-32s %s\n", test->name, test->error);
+		}
+		break;
+	}
+}
+
+FILE_SCOPE bool conform_write_record(const char *path, const ConformLine *lines,
+                                     u32 numLines)
+{
+	FILE *file = fopen(path, "wb");
+	if (!file) return false;
+
+	for (u32 i = 0; i < numLines; i++)
+	{
+		const ConformCase *test = lines[i].test;
+		if (!test)
+		{
+			fprintf(file, "%s", lines[i].text);
+			continue;
+		}
+
+		fprintf(file, "%s display=0x%016llX memory=0x%016llX name=%s\n",
+		        test->recordLine, (unsigned long long)test->display,
+		        (unsigned long long)test->memory, test->name);
+	}
+
+	bool result = (ferror(file) == 0);
+	if (fclose(file) != 0) result = false;
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	u32 numThreads         = dqnt_num_cores();
+	const char *recordPath = NULL;
+
+	i32 argIndex = 1;
+	for (; argIndex < argc; argIndex++)
+	{
+		const char *arg = argv[argIndex];
+		if (arg[0] != '-' || argIndex + 1 >= argc) break;
+
+		const char *value = argv[++argIndex];
+		if      (dqnt_strcmp(arg, "-threads") == 0) numThreads = (u32)strtoul(value, NULL, 0);
+		else if (dqnt_strcmp(arg, "-record") == 0)  recordPath = value;
+		else
+		{
+			fprintf(stderr, "conform: unknown option %s\n", arg);
+			return -1;
+		}
+	}
+
+	if (argIndex >= argc)
+	{
+		fprintf(stderr,
+		        "usage: conform_dchip8 [-threads N] [-record out] manifest\n");
+		return -1;
+	}
+
+	////////////////////////////////////////////////////////////////////////////
+	// Load Manifest
+	////////////////////////////////////////////////////////////////////////////
+	const char *manifestPath = argv[argIndex];
+	FILE *manifest           = fopen(manifestPath, "rb");
+	if (!manifest)
+	{
+		fprintf(stderr, "conform: could not open %s\n", manifestPath);
+		return -1;
+	}
+
+	char manifestDir[260] = {};
+	snprintf(manifestDir, sizeof(manifestDir), "%s", manifestPath);
+	char *lastSlash = NULL;
+	for (char *c = manifestDir; *c; c++)
+		if (*c == '/' || *c == '\\') lastSlash = c;
+	if (lastSlash) *lastSlash = 0;
+	else manifestDir[0] = 0;
+
+	u32 numLines         = 0;
+	u32 maxLines         = 64;
+	ConformLine *lines   = (ConformLine *)malloc(maxLines * sizeof(ConformLine));
+	ConformSuite suite   = {};
+	u32 maxCases         = 64;
+	suite.cases = (ConformCase *)malloc(maxCases * sizeof(ConformCase));
+
+	char line[1024];
+	char parseBuffer[1024];
+	i32 lineNum = 0;
+	while (fgets(line, sizeof(line), manifest))
+	{
+		lineNum++;
+		memcpy(parseBuffer, line, sizeof(line));
+
+		if (suite.numCases == maxCases)
+		{
+			maxCases *= 2;
+			suite.cases = (ConformCase *)realloc(
+			    suite.cases, maxCases * sizeof(ConformCase));
+		}
+		if (numLines == maxLines)
+		{
+			maxLines *= 2;
+			lines = (ConformLine *)realloc(lines, maxLines * sizeof(ConformLine));
+		}
+		if (!suite.cases || !lines)
+		{
+			fprintf(stderr, "conform: out of memory\n");
+			return -1;
+		}
+
+		ConformCase *test = &suite.cases[suite.numCases];
+		if (!conform_parse_line(manifestPath, manifestDir, lineNum, parseBuffer,
+		                        test))
+			return -1;
+
+		ConformLine *entry = &lines[numLines++];
+		entry->text        = NULL;
+		entry->test        = NULL;
+		if (test->romPath[0])
+			suite.numCases++;
+		else
+			entry->text = strdup(line);
+	}
+	fclose(manifest);
+
+	// NOTE: Cases move while the array grows, resolve them once it is final
+	for (u32 i = 0, caseIndex = 0; i < numLines; i++)
+		if (!lines[i].text) lines[i].test = &suite.cases[caseIndex++];
+
+	////////////////////////////////////////////////////////////////////////////
+	// Run
+	////////////////////////////////////////////////////////////////////////////
+	numThreads = DQNT_MATH_MAX(1u, DQNT_MATH_MIN(numThreads, suite.numCases));
+	DqntThread *threads =
+	    (DqntThread *)calloc(numThreads, sizeof(DqntThread));
+
+	f64 startInS      = dqnt_time_now_s();
+	u32 numWorkers    = 0;
+	for (u32 i = 0; threads && i + 1 < numThreads; i++)
+	{
+		if (dqnt_thread_create(&threads[numWorkers], conform_worker, &suite))
+			numWorkers++;
+	}
+	conform_worker(&suite);
+	for (u32 i = 0; i < numWorkers; i++)
+		dqnt_thread_join(&threads[i]);
+	f64 elapsedInS = dqnt_time_now_s() - startInS;
+
+	////////////////////////////////////////////////////////////////////////////
+	// Report
+	////////////////////////////////////////////////////////////////////////////
+	u32 numCounted[conformresult_error + 1] = {};
+	for (u32 i = 0; i < suite.numCases; i++)
+	{
+		conform_print_case(&suite.cases[i]);
+		numCounted[suite.cases[i].result]++;
+	}
+
+	printf("%u passed, %u failed, %u unrecorded, %u errors in %.3fs on %u "
+	       "threads\n",
+	       numCounted[conformresult_pass], numCounted[conformresult_fail],
+	       numCounted[conformresult_unrecorded], numCounted[conformresult_error],
+	       elapsedInS, numWorkers + 1);
+
+	i32 result = (numCounted[conformresult_pass] == suite.numCases) ? 0 : 1;
+	if (recordPath)
+	{
+		// NOTE: A case that couldn't run has nothing to record
+		if (numCounted[conformresult_error] > 0)
+		{
+			fprintf(stderr, "conform: not recording, some cases had errors\n");
+			return 1;
+		}
+
+		if (!conform_write_record(recordPath, lines, numLines))
+		{
+			fprintf(stderr, "conform: could not write %s\n", recordPath);
+			return 1;
+		}
+
+		printf("Recorded %u cases to %s\n", suite.numCases, recordPath);
+		result = 0;
+	}
+
+	return result;
+}
@@ -2,80 +2,11 @@
 	#define _CRT_SECURE_NO_WARNINGS
 #endif
 
+#include "dchip8.h"
 #include "dchip8_platform.h"
 #include "dqnt.h"
 #include "stdio.h"
-
-enum Chip8State
-{
-	chip8state_off,
-	chip8state_await_input,
-	chip8state_running,
-};
-
-typedef struct Chip8Controller
-{
-	bool key[0x10];
-} Chip8Controller;
-
-#define INIT_ADDRESS 0x200
-typedef struct Chip8CPU
-{
-	union {
-		u8 registerArray[16];
-		struct
-		{
-			u8 V0;
-			u8 V1;
-			u8 V2;
-			u8 V3;
-			u8 V4;
-			u8 V5;
-			u8 V6;
-			u8 V7;
-			u8 V8;
-			u8 V9;
-			u8 VA;
-			u8 VB;
-			u8 VC;
-			u8 VD;
-			u8 VE;
-			u8 VF;
-		};
-	};
-
-
-	// NOTE: Timer that count at 60hz and when set above 0 will count down to 0.
-	union {
-		u8 dt;
-		u8 delayTimer;
-	};
-
-	union {
-		u8 st;
-		u8 soundTimer;
-	};
-
-	// NOTE: Maximum value is 0xFFF, or 4095 or 12 bits
-	union {
-		u16 I;
-		u16 indexRegister;
-	};
-
-	// NOTE: Maximum value is 0xFFF, or 4095 or 12 bits
-	u16 programCounter;
-
-	u8 stackPointer;
-	u16 stack[16];
-
-	// Metadata
-	u8   storeKeyToRegisterIndex;
-	f32  elapsedTime;
-	enum Chip8State state;
-} Chip8CPU;
-
-FILE_SCOPE Chip8CPU     cpu;
-FILE_SCOPE RandPCGState pcgState;
+#include "string.h"
 
 FILE_SCOPE void dchip8_init_memory(u8 *memory, u32 size)
 {
@@ -201,8 +132,9 @@ FILE_SCOPE void dchip8_init_memory(u8 *memory, u32 size)
 		memory[i] = PRESET_FONTS[i];
 }
 
-FILE_SCOPE void dchip8_init_cpu(Chip8CPU *chip8CPU)
+FILE_SCOPE void dchip8_init_cpu(Chip8VM *vm)
 {
+	Chip8CPU *chip8CPU = &vm->cpu;
 	memset(chip8CPU, 0, sizeof(*chip8CPU));
 
 	// NOTE: Everything before 0x200 is reserved for the actual emulator
@@ -211,7 +143,7 @@ FILE_SCOPE void dchip8_init_cpu(Chip8CPU *chip8CPU)
 	chip8CPU->stackPointer   = 0;
 
 	const u32 SEED = 0x8293A8DE;
-	dqnt_rnd_pcg_seed(&pcgState, SEED);
+	dqnt_rnd_pcg_seed(&vm->pcgState, SEED);
 }
 
 FILE_SCOPE
@@ -257,608 +189,1722 @@ void dchip8_debug_draw_half_colored_screen_internal(
 	}
 }
 
-FILE_SCOPE void dchip8_init_display(PlatformRenderBuffer renderBuffer)
+////////////////////////////////////////////////////////////////////////////////
+// Incremental Hashing
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Memory and display hashes are the XOR of a hash per (location, value)
+// pair, Zobrist style, so a write is undone and redone with two XORs. The
+// per pair hash is computed rather than looked up, a table for every byte
+// value at every address would be 8MB.
+FILE_SCOPE inline u64 dchip8_hash_avalanche_internal(u64 h)
 {
-	// Init screen to 0 alpha, and let alpha simulate "turning on a pixel"
-	i32 numPixels     = renderBuffer.width * renderBuffer.height;
-	u32 *bitmapBuffer = (u32 *)renderBuffer.memory;
-	for (i32 i = 0; i < numPixels; i++)
-	{
-		u8 r = (u8)(0.0f);
-		u8 g = (u8)(0.0f);
-		u8 b = (u8)(0.0f);
-		u8 a = (u8)(0.0f);
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+	return h;
+}
 
-		u32 color       = (a << 24) | (r << 16) | (g << 8) | (b << 0);
-		bitmapBuffer[i] = color;
-	}
+FILE_SCOPE inline u64 dchip8_hash_memory_byte_internal(u32 address, u8 value)
+{
+	u64 key    = ((u64)address << 8) | value;
+	u64 result = dchip8_hash_avalanche_internal(key + 0x9E3779B97F4A7C15ULL);
+	return result;
 }
 
-FILE_SCOPE Chip8Controller dchip8_controller_map_input(PlatformInput input)
+FILE_SCOPE inline u64 dchip8_hash_display_row_internal(i32 row, u64 bits)
 {
-	// NOTE: Chip8 Hex Controller to Keyboard Mapping
-	// Keypad         Keyboard
-	// +-+-+-+-+     +-+-+-+-+
-	// |1|2|3|C|     |1|2|3|4|
-	// +-+-+-+-+     +-+-+-+-+
-	// |4|5|6|D|     |Q|W|E|R|
-	// +-+-+-+-+  => +-+-+-+-+
-	// |7|8|9|E|     |A|S|D|F|
-	// +-+-+-+-+     +-+-+-+-+
-	// |A|0|B|F|     |Z|X|C|V|
-	// +-+-+-+-+     +-+-+-+-+
+	u64 key    = dchip8_hash_avalanche_internal(bits) +
+	             ((u64)(row + 1) * 0x9E3779B97F4A7C15ULL);
+	u64 result = dchip8_hash_avalanche_internal(key);
+	return result;
+}
 
-	Chip8Controller result = {};
+FILE_SCOPE inline void dchip8_write_memory_internal(Chip8VM *vm, u32 address,
+                                                    u8 value)
+{
+	vm->memoryHash ^= dchip8_hash_memory_byte_internal(address, vm->memory[address]) ^
+	                  dchip8_hash_memory_byte_internal(address, value);
+	vm->memory[address] = value;
+	vm->dirtyPages |= (u16)(1 << (address / CHIP8_PAGE_SIZE));
+}
+
+FILE_SCOPE inline void dchip8_write_display_row_internal(Chip8VM *vm, i32 row,
+                                                         u64 bits)
+{
+	vm->displayHash ^= dchip8_hash_display_row_internal(row, vm->display[row]) ^
+	                   dchip8_hash_display_row_internal(row, bits);
+	vm->display[row] = bits;
+}
 
-	result.key[0x01] = input.key_1.endedDown;
-	result.key[0x02] = input.key_2.endedDown;
-	result.key[0x03] = input.key_3.endedDown;
-	result.key[0x0C] = input.key_4.endedDown;
+void dchip8_vm_write_memory(Chip8VM *vm, u16 address, u8 value)
+{
+	DQNT_ASSERT(address < CHIP8_MEMORY_SIZE);
+	dchip8_write_memory_internal(vm, address, value);
+}
 
-	result.key[0x04] = input.key_q.endedDown;
-	result.key[0x05] = input.key_w.endedDown;
-	result.key[0x06] = input.key_e.endedDown;
-	result.key[0x0D] = input.key_r.endedDown;
+void dchip8_vm_write_memory_block(Chip8VM *vm, u16 address, const u8 *src,
+                                  u32 size)
+{
+	DQNT_ASSERT((u32)address + size <= CHIP8_MEMORY_SIZE);
+	for (u32 i = 0; i < size; i++)
+		dchip8_write_memory_internal(vm, address + i, src[i]);
+}
 
-	result.key[0x07] = input.key_a.endedDown;
-	result.key[0x08] = input.key_s.endedDown;
-	result.key[0x09] = input.key_d.endedDown;
-	result.key[0x0E] = input.key_f.endedDown;
+void dchip8_vm_write_display_row(Chip8VM *vm, i32 row, u64 bits)
+{
+	DQNT_ASSERT(row >= 0 && row < CHIP8_DISPLAY_HEIGHT);
+	dchip8_write_display_row_internal(vm, row, bits);
+}
 
-	result.key[0x0A] = input.key_z.endedDown;
-	result.key[0x00] = input.key_x.endedDown;
-	result.key[0x0B] = input.key_c.endedDown;
-	result.key[0x0F] = input.key_v.endedDown;
+FILE_SCOPE u64 dchip8_hash_memory_full_internal(const Chip8VM *vm)
+{
+	u64 result = 0;
+	for (u32 i = 0; i < CHIP8_MEMORY_SIZE; i++)
+		result ^= dchip8_hash_memory_byte_internal(i, vm->memory[i]);
 
 	return result;
 }
 
-void dchip8_update(PlatformRenderBuffer renderBuffer, PlatformInput input,
-                   PlatformMemory memory, u32 cyclesToEmulate)
+FILE_SCOPE u64 dchip8_hash_display_full_internal(const Chip8VM *vm)
 {
-	DQNT_ASSERT(cpu.indexRegister >= 0 && cpu.indexRegister <= 0xFFF);
-	DQNT_ASSERT(cpu.programCounter >= 0 && cpu.programCounter <= 0xFFF);
-	DQNT_ASSERT(renderBuffer.bytesPerPixel == 4);
-	DQNT_ASSERT(memory.permanentMemSize == 4096);
+	u64 result = 0;
+	for (i32 row = 0; row < CHIP8_DISPLAY_HEIGHT; row++)
+		result ^= dchip8_hash_display_row_internal(row, vm->display[row]);
 
-	u8 *mainMem                = (u8 *)memory.permanentMem;
-	Chip8Controller controller = dchip8_controller_map_input(input);
+	return result;
+}
 
-	if (input.loadNewRom)
-	{
-		dchip8_init_memory(mainMem, memory.permanentMemSize);
-		dchip8_init_cpu(&cpu);
-		dchip8_init_display(renderBuffer);
+void dchip8_vm_rehash(Chip8VM *vm)
+{
+	vm->memoryHash  = dchip8_hash_memory_full_internal(vm);
+	vm->displayHash = dchip8_hash_display_full_internal(vm);
+}
 
-		PlatformFile file = {};
-		if (platform_open_file(input.rom, &file))
-		{
-			DQNT_ASSERT((INIT_ADDRESS + file.size) <= memory.permanentMemSize);
+FILE_SCOPE void dchip8_init_display(Chip8VM *vm)
+{
+	// Init screen to all pixels off
+	for (i32 row = 0; row < CHIP8_DISPLAY_HEIGHT; row++)
+		dchip8_write_display_row_internal(vm, row, 0);
+}
 
-			void *loadToAddr = (void *)(&mainMem[INIT_ADDRESS]);
-			if (platform_read_file(file, loadToAddr, (u32)file.size))
-			{
-				cpu.state = chip8state_running;
-			}
-			else
-			{
-				cpu.state = chip8state_off;
-			}
-			platform_close_file(&file);
-		}
+void dchip8_vm_init(Chip8VM *vm)
+{
+	dchip8_init_memory(vm->memory, DQNT_ARRAY_COUNT(vm->memory));
+	dchip8_init_cpu(vm);
+	for (i32 row = 0; row < CHIP8_DISPLAY_HEIGHT; row++)
+		vm->display[row] = 0;
+	vm->dirtyPages = 0;
+	dchip8_vm_rehash(vm);
+}
+
+bool dchip8_vm_load_rom(Chip8VM *vm, const u8 *rom, u32 romSize)
+{
+	dchip8_vm_init(vm);
+	if (romSize > CHIP8_MAX_ROM_SIZE) return false;
 
-		input.loadNewRom = false;
+	dchip8_vm_write_memory_block(vm, INIT_ADDRESS, rom, romSize);
+
+	vm->cpu.state = chip8state_running;
+	return true;
+}
+
+Chip8Controller dchip8_controller_from_bitmask(u16 keyMask)
+{
+	Chip8Controller result = {};
+	for (i32 keyVal = 0; keyVal < DQNT_ARRAY_COUNT(result.key); keyVal++)
+		result.key[keyVal] = ((keyMask >> keyVal) & 1);
+
+	return result;
+}
+
+// NOTE: Chip8 Hex Controller to Keyboard Mapping
+// Keypad         Keyboard
+// +-+-+-+-+     +-+-+-+-+
+// |1|2|3|C|     |1|2|3|4|
+// +-+-+-+-+     +-+-+-+-+
+// |4|5|6|D|     |Q|W|E|R|
+// +-+-+-+-+  => +-+-+-+-+
+// |7|8|9|E|     |A|S|D|F|
+// +-+-+-+-+     +-+-+-+-+
+// |A|0|B|F|     |Z|X|C|V|
+// +-+-+-+-+     +-+-+-+-+
+FILE_SCOPE const u8 DEFAULT_KEYMAP[CHIP8_NUM_KEYS] = {
+    key_x, key_1, key_2, key_3, // 0 1 2 3
+    key_q, key_w, key_e, key_a, // 4 5 6 7
+    key_s, key_d, key_z, key_c, // 8 9 A B
+    key_4, key_r, key_f, key_v, // C D E F
+};
+
+Chip8Controller dchip8_controller_map_input(const PlatformInput *input,
+                                            const u8 *keymap)
+{
+	Chip8Controller result = {};
+	for (i32 hexKey = 0; hexKey < CHIP8_NUM_KEYS; hexKey++)
+	{
+		u8 platformKey = keymap[hexKey];
+		if (platformKey < key_count)
+			result.key[hexKey] = input->key[platformKey].endedDown;
+	}
+
+	return result;
+}
+
+const char *dchip8_fault_string(enum Chip8Fault fault)
+{
+	switch (fault)
+	{
+		case chip8fault_none:               return "none";
+		case chip8fault_pc_out_of_bounds:   return "pc_out_of_bounds";
+		case chip8fault_stack_overflow:     return "stack_overflow";
+		case chip8fault_stack_underflow:    return "stack_underflow";
+		case chip8fault_mem_out_of_bounds:  return "mem_out_of_bounds";
+		case chip8fault_invalid_font_digit: return "invalid_font_digit";
+		case chip8fault_invalid_key:        return "invalid_key";
+		case chip8fault_invalid_opcode:     return "invalid_opcode";
+		default:                            return "unknown";
 	}
+}
+
+FILE_SCOPE inline void dchip8_raise_fault_internal(Chip8CPU *cpu,
+                                                   enum Chip8Fault fault,
+                                                   u16 opAddress)
+{
+	cpu->state        = chip8state_fault;
+	cpu->fault        = fault;
+	cpu->faultAddress = opAddress;
+}
+
+FILE_SCOPE inline void dchip8_trace_record_internal(Chip8Trace *trace,
+                                                    const Chip8CPU *cpu,
+                                                    u16 opAddress, u16 opcode)
+{
+	Chip8TraceRecord *record = &trace->records[trace->numTraced & trace->mask];
+	record->pc               = opAddress;
+	record->opcode           = opcode;
+	record->vx               = cpu->registerArray[(opcode >> 8) & 0x0F];
+	record->vf               = cpu->VF;
+	record->I                = cpu->I;
+	trace->numTraced++;
+}
+
+#ifdef _MSC_VER
+	#define DCHIP8_FORCE_INLINE __forceinline
+#else
+	#define DCHIP8_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+// NOTE: Shared by the plain and traced entry points and forced inline into
+// both, so in dchip8_vm_run trace is a constant NULL and the tracing is
+// compiled out entirely.
+FILE_SCOPE DCHIP8_FORCE_INLINE u32 dchip8_vm_run_internal(
+    Chip8VM *vm, Chip8Controller controller, u32 cyclesToEmulate,
+    Chip8Trace *trace)
+{
+	Chip8CPU *cpu = &vm->cpu;
+	u8 *mainMem   = vm->memory;
 
-	if (cpu.state == chip8state_await_input)
+	if (cpu->state == chip8state_await_input)
 	{
 		for (i32 keyVal = 0; keyVal < DQNT_ARRAY_COUNT(controller.key); keyVal++)
 		{
 			if (controller.key[keyVal])
 			{
-				u8 regIndex = cpu.storeKeyToRegisterIndex;
+				u8 regIndex = cpu->storeKeyToRegisterIndex;
 				DQNT_ASSERT(keyVal >= 0 && keyVal <= 0x0F);
 
-				cpu.registerArray[regIndex] = (u8)keyVal;
-				cpu.state                   = chip8state_running;
+				cpu->registerArray[regIndex] = (u8)keyVal;
+				cpu->state                   = chip8state_running;
 				break;
 			}
 		}
 	}
 
-	if (cpu.state == chip8state_running)
+	if (cpu->state != chip8state_running) return 0;
+
+	u32 opCycle = 0;
+	for (; opCycle < cyclesToEmulate && cpu->state == chip8state_running;
+	     opCycle++)
 	{
-		bool earlyExit = false;
-		for (u32 opCycle = 0; opCycle < cyclesToEmulate && !earlyExit;
-		     opCycle++)
+		u16 opAddress = cpu->programCounter;
+		if (opAddress > (CHIP8_MEMORY_SIZE - 2))
+		{
+			dchip8_raise_fault_internal(cpu, chip8fault_pc_out_of_bounds,
+			                            opAddress);
+			if (trace)
+				dchip8_trace_record_internal(trace, cpu, opAddress, 0);
+			break;
+		}
+
+		u8 opHighByte = mainMem[cpu->programCounter++];
+		u8 opLowByte  = mainMem[cpu->programCounter++];
+		u8 opFirstNibble = (opHighByte & 0xF0);
+		switch (opFirstNibble)
 		{
-			u8 opHighByte = mainMem[cpu.programCounter++];
-			u8 opLowByte  = mainMem[cpu.programCounter++];
-			u8 opFirstNibble = (opHighByte & 0xF0);
-			switch (opFirstNibble)
+			case 0x00:
 			{
-				case 0x00:
+				// CLS - 00E0 - Clear the display
+				if (opHighByte == 0x00 && opLowByte == 0xE0)
 				{
-					// CLS - 00E0 - Clear the display
-					if (opLowByte == 0xE0)
-					{
-						dchip8_init_display(renderBuffer);
-					}
-					// RET - 00EE - Return from subroutine
-					else if (opLowByte == 0xEE)
+					dchip8_init_display(vm);
+				}
+				// RET - 00EE - Return from subroutine
+				else if (opHighByte == 0x00 && opLowByte == 0xEE)
+				{
+					if (cpu->stackPointer == 0)
 					{
-						cpu.programCounter = cpu.stack[--cpu.stackPointer];
+						dchip8_raise_fault_internal(
+						    cpu, chip8fault_stack_underflow, opAddress);
+						break;
 					}
+					cpu->programCounter = cpu->stack[--cpu->stackPointer];
 				}
-				break;
+				// NOTE: SYS addr - 0nnn - Jump to a machine code routine at
+				// nnn, ignored by modern interpreters
+			}
+			break;
 
-				case 0x10:
-				case 0x20:
-				{
-					u16 loc = ((0x0F & opHighByte) << 8) | opLowByte;
-					DQNT_ASSERT(loc <= 0x0FFF);
+			case 0x10:
+			case 0x20:
+			{
+				u16 loc = ((0x0F & opHighByte) << 8) | opLowByte;
+				DQNT_ASSERT(loc <= 0x0FFF);
 
-					// JP addr - 1nnn - Jump to location nnn
-					if (opFirstNibble == 0x10)
-					{
-						// NOTE: Jump to loc, as per below
-					}
-					// Call addr - 2nnn - Call subroutine at nnn
-					else
+				// JP addr - 1nnn - Jump to location nnn
+				if (opFirstNibble == 0x10)
+				{
+					// NOTE: Jump to loc, as per below
+				}
+				// Call addr - 2nnn - Call subroutine at nnn
+				else
+				{
+					DQNT_ASSERT(opFirstNibble == 0x20);
+					if (cpu->stackPointer >= DQNT_ARRAY_COUNT(cpu->stack))
 					{
-						DQNT_ASSERT(opFirstNibble == 0x20);
-						cpu.stack[cpu.stackPointer++] = cpu.programCounter;
-						DQNT_ASSERT(cpu.stackPointer <
-						            DQNT_ARRAY_COUNT(cpu.stack));
+						dchip8_raise_fault_internal(
+						    cpu, chip8fault_stack_overflow, opAddress);
+						break;
 					}
-
-					cpu.programCounter = loc;
+					cpu->stack[cpu->stackPointer++] = cpu->programCounter;
 				}
-				break;
 
-				case 0x30:
-				case 0x40:
-				{
-					u8 regNum = (0x0F & opHighByte);
-					DQNT_ASSERT(regNum < DQNT_ARRAY_COUNT(cpu.registerArray));
-					u8 *vx = &cpu.registerArray[regNum];
+				cpu->programCounter = loc;
+			}
+			break;
 
-					u8 valToCheck = opLowByte;
+			case 0x30:
+			case 0x40:
+			{
+				u8 regNum = (0x0F & opHighByte);
+				DQNT_ASSERT(regNum < DQNT_ARRAY_COUNT(cpu->registerArray));
+				u8 *vx = &cpu->registerArray[regNum];
 
-					// SE Vx, byte - 3xkk - Skip next instruction if Vx == kk
-					if (opFirstNibble == 0x30)
-					{
-						if (*vx == valToCheck) cpu.programCounter += 2;
-					}
-					// SNE Vx, byte - 4xkk - Skip next instruction if Vx == kk
-					else
-					{
-						DQNT_ASSERT(opFirstNibble == 0x40);
-						if (*vx != valToCheck) cpu.programCounter += 2;
-					}
-				}
-				break;
+				u8 valToCheck = opLowByte;
 
-				// SE Vx, Vy - 5xy0 - Skip next instruction if Vx = Vy
-				case 0x50:
+				// SE Vx, byte - 3xkk - Skip next instruction if Vx == kk
+				if (opFirstNibble == 0x30)
+				{
+					if (*vx == valToCheck) cpu->programCounter += 2;
+				}
+				// SNE Vx, byte - 4xkk - Skip next instruction if Vx != kk
+				else
 				{
-					u8 firstRegNum = (0x0F & opHighByte);
-					DQNT_ASSERT(firstRegNum <
-					            DQNT_ARRAY_COUNT(cpu.registerArray));
+					DQNT_ASSERT(opFirstNibble == 0x40);
+					if (*vx != valToCheck) cpu->programCounter += 2;
+				}
+			}
+			break;
 
-					u8 secondRegNum = (0xF0 & opLowByte) >> 4;
-					DQNT_ASSERT(secondRegNum <
-					            DQNT_ARRAY_COUNT(cpu.registerArray));
+			// SE Vx, Vy - 5xy0 - Skip next instruction if Vx = Vy
+			case 0x50:
+			{
+				u8 firstRegNum = (0x0F & opHighByte);
+				DQNT_ASSERT(firstRegNum <
+				            DQNT_ARRAY_COUNT(cpu->registerArray));
 
-					u8 *vx = &cpu.registerArray[firstRegNum];
-					u8 *vy = &cpu.registerArray[secondRegNum];
+				u8 secondRegNum = (0xF0 & opLowByte) >> 4;
+				DQNT_ASSERT(secondRegNum <
+				            DQNT_ARRAY_COUNT(cpu->registerArray));
 
-					if (*vx == *vy) cpu.programCounter += 2;
-				}
-				break;
+				u8 *vx = &cpu->registerArray[firstRegNum];
+				u8 *vy = &cpu->registerArray[secondRegNum];
 
-				case 0x60:
-				case 0x70:
-				{
-					u8 regNum = (0x0F & opHighByte);
-					DQNT_ASSERT(regNum < DQNT_ARRAY_COUNT(cpu.registerArray));
-					u8 valToOperateOn = opLowByte;
+				if (*vx == *vy) cpu->programCounter += 2;
+			}
+			break;
 
-					u8 *vx = &cpu.registerArray[regNum];
-					// LD Vx, byte - 6xkk - Set Vx = kk
-					if (opFirstNibble == 0x60)
-					{
-						*vx = valToOperateOn;
-					}
-					// ADD Vx, byte - 7xkk - Set Vx = Vx + kk
-					else
-					{
-						DQNT_ASSERT(opFirstNibble == 0x70);
-						*vx += valToOperateOn;
-					}
-				}
-				break;
+			case 0x60:
+			case 0x70:
+			{
+				u8 regNum = (0x0F & opHighByte);
+				DQNT_ASSERT(regNum < DQNT_ARRAY_COUNT(cpu->registerArray));
+				u8 valToOperateOn = opLowByte;
 
-				case 0x80:
+				u8 *vx = &cpu->registerArray[regNum];
+				// LD Vx, byte - 6xkk - Set Vx = kk
+				if (opFirstNibble == 0x60)
+				{
+					*vx = valToOperateOn;
+				}
+				// ADD Vx, byte - 7xkk - Set Vx = Vx + kk
+				else
 				{
-					u8 firstRegNum = (0x0F & opHighByte);
-					DQNT_ASSERT(firstRegNum <
-					            DQNT_ARRAY_COUNT(cpu.registerArray));
+					DQNT_ASSERT(opFirstNibble == 0x70);
+					*vx += valToOperateOn;
+				}
+			}
+			break;
 
-					u8 secondRegNum = (0xF0 & opLowByte) >> 4;
-					DQNT_ASSERT(secondRegNum <
-					            DQNT_ARRAY_COUNT(cpu.registerArray));
+			case 0x80:
+			{
+				u8 firstRegNum = (0x0F & opHighByte);
+				DQNT_ASSERT(firstRegNum <
+				            DQNT_ARRAY_COUNT(cpu->registerArray));
 
-					u8 *vx = &cpu.registerArray[firstRegNum];
-					u8 *vy = &cpu.registerArray[secondRegNum];
+				u8 secondRegNum = (0xF0 & opLowByte) >> 4;
+				DQNT_ASSERT(secondRegNum <
+				            DQNT_ARRAY_COUNT(cpu->registerArray));
 
-					u8 opFourthNibble = (opLowByte & 0x0F);
-					// LD Vx, Vy - 8xy0 - Set Vx = Vy
-					if (opFourthNibble == 0x00)
-					{
-						*vx = *vy;
-					}
-					// OR Vx, Vy - 8xy1 - Set Vx = Vx OR Vy
-					else if (opFourthNibble == 0x01)
-					{
-						u8 result = (*vx | *vy);
-						*vx       = result;
-					}
-					// AND Vx, Vy - 8xy2 - Set Vx = Vx AND Vy
-					else if (opFourthNibble == 0x02)
-					{
-						u8 result = (*vx & *vy);
-						*vx       = result;
-					}
-					// XOR Vx, Vy - 8xy3 - Set Vx = Vx XOR Vy
-					else if (opFourthNibble == 0x03)
-					{
-						u8 result = (*vx ^ *vy);
-						*vx       = result;
-					}
-					// ADD Vx, Vy - 8xy4 - Set Vx = Vx + Vy, set VF = carry
-					else if (opFourthNibble == 0x04)
-					{
-						u16 result = (*vx + *vy);
-						*vx = (result > 255) ? (u8)(result - 256) : (u8)result;
+				u8 *vx = &cpu->registerArray[firstRegNum];
+				u8 *vy = &cpu->registerArray[secondRegNum];
 
-						cpu.VF = (result > 255) ? 1 : 0;
-					}
-					// SUB Vx, Vy - 8xy5 - Set Vx = Vx - Vy, set VF = NOT borrow
-					else if (opFourthNibble == 0x05)
-					{
-						if (*vx > *vy)
-						{
-							cpu.VF = 1;
-							*vx -= *vy;
-						}
-						else
-						{
-							cpu.VF = 0;
-							*vx    = (u8)(256 + *vx - *vy);
-						}
-					}
-					// SHR Vx {, Vy} - 8xy6 - Set Vx = Vx SHR 1
-					else if (opFourthNibble == 0x06)
-					{
-						if (*vx & 1)
-							cpu.VF = 1;
-						else
-							cpu.VF = 0;
+				u8 opFourthNibble = (opLowByte & 0x0F);
+				// LD Vx, Vy - 8xy0 - Set Vx = Vy
+				if (opFourthNibble == 0x00)
+				{
+					*vx = *vy;
+				}
+				// OR Vx, Vy - 8xy1 - Set Vx = Vx OR Vy
+				else if (opFourthNibble == 0x01)
+				{
+					u8 result = (*vx | *vy);
+					*vx       = result;
+					if (cpu->quirks & chip8quirk_logic_vf_reset) cpu->VF = 0;
+				}
+				// AND Vx, Vy - 8xy2 - Set Vx = Vx AND Vy
+				else if (opFourthNibble == 0x02)
+				{
+					u8 result = (*vx & *vy);
+					*vx       = result;
+					if (cpu->quirks & chip8quirk_logic_vf_reset) cpu->VF = 0;
+				}
+				// XOR Vx, Vy - 8xy3 - Set Vx = Vx XOR Vy
+				else if (opFourthNibble == 0x03)
+				{
+					u8 result = (*vx ^ *vy);
+					*vx       = result;
+					if (cpu->quirks & chip8quirk_logic_vf_reset) cpu->VF = 0;
+				}
+				// ADD Vx, Vy - 8xy4 - Set Vx = Vx + Vy, set VF = carry
+				else if (opFourthNibble == 0x04)
+				{
+					u16 result = (*vx + *vy);
+					*vx = (result > 255) ? (u8)(result - 256) : (u8)result;
 
-						*vx >>= 1;
-					}
-					// SUBN Vx {, Vy} - 8xy7 - Set Vx = Vy - Vx, set VF = NOT
-					// borrow
-					else if (opFourthNibble == 0x07)
+					cpu->VF = (result > 255) ? 1 : 0;
+				}
+				// SUB Vx, Vy - 8xy5 - Set Vx = Vx - Vy, set VF = NOT borrow
+				else if (opFourthNibble == 0x05)
+				{
+					if (*vx > *vy)
 					{
-						if (*vy > *vx)
-						{
-							cpu.VF = 1;
-							*vx    = *vy - *vx;
-						}
-						else
-						{
-							cpu.VF = 0;
-							*vx    = (u8)(256 + *vy - *vx);
-						}
+						cpu->VF = 1;
+						*vx -= *vy;
 					}
-					// SHL Vx {, Vy} - 8xyE - Set Vx = SHL 1
 					else
 					{
-						DQNT_ASSERT(opFourthNibble == 0x0E);
-						if ((*vx >> 7) == 1)
-							cpu.VF = 1;
-						else
-							cpu.VF = 0;
-
-						*vx <<= 1;
+						cpu->VF = 0;
+						*vx     = (u8)(256 + *vx - *vy);
 					}
 				}
-				break;
-
-				// SNE Vx, Vy - 9xy0 - Skip next instruction if Vx != Vy
-				case 0x90:
+				// SHR Vx {, Vy} - 8xy6 - Set Vx = Vx SHR 1
+				else if (opFourthNibble == 0x06)
 				{
-					u8 firstRegNum = (0x0F & opHighByte);
-					DQNT_ASSERT(firstRegNum <
-					            DQNT_ARRAY_COUNT(cpu.registerArray));
-
-					u8 secondRegNum = (0xF0 & opLowByte) >> 4;
-					DQNT_ASSERT(secondRegNum <
-					            DQNT_ARRAY_COUNT(cpu.registerArray));
-
-					u8 *vx = &cpu.registerArray[firstRegNum];
-					u8 *vy = &cpu.registerArray[secondRegNum];
-
-					if (*vx != *vy) cpu.programCounter += 2;
-				}
-				break;
+					u8 *src = (cpu->quirks & chip8quirk_shift_vy) ? vy : vx;
+					if (*src & 1)
+						cpu->VF = 1;
+					else
+						cpu->VF = 0;
 
-				// LD I, addr - Annn - Set I = nnn
-				case 0xA0:
-				{
-					u16 valToSet      = ((0x0F & opHighByte) << 8) | opLowByte;
-					cpu.indexRegister = valToSet;
+					*vx = (*src >> 1);
 				}
-				break;
-
-				// JP V0, addr - Bnnn - Jump to location (nnn + V0)
-				case 0xB0:
+				// SUBN Vx {, Vy} - 8xy7 - Set Vx = Vy - Vx, set VF = NOT
+				// borrow
+				else if (opFourthNibble == 0x07)
 				{
-					u16 addr =
-					    (((0x0F & opHighByte) << 8) | opLowByte) + cpu.V0;
-					cpu.programCounter = addr;
+					if (*vy > *vx)
+					{
+						cpu->VF = 1;
+						*vx     = *vy - *vx;
+					}
+					else
+					{
+						cpu->VF = 0;
+						*vx     = (u8)(256 + *vy - *vx);
+					}
 				}
-				break;
-
-				// RND Vx, byte - Cxkk - Set Vx = random byte AND kk
-				case 0xC0:
+				// SHL Vx {, Vy} - 8xyE - Set Vx = SHL 1
+				else if (opFourthNibble == 0x0E)
 				{
-					u8 regNum = (0x0F & opHighByte);
-					DQNT_ASSERT(regNum < DQNT_ARRAY_COUNT(cpu.registerArray));
-					u8 *vx = &cpu.registerArray[regNum];
-
-					u8 randNum = (u8)dqnt_rnd_pcg_range(&pcgState, 0, 255);
-					u8 andBits = opLowByte;
-					DQNT_ASSERT(randNum >= 0 && randNum <= 255);
+					u8 *src = (cpu->quirks & chip8quirk_shift_vy) ? vy : vx;
+					if ((*src >> 7) == 1)
+						cpu->VF = 1;
+					else
+						cpu->VF = 0;
 
-					*vx = (randNum & andBits);
+					*vx = (u8)(*src << 1);
 				}
-				break;
-
-				// DRW Vx, Vy, nibble - Dxyn - Display n-byte sprite starting at
-				// mem
-				// location I at (Vx, Vy), set VF = collision
-				case 0xD0:
+				else
 				{
-					u8 xRegister = (0x0F & opHighByte);
-					u8 yRegister = (0xF0 & opLowByte) >> 4;
-					DQNT_ASSERT(
-					    xRegister < DQNT_ARRAY_COUNT(cpu.registerArray) &&
-					    yRegister < DQNT_ARRAY_COUNT(cpu.registerArray));
+					dchip8_raise_fault_internal(cpu, chip8fault_invalid_opcode,
+					                            opAddress);
+				}
+			}
+			break;
 
-					u8 initPosX = cpu.registerArray[xRegister];
-					u8 initPosY = cpu.registerArray[yRegister];
+			// SNE Vx, Vy - 9xy0 - Skip next instruction if Vx != Vy
+			case 0x90:
+			{
+				u8 firstRegNum = (0x0F & opHighByte);
+				DQNT_ASSERT(firstRegNum <
+				            DQNT_ARRAY_COUNT(cpu->registerArray));
 
-					u8 readNumBytesFromMem = (0x0F & opLowByte);
-					// NOTE: can't be more than 16 in Y according to specs.
-					DQNT_ASSERT(readNumBytesFromMem < 16);
+				u8 secondRegNum = (0xF0 & opLowByte) >> 4;
+				DQNT_ASSERT(secondRegNum <
+				            DQNT_ARRAY_COUNT(cpu->registerArray));
 
-					u8 *renderBitmap          = (u8 *)renderBuffer.memory;
-					const i32 BYTES_PER_PIXEL = renderBuffer.bytesPerPixel;
-					i32 pitch = renderBuffer.width * BYTES_PER_PIXEL;
+				u8 *vx = &cpu->registerArray[firstRegNum];
+				u8 *vy = &cpu->registerArray[secondRegNum];
 
-					bool collisionFlag = false;
-					for (i32 i = 0; i < readNumBytesFromMem; i++)
-					{
-						u8 spriteBytes = mainMem[cpu.indexRegister + i];
-						u8 posY        = initPosY + (u8)i;
-						if (posY >= renderBuffer.height) posY = 0;
+				if (*vx != *vy) cpu->programCounter += 2;
+			}
+			break;
 
-						// NOTE: Flip the Y
-						posY = ((u8)(renderBuffer.height - 1) - posY);
+			// LD I, addr - Annn - Set I = nnn
+			case 0xA0:
+			{
+				u16 valToSet       = ((0x0F & opHighByte) << 8) | opLowByte;
+				cpu->indexRegister = valToSet;
+			}
+			break;
 
-						const i32 ALPHA_BYTE_INTERVAL =
-						    renderBuffer.bytesPerPixel;
-						const i32 BITS_IN_BYTE = 8;
-						i32 baseBitShift       = BITS_IN_BYTE - 1;
-						for (i32 shift = 0; shift < BITS_IN_BYTE; shift++)
-						{
-							u8 posX = initPosX + (u8)shift;
+			// JP V0, addr - Bnnn - Jump to location (nnn + V0)
+			case 0xB0:
+			{
+				u8 offsetRegNum = 0;
+				if (cpu->quirks & chip8quirk_jump_vx)
+					offsetRegNum = (0x0F & opHighByte);
 
-							if (posX >= renderBuffer.width) posX = 0;
-							u32 bitmapOffset =
-							    (posX * BYTES_PER_PIXEL) + (posY * pitch);
+				u16 addr = (((0x0F & opHighByte) << 8) | opLowByte) +
+				           cpu->registerArray[offsetRegNum];
+				cpu->programCounter = addr;
+			}
+			break;
 
-							// NOTE: Since we are using a 4bpp bitmap, let's use
-							// the
-							// alpha channel to determine if a pixel is on or
-							// not.
-							u32 *pixel  = (u32 *)(&renderBitmap[bitmapOffset]);
-							u8 alphaBit = (*pixel >> 24);
+			// RND Vx, byte - Cxkk - Set Vx = random byte AND kk
+			case 0xC0:
+			{
+				u8 regNum = (0x0F & opHighByte);
+				DQNT_ASSERT(regNum < DQNT_ARRAY_COUNT(cpu->registerArray));
+				u8 *vx = &cpu->registerArray[regNum];
 
-							DQNT_ASSERT(alphaBit == 0 || alphaBit == 255);
-							bool pixelWasOn = (alphaBit == 255) ? true : false;
+				u8 randNum = (u8)dqnt_rnd_pcg_range(&vm->pcgState, 0, 255);
+				u8 andBits = opLowByte;
+				DQNT_ASSERT(randNum >= 0 && randNum <= 255);
 
-							i32 bitShift   = baseBitShift - shift;
-							bool spriteBit = ((spriteBytes >> bitShift) & 1);
-							bool pixelIsOn = (pixelWasOn ^ spriteBit);
-
-							// NOTE: If caused a pixel to XOR into off, then
-							// this is
-							// known as a "collision" in chip8
-							if (pixelWasOn && !pixelIsOn) collisionFlag = true;
-
-							if (pixelIsOn)
-							{
-								*pixel = 0xFFFFFFFF;
-							}
-							else
-							{
-								*pixel = 0;
-							}
-						}
-					}
+				*vx = (randNum & andBits);
+			}
+			break;
 
-					cpu.VF = collisionFlag;
+			// DRW Vx, Vy, nibble - Dxyn - Display n-byte sprite starting at
+			// mem location I at (Vx, Vy), set VF = collision
+			case 0xD0:
+			{
+				u8 xRegister = (0x0F & opHighByte);
+				u8 yRegister = (0xF0 & opLowByte) >> 4;
+				DQNT_ASSERT(
+				    xRegister < DQNT_ARRAY_COUNT(cpu->registerArray) &&
+				    yRegister < DQNT_ARRAY_COUNT(cpu->registerArray));
+
+				u8 initPosX = cpu->registerArray[xRegister];
+				u8 initPosY = cpu->registerArray[yRegister];
+				bool clip   = (cpu->quirks & chip8quirk_clip_sprites) != 0;
+				if (clip)
+				{
+					// NOTE: When clipping the origin still wraps, only the
+					// pixels hanging off the edge are dropped
+					initPosX %= CHIP8_DISPLAY_WIDTH;
+					initPosY %= CHIP8_DISPLAY_HEIGHT;
 				}
-				break;
 
-				case 0xE0:
+				u8 readNumBytesFromMem = (0x0F & opLowByte);
+				// NOTE: can't be more than 16 in Y according to specs.
+				DQNT_ASSERT(readNumBytesFromMem < 16);
+				if ((u32)(cpu->indexRegister + readNumBytesFromMem) >
+				    CHIP8_MEMORY_SIZE)
 				{
-					u8 regNum = (0x0F & opHighByte);
-					DQNT_ASSERT(regNum < DQNT_ARRAY_COUNT(cpu.registerArray));
-					u8 vx = cpu.registerArray[regNum];
-					DQNT_ASSERT(vx >= 0 && vx <= 0x0F);
-					DQNT_ASSERT(vx < DQNT_ARRAY_COUNT(controller.key));
-
-					bool skipNextInstruction = false;
-					// SKP Vx - Ex9E - Skip next instruction if key with the
-					// value
-					// of Vx is pressed
-					if (opLowByte == 0x9E)
-					{
-						skipNextInstruction = controller.key[vx];
-					}
-					// SKNP Vx - ExA1 - Skip next instruction if key with the
-					// value
-					// of Vx is not pressed
-					else
-					{
-						DQNT_ASSERT(opLowByte == 0xA1);
-						skipNextInstruction = !controller.key[vx];
-					}
-
-					if (skipNextInstruction) cpu.programCounter += 2;
+					dchip8_raise_fault_internal(
+					    cpu, chip8fault_mem_out_of_bounds, opAddress);
+					break;
 				}
-				break;
 
-				case 0xF0:
+				const i32 BITS_IN_BYTE = 8;
+				bool collisionFlag     = false;
+				for (i32 i = 0; i < readNumBytesFromMem; i++)
 				{
-					u8 regNum = (0x0F & opHighByte);
-					DQNT_ASSERT(regNum < DQNT_ARRAY_COUNT(cpu.registerArray));
-					u8 *vx = &cpu.registerArray[regNum];
-
-					// LD Vx, DT - Fx07 - Set Vx = delay timer value
-					if (opLowByte == 0x07)
-					{
-						*vx = cpu.delayTimer;
-					}
-					// LD Vx, K - Fx0A - Wait for a key press, store the value
-					// of
-					// the key in Vx
-					else if (opLowByte == 0x0A)
+					u8 spriteBytes = mainMem[cpu->indexRegister + i];
+					u8 posY        = initPosY + (u8)i;
+					if (posY >= CHIP8_DISPLAY_HEIGHT)
 					{
-						cpu.state                   = chip8state_await_input;
-						cpu.storeKeyToRegisterIndex = regNum;
-						earlyExit = true;
+						if (clip) break;
+						posY = 0;
 					}
-					// LD DT, Vx - Fx15 - Set delay timer = Vx
-					else if (opLowByte == 0x15)
-					{
-						cpu.delayTimer = *vx;
-					}
-					// LD ST, Vx - Fx18 - Set sound timer = Vx
-					else if (opLowByte == 0x18)
-					{
-						cpu.soundTimer = *vx;
-					}
-					// ADD I, Vx - Fx1E - Set I = I + Vx
-					else if (opLowByte == 0x1E)
+
+					u64 row = vm->display[posY];
+					if (initPosX <= (CHIP8_DISPLAY_WIDTH - BITS_IN_BYTE))
 					{
-						cpu.indexRegister += *vx;
+						i32 rowShift =
+						    (CHIP8_DISPLAY_WIDTH - BITS_IN_BYTE) - initPosX;
+						u64 spriteRow = ((u64)spriteBytes << rowShift);
+
+						// NOTE: If caused a pixel to XOR into off, then this
+						// is known as a "collision" in chip8
+						if (row & spriteRow) collisionFlag = true;
+						row ^= spriteRow;
 					}
-					// LD F, Vx - Fx29 - Set I = location of sprite for digit Vx
-					else if (opLowByte == 0x29)
+					else if (clip)
 					{
-						u8 hexCharFromFontSet = *vx;
-						DQNT_ASSERT(hexCharFromFontSet >= 0x00 &&
-						            hexCharFromFontSet <= 0x0F);
-
-						const u32 START_ADDR_OF_FONT = 0;
-						const u32 BYTES_PER_FONT     = 5;
+						i32 rowShift =
+						    initPosX - (CHIP8_DISPLAY_WIDTH - BITS_IN_BYTE);
+						u64 spriteRow = ((u64)spriteBytes >> rowShift);
 
-						cpu.I = START_ADDR_OF_FONT +
-						        (hexCharFromFontSet * BYTES_PER_FONT);
+						if (row & spriteRow) collisionFlag = true;
+						row ^= spriteRow;
 					}
-					// LD B, Vx - Fx33 - Store BCD representations of Vx in
-					// memory
-					// locations I, I+1 and I+2
-					else if (opLowByte == 0x33)
+					else
 					{
-						DQNT_ASSERT(regNum <
-						            DQNT_ARRAY_COUNT(cpu.registerArray));
-						u8 vxVal = *vx;
-
-						const i32 NUM_DIGITS_IN_HUNDREDS = 3;
-						for (i32 i = 0; i < NUM_DIGITS_IN_HUNDREDS; i++)
+						// NOTE: Pixels past the right edge wrap to the first
+						// column one at a time, so they may toggle the same
+						// pixel more than once.
+						i32 baseBitShift = BITS_IN_BYTE - 1;
+						for (i32 shift = 0; shift < BITS_IN_BYTE; shift++)
 						{
-							u8 rem = vxVal % 10;
-							vxVal /= 10;
+							u8 posX = initPosX + (u8)shift;
+							if (posX >= CHIP8_DISPLAY_WIDTH) posX = 0;
+
+							i32 bitShift   = baseBitShift - shift;
+							bool spriteBit = ((spriteBytes >> bitShift) & 1);
+							if (!spriteBit) continue;
 
-							mainMem[cpu.I +
-							        ((NUM_DIGITS_IN_HUNDREDS - 1) - i)] = rem;
+							u64 pixel = (1ULL << ((CHIP8_DISPLAY_WIDTH - 1) - posX));
+							if (row & pixel) collisionFlag = true;
+							row ^= pixel;
 						}
 					}
-					// LD [I], Vx - Fx55 - Store register V0 through Vx in
-					// memory
-					// starting at location I.
-					else if (opLowByte == 0x55)
-					{
-						for (u32 regIndex = 0; regIndex <= regNum; regIndex++)
-						{
-							u32 mem_offset = regIndex;
-							mainMem[cpu.indexRegister + mem_offset] =
-							    cpu.registerArray[regIndex];
-						}
+
+					if (spriteBytes) dchip8_write_display_row_internal(vm, posY, row);
+				}
+
+				cpu->VF = collisionFlag;
+			}
+			break;
+
+			case 0xE0:
+			{
+				u8 regNum = (0x0F & opHighByte);
+				DQNT_ASSERT(regNum < DQNT_ARRAY_COUNT(cpu->registerArray));
+				u8 vx = cpu->registerArray[regNum];
+				if (vx >= DQNT_ARRAY_COUNT(controller.key))
+				{
+					dchip8_raise_fault_internal(cpu, chip8fault_invalid_key,
+					                            opAddress);
+					break;
+				}
+
+				bool skipNextInstruction = false;
+				// SKP Vx - Ex9E - Skip next instruction if key with the value
+				// of Vx is pressed
+				if (opLowByte == 0x9E)
+				{
+					skipNextInstruction = controller.key[vx];
+				}
+				// SKNP Vx - ExA1 - Skip next instruction if key with the value
+				// of Vx is not pressed
+				else if (opLowByte == 0xA1)
+				{
+					skipNextInstruction = !controller.key[vx];
+				}
+				else
+				{
+					dchip8_raise_fault_internal(cpu, chip8fault_invalid_opcode,
+					                            opAddress);
+					break;
+				}
+
+				if (skipNextInstruction) cpu->programCounter += 2;
+			}
+			break;
+
+			case 0xF0:
+			{
+				u8 regNum = (0x0F & opHighByte);
+				DQNT_ASSERT(regNum < DQNT_ARRAY_COUNT(cpu->registerArray));
+				u8 *vx = &cpu->registerArray[regNum];
+
+				// LD Vx, DT - Fx07 - Set Vx = delay timer value
+				if (opLowByte == 0x07)
+				{
+					*vx = cpu->delayTimer;
+				}
+				// LD Vx, K - Fx0A - Wait for a key press, store the value of
+				// the key in Vx
+				else if (opLowByte == 0x0A)
+				{
+					cpu->state                   = chip8state_await_input;
+					cpu->storeKeyToRegisterIndex = regNum;
+				}
+				// LD DT, Vx - Fx15 - Set delay timer = Vx
+				else if (opLowByte == 0x15)
+				{
+					cpu->delayTimer = *vx;
+				}
+				// LD ST, Vx - Fx18 - Set sound timer = Vx
+				else if (opLowByte == 0x18)
+				{
+					cpu->soundTimer = *vx;
+				}
+				// ADD I, Vx - Fx1E - Set I = I + Vx
+				else if (opLowByte == 0x1E)
+				{
+					cpu->indexRegister += *vx;
+				}
+				// LD F, Vx - Fx29 - Set I = location of sprite for digit Vx
+				else if (opLowByte == 0x29)
+				{
+					u8 hexCharFromFontSet = *vx;
+					if (hexCharFromFontSet > 0x0F)
+					{
+						dchip8_raise_fault_internal(
+						    cpu, chip8fault_invalid_font_digit, opAddress);
+						break;
 					}
-					// LD [I], Vx - Fx65 - Read registers V0 through Vx from
-					// memory
-					// starting at location I.
-					else
+
+					const u32 START_ADDR_OF_FONT = 0;
+					const u32 BYTES_PER_FONT     = 5;
+
+					cpu->I = START_ADDR_OF_FONT +
+					         (hexCharFromFontSet * BYTES_PER_FONT);
+				}
+				// LD B, Vx - Fx33 - Store BCD representations of Vx in memory
+				// locations I, I+1 and I+2
+				else if (opLowByte == 0x33)
+				{
+					const i32 NUM_DIGITS_IN_HUNDREDS = 3;
+					if ((u32)(cpu->I + NUM_DIGITS_IN_HUNDREDS) >
+					    CHIP8_MEMORY_SIZE)
 					{
-						DQNT_ASSERT(opLowByte == 0x65);
-						for (u32 regIndex = 0; regIndex <= regNum; regIndex++)
-						{
-							u32 mem_offset = regIndex;
-							cpu.registerArray[regIndex] =
-							    mainMem[cpu.indexRegister + mem_offset];
-						}
+						dchip8_raise_fault_internal(
+						    cpu, chip8fault_mem_out_of_bounds, opAddress);
+						break;
+					}
+
+					u8 vxVal = *vx;
+					for (i32 i = 0; i < NUM_DIGITS_IN_HUNDREDS; i++)
+					{
+						u8 rem = vxVal % 10;
+						vxVal /= 10;
+
+						dchip8_write_memory_internal(
+						    vm, cpu->I + ((NUM_DIGITS_IN_HUNDREDS - 1) - i), rem);
 					}
 				}
-				break;
-			};
+				// LD [I], Vx - Fx55 - Store register V0 through Vx in memory
+				// starting at location I.
+				// LD Vx, [I] - Fx65 - Read registers V0 through Vx from memory
+				// starting at location I.
+				else if (opLowByte == 0x55 || opLowByte == 0x65)
+				{
+					if ((u32)(cpu->indexRegister + regNum) >=
+					    CHIP8_MEMORY_SIZE)
+					{
+						dchip8_raise_fault_internal(
+						    cpu, chip8fault_mem_out_of_bounds, opAddress);
+						break;
+					}
+
+					for (u32 regIndex = 0; regIndex <= regNum; regIndex++)
+					{
+						u32 memOffset = cpu->indexRegister + regIndex;
+						if (opLowByte == 0x55)
+							dchip8_write_memory_internal(
+							    vm, memOffset, cpu->registerArray[regIndex]);
+						else
+							cpu->registerArray[regIndex] = mainMem[memOffset];
+					}
+
+					if (cpu->quirks & chip8quirk_load_store_inc_i)
+						cpu->indexRegister += (regNum + 1);
+				}
+				else
+				{
+					dchip8_raise_fault_internal(cpu, chip8fault_invalid_opcode,
+					                            opAddress);
+				}
+			}
+			break;
+		};
+
+		if (trace)
+		{
+			u16 opcode = (u16)((opHighByte << 8) | opLowByte);
+			dchip8_trace_record_internal(trace, cpu, opAddress, opcode);
+		}
+	}
+
+	return opCycle;
+}
+
+u32 dchip8_vm_run(Chip8VM *vm, Chip8Controller controller, u32 cyclesToEmulate)
+{
+	u32 result = dchip8_vm_run_internal(vm, controller, cyclesToEmulate, NULL);
+	return result;
+}
+
+u32 dchip8_vm_run_traced(Chip8VM *vm, Chip8Controller controller,
+                         u32 cyclesToEmulate, Chip8Trace *trace)
+{
+	u32 result = dchip8_vm_run_internal(vm, controller, cyclesToEmulate, trace);
+	return result;
+}
+
+void dchip8_vm_tick_timers(Chip8VM *vm)
+{
+	Chip8CPU *cpu = &vm->cpu;
+	if (cpu->delayTimer > 0) cpu->delayTimer--;
+
+	if (cpu->soundTimer > 0)
+	{
+		cpu->soundTimer--;
+		if (cpu->soundTimer == 1)
+		{
+			// TODO(doyle): This needs to play a buzzing sound
+			// whilst timer > 0
+		}
+	}
+}
+
+u32 dchip8_vm_update_timers(Chip8VM *vm, f32 deltaForFrame)
+{
+	// IMPORTANT: Timers need to be decremented at a rate of 60hz. Since we
+	// can run the interpreter faster than that, make sure we decrement
+	// timers at the fixed rate.
+	u32 result    = 0;
+	Chip8CPU *cpu = &vm->cpu;
+	if (cpu->delayTimer > 0 || cpu->soundTimer > 0)
+	{
+		cpu->elapsedTime += deltaForFrame;
+		f32 TIMER_DECREMENT_INTERVAL = 1 / 60.0f;
+
+		if (cpu->elapsedTime >= TIMER_DECREMENT_INTERVAL)
+		{
+			cpu->elapsedTime = 0;
+			dchip8_vm_tick_timers(vm);
+			result = 1;
 		}
+	}
+	else
+	{
+		cpu->elapsedTime = 0;
+	}
+
+	return result;
+}
+
+FILE_SCOPE inline u64 dchip8_hash_mix_internal(u64 hash, u64 value)
+{
+	hash ^= value;
+	hash *= 0x9E3779B97F4A7C15ULL;
+	hash ^= (hash >> 29);
+	return hash;
+}
+
+// NOTE: The cpu is a fixed ~60 bytes so it is hashed on demand, keeping an
+// incremental hash for it would cost a few instructions on every ALU op.
+FILE_SCOPE u64 dchip8_hash_combine_internal(const Chip8VM *vm, u64 memoryHash,
+                                            u64 displayHash)
+{
+	const Chip8CPU *cpu = &vm->cpu;
+	u64 result          = 0xCBF29CE484222325ULL;
+
+	for (i32 i = 0; i < DQNT_ARRAY_COUNT(cpu->registerArray); i += 8)
+	{
+		u64 word;
+		memcpy(&word, &cpu->registerArray[i], sizeof(word));
+		result = dchip8_hash_mix_internal(result, word);
+	}
+
+	for (i32 i = 0; i < DQNT_ARRAY_COUNT(cpu->stack); i += 4)
+	{
+		u64 word;
+		memcpy(&word, &cpu->stack[i], sizeof(word));
+		result = dchip8_hash_mix_internal(result, word);
+	}
+
+	u64 control = ((u64)cpu->I << 48) | ((u64)cpu->programCounter << 32) |
+	              ((u64)cpu->stackPointer << 24) | ((u64)cpu->delayTimer << 16) |
+	              ((u64)cpu->soundTimer << 8) | cpu->storeKeyToRegisterIndex;
+	u64 status = ((u64)cpu->quirks << 40) | ((u64)cpu->state << 32) |
+	             ((u64)cpu->fault << 16) | cpu->faultAddress;
+	result = dchip8_hash_mix_internal(result, control);
+	result = dchip8_hash_mix_internal(result, status);
+	result = dchip8_hash_mix_internal(result, vm->pcgState.state[0]);
+	result = dchip8_hash_mix_internal(result, vm->pcgState.state[1]);
+	result = dchip8_hash_mix_internal(result, displayHash);
+	result = dchip8_hash_mix_internal(result, memoryHash);
+
+	return result;
+}
+
+u64 dchip8_vm_hash(const Chip8VM *vm)
+{
+	u64 result = dchip8_hash_combine_internal(vm, vm->memoryHash, vm->displayHash);
+	return result;
+}
+
+u64 dchip8_vm_hash_full(const Chip8VM *vm)
+{
+	u64 result = dchip8_hash_combine_internal(
+	    vm, dchip8_hash_memory_full_internal(vm),
+	    dchip8_hash_display_full_internal(vm));
+	return result;
+}
+
+void dchip8_vm_render(const Chip8VM *vm, PlatformRenderBuffer renderBuffer)
+{
+	DQNT_ASSERT(renderBuffer.bytesPerPixel == 4);
+	DQNT_ASSERT(renderBuffer.width == CHIP8_DISPLAY_WIDTH &&
+	            renderBuffer.height == CHIP8_DISPLAY_HEIGHT);
 
-		// IMPORTANT: Timers need to be decremented at a rate of 60hz. Since we
-		// can run the interpreter faster than that, make sure we decrement
-		// timers at the fixed rate.
-		if (cpu.delayTimer > 0 || cpu.soundTimer > 0)
+	// NOTE: Since we are using a 4bpp bitmap, the alpha channel determines if
+	// a pixel is on or not, "turning on a pixel" sets every channel to 255.
+	u32 *bitmapBuffer = (u32 *)renderBuffer.memory;
+	for (i32 y = 0; y < CHIP8_DISPLAY_HEIGHT; y++)
+	{
+		// NOTE: Flip the Y
+		i32 posY = (renderBuffer.height - 1) - y;
+		u32 *dest = bitmapBuffer + (posY * renderBuffer.width);
+		u64 row   = vm->display[y];
+		for (i32 x = 0; x < CHIP8_DISPLAY_WIDTH; x++)
 		{
-			cpu.elapsedTime += input.deltaForFrame;
-			f32 TIMER_DECREMENT_INTERVAL = 1 / 60.0f;
+			u32 pixelIsOn = (u32)((row >> ((CHIP8_DISPLAY_WIDTH - 1) - x)) & 1);
+			dest[x]       = (0 - pixelIsOn);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ROM Database
+////////////////////////////////////////////////////////////////////////////////
+u64 dchip8_rom_hash(const u8 *rom, u32 romSize)
+{
+	// NOTE: FNV-1a then avalanched so near identical ROMs spread over the table
+	u64 result = 0xCBF29CE484222325ULL;
+	for (u32 i = 0; i < romSize; i++)
+	{
+		result ^= rom[i];
+		result *= 0x100000001B3ULL;
+	}
+
+	result = dchip8_hash_avalanche_internal(result ^ romSize);
+	if (result == 0) result = 1;
+	return result;
+}
+
+Chip8RomSettings dchip8_rom_settings_default()
+{
+	Chip8RomSettings result = {};
+	result.cyclesPerFrame   = CHIP8_DEFAULT_CYCLES_PER_FRAME;
+	result.quirks           = 0;
+	memcpy(result.keymap, DEFAULT_KEYMAP, sizeof(result.keymap));
+	return result;
+}
+
+bool dchip8_romdb_open(Chip8RomDB *db, const wchar_t *path)
+{
+	*db = {};
+	if (!platform_map_file(path, &db->file)) return false;
+
+	const Chip8RomDBHeader *header = (const Chip8RomDBHeader *)db->file.memory;
+	bool valid = db->file.size >= sizeof(*header) &&
+	             header->magic == CHIP8_ROMDB_MAGIC &&
+	             header->version == CHIP8_ROMDB_VERSION &&
+	             header->numSlots > 0 &&
+	             (header->numSlots & (header->numSlots - 1)) == 0 &&
+	             header->numEntries < header->numSlots &&
+	             db->file.size >= sizeof(*header) + ((u64)header->numSlots *
+	                                                 sizeof(Chip8RomDBEntry));
+	if (!valid)
+	{
+		dchip8_romdb_close(db);
+		return false;
+	}
+
+	db->entries  = (const Chip8RomDBEntry *)(header + 1);
+	db->numSlots = header->numSlots;
+	return true;
+}
+
+void dchip8_romdb_close(Chip8RomDB *db)
+{
+	platform_unmap_file(&db->file);
+	*db = {};
+}
+
+const Chip8RomDBEntry *dchip8_romdb_find(const Chip8RomDB *db, u64 romHash)
+{
+	if (!db || !db->entries || romHash == 0) return NULL;
+
+	// NOTE: The builder keeps at least one slot empty, but the file may not
+	// have come from the builder, so never probe more than every slot once
+	u32 mask = db->numSlots - 1;
+	u32 slot = (u32)romHash & mask;
+	for (u32 probe = 0; probe < db->numSlots; probe++)
+	{
+		const Chip8RomDBEntry *entry = &db->entries[slot];
+		if (entry->romHash == romHash) return entry;
+		if (entry->romHash == 0) return NULL;
+		slot = (slot + 1) & mask;
+	}
+
+	return NULL;
+}
+
+bool dchip8_session_load_rom(Chip8Session *session, const Chip8RomDB *romDB,
+                             const u8 *rom, u32 romSize)
+{
+	session->romHash = 0;
+	session->romSize = 0;
+	dchip8_arena_reset(&session->romArena);
+	if (!dchip8_vm_load_rom(&session->vm, rom, romSize)) return false;
+
+	memcpy(session->rom, rom, romSize);
+	session->romSize             = romSize;
+	session->romHash             = dchip8_rom_hash(rom, romSize);
+	const Chip8RomDBEntry *entry = dchip8_romdb_find(romDB, session->romHash);
+	session->settings = (entry) ? entry->settings : dchip8_rom_settings_default();
+	if (session->settings.cyclesPerFrame == 0)
+		session->settings.cyclesPerFrame = CHIP8_DEFAULT_CYCLES_PER_FRAME;
+
+	session->vm.cpu.quirks = (session->settings.quirks & chip8quirk_all);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Memory
+////////////////////////////////////////////////////////////////////////////////
+void dchip8_arena_init(Chip8Arena *arena, void *memory, size_t size)
+{
+	arena->base      = (u8 *)memory;
+	arena->size      = (memory) ? size : 0;
+	arena->used      = 0;
+	arena->highWater = 0;
+}
+
+void *dchip8_arena_push(Chip8Arena *arena, size_t size, size_t alignment)
+{
+	DQNT_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+	// NOTE: Align the address rather than the offset, base is only as aligned
+	// as the platform made it
+	uintptr_t address = (uintptr_t)(arena->base + arena->used);
+	size_t padding    = (size_t)((alignment - (address & (alignment - 1))) &
+	                          (alignment - 1));
+	if (padding > arena->size - arena->used ||
+	    size > arena->size - arena->used - padding)
+		return NULL;
+
+	void *result = arena->base + arena->used + padding;
+	arena->used += padding + size;
+	if (arena->used > arena->highWater) arena->highWater = arena->used;
+	return result;
+}
+
+void *dchip8_arena_push_zero(Chip8Arena *arena, size_t size, size_t alignment)
+{
+	void *result = dchip8_arena_push(arena, size, alignment);
+	if (result) memset(result, 0, size);
+	return result;
+}
+
+bool dchip8_arena_push_arena(Chip8Arena *arena, Chip8Arena *child, size_t size)
+{
+	void *memory = dchip8_arena_push(arena, size, 64);
+	dchip8_arena_init(child, memory, size);
+	return (memory != NULL);
+}
+
+void dchip8_arena_reset(Chip8Arena *arena) { arena->used = 0; }
+
+size_t dchip8_arena_mark(const Chip8Arena *arena) { return arena->used; }
+
+void dchip8_arena_rewind(Chip8Arena *arena, size_t mark)
+{
+	DQNT_ASSERT(mark <= arena->used);
+	arena->used = mark;
+}
+
+bool dchip8_pool_init(Chip8Pool *pool, Chip8Arena *arena, size_t blockSize,
+                      u32 numBlocks, size_t alignment)
+{
+	*pool = {};
+	if (blockSize < sizeof(void *)) blockSize = sizeof(void *);
+	if (alignment < alignof(void *)) alignment = alignof(void *);
+	blockSize = (blockSize + alignment - 1) & ~(alignment - 1);
+
+	if (numBlocks > 0 && blockSize > ((size_t)-1) / numBlocks) return false;
+	pool->blocks = (u8 *)dchip8_arena_push(arena, blockSize * numBlocks,
+	                                       alignment);
+	if (!pool->blocks) return false;
+
+	pool->blockSize = blockSize;
+	pool->numBlocks = numBlocks;
+	return true;
+}
+
+void *dchip8_pool_alloc(Chip8Pool *pool)
+{
+	void *result = pool->freeList;
+	if (result)
+	{
+		pool->freeList = *(void **)result;
+	}
+	else
+	{
+		if (pool->numCarved >= pool->numBlocks) return NULL;
+		result = pool->blocks + (pool->blockSize * pool->numCarved++);
+	}
+
+	pool->numUsed++;
+	return result;
+}
+
+void dchip8_pool_free(Chip8Pool *pool, void *block)
+{
+	if (!block) return;
+	u8 *carvedEnd = pool->blocks + (pool->blockSize * pool->numCarved);
+	DQNT_ASSERT((u8 *)block >= pool->blocks && (u8 *)block < carvedEnd);
+
+	*(void **)block = pool->freeList;
+	pool->freeList  = block;
+	pool->numUsed--;
+}
+
+void dchip8_pool_reset(Chip8Pool *pool)
+{
+	pool->freeList  = NULL;
+	pool->numCarved = 0;
+	pool->numUsed   = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Paged Machines
+////////////////////////////////////////////////////////////////////////////////
+void dchip8_paged_vm_init(Chip8PagedVM *paged, const Chip8VM *image)
+{
+	paged->cpu          = image->cpu;
+	paged->pcgState     = image->pcgState;
+	paged->memoryHash   = image->memoryHash;
+	paged->displayHash  = image->displayHash;
+	paged->privatePages = 0;
+	memcpy(paged->display, image->display, sizeof(paged->display));
+
+	for (u32 page = 0; page < CHIP8_NUM_PAGES; page++)
+		paged->pages[page] = image->memory + (page * CHIP8_PAGE_SIZE);
+}
 
-			if (cpu.elapsedTime >= TIMER_DECREMENT_INTERVAL)
+void dchip8_paged_vm_release(Chip8PagedVM *paged, Chip8Pool *pool,
+                             Chip8PageView *view)
+{
+	for (u32 page = 0; page < CHIP8_NUM_PAGES; page++)
+	{
+		if (!(paged->privatePages & (1 << page))) continue;
+
+		// NOTE: The block goes on to back another page, the view must not
+		// take its copy for a copy of that
+		if (view && view->source[page] == paged->pages[page])
+			view->source[page] = NULL;
+
+		dchip8_pool_free(pool, (void *)paged->pages[page]);
+		paged->pages[page] = NULL;
+	}
+
+	paged->privatePages = 0;
+}
+
+void dchip8_page_view_init(Chip8PageView *view)
+{
+	memset(view, 0, sizeof(*view));
+}
+
+void dchip8_page_view_load(Chip8PageView *view, const Chip8PagedVM *paged)
+{
+	Chip8VM *vm     = &view->vm;
+	vm->cpu         = paged->cpu;
+	vm->pcgState    = paged->pcgState;
+	vm->memoryHash  = paged->memoryHash;
+	vm->displayHash = paged->displayHash;
+	memcpy(vm->display, paged->display, sizeof(vm->display));
+
+	// NOTE: Pages written since the last store no longer match their source,
+	// i.e. the machine before ran and was never stored
+	for (u32 page = 0; page < CHIP8_NUM_PAGES; page++)
+	{
+		bool written = (vm->dirtyPages & (1 << page)) != 0;
+		if (!written && view->source[page] == paged->pages[page]) continue;
+
+		memcpy(vm->memory + (page * CHIP8_PAGE_SIZE), paged->pages[page],
+		       CHIP8_PAGE_SIZE);
+		view->source[page] = paged->pages[page];
+	}
+
+	vm->dirtyPages = 0;
+}
+
+bool dchip8_page_view_store(Chip8PageView *view, Chip8PagedVM *paged,
+                            Chip8Pool *pool)
+{
+	DQNT_ASSERT(pool->blockSize >= CHIP8_PAGE_SIZE);
+	Chip8VM *vm = &view->vm;
+
+	// NOTE: Take every page needed before changing anything so running out
+	// leaves paged whole
+	u16 copyOnWrite = vm->dirtyPages & ~paged->privatePages;
+	u8 *newPages[CHIP8_NUM_PAGES];
+	for (u32 page = 0; page < CHIP8_NUM_PAGES; page++)
+	{
+		if (!(copyOnWrite & (1 << page))) continue;
+
+		newPages[page] = (u8 *)dchip8_pool_alloc(pool);
+		if (!newPages[page])
+		{
+			for (u32 taken = 0; taken < page; taken++)
+				if (copyOnWrite & (1 << taken))
+					dchip8_pool_free(pool, newPages[taken]);
+			return false;
+		}
+	}
+
+	for (u32 page = 0; page < CHIP8_NUM_PAGES; page++)
+	{
+		if (!(vm->dirtyPages & (1 << page))) continue;
+
+		// NOTE: Private pages are only ever handed out by this pool
+		u8 *dest = (copyOnWrite & (1 << page)) ? newPages[page]
+		                                       : (u8 *)paged->pages[page];
+		memcpy(dest, vm->memory + (page * CHIP8_PAGE_SIZE), CHIP8_PAGE_SIZE);
+		paged->pages[page] = dest;
+		view->source[page] = dest;
+	}
+
+	paged->privatePages |= copyOnWrite;
+	paged->cpu          = vm->cpu;
+	paged->pcgState     = vm->pcgState;
+	paged->memoryHash   = vm->memoryHash;
+	paged->displayHash  = vm->displayHash;
+	memcpy(paged->display, vm->display, sizeof(paged->display));
+
+	vm->dirtyPages = 0;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Command Queue
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Each slot's sequence says whose turn it is. A slot is free for the
+// producer that claims tail == sequence and readable by the consumer once the
+// sequence is index + 1, after which it is handed back a lap ahead.
+void dchip8_command_queue_init(Chip8CommandQueue *queue)
+{
+	*queue = {};
+	for (u32 i = 0; i < CHIP8_COMMAND_QUEUE_SIZE; i++)
+		queue->slots[i].sequence = i;
+	dqnt_atomic_fence();
+}
+
+bool dchip8_command_queue_push(Chip8CommandQueue *queue, Chip8Command command)
+{
+	for (;;)
+	{
+		u32 tail               = dqnt_atomic_load_u32(&queue->tail);
+		Chip8CommandSlot *slot = &queue->slots[tail % CHIP8_COMMAND_QUEUE_SIZE];
+		u32 sequence           = dqnt_atomic_load_u32(&slot->sequence);
+
+		i32 diff = (i32)(sequence - tail);
+		if (diff < 0) return false;
+		if (diff > 0) continue;
+
+		if (dqnt_atomic_compare_swap_u32(&queue->tail, tail + 1, tail) == tail)
+		{
+			slot->command = command;
+			dqnt_atomic_store_u32(&slot->sequence, tail + 1);
+			return true;
+		}
+	}
+}
+
+bool dchip8_command_queue_pop(Chip8CommandQueue *queue, Chip8Command *command)
+{
+	u32 head               = queue->head;
+	Chip8CommandSlot *slot = &queue->slots[head % CHIP8_COMMAND_QUEUE_SIZE];
+	if (dqnt_atomic_load_u32(&slot->sequence) != head + 1) return false;
+
+	*command = slot->command;
+	dqnt_atomic_store_u32(&slot->sequence, head + CHIP8_COMMAND_QUEUE_SIZE);
+	dqnt_atomic_store_u32(&queue->head, head + 1);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ROM Loader
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE void dchip8_rom_loader_lock_internal(Chip8RomLoader *loader)
+{
+	while (dqnt_atomic_compare_swap_u32(&loader->pathLock, 1, 0) != 0)
+		dqnt_sleep_ms(0);
+}
+
+FILE_SCOPE void dchip8_rom_loader_unlock_internal(Chip8RomLoader *loader)
+{
+	dqnt_atomic_store_u32(&loader->pathLock, 0);
+}
+
+// Return NULL if the core still holds both images
+FILE_SCOPE Chip8RomImage *
+dchip8_rom_loader_acquire_image_internal(Chip8RomLoader *loader)
+{
+	for (u32 i = 0; i < DQNT_ARRAY_COUNT(loader->images); i++)
+	{
+		Chip8RomImage *image = &loader->images[i];
+		if (dqnt_atomic_compare_swap_u32(&image->inUse, 1, 0) == 0) return image;
+	}
+
+	return NULL;
+}
+
+FILE_SCOPE u32 dchip8_rom_loader_thread_internal(void *userData)
+{
+	Chip8RomLoader *loader = (Chip8RomLoader *)userData;
+	u32 requestsServed     = 0;
+
+	while (!dqnt_atomic_load_u32(&loader->quit))
+	{
+		if (dqnt_atomic_load_u32(&loader->requestCount) == requestsServed)
+		{
+			dqnt_sleep_ms(5);
+			continue;
+		}
+
+		// NOTE: Copy the newest request out so the lock is never held over I/O
+		wchar_t path[DQNT_ARRAY_COUNT(loader->path)];
+		dchip8_rom_loader_lock_internal(loader);
+		{
+			requestsServed = loader->requestCount;
+			memcpy(path, loader->path, sizeof(path));
+		}
+		dchip8_rom_loader_unlock_internal(loader);
+
+		Chip8RomImage *image = dchip8_rom_loader_acquire_image_internal(loader);
+		while (!image && !dqnt_atomic_load_u32(&loader->quit))
+		{
+			dqnt_sleep_ms(1);
+			image = dchip8_rom_loader_acquire_image_internal(loader);
+		}
+		if (!image) break;
+
+		// NOTE: A failed read is still sent, with size 0, so the core resets the
+		// same way it did when loading synchronously
+		image->size       = 0;
+		PlatformFile file = {};
+		if (platform_open_file(path, &file))
+		{
+			if (file.size > 0 && file.size <= CHIP8_MAX_ROM_SIZE)
 			{
-				cpu.elapsedTime = 0;
-				if (cpu.delayTimer > 0) cpu.delayTimer--;
+				u32 romSize = (u32)file.size;
+				if (platform_read_file(file, image->data, romSize) == romSize)
+					image->size = romSize;
+			}
+			platform_close_file(&file);
+		}
 
-				if (cpu.soundTimer > 0)
-				{
-					cpu.soundTimer--;
-					if (cpu.soundTimer == 1)
-					{
-						// TODO(doyle): This needs to play a buzzing sound
-						// whilst timer > 0
-					}
-				}
+		Chip8Command command = {};
+		command.type         = chip8command_load_rom;
+		command.romImage     = image;
+		while (!dchip8_command_queue_push(loader->queue, command))
+		{
+			if (dqnt_atomic_load_u32(&loader->quit))
+			{
+				dqnt_atomic_store_u32(&image->inUse, 0);
+				break;
 			}
+			dqnt_sleep_ms(1);
 		}
-		else
+	}
+
+	return 0;
+}
+
+bool dchip8_rom_loader_start(Chip8RomLoader *loader, Chip8CommandQueue *queue)
+{
+	*loader       = {};
+	loader->queue = queue;
+	bool result =
+	    dqnt_thread_create(&loader->thread, dchip8_rom_loader_thread_internal,
+	                       loader);
+	return result;
+}
+
+void dchip8_rom_loader_request(Chip8RomLoader *loader, const wchar_t *path)
+{
+	dchip8_rom_loader_lock_internal(loader);
+	{
+		u32 len = (u32)dqnt_wstrlen(path);
+		if (len >= DQNT_ARRAY_COUNT(loader->path))
+			len = DQNT_ARRAY_COUNT(loader->path) - 1;
+		memcpy(loader->path, path, len * sizeof(*path));
+		loader->path[len] = 0;
+		loader->requestCount++;
+	}
+	dchip8_rom_loader_unlock_internal(loader);
+}
+
+void dchip8_rom_loader_stop(Chip8RomLoader *loader)
+{
+	dqnt_atomic_store_u32(&loader->quit, 1);
+	dqnt_thread_join(&loader->thread);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Speculation
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE void dchip8_speculator_run_branch_internal(Chip8Speculator *speculator,
+                                                      u32 key)
+{
+	Chip8SpeculativeBranch *branch = &speculator->branches[key];
+	memcpy(&branch->vm, &speculator->source, sizeof(branch->vm));
+
+	Chip8Controller controller = {};
+	controller.key[key]        = true;
+	branch->cyclesEmulated =
+	    speculator->run(&branch->vm, controller, speculator->cycles);
+	dqnt_atomic_store_u32(&branch->state, chip8branch_done);
+}
+
+FILE_SCOPE bool dchip8_speculator_claim_internal(Chip8SpeculativeBranch *branch)
+{
+	bool result =
+	    dqnt_atomic_compare_swap_u32(&branch->state, chip8branch_running,
+	                                 chip8branch_pending) == chip8branch_pending;
+	return result;
+}
+
+FILE_SCOPE u32 dchip8_speculator_worker_internal(void *userData)
+{
+	Chip8Speculator *speculator = (Chip8Speculator *)userData;
+
+	// NOTE: Forks are rare, at most one every few frames, so an idle worker
+	// spends nearly all its time blocked on the signal
+	u32 seenGeneration = 0;
+	for (;;)
+	{
+		seenGeneration =
+		    dqnt_signal_wait(&speculator->forkSignal, seenGeneration);
+		if (dqnt_atomic_load_u32(&speculator->quit)) break;
+
+		for (u32 key = 0; key < CHIP8_NUM_KEYS; key++)
+		{
+			Chip8SpeculativeBranch *branch = &speculator->branches[key];
+			if (dchip8_speculator_claim_internal(branch))
+				dchip8_speculator_run_branch_internal(speculator, key);
+		}
+	}
+
+	return 0;
+}
+
+bool dchip8_speculator_start(Chip8Speculator *speculator, u32 numThreads,
+                             Chip8RunFunc *run)
+{
+	memset(speculator, 0, sizeof(*speculator));
+	speculator->run = run ? run : dchip8_vm_run;
+	for (u32 key = 0; key < CHIP8_NUM_KEYS; key++)
+		speculator->branches[key].state = chip8branch_done;
+
+	numThreads = DQNT_MATH_MIN(numThreads, CHIP8_SPECULATOR_MAX_THREADS);
+	if (numThreads > 0 && !dqnt_signal_init(&speculator->forkSignal))
+		return false;
+
+	for (u32 i = 0; i < numThreads; i++)
+	{
+		DqntThread *thread = &speculator->threads[speculator->numThreads];
+		if (!dqnt_thread_create(thread, dchip8_speculator_worker_internal,
+		                        speculator))
 		{
-			cpu.elapsedTime = 0;
+			dchip8_speculator_stop(speculator);
+			return false;
+		}
+		speculator->numThreads++;
+	}
+
+	return true;
+}
+
+void dchip8_speculator_stop(Chip8Speculator *speculator)
+{
+	dqnt_atomic_store_u32(&speculator->quit, 1);
+	dqnt_signal_publish(&speculator->forkSignal);
+	for (u32 i = 0; i < speculator->numThreads; i++)
+		dqnt_thread_join(&speculator->threads[i]);
+	dqnt_signal_free(&speculator->forkSignal);
+	speculator->numThreads = 0;
+	speculator->forked     = false;
+}
+
+void dchip8_speculator_discard(Chip8Speculator *speculator)
+{
+	if (!speculator->forked) return;
+	speculator->forked = false;
+
+	// NOTE: Cancel what no worker has claimed, then wait out the rest since
+	// they read the source and write their branch
+	for (u32 key = 0; key < CHIP8_NUM_KEYS; key++)
+	{
+		Chip8SpeculativeBranch *branch = &speculator->branches[key];
+		dqnt_atomic_compare_swap_u32(&branch->state, chip8branch_done,
+		                             chip8branch_pending);
+		dqnt_spin_until_u32(&branch->state, chip8branch_done);
+	}
+}
+
+void dchip8_speculator_fork(Chip8Speculator *speculator, const Chip8VM *vm,
+                            u32 cyclesToEmulate)
+{
+	if (vm->cpu.state != chip8state_await_input) return;
+
+	u64 hash = dchip8_vm_hash(vm);
+	if (speculator->forked && speculator->sourceHash == hash &&
+	    speculator->cycles == cyclesToEmulate)
+		return;
+
+	dchip8_speculator_discard(speculator);
+	memcpy(&speculator->source, vm, sizeof(speculator->source));
+	speculator->sourceHash = hash;
+	speculator->cycles     = cyclesToEmulate;
+	speculator->forked     = true;
+	speculator->numForks++;
+
+	if (speculator->numThreads == 0)
+	{
+		for (u32 key = 0; key < CHIP8_NUM_KEYS; key++)
+			dchip8_speculator_run_branch_internal(speculator, key);
+		return;
+	}
+
+	for (u32 key = 0; key < CHIP8_NUM_KEYS; key++)
+		dqnt_atomic_store_u32(&speculator->branches[key].state,
+		                      chip8branch_pending);
+	dqnt_signal_publish(&speculator->forkSignal);
+}
+
+bool dchip8_speculator_commit(Chip8Speculator *speculator, Chip8VM *vm,
+                              Chip8Controller controller, u32 cyclesToEmulate,
+                              u32 *cyclesEmulated)
+{
+	if (!speculator->forked) return false;
+
+	u32 numKeys = 0;
+	u32 key     = 0;
+	for (u32 i = 0; i < CHIP8_NUM_KEYS; i++)
+	{
+		if (!controller.key[i]) continue;
+		if (numKeys++ == 0) key = i;
+	}
+
+	// NOTE: No key frame to stand in for. Either still blocked and the fork
+	// stays good, or the machine was replaced under it, e.g. by a reset.
+	if (numKeys == 0)
+	{
+		if (vm->cpu.state != chip8state_await_input)
+			dchip8_speculator_discard(speculator);
+		return false;
+	}
+
+	bool match = (numKeys == 1 && speculator->cycles == cyclesToEmulate &&
+	              dchip8_vm_hash(vm) == speculator->sourceHash);
+	if (!match)
+	{
+		speculator->numMisses++;
+		dchip8_speculator_discard(speculator);
+		return false;
+	}
+
+	// NOTE: A branch no worker got to yet is run here, which costs the same as
+	// the frame would have
+	Chip8SpeculativeBranch *branch = &speculator->branches[key];
+	if (dchip8_speculator_claim_internal(branch))
+		dchip8_speculator_run_branch_internal(speculator, key);
+	dqnt_spin_until_u32(&branch->state, chip8branch_done);
+
+	memcpy(vm, &branch->vm, sizeof(*vm));
+	*cyclesEmulated = branch->cyclesEmulated;
+	speculator->numCommits++;
+	dchip8_speculator_discard(speculator);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Update
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE void dchip8_execute_command_internal(Chip8Session *session,
+                                                const Chip8RomDB *romDB,
+                                                const Chip8Command *command)
+{
+	Chip8VM *vm = &session->vm;
+	switch (command->type)
+	{
+		case chip8command_load_rom:
+		{
+			Chip8RomImage *image = command->romImage;
+			dchip8_vm_init(vm);
+			dchip8_arena_reset(&session->romArena);
+			session->romHash = 0;
+			session->romSize = 0;
+			if (image->size > 0)
+				dchip8_session_load_rom(session, romDB, image->data, image->size);
+			dqnt_atomic_store_u32(&image->inUse, 0);
+		}
+		break;
+
+		case chip8command_reset:
+		{
+			// NOTE: Reboot the same ROM but keep the settings, they may have
+			// been changed since it was loaded
+			if (session->romHash == 0) break;
+			dchip8_vm_init(vm);
+			dchip8_arena_reset(&session->romArena);
+			dchip8_vm_load_rom(vm, session->rom, session->romSize);
+			vm->cpu.quirks = (session->settings.quirks & chip8quirk_all);
+		}
+		break;
+
+		case chip8command_set_speed:
+		{
+			u32 cyclesPerFrame = command->cyclesPerFrame;
+			if (cyclesPerFrame == 0)
+			{
+				const Chip8RomDBEntry *entry =
+				    dchip8_romdb_find(romDB, session->romHash);
+				cyclesPerFrame = (entry && entry->settings.cyclesPerFrame)
+				                     ? entry->settings.cyclesPerFrame
+				                     : CHIP8_DEFAULT_CYCLES_PER_FRAME;
+			}
+			session->settings.cyclesPerFrame = cyclesPerFrame;
+		}
+		break;
+
+		case chip8command_snapshot:
+		{
+			*command->snapshot.dest = *vm;
+			dqnt_atomic_store_u32(command->snapshot.done, 1);
+		}
+		break;
+
+		case chip8command_set_speculator:
+		{
+			Chip8Speculator *speculator = session->speculator;
+			if (speculator && speculator != command->speculator)
+				dchip8_speculator_discard(speculator);
+			session->speculator = command->speculator;
+		}
+		break;
+
+		case chip8command_set_run_ahead:
+		{
+			session->runAheadFrames = DQNT_MATH_MIN(command->runAheadFrames,
+			                                        CHIP8_MAX_RUN_AHEAD_FRAMES);
+		}
+		break;
+
+		default: DQNT_ASSERT(DQNT_INVALID_CODE_PATH); break;
+	}
+}
+
+void dchip8_update(PlatformRenderBuffer renderBuffer, const PlatformInput *input,
+                   PlatformMemory memory, Chip8CommandQueue *commands,
+                   const Chip8RomDB *romDB)
+{
+	DQNT_ASSERT(!renderBuffer.memory || renderBuffer.bytesPerPixel == 4);
+	DQNT_ASSERT(memory.permanentMemSize >= DCHIP8_MIN_PERMANENT_MEM_SIZE);
+
+	Chip8Session *session = (Chip8Session *)memory.permanentMem;
+	Chip8VM *vm           = &session->vm;
+
+	// NOTE: The platform hands over the same block every frame, adopt it the
+	// first time it is seen
+	if (session->romArena.base != memory.transientMem)
+	{
+		dchip8_arena_init(&session->romArena, memory.transientMem,
+		                  memory.transientMemSize);
+	}
+
+	Chip8Command command;
+	while (commands && dchip8_command_queue_pop(commands, &command))
+		dchip8_execute_command_internal(session, romDB, &command);
+
+	// NOTE: Nothing loaded yet, keep the default keymap so the input mapping
+	// still has something valid to read
+	if (session->romHash == 0) session->settings = dchip8_rom_settings_default();
+
+	Chip8Controller controller =
+	    dchip8_controller_map_input(input, session->settings.keymap);
+
+	u32 cycles                  = session->settings.cyclesPerFrame;
+	Chip8Speculator *speculator = session->speculator;
+	u32 cyclesEmulated          = 0;
+	if (!speculator || !dchip8_speculator_commit(speculator, vm, controller,
+	                                             cycles, &cyclesEmulated))
+		cyclesEmulated = dchip8_vm_run(vm, controller, cycles);
+
+	session->numInstructions += cyclesEmulated;
+	if (cyclesEmulated > 0)
+		session->numTimerTicks += dchip8_vm_update_timers(vm, input->deltaForFrame);
+
+	// NOTE: Blocking on Fx0A usually happens mid frame, fork straight away so
+	// the branches have the rest of this frame to run in
+	if (speculator) dchip8_speculator_fork(speculator, vm, cycles);
+
+	// NOTE: Save, run ahead and restore is one copy into scratch memory that
+	// is dropped afterwards, the real machine is never touched
+	const Chip8VM *presentVM = vm;
+	Chip8Arena *arena        = &session->romArena;
+	size_t arenaMark         = dchip8_arena_mark(arena);
+	if (session->runAheadFrames > 0)
+	{
+		Chip8VM *ahead = (Chip8VM *)dchip8_arena_push(arena, sizeof(Chip8VM),
+		                                              alignof(Chip8VM));
+		if (ahead)
+		{
+			memcpy(ahead, vm, sizeof(*ahead));
+			for (u32 frame = 0; frame < session->runAheadFrames; frame++)
+			{
+				if (dchip8_vm_run(ahead, controller, cycles) > 0)
+					dchip8_vm_update_timers(ahead, input->deltaForFrame);
+			}
+			presentVM = ahead;
 		}
 	}
 
+	memcpy(session->display, presentVM->display, sizeof(session->display));
+	if (renderBuffer.memory) dchip8_vm_render(presentVM, renderBuffer);
+	dchip8_arena_rewind(arena, arenaMark);
 }
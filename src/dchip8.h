@@ -3,9 +3,617 @@
 
 #include "dchip8_platform.h"
 
-bool dchip8_load_rom(wchar_t *filePath);
+#define CHIP8_MEMORY_SIZE    4096
+#define CHIP8_DISPLAY_WIDTH  64
+#define CHIP8_DISPLAY_HEIGHT 32
+#define CHIP8_NUM_KEYS       16
 
-void dchip8_update(PlatformRenderBuffer renderBuffer, PlatformInput input,
-                   PlatformMemory memory, u32 cyclesToEmulate);
+// NOTE: Everything before 0x200 is reserved for the actual emulator
+#define INIT_ADDRESS     0x200
+#define CHIP8_MAX_ROM_SIZE (CHIP8_MEMORY_SIZE - INIT_ADDRESS)
+
+// NOTE: Granularity machines share memory at, see Chip8PagedVM
+#define CHIP8_PAGE_SIZE      256
+#define CHIP8_NUM_PAGES      (CHIP8_MEMORY_SIZE / CHIP8_PAGE_SIZE)
+
+enum Chip8State
+{
+	chip8state_off,
+	chip8state_await_input,
+	chip8state_running,
+	chip8state_fault,
+};
+
+// NOTE: A fault is raised when the ROM asks the interpreter to do something
+// that would otherwise touch memory outside of the machine. The machine halts
+// in chip8state_fault instead of corrupting the host.
+enum Chip8Fault
+{
+	chip8fault_none,
+	chip8fault_pc_out_of_bounds,
+	chip8fault_stack_overflow,
+	chip8fault_stack_underflow,
+	chip8fault_mem_out_of_bounds,
+	chip8fault_invalid_font_digit,
+	chip8fault_invalid_key,
+	chip8fault_invalid_opcode,
+
+	chip8fault_count,
+};
+
+// NOTE: Behaviours that differ between interpreters over the years. The
+// defaults (no quirks set) are what this interpreter has always done, set a
+// flag to switch to the alternative a ROM was written for.
+enum Chip8Quirk
+{
+	// 8xy6/8xyE shift Vy into Vx instead of shifting Vx in place
+	chip8quirk_shift_vy         = 1 << 0,
+	// Fx55/Fx65 leave I pointing past the last register transferred
+	chip8quirk_load_store_inc_i = 1 << 1,
+	// Bxnn jumps to xnn + Vx instead of Bnnn jumping to nnn + V0
+	chip8quirk_jump_vx          = 1 << 2,
+	// 8xy1/8xy2/8xy3 reset VF to 0
+	chip8quirk_logic_vf_reset   = 1 << 3,
+	// Sprites are clipped at the right and bottom edges instead of wrapping
+	chip8quirk_clip_sprites     = 1 << 4,
+
+	chip8quirk_all = (1 << 5) - 1,
+};
+
+typedef struct Chip8Controller
+{
+	bool key[CHIP8_NUM_KEYS];
+} Chip8Controller;
+
+typedef struct Chip8CPU
+{
+	union {
+		u8 registerArray[16];
+		struct
+		{
+			u8 V0;
+			u8 V1;
+			u8 V2;
+			u8 V3;
+			u8 V4;
+			u8 V5;
+			u8 V6;
+			u8 V7;
+			u8 V8;
+			u8 V9;
+			u8 VA;
+			u8 VB;
+			u8 VC;
+			u8 VD;
+			u8 VE;
+			u8 VF;
+		};
+	};
+
+
+	// NOTE: Timer that count at 60hz and when set above 0 will count down to 0.
+	union {
+		u8 dt;
+		u8 delayTimer;
+	};
+
+	union {
+		u8 st;
+		u8 soundTimer;
+	};
+
+	// NOTE: Maximum value is 0xFFF, or 4095 or 12 bits
+	union {
+		u16 I;
+		u16 indexRegister;
+	};
+
+	// NOTE: Maximum value is 0xFFF, or 4095 or 12 bits
+	u16 programCounter;
+
+	u8 stackPointer;
+	u16 stack[16];
+
+	// Metadata
+	u8   storeKeyToRegisterIndex;
+	f32  elapsedTime;
+	enum Chip8State state;
+	enum Chip8Fault fault;
+	// NOTE: Address of the instruction that raised the fault
+	u16             faultAddress;
+	// NOTE: Chip8Quirk flags, set after loading a ROM
+	u32             quirks;
+} Chip8CPU;
+
+// NOTE: A complete machine, plain old data so it can be copied, snapshotted
+// and reset with a memcpy. The display is 1bpp, row 0 is the top of the
+// screen and the most significant bit of a row is the left most pixel.
+//
+// memoryHash and displayHash are kept up to date on every write so that
+// fingerprinting the machine never has to touch memory or the display. Write
+// through dchip8_vm_write_memory/dchip8_vm_write_display_row, or call
+// dchip8_vm_rehash after modifying memory or display directly.
+//
+// Chip8PagedVM holds every field but memory, add new fields to both.
+typedef struct Chip8VM
+{
+	Chip8CPU     cpu;
+	RandPCGState pcgState;
+	u64          display[CHIP8_DISPLAY_HEIGHT];
+	u64          memoryHash;
+	u64          displayHash;
+	// NOTE: Bit N is set when page N of memory is written, whoever needs to
+	// know clears it. Not part of the machine's state.
+	u16          dirtyPages;
+	u8           memory[CHIP8_MEMORY_SIZE];
+} Chip8VM;
+
+// Reset memory (with fonts), cpu and display. The machine is left off with no
+// quirks set.
+void dchip8_vm_init    (Chip8VM *vm);
+// Reset the machine and copy the ROM to INIT_ADDRESS. Return false if the ROM
+// does not fit, the machine is left off.
+bool dchip8_vm_load_rom(Chip8VM *vm, const u8 *rom, u32 romSize);
+
+// Execute up to cyclesToEmulate instructions. Return the number executed, less
+// if the machine blocked on Fx0A or faulted.
+u32  dchip8_vm_run              (Chip8VM *vm, Chip8Controller controller,
+                                 u32 cyclesToEmulate);
+// NOTE: Ring of the last instructions a machine executed, see dchip8_trace.h.
+// vx is register x of the opcode after the instruction ran, whether or not the
+// instruction writes it. A PC that faults out of bounds is recorded with an
+// opcode of 0.
+typedef struct Chip8TraceRecord
+{
+	u16 pc;
+	u16 opcode;
+	u8  vx;
+	u8  vf;
+	u16 I;
+} Chip8TraceRecord;
+
+typedef struct Chip8Trace
+{
+	Chip8TraceRecord *records;
+	// Capacity - 1, the capacity is a power of 2
+	u32               mask;
+	u32               id;
+	u64               numTraced;
+} Chip8Trace;
+
+// dchip8_vm_run that also appends every instruction it executes to trace
+u32  dchip8_vm_run_traced       (Chip8VM *vm, Chip8Controller controller,
+                                 u32 cyclesToEmulate, Chip8Trace *trace);
+// Decrement the delay and sound timers by one 60hz tick.
+void dchip8_vm_tick_timers      (Chip8VM *vm);
+// Decrement the timers based on wall-clock time elapsed since the last call.
+// Return the number of 60hz ticks applied.
+u32  dchip8_vm_update_timers    (Chip8VM *vm, f32 deltaForFrame);
+// Expand the 1bpp display to the 4 bytes per pixel platform buffer.
+void dchip8_vm_render           (const Chip8VM *vm,
+                                 PlatformRenderBuffer renderBuffer);
+
+// Fingerprint of the architectural state (cpu, rng, display and memory) for
+// comparing machines. Host side metadata such as elapsed time is excluded.
+// O(1), memory and display contribute through their incremental hashes.
+u64  dchip8_vm_hash             (const Chip8VM *vm);
+// Same result as dchip8_vm_hash but recomputed from scratch, for validating
+// the incremental hashes.
+u64  dchip8_vm_hash_full        (const Chip8VM *vm);
+// Recompute memoryHash and displayHash after writing to them directly.
+void dchip8_vm_rehash           (Chip8VM *vm);
+
+// Writes that keep the incremental hashes up to date
+void dchip8_vm_write_memory      (Chip8VM *vm, u16 address, u8 value);
+void dchip8_vm_write_memory_block(Chip8VM *vm, u16 address, const u8 *src,
+                                  u32 size);
+void dchip8_vm_write_display_row (Chip8VM *vm, i32 row, u64 bits);
+
+// NOTE: An engine is any implementation of dchip8_vm_run, i.e. the interpreter
+// or the reference interpreter. Engines must be interchangeable on the same
+// machine at any instruction boundary.
+typedef u32 Chip8RunFunc(Chip8VM *vm, Chip8Controller controller,
+                         u32 cyclesToEmulate);
+typedef struct Chip8Engine
+{
+	const char   *name;
+	Chip8RunFunc *run;
+} Chip8Engine;
+
+// Naive reference interpreter for cross checking, see dchip8_reference.cpp
+u32 dchip8_reference_run(Chip8VM *vm, Chip8Controller controller,
+                         u32 cyclesToEmulate);
+
+////////////////////////////////////////////////////////////////////////////////
+// ROM Database
+////////////////////////////////////////////////////////////////////////////////
+#define CHIP8_DEFAULT_CYCLES_PER_FRAME 15
+#define CHIP8_KEYMAP_UNMAPPED          0xFF
+
+typedef struct Chip8RomSettings
+{
+	u32 cyclesPerFrame;
+	// Chip8Quirk flags
+	u32 quirks;
+	// keymap[hexKey] is the platform enum Key that presses hexKey, or
+	// CHIP8_KEYMAP_UNMAPPED
+	u8  keymap[CHIP8_NUM_KEYS];
+} Chip8RomSettings;
+
+// NOTE: The database is one index file that is mapped and used in place, so
+// looking a ROM up at load time is a hash and a probe with no parsing. The file
+// is a Chip8RomDBHeader followed by numSlots entries forming an open addressed
+// hash table on romHash with linear probing, empty slots have a romHash of 0.
+// numSlots is a power of 2. Integers are little endian. Build it with
+// romdb_dchip8.
+#define CHIP8_ROMDB_MAGIC   0x42444D52 // "RMDB"
+#define CHIP8_ROMDB_VERSION 1
+
+typedef struct Chip8RomDBHeader
+{
+	u32 magic;
+	u32 version;
+	u32 numSlots;
+	u32 numEntries;
+	u8  reserved[48];
+} Chip8RomDBHeader;
+
+typedef struct Chip8RomDBEntry
+{
+	u64              romHash;
+	Chip8RomSettings settings;
+	char             name[32];
+} Chip8RomDBEntry;
+
+typedef struct Chip8RomDB
+{
+	PlatformMappedFile     file;
+	const Chip8RomDBEntry *entries;
+	u32                    numSlots;
+} Chip8RomDB;
+
+// Content hash of the ROM bytes, never 0
+u64              dchip8_rom_hash            (const u8 *rom, u32 romSize);
+// 15 cycles per frame, no quirks and the keyboard layout documented in
+// dchip8_controller_map_input
+Chip8RomSettings dchip8_rom_settings_default();
+
+// Return false if the file is missing or not a valid index
+bool                   dchip8_romdb_open (Chip8RomDB *db, const wchar_t *path);
+void                   dchip8_romdb_close(Chip8RomDB *db);
+// Return NULL if the ROM is not in the database. db may be NULL.
+const Chip8RomDBEntry *dchip8_romdb_find (const Chip8RomDB *db, u64 romHash);
+
+////////////////////////////////////////////////////////////////////////////////
+// Memory
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Linear allocator over a block the caller owns, e.g. the platform's
+// transient memory. Pushing is a bump of used and nothing is freed on its own,
+// everything goes at once on reset or back to a mark. Never calls malloc.
+typedef struct Chip8Arena
+{
+	u8    *base;
+	size_t size;
+	size_t used;
+	// Most ever used at once, for sizing the block
+	size_t highWater;
+} Chip8Arena;
+
+void   dchip8_arena_init      (Chip8Arena *arena, void *memory, size_t size);
+// Return NULL if the arena is out of space. alignment is a power of 2. The
+// memory is left as it was, _zero clears it.
+void  *dchip8_arena_push      (Chip8Arena *arena, size_t size,
+                               size_t alignment);
+void  *dchip8_arena_push_zero (Chip8Arena *arena, size_t size,
+                               size_t alignment);
+// Carve a child arena out of the parent, e.g. to give a subsystem a budget
+bool   dchip8_arena_push_arena(Chip8Arena *arena, Chip8Arena *child,
+                               size_t size);
+void   dchip8_arena_reset     (Chip8Arena *arena);
+// Everything pushed after a mark is released by rewinding to it
+size_t dchip8_arena_mark      (const Chip8Arena *arena);
+void   dchip8_arena_rewind    (Chip8Arena *arena, size_t mark);
+
+#define DCHIP8_ARENA_PUSH_STRUCT(arena, Type)                                  \
+	((Type *)dchip8_arena_push_zero(arena, sizeof(Type), alignof(Type)))
+#define DCHIP8_ARENA_PUSH_ARRAY(arena, Type, count)                            \
+	((Type *)dchip8_arena_push_zero(arena, sizeof(Type) * (size_t)(count),     \
+	                                alignof(Type)))
+
+// NOTE: Fixed size blocks carved from an arena with O(1) alloc and free. Blocks
+// are handed out in order until the first free, then the free list is reused,
+// so reset is O(1) and never walks the blocks.
+typedef struct Chip8Pool
+{
+	u8    *blocks;
+	size_t blockSize;
+	u32    numBlocks;
+	// Blocks handed out from the start of blocks, the rest have never been used
+	u32    numCarved;
+	u32    numUsed;
+	void  *freeList;
+} Chip8Pool;
+
+// Return false if the arena can't hold numBlocks blocks. blockSize is rounded
+// up to alignment and to fit a pointer.
+bool  dchip8_pool_init (Chip8Pool *pool, Chip8Arena *arena, size_t blockSize,
+                        u32 numBlocks, size_t alignment);
+// Return NULL if every block is in use. The block is left as it was.
+void *dchip8_pool_alloc(Chip8Pool *pool);
+void  dchip8_pool_free (Chip8Pool *pool, void *block);
+void  dchip8_pool_reset(Chip8Pool *pool);
+
+////////////////////////////////////////////////////////////////////////////////
+// Paged Machines
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Machines booted from the same image share every page of memory they
+// haven't written, i.e. the fonts, the code and most sprites, and get a private
+// copy of a page from a pool the first time they write to it. Most ROMs never
+// write more than a page or two (Fx33/Fx55 scratch) so a paged machine is
+// around a tenth the size of a Chip8VM and machines of one ROM share the rest
+// in cache.
+//
+// A paged machine runs by being loaded into a Chip8PageView, an ordinary
+// Chip8VM that remembers which page each of its pages was copied from. Loading
+// only copies the pages that differ from the last machine loaded, so running
+// machines of one ROM in turn copies their private pages and little else.
+typedef struct Chip8PagedVM
+{
+	Chip8CPU     cpu;
+	RandPCGState pcgState;
+	u64          display[CHIP8_DISPLAY_HEIGHT];
+	u64          memoryHash;
+	u64          displayHash;
+	// NOTE: The page in the shared image, or the private copy if the bit in
+	// privatePages is set
+	const u8    *pages[CHIP8_NUM_PAGES];
+	u16          privatePages;
+} Chip8PagedVM;
+
+typedef struct Chip8PageView
+{
+	Chip8VM   vm;
+	// The page each page of vm.memory is a copy of, NULL if none
+	const u8 *source[CHIP8_NUM_PAGES];
+} Chip8PageView;
+
+// Point every page of paged at image's memory and copy the rest of it. image
+// must not change while a machine shares it.
+void dchip8_paged_vm_init   (Chip8PagedVM *paged, const Chip8VM *image);
+// Return the private pages of paged to pool, e.g. before init to reset it.
+// view is forgotten about the pages freed.
+void dchip8_paged_vm_release(Chip8PagedVM *paged, Chip8Pool *pool,
+                             Chip8PageView *view);
+
+void dchip8_page_view_init  (Chip8PageView *view);
+// Make view->vm a copy of paged to run
+void dchip8_page_view_load  (Chip8PageView *view, const Chip8PagedVM *paged);
+// Copy view->vm back into paged, giving it a private page from pool for each
+// shared page written since the load. The pool must hold CHIP8_PAGE_SIZE
+// blocks. Return false if it ran out, paged is left as it was loaded.
+bool dchip8_page_view_store (Chip8PageView *view, Chip8PagedVM *paged,
+                             Chip8Pool *pool);
+
+////////////////////////////////////////////////////////////////////////////////
+// Platform Interface
+////////////////////////////////////////////////////////////////////////////////
+// Bit N of keyMask set means hex key N is down.
+Chip8Controller dchip8_controller_from_bitmask(u16 keyMask);
+Chip8Controller dchip8_controller_map_input   (const PlatformInput *input,
+                                               const u8 *keymap);
+
+const char *dchip8_fault_string(enum Chip8Fault fault);
+
+// NOTE: Layout of the platform's permanent memory, it must be at least
+// DCHIP8_MIN_PERMANENT_MEM_SIZE bytes. The platform's transient memory is
+// optional and becomes romArena.
+typedef struct Chip8Session
+{
+	Chip8VM          vm;
+	Chip8RomSettings settings;
+	// NOTE: 0 when no ROM is loaded
+	u64              romHash;
+	// NOTE: Kept to reset the machine without going back to the file
+	u32              romSize;
+	u8               rom[CHIP8_MAX_ROM_SIZE];
+
+	// NOTE: Running totals since startup for metrics, never reset
+	u64              numInstructions;
+	u64              numTimerTicks;
+
+	// NOTE: Storage that only lives as long as the ROM, e.g. decoded programs,
+	// trace rings and snapshots. Reset whenever a ROM is loaded or reset,
+	// anything held in it must be rebuilt after.
+	Chip8Arena       romArena;
+
+	// NOTE: Owned by the platform, NULL when not speculating. See
+	// Chip8Speculator.
+	struct Chip8Speculator *speculator;
+
+	// NOTE: Frames emulated past the real machine on a throwaway copy each
+	// frame so what is presented already shows the response to this frame's
+	// input, hiding that many frames of the ROM's own input lag. Needs
+	// transient memory for the copy, otherwise it is ignored.
+	u32              runAheadFrames;
+	// The frame to present, the machine's display or the run-ahead copy's
+	u64              display[CHIP8_DISPLAY_HEIGHT];
+} Chip8Session;
+
+#define CHIP8_MAX_RUN_AHEAD_FRAMES 8
+
+#define DCHIP8_MIN_PERMANENT_MEM_SIZE     sizeof(Chip8Session)
+#define DCHIP8_DEFAULT_TRANSIENT_MEM_SIZE (16 * 1024 * 1024)
+
+// Load the ROM and apply the settings romDB has for it, or the defaults if
+// romDB is NULL or doesn't know the ROM. Return false if the ROM does not fit.
+bool dchip8_session_load_rom(Chip8Session *session, const Chip8RomDB *romDB,
+                             const u8 *rom, u32 romSize);
+
+////////////////////////////////////////////////////////////////////////////////
+// Command Queue
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Occasional requests to the core. Any thread may push, the core drains
+// the queue at the start of dchip8_update so every command takes effect on a
+// frame boundary.
+enum Chip8CommandType
+{
+	chip8command_load_rom,
+	chip8command_reset,
+	chip8command_set_speed,
+	chip8command_snapshot,
+	chip8command_set_speculator,
+	chip8command_set_run_ahead,
+};
+
+// NOTE: A ROM read by the loader thread. inUse is cleared by the core once it
+// has copied the image into the session.
+typedef struct Chip8RomImage
+{
+	volatile u32 inUse;
+	u32          size;
+	u8           data[CHIP8_MAX_ROM_SIZE];
+} Chip8RomImage;
+
+typedef struct Chip8Command
+{
+	enum Chip8CommandType type;
+	union {
+		Chip8RomImage *romImage;
+		// 0 restores the ROM's preferred speed
+		u32            cyclesPerFrame;
+		struct
+		{
+			// The machine is copied to dest and done is set to 1 after
+			Chip8VM      *dest;
+			volatile u32 *done;
+		} snapshot;
+		// NULL stops speculating
+		struct Chip8Speculator *speculator;
+		// Clamped to CHIP8_MAX_RUN_AHEAD_FRAMES, 0 turns run-ahead off
+		u32            runAheadFrames;
+	};
+} Chip8Command;
+
+#define CHIP8_COMMAND_QUEUE_SIZE 64
+typedef struct Chip8CommandSlot
+{
+	volatile u32 sequence;
+	Chip8Command command;
+} Chip8CommandSlot;
+
+// Bounded lock free queue, many producers and a single consumer
+typedef struct Chip8CommandQueue
+{
+	Chip8CommandSlot slots[CHIP8_COMMAND_QUEUE_SIZE];
+	volatile u32     head;
+	volatile u32     tail;
+} Chip8CommandQueue;
+
+void dchip8_command_queue_init(Chip8CommandQueue *queue);
+// Return false if the queue is full
+bool dchip8_command_queue_push(Chip8CommandQueue *queue, Chip8Command command);
+// Consumer only, return false if the queue is empty
+bool dchip8_command_queue_pop (Chip8CommandQueue *queue, Chip8Command *command);
+
+// NOTE: Reads ROM files on a background thread and pushes load_rom commands,
+// so file I/O never happens on the emulation thread. Only the newest request
+// is kept if several arrive before the loader gets to them.
+typedef struct Chip8RomLoader
+{
+	Chip8CommandQueue *queue;
+	DqntThread         thread;
+	volatile u32       quit;
+
+	volatile u32       pathLock;
+	volatile u32       requestCount;
+	wchar_t            path[260];
+
+	Chip8RomImage      images[2];
+} Chip8RomLoader;
+
+bool dchip8_rom_loader_start  (Chip8RomLoader *loader, Chip8CommandQueue *queue);
+void dchip8_rom_loader_request(Chip8RomLoader *loader, const wchar_t *path);
+void dchip8_rom_loader_stop   (Chip8RomLoader *loader);
+
+////////////////////////////////////////////////////////////////////////////////
+// Speculation
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: A machine blocked on Fx0A can only go 16 ways, one per key. Once it
+// blocks the speculator forks a copy per key and workers run each one frame
+// ahead with only that key down, so the frame the key arrives in is already
+// emulated and committing it is a copy of the finished branch.
+//
+// A branch is only valid for the exact frame the core would have run: the
+// same machine, the same cycle count and that one key down. Anything else,
+// e.g. two keys at once, falls back to running the frame as normal.
+#define CHIP8_SPECULATOR_MAX_THREADS CHIP8_NUM_KEYS
+
+enum Chip8BranchState
+{
+	chip8branch_pending,
+	chip8branch_running,
+	chip8branch_done,
+};
+
+typedef struct Chip8SpeculativeBranch
+{
+	Chip8VM      vm;
+	u32          cyclesEmulated;
+	// Chip8BranchState, only pending branches may be claimed
+	volatile u32 state;
+} Chip8SpeculativeBranch;
+
+typedef struct Chip8Speculator
+{
+	Chip8RunFunc          *run;
+
+	// NOTE: Only written by the owner while no branch is pending or running
+	bool                   forked;
+	Chip8VM                source;
+	u64                    sourceHash;
+	u32                    cycles;
+	Chip8SpeculativeBranch branches[CHIP8_NUM_KEYS];
+
+	// NOTE: Workers block on forkSignal and claim pending branches until
+	// there are none left. Without workers the owner runs every branch when it
+	// forks, which still moves the work off the frame the key lands in.
+	DqntThread             threads[CHIP8_SPECULATOR_MAX_THREADS];
+	u32                    numThreads;
+	DqntSignal             forkSignal;
+	volatile u32           quit;
+
+	u64                    numForks;
+	// Key frames that were a copy of a branch
+	u64                    numCommits;
+	// Key frames that had to be run, i.e. the input or machine didn't match
+	u64                    numMisses;
+} Chip8Speculator;
+
+// numThreads is clamped to CHIP8_SPECULATOR_MAX_THREADS, 0 runs branches on
+// the owner's thread. run defaults to dchip8_vm_run.
+bool dchip8_speculator_start  (Chip8Speculator *speculator, u32 numThreads,
+                               Chip8RunFunc *run);
+void dchip8_speculator_stop   (Chip8Speculator *speculator);
+// Owner only. Fork vm if it is blocked on Fx0A and not already forked.
+void dchip8_speculator_fork   (Chip8Speculator *speculator, const Chip8VM *vm,
+                               u32 cyclesToEmulate);
+// Owner only. Stand in for running vm with controller for cyclesToEmulate,
+// return false if no branch matches and the frame has to be run normally.
+bool dchip8_speculator_commit (Chip8Speculator *speculator, Chip8VM *vm,
+                               Chip8Controller controller,
+                               u32 cyclesToEmulate, u32 *cyclesEmulated);
+// Owner only. Drop the current fork, waiting out branches already running.
+void dchip8_speculator_discard(Chip8Speculator *speculator);
+
+////////////////////////////////////////////////////////////////////////////////
+// Update
+////////////////////////////////////////////////////////////////////////////////
+// Apply queued commands, then emulate one frame at the session's speed and
+// render it, or the run-ahead frame, which is also left in session->display.
+// commands and romDB may be NULL. A renderBuffer without memory skips the
+// render, for platforms that present from session->display.
+void dchip8_update(PlatformRenderBuffer renderBuffer, const PlatformInput *input,
+                   PlatformMemory memory, Chip8CommandQueue *commands,
+                   const Chip8RomDB *romDB);
 
 #endif
@@ -0,0 +1,350 @@
+#include "dchip8_capture.h"
+#include "dqnt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+FILE_SCOPE inline void dchip8_capture_write_u32_internal(u8 *out, u32 value)
+{
+	out[0] = (u8)(value >> 0);
+	out[1] = (u8)(value >> 8);
+	out[2] = (u8)(value >> 16);
+	out[3] = (u8)(value >> 24);
+}
+
+FILE_SCOPE inline u32 dchip8_capture_read_u32_internal(const u8 *data)
+{
+	u32 result = (u32)data[0] | ((u32)data[1] << 8) | ((u32)data[2] << 16) |
+	             ((u32)data[3] << 24);
+	return result;
+}
+
+FILE_SCOPE inline u32 dchip8_capture_write_varint_internal(u8 *out, u32 value)
+{
+	u32 numBytes = 0;
+	while (value >= 0x80)
+	{
+		out[numBytes++] = (u8)(value | 0x80);
+		value >>= 7;
+	}
+	out[numBytes++] = (u8)value;
+	return numBytes;
+}
+
+// Return the number of bytes read, 0 if the varint is truncated or too long
+FILE_SCOPE inline u32 dchip8_capture_read_varint_internal(const u8 *data,
+                                                          u32 size, u32 *value)
+{
+	u32 result = 0;
+	for (u32 i = 0; i < size && i < 5; i++)
+	{
+		result |= (u32)(data[i] & 0x7F) << (7 * i);
+		if ((data[i] & 0x80) == 0)
+		{
+			*value = result;
+			return i + 1;
+		}
+	}
+
+	return 0;
+}
+
+u32 dchip8_capture_write_header(u8 *out)
+{
+	dchip8_capture_write_u32_internal(out + 0, DCHIP8_CAPTURE_MAGIC);
+	dchip8_capture_write_u32_internal(out + 4, DCHIP8_CAPTURE_VERSION);
+	dchip8_capture_write_u32_internal(out + 8, CHIP8_DISPLAY_WIDTH);
+	dchip8_capture_write_u32_internal(out + 12, CHIP8_DISPLAY_HEIGHT);
+	return DCHIP8_CAPTURE_HEADER_SIZE;
+}
+
+bool dchip8_capture_read_header(const u8 *data, u32 size)
+{
+	if (size < DCHIP8_CAPTURE_HEADER_SIZE) return false;
+
+	u32 version = dchip8_capture_read_u32_internal(data + 4);
+	bool result =
+	    dchip8_capture_read_u32_internal(data + 0) == DCHIP8_CAPTURE_MAGIC &&
+	    version >= 1 && version <= DCHIP8_CAPTURE_VERSION &&
+	    dchip8_capture_read_u32_internal(data + 8) == CHIP8_DISPLAY_WIDTH &&
+	    dchip8_capture_read_u32_internal(data + 12) == CHIP8_DISPLAY_HEIGHT;
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Encoder
+////////////////////////////////////////////////////////////////////////////////
+u32 dchip8_capture_encode_flush(Chip8CaptureEncoder *encoder, u8 *out)
+{
+	if (encoder->pendingRepeats == 0) return 0;
+
+	u32 numBytes    = 0;
+	out[numBytes++] = chip8capturerecord_repeat;
+	numBytes += dchip8_capture_write_varint_internal(out + numBytes,
+	                                                 encoder->pendingRepeats);
+	encoder->pendingRepeats = 0;
+	return numBytes;
+}
+
+u32 dchip8_capture_encode_gap(Chip8CaptureEncoder *encoder, u32 count,
+                              u8 *out)
+{
+	if (count == 0) return 0;
+
+	// NOTE: Held back repeats came before the gap
+	u32 numBytes    = dchip8_capture_encode_flush(encoder, out);
+	out[numBytes++] = chip8capturerecord_gap;
+	numBytes += dchip8_capture_write_varint_internal(out + numBytes, count);
+	return numBytes;
+}
+
+u32 dchip8_capture_encode_frame(Chip8CaptureEncoder *encoder, const u8 *frame,
+                                u8 *out)
+{
+	const u32 FRAME_SIZE = DCHIP8_CAPTURE_FRAME_SIZE;
+	u8 delta[DCHIP8_CAPTURE_FRAME_SIZE];
+
+	// NOTE: XOR a u64 at a time, the common case is a frame that barely changed
+	u64 changed = 0;
+	for (u32 i = 0; i < FRAME_SIZE; i += sizeof(u64))
+	{
+		u64 a, b;
+		memcpy(&a, frame + i, sizeof(a));
+		memcpy(&b, encoder->prevFrame + i, sizeof(b));
+		u64 x = a ^ b;
+		memcpy(delta + i, &x, sizeof(x));
+		changed |= x;
+	}
+
+	if (!changed)
+	{
+		encoder->pendingRepeats++;
+		return 0;
+	}
+
+	u32 numBytes = dchip8_capture_encode_flush(encoder, out);
+	out[numBytes++] = chip8capturerecord_delta;
+
+	// NOTE: A lone zero between literals costs a byte as a literal but two as a
+	// run, so literal runs only end at two or more zeros.
+	u32 index = 0;
+	while (index < FRAME_SIZE)
+	{
+		u32 zeroStart = index;
+		while (index < FRAME_SIZE && delta[index] == 0) index++;
+		u32 zeroRun = index - zeroStart;
+
+		u32 literalStart = index;
+		while (index < FRAME_SIZE)
+		{
+			if (delta[index] == 0 &&
+			    (index + 1 >= FRAME_SIZE || delta[index + 1] == 0))
+				break;
+			index++;
+		}
+		u32 literalLen = index - literalStart;
+
+		numBytes += dchip8_capture_write_varint_internal(out + numBytes, zeroRun);
+		numBytes +=
+		    dchip8_capture_write_varint_internal(out + numBytes, literalLen);
+		memcpy(out + numBytes, delta + literalStart, literalLen);
+		numBytes += literalLen;
+	}
+
+	memcpy(encoder->prevFrame, frame, FRAME_SIZE);
+	return numBytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Decoder
+////////////////////////////////////////////////////////////////////////////////
+i32 dchip8_capture_decode_record(Chip8CaptureDecoder *decoder, const u8 *data,
+                                 u32 size, u32 *numFrames)
+{
+	if (size == 0) return 0;
+
+	u32 pos = 1;
+	switch (data[0])
+	{
+		case chip8capturerecord_repeat:
+		case chip8capturerecord_gap:
+		{
+			u32 count     = 0;
+			u32 varintLen = dchip8_capture_read_varint_internal(
+			    data + pos, size - pos, &count);
+			if (varintLen == 0) return (size - pos >= 5) ? -1 : 0;
+			pos += varintLen;
+
+			if (data[0] == chip8capturerecord_gap) decoder->numLost += count;
+			*numFrames = count;
+			return (i32)pos;
+		}
+
+		case chip8capturerecord_delta:
+		{
+			// NOTE: Decode into a copy so a truncated record can be retried
+			// once more data arrives
+			u8 frame[DCHIP8_CAPTURE_FRAME_SIZE];
+			memcpy(frame, decoder->frame, sizeof(frame));
+
+			u32 index = 0;
+			while (index < DCHIP8_CAPTURE_FRAME_SIZE)
+			{
+				u32 zeroRun = 0, literalLen = 0;
+				u32 varintLen = dchip8_capture_read_varint_internal(
+				    data + pos, size - pos, &zeroRun);
+				if (varintLen == 0) return (size - pos >= 5) ? -1 : 0;
+				pos += varintLen;
+
+				varintLen = dchip8_capture_read_varint_internal(
+				    data + pos, size - pos, &literalLen);
+				if (varintLen == 0) return (size - pos >= 5) ? -1 : 0;
+				pos += varintLen;
+
+				if (zeroRun > DCHIP8_CAPTURE_FRAME_SIZE - index) return -1;
+				index += zeroRun;
+
+				if (literalLen > DCHIP8_CAPTURE_FRAME_SIZE - index) return -1;
+				if (literalLen > size - pos) return 0;
+				for (u32 i = 0; i < literalLen; i++)
+					frame[index++] ^= data[pos++];
+			}
+
+			memcpy(decoder->frame, frame, sizeof(frame));
+			*numFrames = 1;
+			return (i32)pos;
+		}
+	}
+
+	return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Capture Writer
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE void dchip8_capture_writer_output_internal(Chip8CaptureWriter *writer,
+                                                      const u8 *data,
+                                                      u32 numBytes)
+{
+	if (numBytes == 0 || writer->ioError) return;
+	if (fwrite(data, 1, numBytes, writer->file) != numBytes)
+		writer->ioError = true;
+	writer->numBytesWritten += numBytes;
+}
+
+FILE_SCOPE u32 dchip8_capture_writer_thread_internal(void *userData)
+{
+	Chip8CaptureWriter *writer = (Chip8CaptureWriter *)userData;
+	u8 record[DCHIP8_CAPTURE_MAX_RECORD_SIZE * 2];
+
+	for (;;)
+	{
+		// NOTE: Read quit before the indexes so frames pushed before stop are
+		// always drained
+		bool quit      = dqnt_atomic_load_u32(&writer->quit) != 0;
+		u32 readIndex  = writer->readIndex;
+		u32 writeIndex = dqnt_atomic_load_u32(&writer->writeIndex);
+
+		if (readIndex == writeIndex)
+		{
+			if (quit) break;
+			fflush(writer->file);
+			dqnt_sleep_ms(1);
+			continue;
+		}
+
+		for (; readIndex != writeIndex; readIndex++)
+		{
+			u32 slot        = readIndex & (writer->ringSize - 1);
+			const u8 *frame = writer->ring + (slot * DCHIP8_CAPTURE_FRAME_SIZE);
+
+			u32 numBytes = dchip8_capture_encode_gap(
+			    &writer->encoder, writer->ringGaps[slot], record);
+			dchip8_capture_writer_output_internal(writer, record, numBytes);
+
+			numBytes = dchip8_capture_encode_frame(&writer->encoder, frame, record);
+			dchip8_capture_writer_output_internal(writer, record, numBytes);
+		}
+		dqnt_atomic_store_u32(&writer->readIndex, readIndex);
+	}
+
+	// NOTE: Nothing is pushed once stop has been called, so the drops after
+	// the last frame pushed are settled
+	u32 numBytes = dchip8_capture_encode_gap(&writer->encoder,
+	                                         writer->numPendingDrops, record);
+	dchip8_capture_writer_output_internal(writer, record, numBytes);
+	numBytes = dchip8_capture_encode_flush(&writer->encoder, record);
+	dchip8_capture_writer_output_internal(writer, record, numBytes);
+	fflush(writer->file);
+	return 0;
+}
+
+bool dchip8_capture_writer_start(Chip8CaptureWriter *writer, FILE *file,
+                                 u32 ringSize)
+{
+	DQNT_ASSERT(ringSize > 0 && (ringSize & (ringSize - 1)) == 0);
+
+	*writer          = {};
+	writer->file     = file;
+	writer->ringSize = ringSize;
+	writer->ring = (u8 *)malloc((size_t)ringSize * DCHIP8_CAPTURE_FRAME_SIZE);
+	writer->ringGaps = (u32 *)malloc((size_t)ringSize * sizeof(u32));
+	if (!writer->ring || !writer->ringGaps)
+	{
+		free(writer->ring);
+		free(writer->ringGaps);
+		writer->ring     = NULL;
+		writer->ringGaps = NULL;
+		return false;
+	}
+
+	u8 header[DCHIP8_CAPTURE_HEADER_SIZE];
+	u32 headerSize = dchip8_capture_write_header(header);
+	dchip8_capture_writer_output_internal(writer, header, headerSize);
+
+	if (!dqnt_thread_create(&writer->thread,
+	                        dchip8_capture_writer_thread_internal, writer))
+	{
+		free(writer->ring);
+		free(writer->ringGaps);
+		writer->ring     = NULL;
+		writer->ringGaps = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+bool dchip8_capture_writer_push(Chip8CaptureWriter *writer, const u64 *display)
+{
+	u32 writeIndex = writer->writeIndex;
+	u32 readIndex  = dqnt_atomic_load_u32(&writer->readIndex);
+	if (writeIndex - readIndex >= writer->ringSize)
+	{
+		writer->numDropped++;
+		writer->numPendingDrops++;
+		return false;
+	}
+
+	u32 slot = writeIndex & (writer->ringSize - 1);
+	memcpy(writer->ring + (slot * DCHIP8_CAPTURE_FRAME_SIZE), display,
+	       DCHIP8_CAPTURE_FRAME_SIZE);
+	writer->ringGaps[slot]  = writer->numPendingDrops;
+	writer->numPendingDrops = 0;
+	dqnt_atomic_store_u32(&writer->writeIndex, writeIndex + 1);
+	return true;
+}
+
+void dchip8_capture_writer_stop(Chip8CaptureWriter *writer)
+{
+	if (!writer->ring) return;
+
+	dqnt_atomic_store_u32(&writer->quit, 1);
+	dqnt_thread_join(&writer->thread);
+
+	free(writer->ring);
+	free(writer->ringGaps);
+	writer->ring     = NULL;
+	writer->ringGaps = NULL;
+}
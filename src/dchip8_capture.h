@@ -0,0 +1,117 @@
+#ifndef DCHIP8_CAPTURE_H
+#define DCHIP8_CAPTURE_H
+
+#include "dchip8.h"
+#include "dqnt.h"
+
+#include <stdio.h>
+
+// NOTE: Compact capture stream of the display. A frame is the packed 1bpp
+// display as it sits in Chip8VM, 32 u64 rows stored little endian, 256 bytes.
+//
+// Stream layout, all integers little endian
+//   u32 magic, u32 version, u32 width, u32 height
+//   Records until the end of the stream, each starts with a type byte
+//     chip8capturerecord_delta : The frame XOR'ed with the previous one (the
+//                                first frame is against a blank display), run
+//                                length encoded as pairs of
+//                                [varint zeroRun][varint literalLen][literals]
+//                                until all 256 bytes are covered.
+//     chip8capturerecord_repeat: [varint count], the previous frame again count
+//                                more times.
+//     chip8capturerecord_gap   : [varint count], count frames were lost here,
+//                                e.g. dropped by a writer that fell behind.
+//                                Playback holds the previous frame for them so
+//                                the stream keeps the original frame timing.
+// varints are LEB128, 7 bits a byte, low bits first. Version 1 streams are
+// version 2 streams without gaps.
+
+#define DCHIP8_CAPTURE_MAGIC           0x50414338 // "8CAP"
+#define DCHIP8_CAPTURE_VERSION         2
+#define DCHIP8_CAPTURE_HEADER_SIZE     16
+#define DCHIP8_CAPTURE_FRAME_SIZE      (CHIP8_DISPLAY_HEIGHT * sizeof(u64))
+// Worst case is a single zero between every literal byte
+#define DCHIP8_CAPTURE_MAX_RECORD_SIZE (1 + (DCHIP8_CAPTURE_FRAME_SIZE * 3))
+
+enum Chip8CaptureRecord
+{
+	chip8capturerecord_delta  = 0x01,
+	chip8capturerecord_repeat = 0x02,
+	chip8capturerecord_gap    = 0x03,
+};
+
+typedef struct Chip8CaptureEncoder
+{
+	u8  prevFrame[DCHIP8_CAPTURE_FRAME_SIZE];
+	u32 pendingRepeats;
+} Chip8CaptureEncoder;
+
+typedef struct Chip8CaptureDecoder
+{
+	u8  frame[DCHIP8_CAPTURE_FRAME_SIZE];
+	// Frames decoded from gap records so far, included in numFrames
+	u64 numLost;
+} Chip8CaptureDecoder;
+
+// Write the stream header to out, return the number of bytes written
+u32 dchip8_capture_write_header(u8 *out);
+// Return false if the header is not a capture stream this version can decode
+bool dchip8_capture_read_header(const u8 *data, u32 size);
+
+// Encode one frame, out must hold DCHIP8_CAPTURE_MAX_RECORD_SIZE * 2 bytes.
+// Identical frames are held back and merged into one repeat record, so this can
+// return 0. Return the number of bytes written.
+u32 dchip8_capture_encode_frame(Chip8CaptureEncoder *encoder, const u8 *frame,
+                                u8 *out);
+// Write any held back repeats, call once at the end of the stream
+u32 dchip8_capture_encode_flush(Chip8CaptureEncoder *encoder, u8 *out);
+// Record that count frames were lost after the last frame encoded, out must
+// hold DCHIP8_CAPTURE_MAX_RECORD_SIZE * 2 bytes. Return the number of bytes
+// written.
+u32 dchip8_capture_encode_gap  (Chip8CaptureEncoder *encoder, u32 count,
+                                u8 *out);
+
+// Decode the record at the start of data. On success decoder->frame holds the
+// frame and numFrames is how many times it's shown. Return the number of bytes
+// consumed, 0 if the record is truncated and -1 if it is invalid.
+i32 dchip8_capture_decode_record(Chip8CaptureDecoder *decoder, const u8 *data,
+                                 u32 size, u32 *numFrames);
+
+////////////////////////////////////////////////////////////////////////////////
+// Capture Writer
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Encodes and writes on a background thread. The emulator only copies the
+// display into a ring buffer, if the writer falls behind so far that the ring
+// fills up the frame is dropped rather than stalling emulation. Drops travel
+// with the next frame that makes it into the ring, or with stop if none does,
+// and are written as a gap record so the stream still has every frame slot.
+typedef struct Chip8CaptureWriter
+{
+	FILE               *file;
+	u8                 *ring;
+	// Frames dropped just before each ring slot's frame
+	u32                *ringGaps;
+	u32                 ringSize;
+	volatile u32        readIndex;
+	volatile u32        writeIndex;
+	volatile u32        quit;
+	u32                 numDropped;
+	// Dropped since the last frame pushed, owned by the pushing thread
+	u32                 numPendingDrops;
+	u64                 numBytesWritten;
+	bool                ioError;
+	Chip8CaptureEncoder encoder;
+	DqntThread          thread;
+} Chip8CaptureWriter;
+
+// ringSize is the number of frames buffered and must be a power of 2. The
+// writer does not own file, close it after stopping.
+bool dchip8_capture_writer_start(Chip8CaptureWriter *writer, FILE *file,
+                                 u32 ringSize);
+// Return false if the frame was dropped
+bool dchip8_capture_writer_push (Chip8CaptureWriter *writer,
+                                 const u64 *display);
+// Write out everything pushed so far and stop the thread
+void dchip8_capture_writer_stop (Chip8CaptureWriter *writer);
+
+#endif
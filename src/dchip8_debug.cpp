@@ -0,0 +1,339 @@
+#include "dchip8_debug.h"
+#include "dqnt.h"
+
+#include <string.h>
+
+void dchip8_debugger_init(Chip8Debugger *debugger, Chip8RunFunc *run)
+{
+	*debugger     = {};
+	debugger->run = run ? run : dchip8_vm_run;
+}
+
+void dchip8_debugger_clear(Chip8Debugger *debugger)
+{
+	memset(debugger->breakpoints, 0, sizeof(debugger->breakpoints));
+	debugger->numBreakpoints = 0;
+	debugger->numWatchpoints = 0;
+	debugger->numConditions  = 0;
+}
+
+bool dchip8_debugger_armed(const Chip8Debugger *debugger)
+{
+	bool result = (debugger->numBreakpoints > 0 ||
+	               debugger->numWatchpoints > 0 || debugger->numConditions > 0);
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Stop Conditions
+////////////////////////////////////////////////////////////////////////////////
+bool dchip8_debugger_set_breakpoint(Chip8Debugger *debugger, u16 address,
+                                    bool enable)
+{
+	if (address >= CHIP8_MEMORY_SIZE) return false;
+
+	u8 *byte = &debugger->breakpoints[address >> 3];
+	u8 bit   = (u8)(1 << (address & 7));
+	bool set = (*byte & bit) != 0;
+	if (set == enable) return true;
+
+	if (enable)
+	{
+		*byte |= bit;
+		debugger->numBreakpoints++;
+	}
+	else
+	{
+		*byte &= (u8)~bit;
+		debugger->numBreakpoints--;
+	}
+	return true;
+}
+
+bool dchip8_debugger_has_breakpoint(const Chip8Debugger *debugger, u16 address)
+{
+	if (address >= CHIP8_MEMORY_SIZE) return false;
+
+	bool result = (debugger->breakpoints[address >> 3] >> (address & 7)) & 1;
+	return result;
+}
+
+bool dchip8_debugger_add_watchpoint(Chip8Debugger *debugger, u16 address,
+                                    u16 size, u32 access)
+{
+	if (size == 0 || (u32)address + size > CHIP8_MEMORY_SIZE) return false;
+	if ((access & (chip8watch_read | chip8watch_write)) == 0) return false;
+	if (debugger->numWatchpoints >= CHIP8_DEBUG_MAX_WATCHPOINTS) return false;
+
+	Chip8Watchpoint *watch = &debugger->watchpoints[debugger->numWatchpoints++];
+	watch->start           = address;
+	watch->end             = address + size;
+	watch->access          = access;
+	return true;
+}
+
+bool dchip8_debugger_add_condition(Chip8Debugger *debugger, u8 reg,
+                                   enum Chip8ConditionType type, u16 value)
+{
+	if (reg >= chip8debugreg_count) return false;
+	if (debugger->numConditions >= CHIP8_DEBUG_MAX_CONDITIONS) return false;
+
+	Chip8Condition *condition = &debugger->conditions[debugger->numConditions++];
+	condition->reg            = reg;
+	condition->type           = type;
+	condition->value          = value;
+	return true;
+}
+
+u16 dchip8_debugger_register_value(const Chip8CPU *cpu, u8 reg)
+{
+	if (reg < DQNT_ARRAY_COUNT(cpu->registerArray))
+		return cpu->registerArray[reg];
+
+	switch (reg)
+	{
+		case chip8debugreg_I:  return cpu->I;
+		case chip8debugreg_dt: return cpu->delayTimer;
+		case chip8debugreg_st: return cpu->soundTimer;
+		case chip8debugreg_sp: return cpu->stackPointer;
+		default: DQNT_ASSERT(DQNT_INVALID_CODE_PATH); return 0;
+	}
+}
+
+// NOTE: The memory an instruction is about to touch can be worked out from the
+// opcode and I before it runs. Return 0 if it doesn't touch memory.
+FILE_SCOPE u32 dchip8_debug_access_internal(const Chip8VM *vm, u16 opAddress,
+                                            u32 *start, u32 *size)
+{
+	if (opAddress > (CHIP8_MEMORY_SIZE - 2)) return 0;
+
+	u8 opHighByte = vm->memory[opAddress];
+	u8 opLowByte  = vm->memory[opAddress + 1];
+	u8 regNum     = (0x0F & opHighByte);
+	*start        = vm->cpu.I;
+
+	u32 result = 0;
+	if ((opHighByte & 0xF0) == 0xD0)
+	{
+		*size  = (0x0F & opLowByte);
+		result = chip8watch_read;
+	}
+	else if ((opHighByte & 0xF0) == 0xF0)
+	{
+		if (opLowByte == 0x33)
+		{
+			*size  = 3;
+			result = chip8watch_write;
+		}
+		else if (opLowByte == 0x55 || opLowByte == 0x65)
+		{
+			*size  = regNum + 1;
+			result = (opLowByte == 0x55) ? chip8watch_write : chip8watch_read;
+		}
+	}
+
+	if (result == 0 || *size == 0) return 0;
+	return result;
+}
+
+FILE_SCOPE bool dchip8_debug_check_before_internal(Chip8Debugger *debugger,
+                                                   const Chip8VM *vm)
+{
+	u16 opAddress = vm->cpu.programCounter;
+	if (dchip8_debugger_has_breakpoint(debugger, opAddress))
+	{
+		debugger->stop        = chip8debugstop_breakpoint;
+		debugger->stopAddress = opAddress;
+		debugger->stopDetail  = opAddress;
+		return true;
+	}
+
+	if (debugger->numWatchpoints == 0) return false;
+
+	u32 start, size;
+	u32 access = dchip8_debug_access_internal(vm, opAddress, &start, &size);
+	if (access == 0) return false;
+
+	u32 end = start + size;
+	for (u32 i = 0; i < debugger->numWatchpoints; i++)
+	{
+		const Chip8Watchpoint *watch = &debugger->watchpoints[i];
+		if ((watch->access & access) == 0) continue;
+		if (end <= watch->start || start >= watch->end) continue;
+
+		debugger->stop        = (access == chip8watch_read)
+		                            ? chip8debugstop_watch_read
+		                            : chip8debugstop_watch_write;
+		debugger->stopAddress = opAddress;
+		debugger->stopDetail  = (u16)DQNT_MATH_MAX(start, (u32)watch->start);
+		return true;
+	}
+
+	return false;
+}
+
+// NOTE: Conditions are edge triggered so continuing past one doesn't stop on
+// every following instruction while it still holds
+FILE_SCOPE bool dchip8_debug_check_after_internal(Chip8Debugger *debugger,
+                                                  const Chip8VM *vm,
+                                                  const u16 *before,
+                                                  u16 opAddress)
+{
+	for (u32 i = 0; i < debugger->numConditions; i++)
+	{
+		const Chip8Condition *condition = &debugger->conditions[i];
+		u16 prev = before[i];
+		u16 now  = dchip8_debugger_register_value(&vm->cpu, condition->reg);
+
+		bool hit = false;
+		if (condition->type == chip8condition_changed)
+			hit = (now != prev);
+		else
+			hit = (now == condition->value && prev != condition->value);
+
+		if (hit)
+		{
+			debugger->stop        = chip8debugstop_condition;
+			debugger->stopAddress = opAddress;
+			debugger->stopDetail  = condition->reg;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Run
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: returnStackPointer of 0xFF means no step over is in progress,
+// otherwise the loop also stops once the call returns to returnAddress
+FILE_SCOPE u32 dchip8_debugger_run_checked_internal(Chip8Debugger *debugger,
+                                                    Chip8VM *vm,
+                                                    Chip8Controller controller,
+                                                    u32 cyclesToEmulate,
+                                                    bool skipFirstCheck,
+                                                    u16 returnAddress,
+                                                    u8 returnStackPointer)
+{
+	Chip8CPU *cpu = &vm->cpu;
+	u16 before[CHIP8_DEBUG_MAX_CONDITIONS];
+
+	u32 opCycle = 0;
+	while (opCycle < cyclesToEmulate)
+	{
+		u16 opAddress = cpu->programCounter;
+		// NOTE: A machine waiting on Fx0A hasn't reached the instruction at PC
+		// yet, it is checked on the call that supplies the key
+		if (!skipFirstCheck && cpu->state == chip8state_running &&
+		    dchip8_debug_check_before_internal(debugger, vm))
+			break;
+		skipFirstCheck = false;
+
+		for (u32 i = 0; i < debugger->numConditions; i++)
+			before[i] =
+			    dchip8_debugger_register_value(cpu, debugger->conditions[i].reg);
+
+		if (debugger->run(vm, controller, 1) == 0) break;
+		opCycle++;
+
+		if (dchip8_debug_check_after_internal(debugger, vm, before, opAddress))
+			break;
+
+		// NOTE: Stop where the engine would have, e.g. right after Fx0A
+		if (cpu->state != chip8state_running) break;
+
+		if (cpu->programCounter == returnAddress &&
+		    cpu->stackPointer == returnStackPointer)
+		{
+			debugger->stop        = chip8debugstop_step;
+			debugger->stopAddress = opAddress;
+			debugger->stopDetail  = 0;
+			break;
+		}
+	}
+
+	return opCycle;
+}
+
+FILE_SCOPE bool dchip8_debugger_resuming_internal(const Chip8Debugger *debugger,
+                                                  const Chip8VM *vm)
+{
+	bool stoppedBefore = (debugger->stop == chip8debugstop_breakpoint ||
+	                      debugger->stop == chip8debugstop_watch_read ||
+	                      debugger->stop == chip8debugstop_watch_write);
+	bool result =
+	    stoppedBefore && vm->cpu.programCounter == debugger->stopAddress;
+	return result;
+}
+
+u32 dchip8_debugger_run(Chip8Debugger *debugger, Chip8VM *vm,
+                        Chip8Controller controller, u32 cyclesToEmulate)
+{
+	bool resuming  = dchip8_debugger_resuming_internal(debugger, vm);
+	debugger->stop = chip8debugstop_none;
+
+	if (!dchip8_debugger_armed(debugger))
+		return debugger->run(vm, controller, cyclesToEmulate);
+
+	u32 result = dchip8_debugger_run_checked_internal(
+	    debugger, vm, controller, cyclesToEmulate, resuming, 0, 0xFF);
+	return result;
+}
+
+u32 dchip8_debugger_step(Chip8Debugger *debugger, Chip8VM *vm,
+                         Chip8Controller controller)
+{
+	u16 opAddress = vm->cpu.programCounter;
+	u32 result    = debugger->run(vm, controller, 1);
+
+	debugger->stop        = chip8debugstop_step;
+	debugger->stopAddress = opAddress;
+	debugger->stopDetail  = 0;
+	return result;
+}
+
+u32 dchip8_debugger_step_over(Chip8Debugger *debugger, Chip8VM *vm,
+                              Chip8Controller controller, u32 cyclesToEmulate)
+{
+	Chip8CPU *cpu = &vm->cpu;
+	u16 pc        = cpu->programCounter;
+	bool isCall   = (cpu->state == chip8state_running &&
+	               pc <= (CHIP8_MEMORY_SIZE - 2) &&
+	               (vm->memory[pc] & 0xF0) == 0x20);
+	if (!isCall) return dchip8_debugger_step(debugger, vm, controller);
+
+	debugger->stop = chip8debugstop_none;
+	u32 result     = dchip8_debugger_run_checked_internal(
+	    debugger, vm, controller, cyclesToEmulate, true, pc + 2,
+	    cpu->stackPointer);
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Strings
+////////////////////////////////////////////////////////////////////////////////
+const char *dchip8_debug_stop_string(enum Chip8DebugStop stop)
+{
+	switch (stop)
+	{
+		case chip8debugstop_none:        return "none";
+		case chip8debugstop_breakpoint:  return "breakpoint";
+		case chip8debugstop_watch_read:  return "watch read";
+		case chip8debugstop_watch_write: return "watch write";
+		case chip8debugstop_condition:   return "condition";
+		case chip8debugstop_step:        return "step";
+		default: return "unknown";
+	}
+}
+
+const char *dchip8_debug_register_string(u8 reg)
+{
+	LOCAL_PERSIST const char *const NAMES[chip8debugreg_count] = {
+	    "V0", "V1", "V2", "V3", "V4", "V5", "V6", "V7", "V8", "V9",
+	    "VA", "VB", "VC", "VD", "VE", "VF", "I",  "DT", "ST", "SP",
+	};
+
+	if (reg >= chip8debugreg_count) return "?";
+	return NAMES[reg];
+}
@@ -0,0 +1,133 @@
+#ifndef DCHIP8_DEBUG_H
+#define DCHIP8_DEBUG_H
+
+#include "dchip8.h"
+#include "dqnt.h"
+
+// NOTE: Breakpoints, watchpoints and stepping on top of any engine. Nothing in
+// the engines knows about the debugger, while nothing is armed
+// dchip8_debugger_run hands the whole slice to the engine so it runs at full
+// speed. Once something is armed it switches to a checked loop that steps the
+// engine one instruction at a time and tests the stop conditions around each
+// one.
+//
+// Breakpoints and watchpoints stop before the instruction executes, so the
+// machine is left exactly as it was when the instruction was reached. Register
+// conditions stop after the instruction that satisfied them. Running again
+// from a breakpoint or watchpoint steps over it instead of stopping on the
+// same instruction again.
+
+enum Chip8DebugStop
+{
+	chip8debugstop_none,
+	chip8debugstop_breakpoint,
+	chip8debugstop_watch_read,
+	chip8debugstop_watch_write,
+	chip8debugstop_condition,
+	chip8debugstop_step,
+
+	chip8debugstop_count,
+};
+
+enum Chip8WatchAccess
+{
+	chip8watch_read  = 1 << 0,
+	chip8watch_write = 1 << 1,
+};
+
+// NOTE: Only the ROM's own data accesses are watched, i.e. Dxyn, Fx33, Fx55
+// and Fx65, not instruction fetches
+typedef struct Chip8Watchpoint
+{
+	u16 start;
+	// Exclusive
+	u16 end;
+	u32 access; // Chip8WatchAccess flags
+} Chip8Watchpoint;
+
+// NOTE: Register numbering for conditions, V0-VF are 0x0-0xF
+enum Chip8DebugRegister
+{
+	chip8debugreg_I = 16,
+	chip8debugreg_dt,
+	chip8debugreg_st,
+	chip8debugreg_sp,
+
+	chip8debugreg_count,
+};
+
+enum Chip8ConditionType
+{
+	// Stop after any instruction that writes a different value
+	chip8condition_changed,
+	// Stop after the instruction that makes the register equal value
+	chip8condition_equals,
+};
+
+typedef struct Chip8Condition
+{
+	u8                      reg; // Chip8DebugRegister
+	enum Chip8ConditionType type;
+	u16                     value;
+} Chip8Condition;
+
+#define CHIP8_DEBUG_MAX_WATCHPOINTS 16
+#define CHIP8_DEBUG_MAX_CONDITIONS  16
+
+typedef struct Chip8Debugger
+{
+	// Engine being debugged, dchip8_vm_run by default
+	Chip8RunFunc   *run;
+
+	// One bit per address
+	u8              breakpoints[CHIP8_MEMORY_SIZE / 8];
+	u32             numBreakpoints;
+	Chip8Watchpoint watchpoints[CHIP8_DEBUG_MAX_WATCHPOINTS];
+	u32             numWatchpoints;
+	Chip8Condition  conditions[CHIP8_DEBUG_MAX_CONDITIONS];
+	u32             numConditions;
+
+	// NOTE: Why the last run returned. stopAddress is the instruction that
+	// stopped it, stopDetail is the memory address for watchpoints and the
+	// register for conditions.
+	enum Chip8DebugStop stop;
+	u16                 stopAddress;
+	u16                 stopDetail;
+} Chip8Debugger;
+
+// run may be NULL for dchip8_vm_run
+void dchip8_debugger_init          (Chip8Debugger *debugger, Chip8RunFunc *run);
+// Remove every breakpoint, watchpoint and condition
+void dchip8_debugger_clear         (Chip8Debugger *debugger);
+bool dchip8_debugger_armed         (const Chip8Debugger *debugger);
+
+// Return false if the address is out of range
+bool dchip8_debugger_set_breakpoint(Chip8Debugger *debugger, u16 address,
+                                    bool enable);
+bool dchip8_debugger_has_breakpoint(const Chip8Debugger *debugger, u16 address);
+// Return false if the range is empty, out of range or the table is full
+bool dchip8_debugger_add_watchpoint(Chip8Debugger *debugger, u16 address,
+                                    u16 size, u32 access);
+// Return false if the register is invalid or the table is full
+bool dchip8_debugger_add_condition (Chip8Debugger *debugger, u8 reg,
+                                    enum Chip8ConditionType type, u16 value);
+u16  dchip8_debugger_register_value(const Chip8CPU *cpu, u8 reg);
+
+// Same contract as dchip8_vm_run, plus debugger->stop says whether a stop
+// condition ended the slice early
+u32 dchip8_debugger_run      (Chip8Debugger *debugger, Chip8VM *vm,
+                              Chip8Controller controller, u32 cyclesToEmulate);
+// Execute exactly one instruction regardless of what is armed
+u32 dchip8_debugger_step     (Chip8Debugger *debugger, Chip8VM *vm,
+                              Chip8Controller controller);
+// As step, except a 2nnn call runs until the subroutine returns to the next
+// instruction, at most cyclesToEmulate instructions. Anything armed inside the
+// subroutine still stops it.
+u32 dchip8_debugger_step_over(Chip8Debugger *debugger, Chip8VM *vm,
+                              Chip8Controller controller, u32 cyclesToEmulate);
+
+const char *dchip8_debug_stop_string    (enum Chip8DebugStop stop);
+// "V0".."VF", "I", "DT", "ST", "SP"
+const char *dchip8_debug_register_string(u8 reg);
+
+#endif
@@ -0,0 +1,500 @@
+#include "dchip8_disasm.h"
+#include "dqnt.h"
+
+#include <stdio.h>
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Instructions
+////////////////////////////////////////////////////////////////////////////////
+u32 dchip8_disasm_instruction(u16 opcode, char *out, u32 outSize)
+{
+	DQNT_ASSERT(outSize > 0);
+
+	u32 x   = (opcode >> 8) & 0x0F;
+	u32 y   = (opcode >> 4) & 0x0F;
+	u32 n   = opcode & 0x0F;
+	u32 kk  = opcode & 0xFF;
+	u32 nnn = opcode & 0x0FFF;
+	i32 len = -1;
+
+	switch (opcode & 0xF000)
+	{
+		case 0x0000:
+		{
+			if (opcode == 0x00E0)      len = snprintf(out, outSize, "CLS");
+			else if (opcode == 0x00EE) len = snprintf(out, outSize, "RET");
+			else len = snprintf(out, outSize, "SYS 0x%03X", nnn);
+		}
+		break;
+
+		case 0x1000: len = snprintf(out, outSize, "JP 0x%03X", nnn); break;
+		case 0x2000: len = snprintf(out, outSize, "CALL 0x%03X", nnn); break;
+		case 0x3000: len = snprintf(out, outSize, "SE V%X, 0x%02X", x, kk); break;
+		case 0x4000: len = snprintf(out, outSize, "SNE V%X, 0x%02X", x, kk); break;
+		case 0x5000: len = snprintf(out, outSize, "SE V%X, V%X", x, y); break;
+		case 0x6000: len = snprintf(out, outSize, "LD V%X, 0x%02X", x, kk); break;
+		case 0x7000: len = snprintf(out, outSize, "ADD V%X, 0x%02X", x, kk); break;
+
+		case 0x8000:
+		{
+			LOCAL_PERSIST const char *const ALU_MNEMONICS[16] = {
+			    "LD", "OR",   "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+			    NULL, NULL,   NULL,  NULL,  NULL,  NULL,  "SHL", NULL,
+			};
+
+			if (ALU_MNEMONICS[n])
+				len = snprintf(out, outSize, "%s V%X, V%X", ALU_MNEMONICS[n], x, y);
+		}
+		break;
+
+		case 0x9000: len = snprintf(out, outSize, "SNE V%X, V%X", x, y); break;
+		case 0xA000: len = snprintf(out, outSize, "LD I, 0x%03X", nnn); break;
+		case 0xB000: len = snprintf(out, outSize, "JP V0, 0x%03X", nnn); break;
+		case 0xC000: len = snprintf(out, outSize, "RND V%X, 0x%02X", x, kk); break;
+		case 0xD000: len = snprintf(out, outSize, "DRW V%X, V%X, %u", x, y, n); break;
+
+		case 0xE000:
+		{
+			if (kk == 0x9E)      len = snprintf(out, outSize, "SKP V%X", x);
+			else if (kk == 0xA1) len = snprintf(out, outSize, "SKNP V%X", x);
+		}
+		break;
+
+		case 0xF000:
+		{
+			switch (kk)
+			{
+				case 0x07: len = snprintf(out, outSize, "LD V%X, DT", x); break;
+				case 0x0A: len = snprintf(out, outSize, "LD V%X, K", x); break;
+				case 0x15: len = snprintf(out, outSize, "LD DT, V%X", x); break;
+				case 0x18: len = snprintf(out, outSize, "LD ST, V%X", x); break;
+				case 0x1E: len = snprintf(out, outSize, "ADD I, V%X", x); break;
+				case 0x29: len = snprintf(out, outSize, "LD F, V%X", x); break;
+				case 0x33: len = snprintf(out, outSize, "LD B, V%X", x); break;
+				case 0x55: len = snprintf(out, outSize, "LD [I], V%X", x); break;
+				case 0x65: len = snprintf(out, outSize, "LD V%X, [I]", x); break;
+				default: break;
+			}
+		}
+		break;
+	}
+
+	if (len < 0) len = snprintf(out, outSize, "DW 0x%04X", opcode);
+	return DQNT_MATH_MIN((u32)len, outSize - 1);
+}
+
+// NOTE: Decode how control leaves an instruction. Ordinary instructions are
+// chip8blockexit_fallthrough to the next one.
+FILE_SCOPE enum Chip8BlockExit
+dchip8_disasm_classify_internal(u16 opcode, u16 address, u16 *successors,
+                                u8 *numSuccessors)
+{
+	u16 next = address + 2;
+	u16 nnn  = opcode & 0x0FFF;
+	u8 kk    = opcode & 0xFF;
+
+	*numSuccessors = 1;
+	successors[0]  = next;
+
+	enum Chip8BlockExit result = chip8blockexit_fallthrough;
+	switch (opcode & 0xF000)
+	{
+		case 0x0000:
+		{
+			if (opcode == 0x00EE)
+			{
+				*numSuccessors = 0;
+				result         = chip8blockexit_return;
+			}
+		}
+		break;
+
+		case 0x1000:
+		{
+			successors[0] = nnn;
+			result        = chip8blockexit_jump;
+		}
+		break;
+
+		case 0x2000:
+		{
+			successors[0]  = nnn;
+			successors[1]  = next;
+			*numSuccessors = 2;
+			result         = chip8blockexit_call;
+		}
+		break;
+
+		case 0x3000:
+		case 0x4000:
+		case 0x5000:
+		case 0x9000:
+		{
+			successors[1]  = next + 2;
+			*numSuccessors = 2;
+			result         = chip8blockexit_skip;
+		}
+		break;
+
+		case 0x8000:
+		{
+			u8 n = opcode & 0x0F;
+			if (n > 0x07 && n != 0x0E)
+			{
+				*numSuccessors = 0;
+				result         = chip8blockexit_halt;
+			}
+		}
+		break;
+
+		case 0xB000:
+		{
+			*numSuccessors = 0;
+			result         = chip8blockexit_indirect;
+		}
+		break;
+
+		case 0xE000:
+		{
+			if (kk == 0x9E || kk == 0xA1)
+			{
+				successors[1]  = next + 2;
+				*numSuccessors = 2;
+				result         = chip8blockexit_skip;
+			}
+			else
+			{
+				*numSuccessors = 0;
+				result         = chip8blockexit_halt;
+			}
+		}
+		break;
+
+		case 0xF000:
+		{
+			bool valid = (kk == 0x07 || kk == 0x0A || kk == 0x15 ||
+			              kk == 0x18 || kk == 0x1E || kk == 0x29 ||
+			              kk == 0x33 || kk == 0x55 || kk == 0x65);
+			if (!valid)
+			{
+				*numSuccessors = 0;
+				result         = chip8blockexit_halt;
+			}
+		}
+		break;
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Analysis
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE inline bool dchip8_disasm_in_rom_internal(const Chip8Program *program,
+                                                     u32 address)
+{
+	bool result = (address >= INIT_ADDRESS &&
+	               address + 2 <= INIT_ADDRESS + program->romSize);
+	return result;
+}
+
+FILE_SCOPE inline u16 dchip8_disasm_opcode_internal(const Chip8Program *program,
+                                                    u16 address)
+{
+	u16 result =
+	    (u16)((program->memory[address] << 8) | program->memory[address + 1]);
+	return result;
+}
+
+// NOTE: Addresses are marked as instructions when queued rather than when
+// decoded, so each one is queued at most once and the worklist can't overflow
+FILE_SCOPE void dchip8_disasm_queue_internal(Chip8Program *program,
+                                             u32 *numPending, u16 address)
+{
+	if (!dchip8_disasm_in_rom_internal(program, address)) return;
+	if (program->flags[address] & chip8address_instruction) return;
+
+	program->flags[address] |= chip8address_instruction | chip8address_code;
+	program->flags[address + 1] |= chip8address_code;
+	program->worklist[(*numPending)++] = address;
+}
+
+FILE_SCOPE void dchip8_disasm_trace_internal(Chip8Program *program)
+{
+	u32 numPending = 0;
+	program->flags[INIT_ADDRESS] |= chip8address_leader;
+	dchip8_disasm_queue_internal(program, &numPending, INIT_ADDRESS);
+
+	while (numPending > 0)
+	{
+		u16 address = program->worklist[--numPending];
+		u16 opcode  = dchip8_disasm_opcode_internal(program, address);
+		program->numInstructions++;
+
+		if ((opcode & 0xF000) == 0xA000)
+			program->flags[opcode & 0x0FFF] |= chip8address_data_ref;
+
+		u16 successors[2];
+		u8 numSuccessors = 0;
+		enum Chip8BlockExit exit = dchip8_disasm_classify_internal(
+		    opcode, address, successors, &numSuccessors);
+
+		if (exit == chip8blockexit_indirect) program->numIndirectJumps++;
+		for (u32 i = 0; i < numSuccessors; i++)
+		{
+			u16 successor = successors[i];
+			if (successor >= CHIP8_MEMORY_SIZE) continue;
+
+			if (exit != chip8blockexit_fallthrough)
+				program->flags[successor] |= chip8address_leader;
+			if (exit == chip8blockexit_jump)
+				program->flags[successor] |= chip8address_jump_target;
+			if (exit == chip8blockexit_call && i == 0)
+				program->flags[successor] |= chip8address_call_target;
+
+			dchip8_disasm_queue_internal(program, &numPending, successor);
+		}
+	}
+}
+
+FILE_SCOPE void dchip8_disasm_build_block_internal(Chip8Program *program,
+                                                   u16 start)
+{
+	DQNT_ASSERT(program->numBlocks < CHIP8_DISASM_MAX_BLOCKS);
+	Chip8BasicBlock *block = &program->blocks[program->numBlocks++];
+	*block                 = {};
+	block->start           = start;
+
+	u16 address = start;
+	for (;;)
+	{
+		u16 opcode = dchip8_disasm_opcode_internal(program, address);
+		u16 successors[2];
+		u8 numSuccessors = 0;
+		enum Chip8BlockExit exit = dchip8_disasm_classify_internal(
+		    opcode, address, successors, &numSuccessors);
+		block->numInstructions++;
+
+		u16 next = address + 2;
+		bool nextIsInstruction =
+		    dchip8_disasm_in_rom_internal(program, next) &&
+		    (program->flags[next] & chip8address_instruction);
+
+		if (exit == chip8blockexit_fallthrough)
+		{
+			if (!nextIsInstruction)
+			{
+				exit          = chip8blockexit_halt;
+				numSuccessors = 0;
+			}
+			else if (!(program->flags[next] & chip8address_leader))
+			{
+				address = next;
+				continue;
+			}
+		}
+
+		// NOTE: Successors outside of the ROM were never traced and are left
+		// out of the graph
+		block->end  = next;
+		block->exit = (u8)exit;
+		for (u32 i = 0; i < numSuccessors; i++)
+		{
+			if (dchip8_disasm_in_rom_internal(program, successors[i]))
+				block->successors[block->numSuccessors++] = successors[i];
+		}
+		break;
+	}
+}
+
+bool dchip8_disasm_analyse(Chip8Program *program, const u8 *rom, u32 romSize)
+{
+	if (romSize > CHIP8_MAX_ROM_SIZE) return false;
+
+	memset(program->memory, 0, sizeof(program->memory));
+	memset(program->flags, 0, sizeof(program->flags));
+	memcpy(program->memory + INIT_ADDRESS, rom, romSize);
+	program->romSize          = romSize;
+	program->numInstructions  = 0;
+	program->numCodeBytes     = 0;
+	program->numIndirectJumps = 0;
+	program->numBlocks        = 0;
+
+	dchip8_disasm_trace_internal(program);
+
+	u32 romEnd = INIT_ADDRESS + romSize;
+	for (u32 address = INIT_ADDRESS; address < romEnd; address++)
+	{
+		u8 flags = program->flags[address];
+		if (flags & chip8address_code) program->numCodeBytes++;
+		if ((flags & chip8address_instruction) && (flags & chip8address_leader))
+			dchip8_disasm_build_block_internal(program, (u16)address);
+	}
+
+	return true;
+}
+
+i32 dchip8_disasm_find_block(const Chip8Program *program, u16 address)
+{
+	i32 low  = 0;
+	i32 high = (i32)program->numBlocks - 1;
+	while (low <= high)
+	{
+		i32 mid   = low + ((high - low) / 2);
+		u16 start = program->blocks[mid].start;
+		if (start == address) return mid;
+		if (start < address) low = mid + 1;
+		else                 high = mid - 1;
+	}
+
+	return -1;
+}
+
+const char *dchip8_block_exit_string(enum Chip8BlockExit exit)
+{
+	switch (exit)
+	{
+		case chip8blockexit_fallthrough: return "fallthrough";
+		case chip8blockexit_jump:        return "jump";
+		case chip8blockexit_call:        return "call";
+		case chip8blockexit_return:      return "return";
+		case chip8blockexit_skip:        return "skip";
+		case chip8blockexit_indirect:    return "indirect";
+		case chip8blockexit_halt:        return "halt";
+		default: return "unknown";
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Output
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE void dchip8_disasm_print_block_internal(const Chip8Program *program,
+                                                   const Chip8BasicBlock *block,
+                                                   FILE *file)
+{
+	fprintf(file, "block_%03X:%s\n", block->start,
+	        (program->flags[block->start] & chip8address_call_target)
+	            ? " ; subroutine"
+	            : "");
+
+	char mnemonic[32];
+	u16 address = block->start;
+	for (u32 i = 0; i < block->numInstructions; i++, address += 2)
+	{
+		u16 opcode = dchip8_disasm_opcode_internal(program, address);
+		dchip8_disasm_instruction(opcode, mnemonic, sizeof(mnemonic));
+		fprintf(file, "  %03X  %04X  %s\n", address, opcode, mnemonic);
+	}
+
+	fprintf(file, "  ; %s",
+	        dchip8_block_exit_string((enum Chip8BlockExit)block->exit));
+	for (u32 i = 0; i < block->numSuccessors; i++)
+		fprintf(file, "%s block_%03X", i ? "," : " ->", block->successors[i]);
+	fprintf(file, "\n\n");
+}
+
+void dchip8_disasm_print_text(const Chip8Program *program, FILE *file)
+{
+	fprintf(file,
+	        "; %u bytes, %u instructions in %u blocks, %u code bytes, %u data "
+	        "bytes, %u indirect jumps\n\n",
+	        program->romSize, program->numInstructions, program->numBlocks,
+	        program->numCodeBytes, program->romSize - program->numCodeBytes,
+	        program->numIndirectJumps);
+
+	// NOTE: Walk the ROM in address order so data is listed between the code
+	// around it
+	const u32 BYTES_PER_DATA_LINE = 8;
+	u32 romEnd     = INIT_ADDRESS + program->romSize;
+	u32 blockIndex = 0;
+	u32 lineLength = 0;
+	for (u32 address = INIT_ADDRESS; address < romEnd; address++)
+	{
+		u8 flags = program->flags[address];
+		if (blockIndex < program->numBlocks &&
+		    program->blocks[blockIndex].start == address)
+		{
+			if (lineLength) fprintf(file, "\n\n");
+			lineLength = 0;
+			dchip8_disasm_print_block_internal(
+			    program, &program->blocks[blockIndex++], file);
+		}
+
+		if (flags & chip8address_code) continue;
+
+		if (flags & chip8address_data_ref)
+		{
+			if (lineLength) fprintf(file, "\n");
+			fprintf(file, "data_%03X:\n", address);
+			lineLength = 0;
+		}
+
+		if (lineLength == BYTES_PER_DATA_LINE)
+		{
+			fprintf(file, "\n");
+			lineLength = 0;
+		}
+
+		if (lineLength == 0) fprintf(file, "  %03X  DB", address);
+		fprintf(file, " 0x%02X", program->memory[address]);
+		lineLength++;
+
+		if (address + 1 < romEnd && (program->flags[address + 1] &
+		                             (chip8address_code | chip8address_data_ref)))
+		{
+			fprintf(file, "\n\n");
+			lineLength = 0;
+		}
+	}
+
+	if (lineLength) fprintf(file, "\n");
+}
+
+void dchip8_disasm_print_dot(const Chip8Program *program, FILE *file)
+{
+	fprintf(file, "digraph rom {\n");
+	fprintf(file, "  node [shape=box fontname=\"monospace\"];\n");
+
+	char mnemonic[32];
+	for (u32 blockIndex = 0; blockIndex < program->numBlocks; blockIndex++)
+	{
+		const Chip8BasicBlock *block = &program->blocks[blockIndex];
+		fprintf(file, "  b%03X [label=\"", block->start);
+
+		u16 address = block->start;
+		for (u32 i = 0; i < block->numInstructions; i++, address += 2)
+		{
+			u16 opcode = dchip8_disasm_opcode_internal(program, address);
+			dchip8_disasm_instruction(opcode, mnemonic, sizeof(mnemonic));
+			fprintf(file, "%03X  %s\\l", address, mnemonic);
+		}
+
+		const char *style = "";
+		if (block->exit == chip8blockexit_indirect ||
+		    block->exit == chip8blockexit_halt)
+			style = " color=red";
+		else if (program->flags[block->start] & chip8address_call_target)
+			style = " peripheries=2";
+		fprintf(file, "\"%s];\n", style);
+	}
+
+	for (u32 blockIndex = 0; blockIndex < program->numBlocks; blockIndex++)
+	{
+		const Chip8BasicBlock *block = &program->blocks[blockIndex];
+		for (u32 i = 0; i < block->numSuccessors; i++)
+		{
+			const char *label = "";
+			if (block->exit == chip8blockexit_skip)
+				label = (i == 0) ? " [label=\"no skip\"]" : " [label=\"skip\"]";
+			else if (block->exit == chip8blockexit_call)
+				label = (i == 0) ? " [label=\"call\"]"
+				                 : " [label=\"return\" style=dashed]";
+
+			fprintf(file, "  b%03X -> b%03X%s;\n", block->start,
+			        block->successors[i], label);
+		}
+	}
+
+	fprintf(file, "}\n");
+}
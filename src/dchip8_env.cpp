@@ -0,0 +1,364 @@
+#include "dchip8.h"
+#include "dchip8_env.h"
+#include "dchip8_trace.h"
+#include "dqnt.h"
+
+#include "stdlib.h"
+#include "string.h"
+
+enum Chip8EnvJob
+{
+	chip8envjob_reset,
+	chip8envjob_step,
+	chip8envjob_quit,
+};
+
+// NOTE: Every instance runs the same ROM so they share the pages of memory
+// they haven't written with bootVM, see Chip8PagedVM
+typedef struct Chip8EnvInstance
+{
+	Chip8PagedVM vm;
+	u32          framesInEpisode;
+	u32          episode;
+	uint64_t     episodeState;
+} Chip8EnvInstance;
+
+// NOTE: The calling thread and each worker always process the same slice of
+// the batch, in their own view with their own pool of private pages. A pool
+// holds every page of its slice so it can never run out.
+typedef struct Chip8EnvSlice
+{
+	Chip8PageView view;
+	Chip8Pool     pool;
+} Chip8EnvSlice;
+
+typedef struct Chip8EnvWorker
+{
+	struct Chip8Env *env;
+	u32              index;
+	DqntThread       thread;
+} Chip8EnvWorker;
+
+struct Chip8Env
+{
+	Chip8EnvConfig    config;
+	Chip8VM           bootVM;
+	Chip8EnvInstance *instances;
+	// NOTE: One per thread, numWorkers + 1 are in use
+	Chip8EnvSlice    *slices;
+	// NOTE: One per instance, NULL when tracing is off
+	Chip8Trace       *traces;
+
+	// NOTE: Workers wait on jobSignal, process their slice of the batch and
+	// bump numFinished. The job fields are written before the signal is
+	// published.
+	Chip8EnvWorker   *workers;
+	u32               numWorkers;
+	DqntSignal        jobSignal;
+	volatile u32      numFinished;
+	enum Chip8EnvJob  job;
+	const uint16_t   *actions;
+	uint8_t          *observations;
+	float            *rewards;
+	uint8_t          *dones;
+};
+
+FILE_SCOPE void dchip8_env_reset_instance_internal(Chip8Env *env,
+                                                   Chip8EnvSlice *slice,
+                                                   u32 index)
+{
+	Chip8EnvInstance *instance = &env->instances[index];
+	dchip8_paged_vm_release(&instance->vm, &slice->pool, &slice->view);
+	dchip8_paged_vm_init(&instance->vm, &env->bootVM);
+
+	// NOTE: Give every environment and episode its own random sequence
+	u32 seed = env->config.seed + index + (instance->episode * 0x9E3779B9);
+	dqnt_rnd_pcg_seed(&instance->vm.pcgState, seed);
+
+	instance->framesInEpisode = 0;
+	instance->episodeState    = 0;
+	instance->episode++;
+}
+
+FILE_SCOPE inline void
+dchip8_env_write_observation_internal(const Chip8PagedVM *vm,
+                                      uint8_t *observation)
+{
+	memcpy(observation, vm->display, DCHIP8_ENV_OBSERVATION_SIZE);
+}
+
+FILE_SCOPE void dchip8_env_slice_range_internal(const Chip8Env *env, u32 slice,
+                                                u32 *first, u32 *last)
+{
+	u32 numSlices = env->numWorkers + 1;
+	u32 batchSize = env->config.batchSize;
+	*first        = (u32)(((u64)batchSize * slice) / numSlices);
+	*last         = (u32)(((u64)batchSize * (slice + 1)) / numSlices);
+}
+
+FILE_SCOPE void dchip8_env_process_range_internal(Chip8Env *env,
+                                                  Chip8EnvSlice *slice,
+                                                  u32 first, u32 last)
+{
+	const Chip8EnvConfig *config = &env->config;
+	for (u32 index = first; index < last; index++)
+	{
+		Chip8EnvInstance *instance = &env->instances[index];
+		uint8_t *observation =
+		    env->observations + ((size_t)index * DCHIP8_ENV_OBSERVATION_SIZE);
+
+		if (env->job == chip8envjob_reset)
+		{
+			dchip8_env_reset_instance_internal(env, slice, index);
+			dchip8_env_write_observation_internal(&instance->vm, observation);
+			continue;
+		}
+
+		dchip8_page_view_load(&slice->view, &instance->vm);
+		Chip8VM *vm = &slice->view.vm;
+		Chip8Controller controller =
+		    dchip8_controller_from_bitmask(env->actions[index]);
+		for (u32 frame = 0; frame < config->framesPerStep; frame++)
+		{
+			if (env->traces)
+				dchip8_vm_run_traced(vm, controller, config->cyclesPerFrame,
+				                     &env->traces[index]);
+			else
+				dchip8_vm_run(vm, controller, config->cyclesPerFrame);
+			dchip8_vm_tick_timers(vm);
+		}
+		instance->framesInEpisode += config->framesPerStep;
+
+		float reward = 0;
+		if (config->rewardFunc)
+		{
+			reward = config->rewardFunc(vm->memory, &instance->episodeState,
+			                            config->rewardUserData);
+		}
+
+		bool done = (vm->cpu.state == chip8state_fault) ||
+		            (config->maxFramesPerEpisode &&
+		             instance->framesInEpisode >= config->maxFramesPerEpisode);
+		if (done)
+		{
+			dchip8_env_reset_instance_internal(env, slice, index);
+		}
+		else
+		{
+			bool stored = dchip8_page_view_store(&slice->view, &instance->vm,
+			                                     &slice->pool);
+			DQNT_ASSERT(stored);
+		}
+
+		dchip8_env_write_observation_internal(&instance->vm, observation);
+		if (env->rewards) env->rewards[index] = reward;
+		if (env->dones)   env->dones[index]   = done;
+	}
+}
+
+// NOTE: Slice 0 is run by the calling thread, slice N by worker N - 1
+FILE_SCOPE void dchip8_env_process_slice_internal(Chip8Env *env, u32 slice)
+{
+	u32 first, last;
+	dchip8_env_slice_range_internal(env, slice, &first, &last);
+	dchip8_env_process_range_internal(env, &env->slices[slice], first, last);
+}
+
+FILE_SCOPE u32 dchip8_env_worker_internal(void *userData)
+{
+	Chip8EnvWorker *worker = (Chip8EnvWorker *)userData;
+	Chip8Env *env          = worker->env;
+
+	u32 seenGeneration = 0;
+	for (;;)
+	{
+		seenGeneration = dqnt_signal_wait(&env->jobSignal, seenGeneration);
+
+		if (env->job == chip8envjob_quit) break;
+		dchip8_env_process_slice_internal(env, worker->index + 1);
+		dqnt_atomic_add_u32(&env->numFinished, 1);
+	}
+
+	return 0;
+}
+
+FILE_SCOPE void dchip8_env_dispatch_internal(Chip8Env *env,
+                                              enum Chip8EnvJob job)
+{
+	env->job = job;
+	dqnt_atomic_store_u32(&env->numFinished, 0);
+	dqnt_signal_publish(&env->jobSignal);
+	if (job == chip8envjob_quit) return;
+
+	dchip8_env_process_slice_internal(env, 0);
+	dqnt_spin_until_u32(&env->numFinished, env->numWorkers);
+}
+
+Chip8Env *dchip8_env_create(const Chip8EnvConfig *config, const uint8_t *rom,
+                            uint32_t romSize)
+{
+	if (config->batchSize == 0) return NULL;
+
+	u32 batchSize  = config->batchSize;
+	u32 numThreads = config->numThreads;
+	if (numThreads == 0) numThreads = dqnt_num_cores();
+	numThreads = DQNT_MATH_MIN(numThreads, batchSize);
+
+	// NOTE: Everything the environment owns comes from one block so creation
+	// is a single allocation and destruction a single free. Instances are
+	// cache line aligned so workers on neighbouring slices don't share lines.
+	// The pools have room for every page of every instance but a page is
+	// only touched once an instance writes it, the rest is never made
+	// resident.
+	const size_t CACHE_LINE = 64;
+	size_t blockSize = sizeof(Chip8Env) + (CACHE_LINE * 4) +
+	                   (sizeof(Chip8EnvInstance) * batchSize) +
+	                   (sizeof(Chip8EnvWorker) * numThreads) +
+	                   ((sizeof(Chip8EnvSlice) + CACHE_LINE) * numThreads) +
+	                   ((size_t)CHIP8_PAGE_SIZE * CHIP8_NUM_PAGES * batchSize);
+	if (config->traceLength)
+	{
+		blockSize += (sizeof(Chip8Trace) * batchSize) + alignof(Chip8Trace) +
+		             (dchip8_trace_memory_size(config->traceLength) * batchSize);
+	}
+
+	void *block = malloc(blockSize);
+	if (!block) return NULL;
+
+	Chip8Arena arena;
+	dchip8_arena_init(&arena, block, blockSize);
+
+	Chip8Env *env = DCHIP8_ARENA_PUSH_STRUCT(&arena, Chip8Env);
+	env->config   = *config;
+	if (env->config.cyclesPerFrame == 0) env->config.cyclesPerFrame = 15;
+	if (env->config.framesPerStep == 0)  env->config.framesPerStep  = 1;
+
+	env->instances = (Chip8EnvInstance *)dchip8_arena_push_zero(
+	    &arena, sizeof(Chip8EnvInstance) * batchSize, CACHE_LINE);
+	env->workers = DCHIP8_ARENA_PUSH_ARRAY(&arena, Chip8EnvWorker, numThreads);
+	env->slices  = (Chip8EnvSlice *)dchip8_arena_push_zero(
+	    &arena, sizeof(Chip8EnvSlice) * numThreads, CACHE_LINE);
+	DQNT_ASSERT(env->instances && env->workers && env->slices);
+	if (!dchip8_vm_load_rom(&env->bootVM, rom, romSize))
+	{
+		dchip8_env_destroy(env);
+		return NULL;
+	}
+
+	for (u32 i = 0; i < batchSize; i++)
+		dchip8_paged_vm_init(&env->instances[i].vm, &env->bootVM);
+
+	if (env->config.traceLength)
+	{
+		env->traces = DCHIP8_ARENA_PUSH_ARRAY(&arena, Chip8Trace, batchSize);
+		for (u32 i = 0; i < batchSize; i++)
+		{
+			bool traced = dchip8_trace_init(&env->traces[i], &arena,
+			                                 env->config.traceLength, i);
+			DQNT_ASSERT(traced);
+		}
+
+		if (env->config.traceCrashPath &&
+		    !dchip8_trace_set_crash_dump(env->config.traceCrashPath,
+		                                 env->traces, batchSize))
+		{
+			dchip8_env_destroy(env);
+			return NULL;
+		}
+	}
+
+	// NOTE: Without a signal to wait on the caller runs every slice itself
+	if (numThreads > 1 && !dqnt_signal_init(&env->jobSignal)) numThreads = 1;
+	for (u32 i = 0; i + 1 < numThreads; i++)
+	{
+		Chip8EnvWorker *worker = &env->workers[env->numWorkers];
+		worker->env            = env;
+		worker->index          = env->numWorkers;
+		if (dqnt_thread_create(&worker->thread, dchip8_env_worker_internal,
+		                       worker))
+		{
+			env->numWorkers++;
+		}
+	}
+
+	// NOTE: Slices are only known once the workers are, the workers don't
+	// touch them before the first job
+	for (u32 i = 0; i < env->numWorkers + 1; i++)
+	{
+		u32 first, last;
+		dchip8_env_slice_range_internal(env, i, &first, &last);
+
+		Chip8EnvSlice *slice = &env->slices[i];
+		dchip8_page_view_init(&slice->view);
+		bool pooled = dchip8_pool_init(&slice->pool, &arena, CHIP8_PAGE_SIZE,
+		                               (last - first) * CHIP8_NUM_PAGES,
+		                               CACHE_LINE);
+		DQNT_ASSERT(pooled);
+	}
+
+	return env;
+}
+
+void dchip8_env_destroy(Chip8Env *env)
+{
+	if (!env) return;
+
+	if (env->numWorkers > 0)
+	{
+		dchip8_env_dispatch_internal(env, chip8envjob_quit);
+		for (u32 i = 0; i < env->numWorkers; i++)
+			dqnt_thread_join(&env->workers[i].thread);
+	}
+	dqnt_signal_free(&env->jobSignal);
+
+	if (env->traces && env->config.traceCrashPath)
+		dchip8_trace_set_crash_dump(NULL, NULL, 0);
+
+	// NOTE: env is the start of the block everything else was pushed into
+	free(env);
+}
+
+void dchip8_env_reset(Chip8Env *env, uint8_t *observations)
+{
+	env->observations = observations;
+	env->rewards      = NULL;
+	env->dones        = NULL;
+	dchip8_env_dispatch_internal(env, chip8envjob_reset);
+}
+
+void dchip8_env_step(Chip8Env *env, const uint16_t *actions,
+                     uint8_t *observations, float *rewards, uint8_t *dones)
+{
+	env->actions      = actions;
+	env->observations = observations;
+	env->rewards      = rewards;
+	env->dones        = dones;
+	dchip8_env_dispatch_internal(env, chip8envjob_step);
+}
+
+int dchip8_env_write_trace(Chip8Env *env, uint32_t index, const char *path)
+{
+	if (!env->traces || index >= env->config.batchSize) return 0;
+
+	FILE *file = fopen(path, "ab");
+	if (!file) return 0;
+
+	bool result = dchip8_trace_write(&env->traces[index], file);
+	if (fclose(file) != 0) result = false;
+	return result ? 1 : 0;
+}
+
+float dchip8_env_reward_u8_delta(const uint8_t *memory, uint64_t *episodeState,
+                                 void *userData)
+{
+	u32 address = (u32)(uintptr_t)userData;
+	if (address >= CHIP8_MEMORY_SIZE) return 0;
+
+	// NOTE: Store value + 1 so the zeroed state means nothing seen yet
+	u8 value     = memory[address];
+	float result = 0;
+	if (*episodeState) result = (float)value - (float)(*episodeState - 1);
+
+	*episodeState = (uint64_t)value + 1;
+	return result;
+}
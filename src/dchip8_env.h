@@ -0,0 +1,92 @@
+#ifndef DCHIP8_ENV_H
+#define DCHIP8_ENV_H
+
+// NOTE: Batched environment API for training agents. A batch of machines runs
+// the same ROM, every call advances all of them and writes results straight
+// into caller owned arrays. Plain C so it can be bound from other languages.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _WIN32
+	#define DCHIP8_ENV_API __declspec(dllexport)
+#else
+	#define DCHIP8_ENV_API __attribute__((visibility("default")))
+#endif
+
+// NOTE: An observation is the packed 64x32 display, 32 rows of uint64_t from
+// the top, the most significant bit of a row is the left most pixel.
+#define DCHIP8_ENV_OBSERVATION_SIZE 256
+
+// Return the reward for the step that just finished. memory is the 4096 bytes
+// of guest RAM. episodeState is scratch owned by this environment that is
+// zeroed on every reset, i.e. to remember the last score seen. Called
+// concurrently for different environments.
+typedef float Chip8EnvRewardFunc(const uint8_t *memory, uint64_t *episodeState,
+                                 void *userData);
+
+typedef struct Chip8EnvConfig
+{
+	uint32_t batchSize;
+	// 0 uses every core
+	uint32_t numThreads;
+	// Instructions per 60hz frame, 0 defaults to 15
+	uint32_t cyclesPerFrame;
+	// Frames the action is held for per step, 0 defaults to 1
+	uint32_t framesPerStep;
+	// Episodes are truncated after this many frames, 0 for no limit
+	uint32_t maxFramesPerEpisode;
+	// Environment N seeds its random number generator with seed + N
+	uint32_t seed;
+
+	// NULL for no reward
+	Chip8EnvRewardFunc *rewardFunc;
+	void               *rewardUserData;
+
+	// Keep the last traceLength instructions of every environment, rounded
+	// up to a power of 2, 0 to not trace. See dchip8_trace.h.
+	uint32_t            traceLength;
+	// If set the traces of every environment are written here if the
+	// process crashes
+	const char         *traceCrashPath;
+} Chip8EnvConfig;
+
+typedef struct Chip8Env Chip8Env;
+
+// Return NULL if the ROM does not fit in memory or allocation failed
+DCHIP8_ENV_API Chip8Env *dchip8_env_create (const Chip8EnvConfig *config,
+                                            const uint8_t *rom,
+                                            uint32_t romSize);
+DCHIP8_ENV_API void      dchip8_env_destroy(Chip8Env *env);
+
+// Reset every environment. observations must hold batchSize *
+// DCHIP8_ENV_OBSERVATION_SIZE bytes.
+DCHIP8_ENV_API void dchip8_env_reset(Chip8Env *env, uint8_t *observations);
+
+// Advance every environment by one step. actions[N] is the key bitmask for
+// environment N, bit K set means hex key K is down. rewards and dones hold
+// batchSize entries and may be NULL. An environment that faults or reaches
+// maxFramesPerEpisode reports done and is reset, its observation is then the
+// first frame of the new episode.
+DCHIP8_ENV_API void dchip8_env_step(Chip8Env *env, const uint16_t *actions,
+                                    uint8_t *observations, float *rewards,
+                                    uint8_t *dones);
+
+// Append environment index's trace to the file at path. Return 0 if tracing is
+// off, index is out of range or the file couldn't be written.
+DCHIP8_ENV_API int dchip8_env_write_trace(Chip8Env *env, uint32_t index,
+                                          const char *path);
+
+// Built-in reward, the change in the byte at guest address (uintptr_t)userData
+DCHIP8_ENV_API float dchip8_env_reward_u8_delta(const uint8_t *memory,
+                                                uint64_t *episodeState,
+                                                void *userData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
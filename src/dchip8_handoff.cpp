@@ -0,0 +1,107 @@
+#include "dchip8_handoff.h"
+#include "dqnt.h"
+
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// Frame Triple Buffer
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: dqnt has no atomic exchange, a compare swap loop does the same job
+FILE_SCOPE u32 dchip8_triple_buffer_exchange_internal(volatile u32 *dest,
+                                                      u32 value)
+{
+	u32 expected = dqnt_atomic_load_u32(dest);
+	for (;;)
+	{
+		u32 prev = dqnt_atomic_compare_swap_u32(dest, value, expected);
+		if (prev == expected) return prev;
+		expected = prev;
+	}
+}
+
+void dchip8_triple_buffer_init(Chip8TripleBuffer *buffer)
+{
+	memset(buffer->slots, 0, sizeof(buffer->slots));
+	buffer->back  = 0;
+	buffer->front = 1;
+	dqnt_atomic_store_u32(&buffer->middle, 2);
+}
+
+Chip8PresentFrame *dchip8_triple_buffer_back(Chip8TripleBuffer *buffer)
+{
+	Chip8PresentFrame *result = &buffer->slots[buffer->back];
+	return result;
+}
+
+void dchip8_triple_buffer_publish(Chip8TripleBuffer *buffer)
+{
+	// NOTE: If the consumer never took the previous frame it comes back as the
+	// new back slot and is simply overwritten
+	u32 prev = dchip8_triple_buffer_exchange_internal(
+	    &buffer->middle, buffer->back | CHIP8_TRIPLE_BUFFER_FRESH);
+	buffer->back = prev & ~CHIP8_TRIPLE_BUFFER_FRESH;
+}
+
+bool dchip8_triple_buffer_acquire(Chip8TripleBuffer *buffer)
+{
+	if ((dqnt_atomic_load_u32(&buffer->middle) & CHIP8_TRIPLE_BUFFER_FRESH) == 0)
+		return false;
+
+	u32 prev =
+	    dchip8_triple_buffer_exchange_internal(&buffer->middle, buffer->front);
+	buffer->front = prev & ~CHIP8_TRIPLE_BUFFER_FRESH;
+	return true;
+}
+
+const Chip8PresentFrame *
+dchip8_triple_buffer_front(const Chip8TripleBuffer *buffer)
+{
+	const Chip8PresentFrame *result = &buffer->slots[buffer->front];
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Input Queue
+////////////////////////////////////////////////////////////////////////////////
+bool dchip8_input_queue_push(Chip8InputQueue *queue, Chip8InputEvent event)
+{
+	u32 writeIndex = queue->writeIndex;
+	u32 readIndex  = dqnt_atomic_load_u32(&queue->readIndex);
+	if (writeIndex - readIndex >= CHIP8_INPUT_QUEUE_SIZE)
+	{
+		queue->numDropped++;
+		return false;
+	}
+
+	queue->events[writeIndex % CHIP8_INPUT_QUEUE_SIZE] = event;
+	dqnt_atomic_store_u32(&queue->writeIndex, writeIndex + 1);
+	return true;
+}
+
+bool dchip8_input_queue_pop(Chip8InputQueue *queue, Chip8InputEvent *event)
+{
+	u32 readIndex  = queue->readIndex;
+	u32 writeIndex = dqnt_atomic_load_u32(&queue->writeIndex);
+	if (readIndex == writeIndex) return false;
+
+	*event = queue->events[readIndex % CHIP8_INPUT_QUEUE_SIZE];
+	dqnt_atomic_store_u32(&queue->readIndex, readIndex + 1);
+	return true;
+}
+
+void dchip8_input_queue_drain(Chip8InputQueue *queue, PlatformInput *input)
+{
+	Chip8InputEvent event;
+	while (dchip8_input_queue_pop(queue, &event))
+	{
+		if (event.key >= key_count) continue;
+
+		KeyState *key = &input->key[event.key];
+		bool isDown   = (event.isDown != 0);
+		if (key->endedDown != isDown)
+		{
+			key->endedDown = isDown;
+			key->halfTransitionCount++;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#ifndef DCHIP8_HANDOFF_H
+#define DCHIP8_HANDOFF_H
+
+#include "dchip8.h"
+#include "dchip8_platform.h"
+#include "dqnt.h"
+
+// NOTE: Lock free handoff between an emulation thread and a presentation
+// thread. Finished frames go forward through a triple buffer, key events come
+// back through a single producer single consumer ring. Neither side ever waits
+// on the other, a slow presenter only skips frames and a slow emulator only
+// means the same frame is presented again.
+
+////////////////////////////////////////////////////////////////////////////////
+// Frame Triple Buffer
+////////////////////////////////////////////////////////////////////////////////
+typedef struct Chip8PresentFrame
+{
+	u64  display[CHIP8_DISPLAY_HEIGHT];
+	// NOTE: ARGB, top row first. Only valid when hasPixels is set, i.e. when
+	// the emulator ran a post-process such as the phosphor filter.
+	u32  pixels[CHIP8_DISPLAY_WIDTH * CHIP8_DISPLAY_HEIGHT];
+	bool hasPixels;
+	u32  state;
+	u64  frameNumber;
+} Chip8PresentFrame;
+
+// Set in middle while it holds a frame the consumer hasn't taken yet
+#define CHIP8_TRIPLE_BUFFER_FRESH 0x4
+
+// NOTE: The producer owns back, the consumer owns front and middle holds the
+// newest published frame. Publishing and acquiring each swap their slot with
+// the middle one in a single atomic step.
+typedef struct Chip8TripleBuffer
+{
+	Chip8PresentFrame slots[3];
+	volatile u32      middle;
+	u32               back;
+	u32               front;
+} Chip8TripleBuffer;
+
+void                     dchip8_triple_buffer_init   (Chip8TripleBuffer *buffer);
+// Producer, the slot to write the next frame into
+Chip8PresentFrame       *dchip8_triple_buffer_back   (Chip8TripleBuffer *buffer);
+void                     dchip8_triple_buffer_publish(Chip8TripleBuffer *buffer);
+// Consumer, take the newest frame if one was published since the last call.
+// Return false if front is still the newest.
+bool                     dchip8_triple_buffer_acquire(Chip8TripleBuffer *buffer);
+const Chip8PresentFrame *dchip8_triple_buffer_front  (const Chip8TripleBuffer *buffer);
+
+////////////////////////////////////////////////////////////////////////////////
+// Input Queue
+////////////////////////////////////////////////////////////////////////////////
+typedef struct Chip8InputEvent
+{
+	u8 key; // enum Key
+	u8 isDown;
+} Chip8InputEvent;
+
+#define CHIP8_INPUT_QUEUE_SIZE 256
+typedef struct Chip8InputQueue
+{
+	Chip8InputEvent events[CHIP8_INPUT_QUEUE_SIZE];
+	volatile u32    readIndex;
+	volatile u32    writeIndex;
+	u32             numDropped;
+} Chip8InputQueue;
+
+// Producer, return false and count the event as dropped if the queue is full
+bool dchip8_input_queue_push (Chip8InputQueue *queue, Chip8InputEvent event);
+// Consumer, return false if the queue is empty
+bool dchip8_input_queue_pop  (Chip8InputQueue *queue, Chip8InputEvent *event);
+// Consumer, apply every queued event to input's key states
+void dchip8_input_queue_drain(Chip8InputQueue *queue, PlatformInput *input);
+
+#endif
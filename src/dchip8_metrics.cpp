@@ -0,0 +1,268 @@
+#include "dchip8_metrics.h"
+#include "dqnt.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <Windows.h>
+#endif
+
+// NOTE: Upper bounds of every bucket but the last, which is +Inf, so each table
+// is at most CHIP8_METRICS_MAX_BUCKETS - 1 long. Frame and phase times straddle
+// the 16.7ms and 33.3ms frame periods.
+FILE_SCOPE const f64 CHIP8_METRICS_TIME_BOUNDS[] = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.0167,
+    0.025,  0.0334,  0.05,   0.1,   0.25,   1.0,
+};
+
+FILE_SCOPE const f64 CHIP8_METRICS_INSTRUCTION_RATE_BOUNDS[] = {
+    60,    120,   250,    500,    1000,   2000,   4000,
+    8000,  16000, 32000,  64000,  128000, 256000, 1000000,
+};
+
+FILE_SCOPE const f64 CHIP8_METRICS_TIMER_RATE_BOUNDS[] = {
+    10, 20, 30, 40, 50, 55, 58, 59, 60, 61, 62, 65, 75, 120,
+};
+
+FILE_SCOPE void dchip8_histogram_observe_internal(Chip8Histogram *histogram,
+                                                  const f64 *bounds,
+                                                  u32 numBounds, f64 value)
+{
+	u32 bucket = 0;
+	while (bucket < numBounds && value > bounds[bucket]) bucket++;
+
+	histogram->buckets[bucket]++;
+	histogram->count++;
+	histogram->sum += value;
+}
+
+void dchip8_metrics_record(Chip8Metrics *metrics, const Chip8FrameSample *sample)
+{
+	dqnt_atomic_add_u32(&metrics->sequence, 1);
+
+	f64 frameTime = sample->frameTimeInS;
+	dchip8_histogram_observe_internal(
+	    &metrics->frameTime, CHIP8_METRICS_TIME_BOUNDS,
+	    DQNT_ARRAY_COUNT(CHIP8_METRICS_TIME_BOUNDS), frameTime);
+
+	// NOTE: A zero frame time only happens on the first frame of an unpaced
+	// run, it has no meaningful rate. Timers only tick while one is running so
+	// frames without a tick say nothing about the tick rate.
+	if (frameTime > 0)
+	{
+		dchip8_histogram_observe_internal(
+		    &metrics->instructionRate, CHIP8_METRICS_INSTRUCTION_RATE_BOUNDS,
+		    DQNT_ARRAY_COUNT(CHIP8_METRICS_INSTRUCTION_RATE_BOUNDS),
+		    sample->numInstructions / frameTime);
+
+		if (sample->numTimerTicks > 0)
+		{
+			dchip8_histogram_observe_internal(
+			    &metrics->timerTickRate, CHIP8_METRICS_TIMER_RATE_BOUNDS,
+			    DQNT_ARRAY_COUNT(CHIP8_METRICS_TIMER_RATE_BOUNDS),
+			    sample->numTimerTicks / frameTime);
+		}
+	}
+
+	for (u32 phase = 0; phase < chip8phase_count; phase++)
+	{
+		dchip8_histogram_observe_internal(
+		    &metrics->phaseTime[phase], CHIP8_METRICS_TIME_BOUNDS,
+		    DQNT_ARRAY_COUNT(CHIP8_METRICS_TIME_BOUNDS),
+		    sample->phaseTimeInS[phase]);
+	}
+
+	metrics->numFrames++;
+	metrics->numInstructions += sample->numInstructions;
+	metrics->numTimerTicks += sample->numTimerTicks;
+
+	dqnt_atomic_add_u32(&metrics->sequence, 1);
+}
+
+void dchip8_metrics_snapshot(const Chip8Metrics *metrics, Chip8Metrics *dest)
+{
+	volatile u32 *sequence = (volatile u32 *)&metrics->sequence;
+	for (;;)
+	{
+		u32 before = dqnt_atomic_load_u32(sequence);
+		if (before & 1)
+		{
+			dqnt_sleep_ms(0);
+			continue;
+		}
+
+		memcpy((void *)dest, (const void *)metrics, sizeof(*dest));
+		if (dqnt_atomic_load_u32(sequence) == before) break;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Prometheus Export
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE const char *const CHIP8_PHASE_NAMES[chip8phase_count] = {
+    "input", "update", "present", "wait",
+};
+
+// NOTE: labels is either empty or ends with a comma, it goes in front of le
+FILE_SCOPE void dchip8_histogram_write_internal(const Chip8Histogram *histogram,
+                                                const f64 *bounds,
+                                                u32 numBounds, const char *name,
+                                                const char *labels, FILE *file)
+{
+	u64 cumulative = 0;
+	for (u32 bucket = 0; bucket < numBounds; bucket++)
+	{
+		cumulative += histogram->buckets[bucket];
+		fprintf(file, "%s_bucket{%sle=\"%g\"} %llu\n", name, labels,
+		        bounds[bucket], (unsigned long long)cumulative);
+	}
+
+	fprintf(file, "%s_bucket{%sle=\"+Inf\"} %llu\n", name, labels,
+	        (unsigned long long)histogram->count);
+
+	// NOTE: The sum and count take the labels without the trailing comma
+	char sampleLabels[64] = {};
+	size_t labelsLength   = strlen(labels);
+	if (labelsLength > 0 && labelsLength < sizeof(sampleLabels))
+	{
+		memcpy(sampleLabels, labels, labelsLength - 1);
+		fprintf(file, "%s_sum{%s} %.9g\n", name, sampleLabels, histogram->sum);
+		fprintf(file, "%s_count{%s} %llu\n", name, sampleLabels,
+		        (unsigned long long)histogram->count);
+	}
+	else
+	{
+		fprintf(file, "%s_sum %.9g\n", name, histogram->sum);
+		fprintf(file, "%s_count %llu\n", name,
+		        (unsigned long long)histogram->count);
+	}
+}
+
+bool dchip8_metrics_write_prometheus(const Chip8Metrics *metrics, FILE *file)
+{
+	fprintf(file, "# HELP dchip8_frame_seconds Frame time, start to start.\n"
+	              "# TYPE dchip8_frame_seconds histogram\n");
+	dchip8_histogram_write_internal(
+	    &metrics->frameTime, CHIP8_METRICS_TIME_BOUNDS,
+	    DQNT_ARRAY_COUNT(CHIP8_METRICS_TIME_BOUNDS), "dchip8_frame_seconds", "",
+	    file);
+
+	fprintf(file, "# HELP dchip8_instructions_per_second Instructions "
+	              "emulated per second, sampled every frame.\n"
+	              "# TYPE dchip8_instructions_per_second histogram\n");
+	dchip8_histogram_write_internal(
+	    &metrics->instructionRate, CHIP8_METRICS_INSTRUCTION_RATE_BOUNDS,
+	    DQNT_ARRAY_COUNT(CHIP8_METRICS_INSTRUCTION_RATE_BOUNDS),
+	    "dchip8_instructions_per_second", "", file);
+
+	fprintf(file, "# HELP dchip8_timer_ticks_per_second Delay and sound timer "
+	              "ticks per second, sampled every frame.\n"
+	              "# TYPE dchip8_timer_ticks_per_second histogram\n");
+	dchip8_histogram_write_internal(
+	    &metrics->timerTickRate, CHIP8_METRICS_TIMER_RATE_BOUNDS,
+	    DQNT_ARRAY_COUNT(CHIP8_METRICS_TIMER_RATE_BOUNDS),
+	    "dchip8_timer_ticks_per_second", "", file);
+
+	fprintf(file, "# HELP dchip8_phase_seconds Time spent in each phase of a "
+	              "frame.\n"
+	              "# TYPE dchip8_phase_seconds histogram\n");
+	for (u32 phase = 0; phase < chip8phase_count; phase++)
+	{
+		char labels[32];
+		snprintf(labels, sizeof(labels), "phase=\"%s\",",
+		         CHIP8_PHASE_NAMES[phase]);
+		dchip8_histogram_write_internal(
+		    &metrics->phaseTime[phase], CHIP8_METRICS_TIME_BOUNDS,
+		    DQNT_ARRAY_COUNT(CHIP8_METRICS_TIME_BOUNDS), "dchip8_phase_seconds",
+		    labels, file);
+	}
+
+	fprintf(file,
+	        "# HELP dchip8_frames_total Frames emulated.\n"
+	        "# TYPE dchip8_frames_total counter\n"
+	        "dchip8_frames_total %llu\n"
+	        "# HELP dchip8_instructions_total Instructions emulated.\n"
+	        "# TYPE dchip8_instructions_total counter\n"
+	        "dchip8_instructions_total %llu\n"
+	        "# HELP dchip8_timer_ticks_total Delay and sound timer ticks.\n"
+	        "# TYPE dchip8_timer_ticks_total counter\n"
+	        "dchip8_timer_ticks_total %llu\n",
+	        (unsigned long long)metrics->numFrames,
+	        (unsigned long long)metrics->numInstructions,
+	        (unsigned long long)metrics->numTimerTicks);
+
+	return ferror(file) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Exporter
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Written next to the destination and renamed over it
+FILE_SCOPE bool dchip8_metrics_export_internal(Chip8MetricsExporter *exporter)
+{
+	char tempPath[DQNT_ARRAY_COUNT(exporter->path) + 8];
+	snprintf(tempPath, sizeof(tempPath), "%s.tmp", exporter->path);
+
+	FILE *file = fopen(tempPath, "wb");
+	if (!file) return false;
+
+	dchip8_metrics_snapshot(exporter->metrics, &exporter->snapshot);
+	bool result = dchip8_metrics_write_prometheus(&exporter->snapshot, file);
+	if (fclose(file) != 0) result = false;
+
+#ifdef _WIN32
+	if (result)
+		result = MoveFileExA(tempPath, exporter->path,
+		                     MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	if (result) result = (rename(tempPath, exporter->path) == 0);
+#endif
+	if (!result) remove(tempPath);
+	return result;
+}
+
+FILE_SCOPE u32 dchip8_metrics_exporter_thread_internal(void *userData)
+{
+	Chip8MetricsExporter *exporter = (Chip8MetricsExporter *)userData;
+
+	// NOTE: Wake often enough that stopping never waits on a long interval
+	const u32 POLL_MS = 50;
+	f64 nextExportInS = dqnt_time_now_s() + exporter->intervalInS;
+	while (!dqnt_atomic_load_u32(&exporter->quit))
+	{
+		dqnt_sleep_ms(POLL_MS);
+		if (dqnt_time_now_s() < nextExportInS) continue;
+
+		dchip8_metrics_export_internal(exporter);
+		nextExportInS += exporter->intervalInS;
+	}
+
+	return 0;
+}
+
+bool dchip8_metrics_exporter_start(Chip8MetricsExporter *exporter,
+                                   const Chip8Metrics *metrics,
+                                   const char *path, f64 intervalInS)
+{
+	DQNT_ASSERT(intervalInS > 0);
+	memset(exporter, 0, sizeof(*exporter));
+
+	i32 length = snprintf(exporter->path, sizeof(exporter->path), "%s", path);
+	if (length < 0 || length >= (i32)sizeof(exporter->path)) return false;
+
+	exporter->metrics     = metrics;
+	exporter->intervalInS = intervalInS;
+	return dqnt_thread_create(&exporter->thread,
+	                          dchip8_metrics_exporter_thread_internal, exporter);
+}
+
+void dchip8_metrics_exporter_stop(Chip8MetricsExporter *exporter)
+{
+	dqnt_atomic_store_u32(&exporter->quit, 1);
+	dqnt_thread_join(&exporter->thread);
+	dchip8_metrics_export_internal(exporter);
+}
@@ -0,0 +1,95 @@
+#ifndef DCHIP8_METRICS_H
+#define DCHIP8_METRICS_H
+
+#include "dqnt.h"
+
+#include <stdio.h>
+
+// NOTE: Emulator health metrics. The emulation thread records one sample a
+// frame into fixed bucket histograms, which is a handful of increments and
+// never blocks or allocates. An exporter thread takes a consistent copy at an
+// interval and writes it out in the Prometheus text format, e.g. for
+// node_exporter's textfile collector to pick up. Every file I/O and
+// formatting happens off the emulation thread.
+//
+// Recording is single writer, the copy is a sequence lock: the writer makes
+// sequence odd while it updates and the reader retries if it changed under it.
+
+// Where a frame's time went, in the order a frame runs
+enum Chip8Phase
+{
+	// Draining input and commands
+	chip8phase_input,
+	// Emulating and rendering, dchip8_update
+	chip8phase_update,
+	// Post processing and handing the frame to whoever shows it
+	chip8phase_present,
+	// Waiting for the next deadline
+	chip8phase_wait,
+
+	chip8phase_count,
+};
+
+#define CHIP8_METRICS_MAX_BUCKETS 16
+
+// NOTE: Counts are per bucket, the export makes them cumulative as Prometheus
+// expects. The last bucket is +Inf.
+typedef struct Chip8Histogram
+{
+	u64 buckets[CHIP8_METRICS_MAX_BUCKETS];
+	u64 count;
+	f64 sum;
+} Chip8Histogram;
+
+typedef struct Chip8Metrics
+{
+	volatile u32   sequence;
+
+	// Start to start
+	Chip8Histogram frameTime;
+	// Instructions emulated a frame over the frame time
+	Chip8Histogram instructionRate;
+	// 60hz timer ticks a frame over the frame time, should sit at 60. Only
+	// frames where a timer was running are sampled.
+	Chip8Histogram timerTickRate;
+	Chip8Histogram phaseTime[chip8phase_count];
+
+	u64            numFrames;
+	u64            numInstructions;
+	u64            numTimerTicks;
+} Chip8Metrics;
+
+typedef struct Chip8FrameSample
+{
+	f64 frameTimeInS;
+	u32 numInstructions;
+	u32 numTimerTicks;
+	f64 phaseTimeInS[chip8phase_count];
+} Chip8FrameSample;
+
+// Writer only
+void dchip8_metrics_record  (Chip8Metrics *metrics,
+                             const Chip8FrameSample *sample);
+// Any thread, a consistent copy of metrics
+void dchip8_metrics_snapshot(const Chip8Metrics *metrics, Chip8Metrics *dest);
+bool dchip8_metrics_write_prometheus(const Chip8Metrics *metrics, FILE *file);
+
+typedef struct Chip8MetricsExporter
+{
+	const Chip8Metrics *metrics;
+	char                path[260];
+	f64                 intervalInS;
+	DqntThread          thread;
+	volatile u32        quit;
+	Chip8Metrics        snapshot;
+} Chip8MetricsExporter;
+
+// Export metrics to path every intervalInS until stopped. The file is
+// replaced whole so a scraper never reads it half written.
+bool dchip8_metrics_exporter_start(Chip8MetricsExporter *exporter,
+                                   const Chip8Metrics *metrics,
+                                   const char *path, f64 intervalInS);
+// Stop and write a final export
+void dchip8_metrics_exporter_stop (Chip8MetricsExporter *exporter);
+
+#endif
@@ -0,0 +1,180 @@
+#include "dchip8_mosaic.h"
+#include "dqnt.h"
+
+#include <string.h>
+
+// NOTE: The font's glyphs are 4 pixels wide, in the top nibble of each byte
+FILE_SCOPE const u32 CHIP8_MOSAIC_GLYPH_WIDTH  = 4;
+FILE_SCOPE const u32 CHIP8_MOSAIC_GLYPH_HEIGHT = 5;
+
+FILE_SCOPE u32 dchip8_mosaic_num_digits_internal(u32 numTiles)
+{
+	u32 result = 1;
+	for (u32 highest = numTiles - 1; highest > 0xF; highest >>= 4)
+		result++;
+	return result;
+}
+
+// NOTE: Work out the grid and image size of layout into mosaic, return false
+// if there's nothing to draw or the image would be too large
+FILE_SCOPE bool dchip8_mosaic_grid_internal(Chip8Mosaic *mosaic,
+                                            const Chip8MosaicLayout *layout)
+{
+	if (layout->numTiles == 0 || layout->scale == 0) return false;
+	if (layout->scale > CHIP8_MOSAIC_MAX_SIZE / CHIP8_DISPLAY_WIDTH) return false;
+
+	u32 columns = layout->columns;
+	if (columns == 0)
+	{
+		columns = 1;
+		while ((u64)columns * columns < layout->numTiles) columns++;
+	}
+	columns  = DQNT_MATH_MIN(columns, layout->numTiles);
+	u32 rows = (layout->numTiles + columns - 1) / columns;
+
+	u32 tileWidth   = CHIP8_DISPLAY_WIDTH * layout->scale;
+	u32 tileHeight  = CHIP8_DISPLAY_HEIGHT * layout->scale;
+	u32 labelHeight = 0;
+	if (layout->labels)
+		labelHeight = (CHIP8_MOSAIC_GLYPH_HEIGHT + 1) * layout->scale;
+
+	u64 width  = layout->gap + ((u64)columns * (tileWidth + layout->gap));
+	u64 height = layout->gap +
+	             ((u64)rows * (labelHeight + tileHeight + layout->gap));
+	if (width > CHIP8_MOSAIC_MAX_SIZE || height > CHIP8_MOSAIC_MAX_SIZE)
+		return false;
+
+	mosaic->columns     = columns;
+	mosaic->rows        = rows;
+	mosaic->tileWidth   = tileWidth;
+	mosaic->tileHeight  = tileHeight;
+	mosaic->labelHeight = labelHeight;
+	mosaic->width       = (u32)width;
+	mosaic->height      = (u32)height;
+	return true;
+}
+
+FILE_SCOPE Chip8ScaleTarget
+dchip8_mosaic_target_internal(const Chip8Mosaic *mosaic, u32 index)
+{
+	Chip8ScaleTarget result = {};
+	result.memory           = dchip8_mosaic_tile(mosaic, index);
+	result.pitch            = mosaic->width;
+	result.scaleX           = mosaic->layout.scale;
+	result.scaleY           = mosaic->layout.scale;
+	result.onColour         = mosaic->layout.onColour;
+	result.offColour        = mosaic->layout.offColour;
+	return result;
+}
+
+// NOTE: Write the tile's index in hex in the strip above it. The glyphs come
+// from a booted machine's memory, where Fx29 finds them.
+FILE_SCOPE void dchip8_mosaic_draw_label_internal(const Chip8Mosaic *mosaic,
+                                                  const u8 *font, u32 index)
+{
+	const u32 BYTES_PER_FONT = 5;
+	u32 scale     = mosaic->layout.scale;
+	u32 numDigits = dchip8_mosaic_num_digits_internal(mosaic->layout.numTiles);
+	u32 *label    = dchip8_mosaic_tile(mosaic, index) -
+	                ((size_t)mosaic->labelHeight * mosaic->width);
+
+	for (u32 digit = 0; digit < numDigits; digit++)
+	{
+		u32 shift       = (numDigits - 1 - digit) * 4;
+		const u8 *glyph = font + (((index >> shift) & 0xF) * BYTES_PER_FONT);
+		u32 *origin     = label + ((CHIP8_MOSAIC_GLYPH_WIDTH + 1) * scale * digit);
+
+		for (u32 y = 0; y < CHIP8_MOSAIC_GLYPH_HEIGHT * scale; y++)
+		{
+			u32 *row = origin + ((size_t)y * mosaic->width);
+			u8 bits  = glyph[y / scale];
+			for (u32 x = 0; x < CHIP8_MOSAIC_GLYPH_WIDTH * scale; x++)
+			{
+				if (bits & (0x80 >> (x / scale)))
+					row[x] = mosaic->layout.labelColour;
+			}
+		}
+	}
+}
+
+bool dchip8_mosaic_init(Chip8Mosaic *mosaic, const Chip8MosaicLayout *layout,
+                        Chip8Arena *arena)
+{
+	*mosaic = {};
+	if (!dchip8_mosaic_grid_internal(mosaic, layout)) return false;
+
+	size_t numPixels = (size_t)mosaic->width * mosaic->height;
+	mosaic->pixels   = (u32 *)dchip8_arena_push(arena, numPixels * sizeof(u32),
+	                                            CHIP8_PAGE_SIZE);
+	mosaic->shown    = (u64(*)[CHIP8_DISPLAY_HEIGHT])DCHIP8_ARENA_PUSH_ARRAY(
+	    arena, u64, (size_t)layout->numTiles * CHIP8_DISPLAY_HEIGHT);
+	if (!mosaic->pixels || !mosaic->shown) return false;
+
+	mosaic->layout = *layout;
+	mosaic->kernel = dchip8_scale_best_kernel();
+
+	for (size_t i = 0; i < numPixels; i++)
+		mosaic->pixels[i] = layout->backgroundColour;
+
+	// NOTE: shown starts zeroed, which is what a blank tile shows
+	Chip8VM bootVM;
+	if (layout->labels) dchip8_vm_init(&bootVM);
+	for (u32 index = 0; index < layout->numTiles; index++)
+	{
+		Chip8ScaleTarget target = dchip8_mosaic_target_internal(mosaic, index);
+		dchip8_scale_rows(mosaic->shown[index], &target, mosaic->kernel, 0,
+		                  mosaic->tileHeight);
+		if (layout->labels)
+			dchip8_mosaic_draw_label_internal(mosaic, bootVM.memory, index);
+	}
+
+	return true;
+}
+
+size_t dchip8_mosaic_memory_size(const Chip8MosaicLayout *layout)
+{
+	Chip8Mosaic mosaic = {};
+	if (!dchip8_mosaic_grid_internal(&mosaic, layout)) return 0;
+
+	size_t result = ((size_t)mosaic.width * mosaic.height * sizeof(u32)) +
+	                CHIP8_PAGE_SIZE;
+	result += ((size_t)layout->numTiles * CHIP8_DISPLAY_HEIGHT * sizeof(u64)) +
+	          alignof(u64);
+	return result;
+}
+
+u32 dchip8_mosaic_composite(Chip8Mosaic *mosaic, const u64 *const *displays)
+{
+	const u64 BLANK[CHIP8_DISPLAY_HEIGHT] = {};
+
+	u32 result = 0;
+	for (u32 index = 0; index < mosaic->layout.numTiles; index++)
+	{
+		// NOTE: Draw from the copy so the image always matches shown, even if
+		// the machine writes its display while we're here
+		const u64 *display = displays[index] ? displays[index] : BLANK;
+		u64 *shown         = mosaic->shown[index];
+		if (memcmp(shown, display, sizeof(mosaic->shown[index])) == 0) continue;
+		memcpy(shown, display, sizeof(mosaic->shown[index]));
+
+		Chip8ScaleTarget target = dchip8_mosaic_target_internal(mosaic, index);
+		dchip8_scale_rows(shown, &target, mosaic->kernel, 0, mosaic->tileHeight);
+		result++;
+	}
+
+	return result;
+}
+
+u32 *dchip8_mosaic_tile(const Chip8Mosaic *mosaic, u32 index)
+{
+	DQNT_ASSERT(index < mosaic->layout.numTiles);
+	u32 column = index % mosaic->columns;
+	u32 row    = index / mosaic->columns;
+	u32 gap    = mosaic->layout.gap;
+
+	size_t x = gap + ((size_t)column * (mosaic->tileWidth + gap));
+	size_t y = gap + mosaic->labelHeight +
+	           ((size_t)row * (mosaic->labelHeight + mosaic->tileHeight + gap));
+	u32 *result = mosaic->pixels + (y * mosaic->width) + x;
+	return result;
+}
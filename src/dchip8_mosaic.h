@@ -0,0 +1,74 @@
+#ifndef DCHIP8_MOSAIC_H
+#define DCHIP8_MOSAIC_H
+
+#include "dchip8.h"
+#include "dchip8_scale.h"
+#include "dqnt.h"
+
+// NOTE: One ARGB image showing the displays of many machines side by side in a
+// grid, for watching a whole batch at once. Every tile keeps a copy of the
+// display it last drew and a composite only redraws the tiles whose display
+// differs from it, so a wall where a few machines are drawing costs a few
+// tiles, not the whole image. Tiles are drawn with the scale kernels.
+//
+// Each cell of the grid is an optional label strip with the tile's index in
+// hex, written in the machine's own font, then the tile itself. Cells are gap
+// pixels apart and gap pixels in from the edge of the image. The background,
+// labels and gaps never change so they are only drawn by init.
+
+// Largest width or height of the image in pixels
+#define CHIP8_MOSAIC_MAX_SIZE 32768
+
+typedef struct Chip8MosaicLayout
+{
+	u32  numTiles;
+	// 0 picks the squarest grid that fits every tile
+	u32  columns;
+	// Image pixels per display pixel in both directions, at least 1
+	u32  scale;
+	u32  gap;
+	bool labels;
+	u32  onColour;
+	u32  offColour;
+	u32  backgroundColour;
+	u32  labelColour;
+} Chip8MosaicLayout;
+
+typedef struct Chip8Mosaic
+{
+	Chip8MosaicLayout layout;
+	// Defaults to the best kernel the CPU supports
+	enum Chip8ScaleKernel kernel;
+
+	u32  columns;
+	u32  rows;
+	u32  tileWidth;
+	u32  tileHeight;
+	u32  labelHeight;
+	// Top row first, the pitch is width
+	u32 *pixels;
+	u32  width;
+	u32  height;
+
+	// The display each tile shows now, numTiles of them
+	u64 (*shown)[CHIP8_DISPLAY_HEIGHT];
+} Chip8Mosaic;
+
+// Every tile starts blank. Return false if the layout is empty, the image
+// would be larger than CHIP8_MOSAIC_MAX_SIZE or the arena is out of space.
+bool   dchip8_mosaic_init       (Chip8Mosaic *mosaic,
+                                 const Chip8MosaicLayout *layout,
+                                 Chip8Arena *arena);
+// Arena space a mosaic of layout needs, including alignment. 0 if the layout
+// is invalid.
+size_t dchip8_mosaic_memory_size(const Chip8MosaicLayout *layout);
+
+// Bring the image up to date with displays, one per tile, where a NULL
+// display shows a blank tile. Return the number of tiles redrawn.
+u32    dchip8_mosaic_composite  (Chip8Mosaic *mosaic,
+                                 const u64 *const *displays);
+
+// The tile's top left pixel in the image
+u32   *dchip8_mosaic_tile       (const Chip8Mosaic *mosaic, u32 index);
+
+#endif
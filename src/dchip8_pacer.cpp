@@ -0,0 +1,104 @@
+#include "dchip8_pacer.h"
+#include "dqnt.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// NOTE: Windows sleeps in whole milliseconds at best, and only that well once
+// the platform layer has raised the timer resolution
+#ifdef _WIN32
+	#define CHIP8_PACER_DEFAULT_SPIN_S 0.002
+#else
+	#define CHIP8_PACER_DEFAULT_SPIN_S 0.0002
+#endif
+
+void dchip8_pacer_init(Chip8Pacer *pacer, f64 framesPerSecond, f64 spinInS)
+{
+	DQNT_ASSERT(framesPerSecond > 0);
+
+	*pacer             = {};
+	pacer->periodInS   = 1.0 / framesPerSecond;
+	pacer->spinInS     = (spinInS > 0) ? spinInS : CHIP8_PACER_DEFAULT_SPIN_S;
+	pacer->lastWakeInS = dqnt_time_now_s();
+	pacer->deadlineInS = pacer->lastWakeInS + pacer->periodInS;
+}
+
+FILE_SCOPE void dchip8_pacer_record_internal(Chip8Pacer *pacer,
+                                             f64 latenessInS)
+{
+	u32 bucket = 0;
+	u64 latenessInUs = (latenessInS > 0) ? (u64)(latenessInS * 1000000.0) : 0;
+	while (latenessInUs > 0 && bucket < CHIP8_PACER_NUM_BUCKETS - 1)
+	{
+		latenessInUs >>= 1;
+		bucket++;
+	}
+
+	pacer->histogram[bucket]++;
+	pacer->numFrames++;
+	pacer->totalLatenessInS += latenessInS;
+	if (latenessInS > pacer->maxLatenessInS) pacer->maxLatenessInS = latenessInS;
+}
+
+f64 dchip8_pacer_wait(Chip8Pacer *pacer)
+{
+	f64 deadline = pacer->deadlineInS;
+	f64 now      = dqnt_time_now_s();
+	if (now < deadline - pacer->spinInS)
+		dqnt_sleep_until_s(deadline - pacer->spinInS);
+
+	while ((now = dqnt_time_now_s()) < deadline)
+		;
+
+	dchip8_pacer_record_internal(pacer, now - deadline);
+
+	// NOTE: A frame that ran over keeps the original phase rather than
+	// restarting the schedule from now, the deadlines it slept through are
+	// counted as missed
+	deadline += pacer->periodInS;
+	if (deadline <= now)
+	{
+		u64 numBehind = (u64)((now - deadline) / pacer->periodInS) + 1;
+		pacer->numMissed += numBehind;
+		deadline += (f64)numBehind * pacer->periodInS;
+	}
+	pacer->deadlineInS = deadline;
+
+	f64 result         = now - pacer->lastWakeInS;
+	pacer->lastWakeInS = now;
+	return result;
+}
+
+void dchip8_pacer_print(const Chip8Pacer *pacer, FILE *file)
+{
+	f64 averageInUs = 0;
+	if (pacer->numFrames)
+		averageInUs = (pacer->totalLatenessInS * 1000000.0) / pacer->numFrames;
+
+	fprintf(file,
+	        "Pacing: %llu frames at %.3f ms, %llu deadlines missed, lateness "
+	        "avg %.1f us max %.1f us\n",
+	        (unsigned long long)pacer->numFrames, pacer->periodInS * 1000.0,
+	        (unsigned long long)pacer->numMissed, averageInUs,
+	        pacer->maxLatenessInS * 1000000.0);
+
+	for (u32 bucket = 0; bucket < CHIP8_PACER_NUM_BUCKETS; bucket++)
+	{
+		u32 count = pacer->histogram[bucket];
+		if (count == 0) continue;
+
+		char range[32];
+		if (bucket == 0)
+			snprintf(range, sizeof(range), "< 1 us");
+		else if (bucket == CHIP8_PACER_NUM_BUCKETS - 1)
+			snprintf(range, sizeof(range), ">= %u us", 1u << (bucket - 1));
+		else
+			snprintf(range, sizeof(range), "%u-%u us", 1u << (bucket - 1),
+			         (1u << bucket) - 1);
+
+		f64 percent = (100.0 * count) / (f64)pacer->numFrames;
+		fprintf(file, "  %14s %8u %6.2f%% ", range, count, percent);
+		for (u32 i = 0; i < (u32)(percent / 2); i++) fputc('#', file);
+		fputc('\n', file);
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef DCHIP8_PACER_H
+#define DCHIP8_PACER_H
+
+#include "dqnt.h"
+
+#include <stdio.h>
+
+// NOTE: Frame pacing against absolute deadlines. Deadlines are a fixed period
+// apart so rounding in one frame's sleep never carries into the next. Waiting
+// sleeps coarsely until spinInS before the deadline and then polls the clock
+// for the rest, which costs a little CPU but wakes within microseconds.
+//
+// Every wake records its lateness, how far past the deadline it was, in a
+// histogram with power of two microsecond buckets.
+
+// Bucket 0 is under 1us, bucket N is [2^(N-1), 2^N) us and the last bucket
+// takes everything from 2^(N-1) us, about 65ms, up
+#define CHIP8_PACER_NUM_BUCKETS 18
+
+typedef struct Chip8Pacer
+{
+	f64 periodInS;
+	f64 spinInS;
+	f64 deadlineInS;
+	f64 lastWakeInS;
+
+	u64 numFrames;
+	// Deadlines that passed while a frame was still running
+	u64 numMissed;
+	f64 totalLatenessInS;
+	f64 maxLatenessInS;
+	u32 histogram[CHIP8_PACER_NUM_BUCKETS];
+} Chip8Pacer;
+
+// spinInS of 0 picks a default for the platform's sleep resolution
+void dchip8_pacer_init (Chip8Pacer *pacer, f64 framesPerSecond, f64 spinInS);
+// Wait for the next deadline. Return the time since the previous wake, i.e.
+// how long the frame that just finished took from start to start.
+f64  dchip8_pacer_wait (Chip8Pacer *pacer);
+void dchip8_pacer_print(const Chip8Pacer *pacer, FILE *file);
+
+#endif
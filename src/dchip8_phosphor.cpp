@@ -0,0 +1,88 @@
+#include "dchip8_phosphor.h"
+#include "dqnt.h"
+
+#include <math.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define DCHIP8_PHOSPHOR_SSE2
+	#include <emmintrin.h>
+#endif
+
+void dchip8_phosphor_init(Chip8Phosphor *phosphor, f32 halfLifeInS,
+                          u32 onColour, u32 offColour)
+{
+	*phosphor             = {};
+	phosphor->halfLifeInS = halfLifeInS;
+	phosphor->onColour    = onColour;
+	phosphor->offColour   = offColour;
+
+	// NOTE: Blend each channel separately, the top byte of the intensity is
+	// plenty to pick a colour with
+	for (u32 level = 0; level < DQNT_ARRAY_COUNT(phosphor->palette); level++)
+	{
+		u32 colour = 0;
+		for (u32 shift = 0; shift < 32; shift += 8)
+		{
+			i32 off     = (i32)((offColour >> shift) & 0xFF);
+			i32 on      = (i32)((onColour >> shift) & 0xFF);
+			i32 channel = off + (((on - off) * (i32)level) / 255);
+			colour |= (u32)channel << shift;
+		}
+		phosphor->palette[level] = colour;
+	}
+
+	for (u32 i = 0; i < CHIP8_PHOSPHOR_NUM_PIXELS; i++)
+		phosphor->pixels[i] = offColour;
+}
+
+void dchip8_phosphor_update(Chip8Phosphor *phosphor, const u64 *display,
+                            f32 deltaInS)
+{
+	// NOTE: Fraction of the intensity kept over deltaInS, in 0.16 fixed point
+	u32 decay = 0;
+	if (phosphor->halfLifeInS > 0)
+	{
+		f32 kept = powf(0.5f, deltaInS / phosphor->halfLifeInS);
+		decay    = (u32)(kept * 65536.0f);
+		if (decay > 0xFFFF) decay = 0xFFFF;
+	}
+
+	u16 *intensity = phosphor->intensity;
+#ifdef DCHIP8_PHOSPHOR_SSE2
+	// NOTE: 8 pixels per vector, one byte of the row. Each lane tests its own
+	// bit of the byte and lit lanes are forced to full after decaying.
+	const __m128i bitMasks =
+	    _mm_set_epi16(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+	const __m128i decayVec = _mm_set1_epi16((short)decay);
+	for (i32 y = 0; y < CHIP8_DISPLAY_HEIGHT; y++)
+	{
+		u64 row = display[y];
+		for (i32 group = 0; group < CHIP8_DISPLAY_WIDTH / 8; group++)
+		{
+			i32 byte     = (i32)((row >> (56 - (group * 8))) & 0xFF);
+			__m128i bits = _mm_and_si128(_mm_set1_epi16((short)byte), bitMasks);
+			__m128i lit  = _mm_cmpeq_epi16(bits, bitMasks);
+
+			__m128i *lanes = (__m128i *)intensity + group;
+			__m128i value  = _mm_loadu_si128(lanes);
+			value          = _mm_mulhi_epu16(value, decayVec);
+			_mm_storeu_si128(lanes, _mm_or_si128(value, lit));
+		}
+		intensity += CHIP8_DISPLAY_WIDTH;
+	}
+#else
+	for (i32 y = 0; y < CHIP8_DISPLAY_HEIGHT; y++)
+	{
+		u64 row = display[y];
+		for (i32 x = 0; x < CHIP8_DISPLAY_WIDTH; x++)
+		{
+			bool lit     = ((row >> ((CHIP8_DISPLAY_WIDTH - 1) - x)) & 1) != 0;
+			intensity[x] = lit ? 0xFFFF : (u16)((intensity[x] * decay) >> 16);
+		}
+		intensity += CHIP8_DISPLAY_WIDTH;
+	}
+#endif
+
+	for (u32 i = 0; i < CHIP8_PHOSPHOR_NUM_PIXELS; i++)
+		phosphor->pixels[i] = phosphor->palette[phosphor->intensity[i] >> 8];
+}
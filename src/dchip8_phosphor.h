@@ -0,0 +1,38 @@
+#ifndef DCHIP8_PHOSPHOR_H
+#define DCHIP8_PHOSPHOR_H
+
+#include "dchip8.h"
+#include "dqnt.h"
+
+// NOTE: Phosphor persistence post-process. Games erase and redraw sprites with
+// XOR, so a sprite that moves is often missing from the frame that gets
+// presented. Every pixel keeps an intensity that jumps to full when the pixel
+// is lit and decays exponentially once it isn't, the output colour is the off
+// colour blended towards the on colour by that intensity.
+//
+// It runs at the machine's resolution, 2048 pixels, and its output is scaled
+// like any other ARGB image, so its cost does not grow with the window.
+
+#define CHIP8_PHOSPHOR_NUM_PIXELS (CHIP8_DISPLAY_WIDTH * CHIP8_DISPLAY_HEIGHT)
+
+typedef struct Chip8Phosphor
+{
+	// NOTE: 0.16 fixed point, 0xFFFF is fully lit
+	u16 intensity[CHIP8_PHOSPHOR_NUM_PIXELS];
+	// ARGB output, top row first
+	u32 pixels[CHIP8_PHOSPHOR_NUM_PIXELS];
+
+	// Time for an unlit pixel to fade to half its intensity
+	f32 halfLifeInS;
+	u32 onColour;
+	u32 offColour;
+	u32 palette[256];
+} Chip8Phosphor;
+
+void dchip8_phosphor_init  (Chip8Phosphor *phosphor, f32 halfLifeInS,
+                            u32 onColour, u32 offColour);
+// Blend in a new frame that was shown for deltaInS and write the output pixels
+void dchip8_phosphor_update(Chip8Phosphor *phosphor, const u64 *display,
+                            f32 deltaInS);
+
+#endif
@@ -50,13 +50,12 @@ typedef struct KeyState
 	u32 halfTransitionCount;
 } KeyState;
 
+// NOTE: Per frame input only, anything that happens occasionally such as
+// loading a ROM goes through the core's command queue instead
 typedef struct PlatformInput
 {
 	f32 deltaForFrame;
 
-	bool loadNewRom;
-	wchar_t rom[260];
-
 	union {
 		KeyState key[key_count];
 		struct
@@ -105,10 +104,23 @@ typedef struct PlatformFile
 	u64   size;
 } PlatformFile;
 
+typedef struct PlatformMappedFile
+{
+	void       *handle;
+	void       *mapping;
+	const void *memory;
+	u64         size;
+} PlatformMappedFile;
+
 // Return true if successful, false if not
 bool platform_open_file (const wchar_t *const file, PlatformFile *platformFile);
 // Return the number of bytes read
 u32  platform_read_file (PlatformFile file, void *buffer, u32 numBytesToRead);
 void platform_close_file(PlatformFile *file);
 
+// Map a whole file read only. Return false if it doesn't exist or is empty,
+// this is silent since mapped files are usually optional.
+bool platform_map_file  (const wchar_t *const file, PlatformMappedFile *mappedFile);
+void platform_unmap_file(PlatformMappedFile *mappedFile);
+
 #endif
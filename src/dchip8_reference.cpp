@@ -0,0 +1,307 @@
+#ifndef _CRT_SECURE_NO_WARNINGS
+	#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+// NOTE: Reference interpreter, a deliberately naive second implementation of
+// the instruction set written straight from the spec. It decodes every field
+// up front and draws one pixel at a time, so it shares no code with the
+// optimised dchip8_vm_run and can be used to cross check it. It must keep the
+// exact same observable behaviour, including faults.
+
+#include "dchip8.h"
+#include "dqnt.h"
+
+FILE_SCOPE bool dchip8_reference_get_pixel_internal(const Chip8VM *vm, i32 x,
+                                                    i32 y)
+{
+	bool result = ((vm->display[y] >> ((CHIP8_DISPLAY_WIDTH - 1) - x)) & 1);
+	return result;
+}
+
+FILE_SCOPE void dchip8_reference_set_pixel_internal(Chip8VM *vm, i32 x, i32 y,
+                                                    bool on)
+{
+	u64 mask = (1ULL << ((CHIP8_DISPLAY_WIDTH - 1) - x));
+	u64 row  = (on) ? (vm->display[y] | mask) : (vm->display[y] & ~mask);
+	dchip8_vm_write_display_row(vm, y, row);
+}
+
+FILE_SCOPE void dchip8_reference_fault_internal(Chip8CPU *cpu,
+                                                enum Chip8Fault fault,
+                                                u16 opAddress)
+{
+	cpu->state        = chip8state_fault;
+	cpu->fault        = fault;
+	cpu->faultAddress = opAddress;
+}
+
+// Same contract as dchip8_vm_run
+u32 dchip8_reference_run(Chip8VM *vm, Chip8Controller controller,
+                         u32 cyclesToEmulate)
+{
+	Chip8CPU *cpu = &vm->cpu;
+	if (cpu->state == chip8state_await_input)
+	{
+		for (u8 key = 0; key < CHIP8_NUM_KEYS; key++)
+		{
+			if (controller.key[key])
+			{
+				cpu->registerArray[cpu->storeKeyToRegisterIndex] = key;
+				cpu->state = chip8state_running;
+				break;
+			}
+		}
+	}
+
+	u32 result = 0;
+	while (result < cyclesToEmulate && cpu->state == chip8state_running)
+	{
+		u16 pc = cpu->programCounter;
+		if (pc + 1 >= CHIP8_MEMORY_SIZE)
+		{
+			dchip8_reference_fault_internal(cpu, chip8fault_pc_out_of_bounds, pc);
+			break;
+		}
+
+		u16 opcode = (u16)((vm->memory[pc] << 8) | vm->memory[pc + 1]);
+		cpu->programCounter += 2;
+		result++;
+
+		u16 nnn = opcode & 0x0FFF;
+		u8 kk   = opcode & 0x00FF;
+		u8 n    = opcode & 0x000F;
+		u8 x    = (opcode >> 8) & 0x0F;
+		u8 y    = (opcode >> 4) & 0x0F;
+		u8 *V   = cpu->registerArray;
+
+		switch (opcode >> 12)
+		{
+			case 0x0:
+			{
+				if (opcode == 0x00E0)
+				{
+					for (i32 row = 0; row < CHIP8_DISPLAY_HEIGHT; row++)
+						for (i32 col = 0; col < CHIP8_DISPLAY_WIDTH; col++)
+							dchip8_reference_set_pixel_internal(vm, col, row, false);
+				}
+				else if (opcode == 0x00EE)
+				{
+					if (cpu->stackPointer == 0)
+						dchip8_reference_fault_internal(cpu, chip8fault_stack_underflow, pc);
+					else
+						cpu->programCounter = cpu->stack[--cpu->stackPointer];
+				}
+			}
+			break;
+
+			case 0x1: cpu->programCounter = nnn; break;
+			case 0x2:
+			{
+				if (cpu->stackPointer >= DQNT_ARRAY_COUNT(cpu->stack))
+				{
+					dchip8_reference_fault_internal(cpu, chip8fault_stack_overflow, pc);
+				}
+				else
+				{
+					cpu->stack[cpu->stackPointer++] = cpu->programCounter;
+					cpu->programCounter             = nnn;
+				}
+			}
+			break;
+
+			case 0x3: if (V[x] == kk)   cpu->programCounter += 2; break;
+			case 0x4: if (V[x] != kk)   cpu->programCounter += 2; break;
+			case 0x5: if (V[x] == V[y]) cpu->programCounter += 2; break;
+			case 0x6: V[x] = kk; break;
+			case 0x7: V[x] = (u8)(V[x] + kk); break;
+
+			case 0x8:
+			{
+				u8 vx = V[x];
+				u8 vy = V[y];
+				switch (n)
+				{
+					case 0x0: V[x] = vy; break;
+					case 0x1:
+					case 0x2:
+					case 0x3:
+					{
+						if      (n == 0x1) V[x] = vx | vy;
+						else if (n == 0x2) V[x] = vx & vy;
+						else               V[x] = vx ^ vy;
+						if (cpu->quirks & chip8quirk_logic_vf_reset) V[0xF] = 0;
+					}
+					break;
+
+					// NOTE: VF is written last for ADD, but before the result
+					// for the rest, which matters when x or y is F.
+					case 0x4:
+					{
+						V[x]   = (u8)(vx + vy);
+						V[0xF] = (vx + vy > 0xFF) ? 1 : 0;
+					}
+					break;
+
+					case 0x5:
+					{
+						V[0xF] = (vx > vy) ? 1 : 0;
+						V[x]   = (u8)(V[x] - V[y]);
+					}
+					break;
+
+					case 0x6:
+					{
+						u8 src = (cpu->quirks & chip8quirk_shift_vy) ? y : x;
+						V[0xF] = V[src] & 1;
+						V[x]   = V[src] >> 1;
+					}
+					break;
+
+					case 0x7:
+					{
+						V[0xF] = (vy > vx) ? 1 : 0;
+						V[x]   = (u8)(V[y] - V[x]);
+					}
+					break;
+
+					case 0xE:
+					{
+						u8 src = (cpu->quirks & chip8quirk_shift_vy) ? y : x;
+						V[0xF] = (V[src] >> 7) & 1;
+						V[x]   = (u8)(V[src] << 1);
+					}
+					break;
+
+					default: dchip8_reference_fault_internal(cpu, chip8fault_invalid_opcode, pc); break;
+				}
+			}
+			break;
+
+			case 0x9: if (V[x] != V[y]) cpu->programCounter += 2; break;
+			case 0xA: cpu->I = nnn; break;
+			case 0xB:
+			{
+				u8 offset = (cpu->quirks & chip8quirk_jump_vx) ? V[x] : V[0];
+				cpu->programCounter = (u16)(nnn + offset);
+			}
+			break;
+			case 0xC: V[x] = (u8)dqnt_rnd_pcg_range(&vm->pcgState, 0, 255) & kk; break;
+
+			case 0xD:
+			{
+				if (cpu->I + n > CHIP8_MEMORY_SIZE)
+				{
+					dchip8_reference_fault_internal(cpu, chip8fault_mem_out_of_bounds, pc);
+					break;
+				}
+
+				bool clip      = (cpu->quirks & chip8quirk_clip_sprites) != 0;
+				u8 originX     = clip ? (V[x] % CHIP8_DISPLAY_WIDTH) : V[x];
+				u8 originY     = clip ? (V[y] % CHIP8_DISPLAY_HEIGHT) : V[y];
+				bool collision = false;
+				for (i32 row = 0; row < n; row++)
+				{
+					u8 sprite = vm->memory[cpu->I + row];
+					u8 posY   = (u8)(originY + row);
+					if (posY >= CHIP8_DISPLAY_HEIGHT)
+					{
+						if (clip) continue;
+						posY = 0;
+					}
+
+					for (i32 col = 0; col < 8; col++)
+					{
+						if (!((sprite >> (7 - col)) & 1)) continue;
+
+						u8 posX = (u8)(originX + col);
+						if (posX >= CHIP8_DISPLAY_WIDTH)
+						{
+							if (clip) continue;
+							posX = 0;
+						}
+
+						bool wasOn = dchip8_reference_get_pixel_internal(vm, posX, posY);
+						if (wasOn) collision = true;
+						dchip8_reference_set_pixel_internal(vm, posX, posY, !wasOn);
+					}
+				}
+				V[0xF] = collision ? 1 : 0;
+			}
+			break;
+
+			case 0xE:
+			{
+				if (V[x] >= CHIP8_NUM_KEYS)
+					dchip8_reference_fault_internal(cpu, chip8fault_invalid_key, pc);
+				else if (kk == 0x9E && controller.key[V[x]])
+					cpu->programCounter += 2;
+				else if (kk == 0xA1 && !controller.key[V[x]])
+					cpu->programCounter += 2;
+				else if (kk != 0x9E && kk != 0xA1)
+					dchip8_reference_fault_internal(cpu, chip8fault_invalid_opcode, pc);
+			}
+			break;
+
+			case 0xF:
+			{
+				switch (kk)
+				{
+					case 0x07: V[x] = cpu->delayTimer; break;
+					case 0x0A:
+					{
+						cpu->state                   = chip8state_await_input;
+						cpu->storeKeyToRegisterIndex = x;
+					}
+					break;
+
+					case 0x15: cpu->delayTimer = V[x]; break;
+					case 0x18: cpu->soundTimer = V[x]; break;
+					case 0x1E: cpu->I = (u16)(cpu->I + V[x]); break;
+					case 0x29:
+					{
+						if (V[x] > 0xF)
+							dchip8_reference_fault_internal(cpu, chip8fault_invalid_font_digit, pc);
+						else
+							cpu->I = (u16)(V[x] * 5);
+					}
+					break;
+
+					case 0x33:
+					{
+						if (cpu->I + 3 > CHIP8_MEMORY_SIZE)
+						{
+							dchip8_reference_fault_internal(cpu, chip8fault_mem_out_of_bounds, pc);
+							break;
+						}
+						dchip8_vm_write_memory(vm, cpu->I + 0, V[x] / 100);
+						dchip8_vm_write_memory(vm, cpu->I + 1, (V[x] / 10) % 10);
+						dchip8_vm_write_memory(vm, cpu->I + 2, V[x] % 10);
+					}
+					break;
+
+					case 0x55:
+					case 0x65:
+					{
+						if (cpu->I + x >= CHIP8_MEMORY_SIZE)
+						{
+							dchip8_reference_fault_internal(cpu, chip8fault_mem_out_of_bounds, pc);
+							break;
+						}
+						for (i32 i = 0; i <= x; i++)
+						{
+							if (kk == 0x55) dchip8_vm_write_memory(vm, (u16)(cpu->I + i), V[i]);
+							else            V[i] = vm->memory[cpu->I + i];
+						}
+						if (cpu->quirks & chip8quirk_load_store_inc_i) cpu->I = (u16)(cpu->I + x + 1);
+					}
+					break;
+
+					default: dchip8_reference_fault_internal(cpu, chip8fault_invalid_opcode, pc); break;
+				}
+			}
+			break;
+		}
+	}
+
+	return result;
+}
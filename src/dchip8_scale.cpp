@@ -0,0 +1,399 @@
+#include "dchip8_scale.h"
+#include "dqnt.h"
+
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define DCHIP8_SCALE_X86
+	#include <immintrin.h>
+
+	// NOTE: Kernels are compiled for their instruction set individually and
+	// picked at runtime, so the rest of the build doesn't need -mavx2
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define DCHIP8_SCALE_TARGET_SSE2
+		#define DCHIP8_SCALE_TARGET_AVX2
+	#else
+		#define DCHIP8_SCALE_TARGET_SSE2 __attribute__((target("sse2")))
+		#define DCHIP8_SCALE_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Row Kernels
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Replicate each of the CHIP8_DISPLAY_WIDTH colours of a source row
+// scaleX times into dest. The SIMD kernels store whole vectors per pixel and
+// let them run over into the next pixel's span, which is written afterwards
+// anyway. Only the last pixel has to stop exactly at the end of the row, and
+// below a vector's width the pixels before it would run past the end too, so
+// those scales take the scalar kernel.
+typedef void Chip8ScaleRowKernel(const u32 *colours, u32 scaleX, u32 *dest);
+
+FILE_SCOPE void dchip8_scale_row_scalar_internal(const u32 *colours, u32 scaleX,
+                                                 u32 *dest)
+{
+	for (i32 x = 0; x < CHIP8_DISPLAY_WIDTH; x++)
+	{
+		u32 colour = colours[x];
+		for (u32 i = 0; i < scaleX; i++)
+			*dest++ = colour;
+	}
+}
+
+#ifdef DCHIP8_SCALE_X86
+DCHIP8_SCALE_TARGET_SSE2
+FILE_SCOPE void dchip8_scale_row_sse2_internal(const u32 *colours, u32 scaleX,
+                                               u32 *dest)
+{
+	if (scaleX < 4)
+	{
+		dchip8_scale_row_scalar_internal(colours, scaleX, dest);
+		return;
+	}
+
+	for (i32 x = 0; x < CHIP8_DISPLAY_WIDTH - 1; x++)
+	{
+		__m128i colour = _mm_set1_epi32((i32)colours[x]);
+		for (u32 i = 0; i < scaleX; i += 4)
+			_mm_storeu_si128((__m128i *)(dest + i), colour);
+		dest += scaleX;
+	}
+
+	u32 last       = colours[CHIP8_DISPLAY_WIDTH - 1];
+	__m128i colour = _mm_set1_epi32((i32)last);
+	u32 i          = 0;
+	for (; i + 4 <= scaleX; i += 4)
+		_mm_storeu_si128((__m128i *)(dest + i), colour);
+	for (; i < scaleX; i++)
+		dest[i] = last;
+}
+
+DCHIP8_SCALE_TARGET_AVX2
+FILE_SCOPE void dchip8_scale_row_avx2_internal(const u32 *colours, u32 scaleX,
+                                               u32 *dest)
+{
+	// NOTE: At 4x a ymm store would write each pixel's span twice
+	if (scaleX <= 4)
+	{
+		dchip8_scale_row_sse2_internal(colours, scaleX, dest);
+		return;
+	}
+
+	for (i32 x = 0; x < CHIP8_DISPLAY_WIDTH - 1; x++)
+	{
+		__m256i colour = _mm256_set1_epi32((i32)colours[x]);
+		for (u32 i = 0; i < scaleX; i += 8)
+			_mm256_storeu_si256((__m256i *)(dest + i), colour);
+		dest += scaleX;
+	}
+
+	u32 last       = colours[CHIP8_DISPLAY_WIDTH - 1];
+	__m256i colour = _mm256_set1_epi32((i32)last);
+	u32 i          = 0;
+	for (; i + 8 <= scaleX; i += 8)
+		_mm256_storeu_si256((__m256i *)(dest + i), colour);
+	for (; i < scaleX; i++)
+		dest[i] = last;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Expand Kernels
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Turn a row of the 1bpp display into CHIP8_DISPLAY_WIDTH colours. The
+// SIMD kernels broadcast a group of bits to every lane and test a different
+// bit per lane, the left most pixel is the group's most significant bit.
+typedef void Chip8ScaleExpandKernel(u64 bits, u32 onColour, u32 offColour,
+                                    u32 *dest);
+
+FILE_SCOPE void dchip8_scale_expand_scalar_internal(u64 bits, u32 onColour,
+                                                    u32 offColour, u32 *dest)
+{
+	u32 colourDiff = onColour ^ offColour;
+	for (i32 x = 0; x < CHIP8_DISPLAY_WIDTH; x++)
+	{
+		u32 isOn = (u32)(bits >> ((CHIP8_DISPLAY_WIDTH - 1) - x)) & 1;
+		dest[x]  = offColour ^ (colourDiff & (0 - isOn));
+	}
+}
+
+#ifdef DCHIP8_SCALE_X86
+DCHIP8_SCALE_TARGET_SSE2
+FILE_SCOPE void dchip8_scale_expand_sse2_internal(u64 bits, u32 onColour,
+                                                  u32 offColour, u32 *dest)
+{
+	const __m128i laneBits = _mm_set_epi32(1, 2, 4, 8);
+	__m128i off            = _mm_set1_epi32((i32)offColour);
+	__m128i colourDiff     = _mm_set1_epi32((i32)(onColour ^ offColour));
+	for (i32 x = 0; x < CHIP8_DISPLAY_WIDTH; x += 4)
+	{
+		i32 nibble   = (i32)(bits >> ((CHIP8_DISPLAY_WIDTH - 4) - x)) & 0xF;
+		__m128i isOn = _mm_and_si128(_mm_set1_epi32(nibble), laneBits);
+		isOn         = _mm_cmpeq_epi32(isOn, laneBits);
+		_mm_storeu_si128((__m128i *)(dest + x),
+		                 _mm_xor_si128(off, _mm_and_si128(colourDiff, isOn)));
+	}
+}
+
+DCHIP8_SCALE_TARGET_AVX2
+FILE_SCOPE void dchip8_scale_expand_avx2_internal(u64 bits, u32 onColour,
+                                                  u32 offColour, u32 *dest)
+{
+	const __m256i laneBits = _mm256_set_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	__m256i off            = _mm256_set1_epi32((i32)offColour);
+	__m256i colourDiff     = _mm256_set1_epi32((i32)(onColour ^ offColour));
+	for (i32 x = 0; x < CHIP8_DISPLAY_WIDTH; x += 8)
+	{
+		i32 byte     = (i32)(bits >> ((CHIP8_DISPLAY_WIDTH - 8) - x)) & 0xFF;
+		__m256i isOn = _mm256_and_si256(_mm256_set1_epi32(byte), laneBits);
+		isOn         = _mm256_cmpeq_epi32(isOn, laneBits);
+		_mm256_storeu_si256(
+		    (__m256i *)(dest + x),
+		    _mm256_xor_si256(off, _mm256_and_si256(colourDiff, isOn)));
+	}
+}
+#endif
+
+FILE_SCOPE Chip8ScaleExpandKernel *
+dchip8_scale_expand_kernel_internal(enum Chip8ScaleKernel kernel)
+{
+#ifdef DCHIP8_SCALE_X86
+	if (kernel == chip8scalekernel_avx2) return dchip8_scale_expand_avx2_internal;
+	if (kernel == chip8scalekernel_sse2) return dchip8_scale_expand_sse2_internal;
+#endif
+	return dchip8_scale_expand_scalar_internal;
+}
+
+FILE_SCOPE Chip8ScaleRowKernel *
+dchip8_scale_row_kernel_internal(enum Chip8ScaleKernel kernel)
+{
+#ifdef DCHIP8_SCALE_X86
+	if (kernel == chip8scalekernel_avx2) return dchip8_scale_row_avx2_internal;
+	if (kernel == chip8scalekernel_sse2) return dchip8_scale_row_sse2_internal;
+#endif
+	return dchip8_scale_row_scalar_internal;
+}
+
+enum Chip8ScaleKernel dchip8_scale_best_kernel()
+{
+	enum Chip8ScaleKernel result = chip8scalekernel_scalar;
+#if defined(DCHIP8_SCALE_X86)
+	#if defined(_MSC_VER)
+	// NOTE: AVX2 also needs the OS to save the ymm registers on context switch
+	i32 info[4];
+	__cpuid(info, 1);
+	bool hasSSE2    = (info[3] & (1 << 26)) != 0;
+	bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+	                  ((_xgetbv(0) & 6) == 6);
+	__cpuidex(info, 7, 0);
+	bool hasAVX2 = osSavesYmm && (info[1] & (1 << 5)) != 0;
+	#else
+	bool hasSSE2 = __builtin_cpu_supports("sse2");
+	bool hasAVX2 = __builtin_cpu_supports("avx2");
+	#endif
+
+	if (hasSSE2) result = chip8scalekernel_sse2;
+	if (hasAVX2) result = chip8scalekernel_avx2;
+#endif
+	return result;
+}
+
+const char *dchip8_scale_kernel_string(enum Chip8ScaleKernel kernel)
+{
+	switch (kernel)
+	{
+		case chip8scalekernel_scalar: return "scalar";
+		case chip8scalekernel_sse2:   return "sse2";
+		case chip8scalekernel_avx2:   return "avx2";
+		default:                      return "unknown";
+	}
+}
+
+// NOTE: Exactly one of display and pixels is set
+FILE_SCOPE void dchip8_scale_rows_internal(const u64 *display, const u32 *pixels,
+                                           const Chip8ScaleTarget *target,
+                                           enum Chip8ScaleKernel kernel,
+                                           u32 firstRow, u32 lastRow)
+{
+	DQNT_ASSERT(target->scaleX > 0 && target->scaleY > 0);
+	DQNT_ASSERT(target->pitch >= CHIP8_DISPLAY_WIDTH * target->scaleX);
+
+	Chip8ScaleRowKernel *scaleRow  = dchip8_scale_row_kernel_internal(kernel);
+	Chip8ScaleExpandKernel *expand = dchip8_scale_expand_kernel_internal(kernel);
+	size_t rowSize = CHIP8_DISPLAY_WIDTH * target->scaleX * sizeof(u32);
+
+	u32 row = firstRow;
+	while (row < lastRow)
+	{
+		u32 srcY    = row / target->scaleY;
+		u32 srcEnd  = (srcY + 1) * target->scaleY;
+		u32 copyEnd = DQNT_MATH_MIN(srcEnd, lastRow);
+		u32 *first  = target->memory + ((size_t)row * target->pitch);
+
+		// NOTE: At 1x across the expanded row is the output row
+		u32 expanded[CHIP8_DISPLAY_WIDTH];
+		const u32 *colours = pixels + (srcY * CHIP8_DISPLAY_WIDTH);
+		if (display)
+		{
+			u32 *dest = (target->scaleX == 1) ? first : expanded;
+			expand(display[srcY], target->onColour, target->offColour, dest);
+			colours = dest;
+		}
+
+		if (colours != first) scaleRow(colours, target->scaleX, first);
+
+		for (row++; row < copyEnd; row++)
+			memcpy(target->memory + ((size_t)row * target->pitch), first, rowSize);
+	}
+}
+
+void dchip8_scale_rows(const u64 *display, const Chip8ScaleTarget *target,
+                       enum Chip8ScaleKernel kernel, u32 firstRow, u32 lastRow)
+{
+	dchip8_scale_rows_internal(display, NULL, target, kernel, firstRow, lastRow);
+}
+
+void dchip8_scale_rows_argb(const u32 *pixels, const Chip8ScaleTarget *target,
+                            enum Chip8ScaleKernel kernel, u32 firstRow,
+                            u32 lastRow)
+{
+	dchip8_scale_rows_internal(NULL, pixels, target, kernel, firstRow, lastRow);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Threaded Scaler
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Claim and scale bands of the job published as generation until there
+// are none left. A worker that wakes up late sees a newer generation in
+// bandClaim and goes back to sleep.
+FILE_SCOPE void dchip8_scaler_process_bands_internal(Chip8Scaler *scaler,
+                                                     u32 generation)
+{
+	u64 claim = dqnt_atomic_compare_swap_u64(&scaler->bandClaim, 0, 0);
+	for (;;)
+	{
+		u32 band = (u32)claim;
+		if ((u32)(claim >> 32) != generation || band >= scaler->numBands) break;
+
+		u64 prevClaim =
+		    dqnt_atomic_compare_swap_u64(&scaler->bandClaim, claim + 1, claim);
+		if (prevClaim != claim)
+		{
+			claim = prevClaim;
+			continue;
+		}
+
+		u32 outputHeight = CHIP8_DISPLAY_HEIGHT * scaler->target.scaleY;
+		u32 firstRow     = band * scaler->rowsPerBand;
+		u32 lastRow = DQNT_MATH_MIN(firstRow + scaler->rowsPerBand, outputHeight);
+		dchip8_scale_rows_internal(scaler->display, scaler->pixels,
+		                           &scaler->target, scaler->kernel, firstRow,
+		                           lastRow);
+		dqnt_atomic_add_u32(&scaler->numBandsDone, 1);
+		claim++;
+	}
+}
+
+FILE_SCOPE u32 dchip8_scaler_worker_internal(void *userData)
+{
+	Chip8ScaleWorker *worker = (Chip8ScaleWorker *)userData;
+	Chip8Scaler *scaler      = worker->scaler;
+
+	u32 seenGeneration = 0;
+	for (;;)
+	{
+		// NOTE: Frames arrive 60 times a second, so between them the worker
+		// blocks and the presenting thread wakes it with the next job
+		u32 generation = dqnt_signal_wait(&scaler->jobSignal, seenGeneration);
+		seenGeneration = generation;
+
+		if (dqnt_atomic_load_u32(&scaler->quit)) break;
+		dchip8_scaler_process_bands_internal(scaler, generation);
+	}
+
+	return 0;
+}
+
+void dchip8_scaler_start(Chip8Scaler *scaler, u32 numThreads)
+{
+	*scaler        = {};
+	scaler->kernel = dchip8_scale_best_kernel();
+
+	if (numThreads == 0) numThreads = dqnt_num_cores();
+	numThreads = DQNT_MATH_MIN(numThreads, CHIP8_SCALE_MAX_THREADS);
+	if (numThreads <= 1 || !dqnt_signal_init(&scaler->jobSignal)) return;
+	for (u32 i = 0; i + 1 < numThreads; i++)
+	{
+		Chip8ScaleWorker *worker = &scaler->workers[scaler->numWorkers];
+		worker->scaler           = scaler;
+		if (dqnt_thread_create(&worker->thread, dchip8_scaler_worker_internal,
+		                       worker))
+		{
+			scaler->numWorkers++;
+		}
+	}
+}
+
+void dchip8_scaler_stop(Chip8Scaler *scaler)
+{
+	dqnt_atomic_store_u32(&scaler->quit, 1);
+	dqnt_signal_publish(&scaler->jobSignal);
+	for (u32 i = 0; i < scaler->numWorkers; i++)
+		dqnt_thread_join(&scaler->workers[i].thread);
+	scaler->numWorkers = 0;
+	dqnt_signal_free(&scaler->jobSignal);
+}
+
+FILE_SCOPE void dchip8_scaler_present_internal(Chip8Scaler *scaler,
+                                               const u64 *display,
+                                               const u32 *pixels,
+                                               const Chip8ScaleTarget *target)
+{
+	u32 outputHeight = CHIP8_DISPLAY_HEIGHT * target->scaleY;
+	u32 outputWidth  = CHIP8_DISPLAY_WIDTH * target->scaleX;
+	u32 numPixels    = outputWidth * outputHeight;
+
+	u32 numBands = numPixels / CHIP8_SCALE_MIN_BAND_PIXELS;
+	numBands     = DQNT_MATH_MIN(numBands, scaler->numWorkers + 1);
+	if (numBands <= 1)
+	{
+		dchip8_scale_rows_internal(display, pixels, target, scaler->kernel, 0,
+		                           outputHeight);
+		return;
+	}
+
+	scaler->display     = display;
+	scaler->pixels      = pixels;
+	scaler->target      = *target;
+	scaler->rowsPerBand = (outputHeight + numBands - 1) / numBands;
+	scaler->numBands    = (outputHeight + scaler->rowsPerBand - 1) /
+	                      scaler->rowsPerBand;
+	dqnt_atomic_store_u32(&scaler->numBandsDone, 0);
+
+	// NOTE: Only this thread publishes, so the claim word can be swapped in
+	// against whatever the last job left in it
+	u32 generation = scaler->jobSignal.generation + 1;
+	u64 claim      = dqnt_atomic_compare_swap_u64(&scaler->bandClaim, 0, 0);
+	u64 newClaim   = (u64)generation << 32;
+	u64 prevClaim;
+	while ((prevClaim = dqnt_atomic_compare_swap_u64(&scaler->bandClaim,
+	                                                 newClaim, claim)) != claim)
+		claim = prevClaim;
+	dqnt_signal_publish(&scaler->jobSignal);
+
+	dchip8_scaler_process_bands_internal(scaler, generation);
+	dqnt_spin_until_u32(&scaler->numBandsDone, scaler->numBands);
+}
+
+void dchip8_scaler_present(Chip8Scaler *scaler, const u64 *display,
+                           const Chip8ScaleTarget *target)
+{
+	dchip8_scaler_present_internal(scaler, display, NULL, target);
+}
+
+void dchip8_scaler_present_argb(Chip8Scaler *scaler, const u32 *pixels,
+                                const Chip8ScaleTarget *target)
+{
+	dchip8_scaler_present_internal(scaler, NULL, pixels, target);
+}
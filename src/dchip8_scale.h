@@ -0,0 +1,92 @@
+#ifndef DCHIP8_SCALE_H
+#define DCHIP8_SCALE_H
+
+#include "dchip8.h"
+#include "dqnt.h"
+
+// NOTE: Software presentation. Expands the packed 1bpp display straight into
+// an integer scaled ARGB image, so the platform only has to copy the result
+// to the screen 1:1 instead of asking the OS to stretch a 64x32 bitmap.
+//
+// Each source row is expanded once into the first output row it covers, the
+// other scaleY - 1 rows are copies of it. Large images are split into bands of
+// output rows that are claimed by whichever threads are awake, the caller
+// included, so presenting never waits on a worker that is still asleep.
+
+#define CHIP8_SCALE_MAX_THREADS 16
+// Bands smaller than this cost more to hand out than to just do
+#define CHIP8_SCALE_MIN_BAND_PIXELS (64 * 1024)
+
+enum Chip8ScaleKernel
+{
+	chip8scalekernel_scalar,
+	chip8scalekernel_sse2,
+	chip8scalekernel_avx2,
+	chip8scalekernel_count,
+};
+
+typedef struct Chip8ScaleTarget
+{
+	// NOTE: Top row first, pitch is in pixels. The image covers
+	// (CHIP8_DISPLAY_WIDTH * scaleX) by (CHIP8_DISPLAY_HEIGHT * scaleY) pixels.
+	// The colours only apply when scaling the 1bpp display.
+	u32 *memory;
+	u32  pitch;
+	u32  scaleX;
+	u32  scaleY;
+	u32  onColour;
+	u32  offColour;
+} Chip8ScaleTarget;
+
+typedef struct Chip8ScaleWorker
+{
+	struct Chip8Scaler *scaler;
+	DqntThread          thread;
+} Chip8ScaleWorker;
+
+typedef struct Chip8Scaler
+{
+	// Defaults to the best kernel the CPU supports
+	enum Chip8ScaleKernel kernel;
+
+	// NOTE: The job fields are written before jobSignal is published and
+	// only change again once every band has been counted in numBandsDone.
+	// bandClaim is the job's generation in the high half and the next band in
+	// the low half, so a claim can never land in a job the claimer didn't see.
+	Chip8ScaleWorker      workers[CHIP8_SCALE_MAX_THREADS - 1];
+	u32                   numWorkers;
+	DqntSignal            jobSignal;
+	volatile u64          bandClaim;
+	volatile u32          numBandsDone;
+	volatile u32          quit;
+	const u64            *display;
+	const u32            *pixels;
+	Chip8ScaleTarget      target;
+	u32                   numBands;
+	u32                   rowsPerBand;
+} Chip8Scaler;
+
+// Return the fastest kernel this CPU can run
+enum Chip8ScaleKernel dchip8_scale_best_kernel();
+const char           *dchip8_scale_kernel_string(enum Chip8ScaleKernel kernel);
+
+// Scale output rows [firstRow, lastRow) on the calling thread. The _argb
+// variants take a CHIP8_DISPLAY_WIDTH x CHIP8_DISPLAY_HEIGHT ARGB image, top
+// row first, instead of the 1bpp display.
+void dchip8_scale_rows     (const u64 *display, const Chip8ScaleTarget *target,
+                            enum Chip8ScaleKernel kernel, u32 firstRow,
+                            u32 lastRow);
+void dchip8_scale_rows_argb(const u32 *pixels, const Chip8ScaleTarget *target,
+                            enum Chip8ScaleKernel kernel, u32 firstRow,
+                            u32 lastRow);
+
+// numThreads counts the caller, 0 uses every core
+void dchip8_scaler_start  (Chip8Scaler *scaler, u32 numThreads);
+void dchip8_scaler_stop   (Chip8Scaler *scaler);
+// Scale the whole image, return once it is complete
+void dchip8_scaler_present     (Chip8Scaler *scaler, const u64 *display,
+                                const Chip8ScaleTarget *target);
+void dchip8_scaler_present_argb(Chip8Scaler *scaler, const u32 *pixels,
+                                const Chip8ScaleTarget *target);
+
+#endif
@@ -0,0 +1,159 @@
+#include "dchip8_shm.h"
+#include "dqnt.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+FILE_SCOPE bool dchip8_shm_map_internal(Chip8SharedMemory *shm, bool writable)
+{
+	i32 prot   = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+	void *addr = mmap(NULL, sizeof(Chip8SharedFrame), prot, MAP_SHARED,
+	                  shm->fd, 0);
+	if (addr == MAP_FAILED)
+	{
+		close(shm->fd);
+		shm->fd = -1;
+		return false;
+	}
+
+	shm->frame    = (Chip8SharedFrame *)addr;
+	shm->writable = writable;
+	return true;
+}
+
+bool dchip8_shm_create(Chip8SharedMemory *shm, const char *name)
+{
+	*shm    = {};
+	shm->fd = -1;
+
+	if (name)
+	{
+		shm->fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		snprintf(shm->path, sizeof(shm->path), "%s", name);
+	}
+	else
+	{
+#ifdef __linux__
+		shm->fd = memfd_create("dchip8", MFD_CLOEXEC);
+		snprintf(shm->path, sizeof(shm->path), "/proc/%d/fd/%d", (i32)getpid(),
+		         shm->fd);
+#endif
+	}
+
+	if (shm->fd < 0) return false;
+	if (ftruncate(shm->fd, sizeof(Chip8SharedFrame)) != 0)
+	{
+		close(shm->fd);
+		if (name) shm_unlink(name);
+		shm->fd = -1;
+		return false;
+	}
+
+	if (!dchip8_shm_map_internal(shm, true))
+	{
+		if (name) shm_unlink(name);
+		return false;
+	}
+
+	// NOTE: ftruncate zero fills so the sequence starts even. Publish the magic
+	// last so readers can tell the header is filled in.
+	Chip8SharedFrame *frame = shm->frame;
+	frame->version          = DCHIP8_SHM_VERSION;
+	frame->width            = CHIP8_DISPLAY_WIDTH;
+	frame->height           = CHIP8_DISPLAY_HEIGHT;
+	frame->bytesPerPixel    = sizeof(frame->pixels[0]);
+	dqnt_atomic_store_u32(&frame->magic, DCHIP8_SHM_MAGIC);
+	return true;
+}
+
+bool dchip8_shm_open(Chip8SharedMemory *shm, const char *nameOrPath)
+{
+	*shm    = {};
+	shm->fd = -1;
+
+	bool isPath = (strchr(nameOrPath + 1, '/') != NULL);
+	if (isPath) shm->fd = open(nameOrPath, O_RDONLY);
+	else        shm->fd = shm_open(nameOrPath, O_RDONLY, 0);
+	if (shm->fd < 0) return false;
+
+	struct stat info;
+	if (fstat(shm->fd, &info) != 0 || info.st_size < (off_t)sizeof(Chip8SharedFrame))
+	{
+		close(shm->fd);
+		shm->fd = -1;
+		return false;
+	}
+
+	snprintf(shm->path, sizeof(shm->path), "%s", nameOrPath);
+	if (!dchip8_shm_map_internal(shm, false)) return false;
+
+	Chip8SharedFrame *frame = shm->frame;
+	if (dqnt_atomic_load_u32((volatile u32 *)&frame->magic) != DCHIP8_SHM_MAGIC ||
+	    frame->version != DCHIP8_SHM_VERSION)
+	{
+		dchip8_shm_close(shm, false);
+		return false;
+	}
+
+	return true;
+}
+
+void dchip8_shm_close(Chip8SharedMemory *shm, bool unlink)
+{
+	if (shm->frame) munmap(shm->frame, sizeof(Chip8SharedFrame));
+	if (shm->fd >= 0) close(shm->fd);
+
+	// NOTE: memfd segments have no name and go away with the last reference
+	if (unlink && shm->writable && shm->path[0] == '/' &&
+	    !strchr(shm->path + 1, '/'))
+	{
+		shm_unlink(shm->path);
+	}
+
+	*shm    = {};
+	shm->fd = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Seqlock
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: There's a single writer so the increments don't need to be atomic read
+// modify writes, but the fences are needed so the frame writes can't be
+// reordered out of the odd section and reader loads out of the read section.
+void dchip8_shm_write_begin(Chip8SharedFrame *frame)
+{
+	u32 sequence = frame->sequence;
+	dqnt_atomic_store_u32(&frame->sequence, sequence + 1);
+	dqnt_atomic_fence();
+}
+
+void dchip8_shm_write_end(Chip8SharedFrame *frame)
+{
+	dqnt_atomic_fence();
+	u32 sequence = frame->sequence;
+	dqnt_atomic_store_u32(&frame->sequence, sequence + 1);
+}
+
+u32 dchip8_shm_read_begin(const Chip8SharedFrame *frame)
+{
+	volatile u32 *sequencePtr = (volatile u32 *)&frame->sequence;
+	u32 result;
+	while ((result = dqnt_atomic_load_u32(sequencePtr)) & 1)
+	{
+	}
+
+	dqnt_atomic_fence();
+	return result;
+}
+
+bool dchip8_shm_read_retry(const Chip8SharedFrame *frame, u32 sequence)
+{
+	dqnt_atomic_fence();
+	bool result =
+	    (dqnt_atomic_load_u32((volatile u32 *)&frame->sequence) != sequence);
+	return result;
+}
@@ -0,0 +1,73 @@
+#ifndef DCHIP8_SHM_H
+#define DCHIP8_SHM_H
+
+#include "dchip8.h"
+#include "dqnt.h"
+
+// NOTE: Shared memory framebuffer export. The emulator renders straight into a
+// shared segment so other processes can watch it without the emulator making
+// any syscalls or copies per frame. Consistency is a seqlock, the writer makes
+// sequence odd while it is touching the frame and even when it's done.
+//
+// Writer                         Reader
+//   dchip8_shm_write_begin()       do {
+//   ... update pixels ...            seq = dchip8_shm_read_begin()
+//   dchip8_shm_write_end()           ... read or copy the frame ...
+//                                  } while (dchip8_shm_read_retry(seq))
+//
+// Readers never block the writer, a reader that races a frame just retries.
+
+#define DCHIP8_SHM_MAGIC   0x38504843 // "CHP8"
+#define DCHIP8_SHM_VERSION 1
+
+typedef struct Chip8SharedFrame
+{
+	u32 magic;
+	u32 version;
+	// NOTE: Odd while the writer is mid frame
+	volatile u32 sequence;
+	u32 width;
+	u32 height;
+	u32 bytesPerPixel;
+
+	// NOTE: Everything below is only consistent inside a read section
+	u64 frameNumber;
+	u32 state;
+	u32 unused;
+
+	// Packed 1bpp display, top row first, the most significant bit of a row is
+	// the left most pixel
+	u64 display[CHIP8_DISPLAY_HEIGHT];
+
+	// ARGB as rendered by the core, the bottom row first like a Win32 DIB
+	u32 pixels[CHIP8_DISPLAY_WIDTH * CHIP8_DISPLAY_HEIGHT];
+} Chip8SharedFrame;
+
+typedef struct Chip8SharedMemory
+{
+	Chip8SharedFrame *frame;
+	i32               fd;
+	bool              writable;
+	// Name for shm_open or a path a reader can open(), i.e. /proc/<pid>/fd/<n>
+	char              path[128];
+} Chip8SharedMemory;
+
+// Create and map a segment for writing. name is a POSIX shared memory name
+// i.e. "/dchip8". If name is NULL an anonymous memfd is used instead and path
+// is set to the /proc path other processes can open it from.
+bool dchip8_shm_create(Chip8SharedMemory *shm, const char *name);
+// Map an existing segment read only. A name containing a '/' past the first
+// character is opened as a file path, otherwise as a shared memory name.
+bool dchip8_shm_open  (Chip8SharedMemory *shm, const char *nameOrPath);
+// unlink removes the shared memory name so no new readers can attach
+void dchip8_shm_close (Chip8SharedMemory *shm, bool unlink);
+
+void dchip8_shm_write_begin(Chip8SharedFrame *frame);
+void dchip8_shm_write_end  (Chip8SharedFrame *frame);
+
+// Spins while a write is in progress, returns the sequence to pass to retry
+u32  dchip8_shm_read_begin(const Chip8SharedFrame *frame);
+// Return true if the frame changed since read_begin and the read is torn
+bool dchip8_shm_read_retry(const Chip8SharedFrame *frame, u32 sequence);
+
+#endif
@@ -0,0 +1,273 @@
+#include "dchip8_store.h"
+#include "dqnt.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <Windows.h>
+#else
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+FILE_SCOPE u32 dchip8_store_slot_size_internal()
+{
+	u32 result = (u32)sizeof(Chip8StoreSlot);
+	result     = (result + CHIP8_STORE_ALIGNMENT - 1) &
+	             ~(CHIP8_STORE_ALIGNMENT - 1);
+	return result;
+}
+
+FILE_SCOPE inline Chip8StoreSlot *
+dchip8_store_slot_internal(const Chip8Store *store, u32 index)
+{
+	DQNT_ASSERT(index < store->numSlots);
+	return (Chip8StoreSlot *)(store->slots + ((size_t)store->slotSize * index));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Mapping
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Map the file at path, creating it size bytes long if size isn't 0 and
+// there's no file. A new file is zero filled, so every slot starts empty with
+// an even sequence. created says whether the header needs filling in.
+#ifdef _WIN32
+FILE_SCOPE bool dchip8_store_map_internal(Chip8Store *store, const char *path,
+                                          u64 size, bool *created)
+{
+	*created = false;
+	HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+	                          FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+	                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE && size > 0)
+	{
+		file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+		                   FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CREATE_NEW,
+		                   FILE_ATTRIBUTE_NORMAL, NULL);
+		*created = (file != INVALID_HANDLE_VALUE);
+	}
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	if (!*created)
+	{
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		size = (u64)fileSize.QuadPart;
+	}
+
+	// NOTE: Mapping more than the file holds grows it to the mapping's size
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+	                                    (DWORD)(size >> 32), (DWORD)size, NULL);
+	void *memory   = NULL;
+	if (mapping) memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (!memory)
+	{
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		if (*created) DeleteFileA(path);
+		return false;
+	}
+
+	store->header  = (Chip8StoreHeader *)memory;
+	store->size    = size;
+	store->handle  = file;
+	store->mapping = mapping;
+	return true;
+}
+
+FILE_SCOPE void dchip8_store_unmap_internal(Chip8Store *store)
+{
+	if (store->header) UnmapViewOfFile(store->header);
+	if (store->mapping) CloseHandle((HANDLE)store->mapping);
+	if (store->handle) CloseHandle((HANDLE)store->handle);
+}
+
+bool dchip8_store_flush(Chip8Store *store)
+{
+	bool result = FlushViewOfFile(store->header, 0) != 0 &&
+	              FlushFileBuffers((HANDLE)store->handle) != 0;
+	return result;
+}
+#else
+FILE_SCOPE bool dchip8_store_map_internal(Chip8Store *store, const char *path,
+                                          u64 size, bool *created)
+{
+	*created = false;
+	i32 fd   = open(path, O_RDWR);
+	if (fd < 0 && errno == ENOENT && size > 0)
+	{
+		fd       = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+		*created = (fd >= 0);
+		if (*created && ftruncate(fd, (off_t)size) != 0)
+		{
+			close(fd);
+			unlink(path);
+			return false;
+		}
+	}
+	if (fd < 0) return false;
+
+	if (!*created)
+	{
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size <= 0)
+		{
+			close(fd);
+			return false;
+		}
+		size = (u64)info.st_size;
+	}
+
+	// NOTE: The mapping keeps the file open
+	void *memory = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED,
+	                    fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		if (*created) unlink(path);
+		return false;
+	}
+
+	store->header = (Chip8StoreHeader *)memory;
+	store->size   = size;
+	return true;
+}
+
+FILE_SCOPE void dchip8_store_unmap_internal(Chip8Store *store)
+{
+	if (store->header) munmap(store->header, (size_t)store->size);
+}
+
+bool dchip8_store_flush(Chip8Store *store)
+{
+	return msync(store->header, (size_t)store->size, MS_SYNC) == 0;
+}
+#endif
+
+bool dchip8_store_open(Chip8Store *store, const char *path, u32 numSlots)
+{
+	*store       = {};
+	u32 slotSize = dchip8_store_slot_size_internal();
+
+	// NOTE: The header takes the first cache line so slots stay aligned
+	DQNT_ASSERT(sizeof(Chip8StoreHeader) <= CHIP8_STORE_ALIGNMENT);
+	u64 size = 0;
+	if (numSlots > 0)
+		size = CHIP8_STORE_ALIGNMENT + ((u64)slotSize * numSlots);
+
+	bool created = false;
+	if (!dchip8_store_map_internal(store, path, size, &created)) return false;
+
+	Chip8StoreHeader *header = store->header;
+	if (created)
+	{
+		// NOTE: Magic last, a store that crashed before it is never opened
+		header->version  = CHIP8_STORE_VERSION;
+		header->numSlots = numSlots;
+		header->slotSize = slotSize;
+		header->vmSize   = sizeof(Chip8VM);
+		dqnt_atomic_store_u32((volatile u32 *)&header->magic, CHIP8_STORE_MAGIC);
+	}
+
+	bool valid = store->size >= CHIP8_STORE_ALIGNMENT &&
+	             header->magic == CHIP8_STORE_MAGIC &&
+	             header->version == CHIP8_STORE_VERSION &&
+	             header->vmSize == sizeof(Chip8VM) &&
+	             header->slotSize == slotSize && header->numSlots > 0 &&
+	             store->size >= CHIP8_STORE_ALIGNMENT +
+	                                ((u64)slotSize * header->numSlots);
+	if (!valid)
+	{
+		dchip8_store_close(store);
+		return false;
+	}
+
+	store->slots    = (u8 *)header + CHIP8_STORE_ALIGNMENT;
+	store->numSlots = header->numSlots;
+	store->slotSize = slotSize;
+	return true;
+}
+
+void dchip8_store_close(Chip8Store *store)
+{
+	dchip8_store_unmap_internal(store);
+	*store = {};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Slots
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: A torn slot is still odd, writing it again must leave it even, so the
+// write section starts from the next odd number instead of adding one. The
+// fences keep the slot's writes inside the odd section.
+FILE_SCOPE u32 dchip8_store_write_begin_internal(Chip8StoreSlot *slot)
+{
+	u32 sequence = (slot->sequence + 1) | 1;
+	dqnt_atomic_store_u32(&slot->sequence, sequence);
+	dqnt_atomic_fence();
+	return sequence;
+}
+
+FILE_SCOPE void dchip8_store_write_end_internal(Chip8StoreSlot *slot,
+                                                u32 sequence)
+{
+	dqnt_atomic_fence();
+	dqnt_atomic_store_u32(&slot->sequence, sequence + 1);
+}
+
+void dchip8_store_suspend(Chip8Store *store, u32 index, const Chip8VM *vm,
+                          u64 key)
+{
+	Chip8StoreSlot *slot = dchip8_store_slot_internal(store, index);
+	u32 sequence         = dchip8_store_write_begin_internal(slot);
+	{
+		memcpy(&slot->vm, vm, sizeof(slot->vm));
+		slot->key      = key;
+		slot->occupied = 1;
+	}
+	dchip8_store_write_end_internal(slot, sequence);
+}
+
+bool dchip8_store_resume(const Chip8Store *store, u32 index, Chip8VM *vm,
+                         u64 *key)
+{
+	const Chip8StoreSlot *slot = dchip8_store_slot_internal(store, index);
+	if (dchip8_store_slot_torn(slot) || !slot->occupied) return false;
+
+	memcpy(vm, &slot->vm, sizeof(*vm));
+	if (key) *key = slot->key;
+	return true;
+}
+
+void dchip8_store_clear(Chip8Store *store, u32 index)
+{
+	Chip8StoreSlot *slot = dchip8_store_slot_internal(store, index);
+	u32 sequence         = dchip8_store_write_begin_internal(slot);
+	{
+		slot->key      = 0;
+		slot->occupied = 0;
+	}
+	dchip8_store_write_end_internal(slot, sequence);
+}
+
+const Chip8StoreSlot *dchip8_store_slot(const Chip8Store *store, u32 index)
+{
+	return dchip8_store_slot_internal(store, index);
+}
+
+bool dchip8_store_slot_torn(const Chip8StoreSlot *slot)
+{
+	u32 sequence = dqnt_atomic_load_u32((volatile u32 *)&slot->sequence);
+	return (sequence & 1) != 0;
+}
@@ -0,0 +1,78 @@
+#ifndef DCHIP8_STORE_H
+#define DCHIP8_STORE_H
+
+#include "dchip8.h"
+#include "dqnt.h"
+
+// NOTE: File of fixed size slots that each hold a complete machine, for
+// parking idle machines and bringing them back, including in a later process.
+// The file is mapped shared so a suspend is a copy into the mapping and a
+// resume a copy out of it, there's nothing to parse and the OS writes the
+// pages back in its own time. A process that crashes loses nothing it
+// suspended, use dchip8_store_flush for surviving the machine going down.
+//
+// Every slot has a sequence that is odd while a suspend is writing it, a slot
+// left odd by a crash mid suspend is torn and won't resume. A slot has one
+// owner at a time, suspends of different slots can run concurrently.
+//
+// File layout, integers in host order which is little endian on every
+// platform we build for. Slots start on a cache line.
+//   Chip8StoreHeader
+//   numSlots slots, slotSize bytes apart, each a Chip8StoreSlot
+#define CHIP8_STORE_MAGIC     0x4F545338 // "8STO"
+#define CHIP8_STORE_VERSION   1
+#define CHIP8_STORE_ALIGNMENT 64
+
+typedef struct Chip8StoreHeader
+{
+	u32 magic;
+	u32 version;
+	u32 numSlots;
+	u32 slotSize;
+	// sizeof(Chip8VM), a store is only readable by builds with the same layout
+	u32 vmSize;
+	u32 reserved[11];
+} Chip8StoreHeader;
+
+typedef struct Chip8StoreSlot
+{
+	volatile u32 sequence;
+	u32          occupied;
+	// The caller's name for the machine, e.g. a session id
+	u64          key;
+	Chip8VM      vm;
+} Chip8StoreSlot;
+
+typedef struct Chip8Store
+{
+	Chip8StoreHeader *header;
+	u8               *slots;
+	u32               numSlots;
+	u32               slotSize;
+	u64               size;
+	void             *handle;
+	void             *mapping;
+} Chip8Store;
+
+// Map the store at path, creating it with numSlots empty slots if there is
+// none. An existing store keeps its own number of slots. Return false if path
+// is not a store of this build's layout or numSlots is 0 for a new store.
+bool dchip8_store_open   (Chip8Store *store, const char *path, u32 numSlots);
+void dchip8_store_close  (Chip8Store *store);
+// Write the mapping to disk, return false on failure
+bool dchip8_store_flush  (Chip8Store *store);
+
+// Copy vm into slot index under key, replacing whatever was there
+void dchip8_store_suspend(Chip8Store *store, u32 index, const Chip8VM *vm,
+                          u64 key);
+// Copy the machine in slot index to vm and its key to key, which may be NULL.
+// Return false if the slot is empty or torn, vm is left as it was.
+bool dchip8_store_resume (const Chip8Store *store, u32 index, Chip8VM *vm,
+                          u64 *key);
+void dchip8_store_clear  (Chip8Store *store, u32 index);
+
+// The slot in place, i.e. for listing the store without copying machines out
+const Chip8StoreSlot *dchip8_store_slot(const Chip8Store *store, u32 index);
+bool dchip8_store_slot_torn(const Chip8StoreSlot *slot);
+
+#endif
@@ -0,0 +1,235 @@
+#include "dchip8_trace.h"
+#include "dqnt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <signal.h>
+	#include <unistd.h>
+#endif
+
+FILE_SCOPE u32 dchip8_trace_capacity_internal(u32 capacity)
+{
+	u32 result = 1;
+	while (result < capacity && result < (1u << 31)) result <<= 1;
+	return result;
+}
+
+bool dchip8_trace_init(Chip8Trace *trace, Chip8Arena *arena, u32 capacity,
+                       u32 id)
+{
+	*trace = {};
+
+	u32 size       = dchip8_trace_capacity_internal(capacity);
+	trace->records = DCHIP8_ARENA_PUSH_ARRAY(arena, Chip8TraceRecord, size);
+	if (!trace->records) return false;
+
+	trace->mask = size - 1;
+	trace->id   = id;
+	return true;
+}
+
+size_t dchip8_trace_memory_size(u32 capacity)
+{
+	size_t result = (sizeof(Chip8TraceRecord) *
+	                 (size_t)dchip8_trace_capacity_internal(capacity)) +
+	                alignof(Chip8TraceRecord);
+	return result;
+}
+
+FILE_SCOPE Chip8TraceHeader dchip8_trace_header_internal(const Chip8Trace *trace)
+{
+	u64 capacity = (u64)trace->mask + 1;
+
+	Chip8TraceHeader result = {};
+	result.magic            = CHIP8_TRACE_MAGIC;
+	result.version          = CHIP8_TRACE_VERSION;
+	result.id               = trace->id;
+	result.numRecords       = (u32)DQNT_MATH_MIN(trace->numTraced, capacity);
+	result.numTraced        = trace->numTraced;
+	result.recordSize       = sizeof(Chip8TraceRecord);
+	return result;
+}
+
+// NOTE: The oldest record is at numTraced once the ring has wrapped, so the
+// stream is the part of the ring from there to the end and then the start
+FILE_SCOPE void dchip8_trace_segments_internal(const Chip8Trace *trace,
+                                               u32 numRecords, u32 *first,
+                                               u32 *firstCount)
+{
+	u32 oldest  = (u32)((trace->numTraced - numRecords) & trace->mask);
+	*first      = oldest;
+	*firstCount = DQNT_MATH_MIN(numRecords, trace->mask + 1 - oldest);
+}
+
+bool dchip8_trace_write(const Chip8Trace *trace, FILE *file)
+{
+	Chip8TraceHeader header = dchip8_trace_header_internal(trace);
+	u32 first, firstCount;
+	dchip8_trace_segments_internal(trace, header.numRecords, &first,
+	                               &firstCount);
+
+	u32 secondCount = header.numRecords - firstCount;
+	bool result =
+	    fwrite(&header, sizeof(header), 1, file) == 1 &&
+	    fwrite(trace->records + first, sizeof(Chip8TraceRecord), firstCount,
+	           file) == firstCount &&
+	    fwrite(trace->records, sizeof(Chip8TraceRecord), secondCount, file) ==
+	        secondCount;
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Crash Dump
+////////////////////////////////////////////////////////////////////////////////
+typedef struct Chip8TraceCrashDump
+{
+	char              path[260];
+	const Chip8Trace *traces;
+	u32               numTraces;
+	bool              installed;
+} Chip8TraceCrashDump;
+
+FILE_SCOPE Chip8TraceCrashDump globalTraceCrashDump;
+
+// NOTE: Runs inside the crash handler, only raw file writes are safe there
+#ifdef _WIN32
+typedef HANDLE Chip8TraceCrashFile;
+
+FILE_SCOPE bool dchip8_trace_crash_write_internal(Chip8TraceCrashFile file,
+                                                  const void *data, u32 size)
+{
+	DWORD bytesWritten = 0;
+	bool result = WriteFile(file, data, size, &bytesWritten, NULL) &&
+	              bytesWritten == size;
+	return result;
+}
+#else
+typedef i32 Chip8TraceCrashFile;
+
+FILE_SCOPE bool dchip8_trace_crash_write_internal(Chip8TraceCrashFile file,
+                                                  const void *data, u32 size)
+{
+	const u8 *bytes = (const u8 *)data;
+	while (size > 0)
+	{
+		ssize_t bytesWritten = write(file, bytes, size);
+		if (bytesWritten <= 0) return false;
+		bytes += bytesWritten;
+		size -= (u32)bytesWritten;
+	}
+	return true;
+}
+#endif
+
+FILE_SCOPE void dchip8_trace_crash_dump_internal(Chip8TraceCrashFile file)
+{
+	for (u32 i = 0; i < globalTraceCrashDump.numTraces; i++)
+	{
+		const Chip8Trace *trace = &globalTraceCrashDump.traces[i];
+		if (!trace->records) continue;
+
+		Chip8TraceHeader header = dchip8_trace_header_internal(trace);
+		u32 first, firstCount;
+		dchip8_trace_segments_internal(trace, header.numRecords, &first,
+		                               &firstCount);
+
+		u32 secondCount = header.numRecords - firstCount;
+		dchip8_trace_crash_write_internal(file, &header, sizeof(header));
+		dchip8_trace_crash_write_internal(
+		    file, trace->records + first, firstCount * sizeof(Chip8TraceRecord));
+		dchip8_trace_crash_write_internal(
+		    file, trace->records, secondCount * sizeof(Chip8TraceRecord));
+	}
+}
+
+#ifdef _WIN32
+FILE_SCOPE LONG WINAPI
+dchip8_trace_crash_handler_internal(EXCEPTION_POINTERS *exception)
+{
+	if (globalTraceCrashDump.traces)
+	{
+		HANDLE file =
+		    CreateFileA(globalTraceCrashDump.path, GENERIC_WRITE, 0, NULL,
+		                CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			dchip8_trace_crash_dump_internal(file);
+			CloseHandle(file);
+		}
+	}
+
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+
+FILE_SCOPE void dchip8_trace_install_crash_handler_internal()
+{
+	SetUnhandledExceptionFilter(dchip8_trace_crash_handler_internal);
+}
+#else
+FILE_SCOPE const i32 CHIP8_TRACE_CRASH_SIGNALS[] = {
+    SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT,
+};
+
+FILE_SCOPE void dchip8_trace_crash_handler_internal(i32 signalNumber)
+{
+	if (globalTraceCrashDump.traces)
+	{
+		i32 file = open(globalTraceCrashDump.path,
+		                O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (file >= 0)
+		{
+			dchip8_trace_crash_dump_internal(file);
+			close(file);
+		}
+	}
+
+	// NOTE: Let the default action run so the process still dies the way it
+	// would have, with a core dump if those are enabled
+	signal(signalNumber, SIG_DFL);
+	raise(signalNumber);
+}
+
+FILE_SCOPE void dchip8_trace_install_crash_handler_internal()
+{
+	struct sigaction action = {};
+	action.sa_handler       = dchip8_trace_crash_handler_internal;
+	action.sa_flags         = SA_RESETHAND;
+	sigemptyset(&action.sa_mask);
+	for (u32 i = 0; i < DQNT_ARRAY_COUNT(CHIP8_TRACE_CRASH_SIGNALS); i++)
+		sigaction(CHIP8_TRACE_CRASH_SIGNALS[i], &action, NULL);
+}
+#endif
+
+bool dchip8_trace_set_crash_dump(const char *path, const Chip8Trace *traces,
+                                 u32 numTraces)
+{
+	// NOTE: Detach the traces first so a crash while swapping never reads a
+	// half written path
+	globalTraceCrashDump.traces    = NULL;
+	globalTraceCrashDump.numTraces = 0;
+	if (!path || !traces) return true;
+
+	i32 length = snprintf(globalTraceCrashDump.path,
+	                      sizeof(globalTraceCrashDump.path), "%s", path);
+	if (length < 0 || length >= (i32)sizeof(globalTraceCrashDump.path))
+		return false;
+
+	if (!globalTraceCrashDump.installed)
+	{
+		dchip8_trace_install_crash_handler_internal();
+		globalTraceCrashDump.installed = true;
+	}
+
+	globalTraceCrashDump.numTraces = numTraces;
+	globalTraceCrashDump.traces    = traces;
+	return true;
+}
@@ -0,0 +1,52 @@
+#ifndef DCHIP8_TRACE_H
+#define DCHIP8_TRACE_H
+
+#include "dchip8.h"
+#include "dqnt.h"
+
+#include <stdio.h>
+
+// NOTE: Execution trace of the last N instructions a machine ran, for working
+// out how a long run reached a bad state. dchip8_vm_run_traced writes one fixed
+// size record per instruction into a power of 2 ring without decoding or
+// formatting anything, the decoder works out afterwards what each record
+// means. dchip8_vm_run is built from the same loop with the tracing compiled
+// out, so it costs nothing when off.
+//
+// File layout, integers in host order which is little endian on every
+// platform we build for. A file is any number of streams back to back.
+//   Chip8TraceHeader
+//   numRecords Chip8TraceRecords, oldest first
+#define CHIP8_TRACE_MAGIC   0x43525438 // "8TRC"
+#define CHIP8_TRACE_VERSION 1
+
+typedef struct Chip8TraceHeader
+{
+	u32 magic;
+	u32 version;
+	// Which machine the stream came from, i.e. the environment index
+	u32 id;
+	u32 numRecords;
+	// Instructions traced in total, the stream holds the last numRecords
+	u64 numTraced;
+	u32 recordSize;
+	u32 reserved;
+} Chip8TraceHeader;
+
+// capacity is rounded up to a power of 2 and the ring comes from arena. Return
+// false if the arena is out of space.
+bool   dchip8_trace_init       (Chip8Trace *trace, Chip8Arena *arena,
+                                u32 capacity, u32 id);
+// Arena space a ring of capacity needs, including alignment
+size_t dchip8_trace_memory_size(u32 capacity);
+
+// Append the ring as one stream
+bool   dchip8_trace_write      (const Chip8Trace *trace, FILE *file);
+
+// Write every trace to path if the process crashes, including on a failed
+// DQNT_ASSERT. Only the last set of traces registered is written, NULL clears
+// it. The traces must stay valid until cleared.
+bool dchip8_trace_set_crash_dump(const char *path, const Chip8Trace *traces,
+                                 u32 numTraces);
+
+#endif
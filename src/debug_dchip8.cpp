@@ -0,0 +1,304 @@
+// NOTE: Command line debugger. Reads one command per line from stdin so it can
+// be driven by hand or from a script.
+//
+// Usage: debug_dchip8 [-engine name] [-cycles N] [-quirks mask] rom
+//
+// Commands, numbers are hex unless prefixed otherwise:
+//   b addr                Toggle a breakpoint on addr
+//   w addr [size] [r|w]   Watch size bytes from addr, both accesses by default
+//   when reg [value]      Stop when reg (V0-VF, I, DT, ST, SP) changes, or
+//                         when it becomes value
+//   clear                 Remove everything armed
+//   s                     Single step
+//   n                     Step, over a 2nnn call in one go
+//   c [frames]            Continue, 600 frames at most by default
+//   keys mask             Hold the keys in the 16 bit mask from now on
+//   regs                  Print the cpu
+//   x addr [size]         Dump memory
+//   q                     Quit
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "dchip8_reference.cpp"
+#include "dchip8_debug.cpp"
+#include "headless_dchip8.cpp"
+
+FILE_SCOPE const Chip8Engine DEBUG_ENGINES[] = {
+    {"interpreter", dchip8_vm_run},
+    {"reference",   dchip8_reference_run},
+};
+
+FILE_SCOPE void debug_print_cpu(const Chip8VM *vm)
+{
+	const Chip8CPU *cpu = &vm->cpu;
+	u16 pc              = cpu->programCounter;
+	u16 opcode          = 0;
+	if (pc <= (CHIP8_MEMORY_SIZE - 2))
+		opcode = (u16)((vm->memory[pc] << 8) | vm->memory[pc + 1]);
+
+	printf("PC %03X [%04X]  I %03X  SP %X  DT %02X  ST %02X", pc, opcode,
+	       cpu->I, cpu->stackPointer, cpu->delayTimer, cpu->soundTimer);
+	if (cpu->state == chip8state_await_input) printf("  waiting for key");
+	if (cpu->state == chip8state_fault)
+		printf("  fault %s@%03X", dchip8_fault_string(cpu->fault),
+		       cpu->faultAddress);
+
+	printf("\n  V ");
+	for (i32 i = 0; i < DQNT_ARRAY_COUNT(cpu->registerArray); i++)
+		printf("%02X ", cpu->registerArray[i]);
+	printf("\n");
+}
+
+FILE_SCOPE void debug_print_stop(const Chip8Debugger *debugger,
+                                 const Chip8VM *vm)
+{
+	switch (debugger->stop)
+	{
+		case chip8debugstop_none: break;
+
+		case chip8debugstop_breakpoint:
+			printf("breakpoint at %03X\n", debugger->stopAddress);
+			break;
+
+		case chip8debugstop_watch_read:
+		case chip8debugstop_watch_write:
+			printf("%s of %03X by %03X\n",
+			       dchip8_debug_stop_string(debugger->stop),
+			       debugger->stopDetail, debugger->stopAddress);
+			break;
+
+		case chip8debugstop_condition:
+		{
+			u8 reg = (u8)debugger->stopDetail;
+			printf("%s = %X after %03X\n", dchip8_debug_register_string(reg),
+			       dchip8_debugger_register_value(&vm->cpu, reg),
+			       debugger->stopAddress);
+		}
+		break;
+
+		case chip8debugstop_step: break;
+		default: DQNT_ASSERT(DQNT_INVALID_CODE_PATH); break;
+	}
+
+	debug_print_cpu(vm);
+}
+
+FILE_SCOPE bool debug_parse_register(const char *name, u8 *reg)
+{
+	for (u8 i = 0; i < chip8debugreg_count; i++)
+	{
+		const char *regName = dchip8_debug_register_string(i);
+		if (strlen(name) != strlen(regName)) continue;
+
+		bool match = true;
+		for (i32 c = 0; regName[c]; c++)
+		{
+			char ch = name[c];
+			if (ch >= 'a' && ch <= 'z') ch -= ('a' - 'A');
+			if (ch != regName[c]) match = false;
+		}
+
+		if (match)
+		{
+			*reg = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	const char *engineName = "interpreter";
+	u32 cyclesPerFrame     = CHIP8_DEFAULT_CYCLES_PER_FRAME;
+	u32 quirks             = 0;
+
+	i32 argIndex = 1;
+	for (; argIndex < argc; argIndex++)
+	{
+		const char *arg = argv[argIndex];
+		if (arg[0] != '-' || argIndex + 1 >= argc) break;
+
+		const char *value = argv[++argIndex];
+		if      (dqnt_strcmp(arg, "-engine") == 0) engineName     = value;
+		else if (dqnt_strcmp(arg, "-cycles") == 0) cyclesPerFrame = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-quirks") == 0) quirks         = (u32)strtoul(value, NULL, 0);
+		else
+		{
+			fprintf(stderr, "debug: unknown option %s\n", arg);
+			return -1;
+		}
+	}
+
+	if (argIndex >= argc || cyclesPerFrame == 0)
+	{
+		fprintf(stderr, "usage: debug_dchip8 [-engine name] [-cycles N] "
+		                "[-quirks mask] rom\n");
+		return -1;
+	}
+
+	const Chip8Engine *engine = NULL;
+	for (i32 i = 0; i < DQNT_ARRAY_COUNT(DEBUG_ENGINES); i++)
+	{
+		if (dqnt_strcmp(DEBUG_ENGINES[i].name, engineName) == 0)
+			engine = &DEBUG_ENGINES[i];
+	}
+
+	if (!engine)
+	{
+		fprintf(stderr, "debug: unknown engine %s\n", engineName);
+		return -1;
+	}
+
+	Chip8VM *vm = (Chip8VM *)calloc(1, sizeof(Chip8VM));
+	u32 romSize = 0;
+	u8 *rom     = headless_read_entire_file(argv[argIndex], &romSize);
+	if (!vm || !rom || !dchip8_vm_load_rom(vm, rom, romSize))
+	{
+		fprintf(stderr, "debug: could not load %s\n", argv[argIndex]);
+		return -1;
+	}
+	vm->cpu.quirks = quirks;
+
+	Chip8Debugger *debugger = (Chip8Debugger *)calloc(1, sizeof(Chip8Debugger));
+	dchip8_debugger_init(debugger, engine->run);
+
+	// NOTE: Timers tick once per frame, a frame being cyclesPerFrame
+	// instructions. Stepping carries the partial frame over.
+	Chip8Controller controller = dchip8_controller_from_bitmask(0);
+	u32 frameCycles            = 0;
+	u64 numFrames              = 0;
+
+	debug_print_cpu(vm);
+	char line[256];
+	while (fgets(line, sizeof(line), stdin))
+	{
+		char command[16] = {};
+		char arg0[32]    = {};
+		char arg1[32]    = {};
+		char arg2[32]    = {};
+		i32 numArgs = sscanf(line, "%15s %31s %31s %31s", command, arg0, arg1,
+		                     arg2) - 1;
+		if (numArgs < 0) continue;
+
+		if (dqnt_strcmp(command, "q") == 0)
+		{
+			break;
+		}
+		else if (dqnt_strcmp(command, "b") == 0 && numArgs >= 1)
+		{
+			u16 address = (u16)strtoul(arg0, NULL, 16);
+			bool enable = !dchip8_debugger_has_breakpoint(debugger, address);
+			if (dchip8_debugger_set_breakpoint(debugger, address, enable))
+				printf("breakpoint %03X %s\n", address, enable ? "on" : "off");
+			else
+				printf("bad address\n");
+		}
+		else if (dqnt_strcmp(command, "w") == 0 && numArgs >= 1)
+		{
+			u16 address = (u16)strtoul(arg0, NULL, 16);
+			u16 size    = (numArgs >= 2) ? (u16)strtoul(arg1, NULL, 16) : 1;
+			u32 access  = chip8watch_read | chip8watch_write;
+			if (numArgs >= 3 && arg2[0] == 'r') access = chip8watch_read;
+			if (numArgs >= 3 && arg2[0] == 'w') access = chip8watch_write;
+
+			if (!dchip8_debugger_add_watchpoint(debugger, address, size, access))
+				printf("could not add watchpoint\n");
+		}
+		else if (dqnt_strcmp(command, "when") == 0 && numArgs >= 1)
+		{
+			u8 reg = 0;
+			if (!debug_parse_register(arg0, &reg))
+			{
+				printf("unknown register %s\n", arg0);
+				continue;
+			}
+
+			enum Chip8ConditionType type = chip8condition_changed;
+			u16 value                    = 0;
+			if (numArgs >= 2)
+			{
+				type  = chip8condition_equals;
+				value = (u16)strtoul(arg1, NULL, 16);
+			}
+
+			if (!dchip8_debugger_add_condition(debugger, reg, type, value))
+				printf("could not add condition\n");
+		}
+		else if (dqnt_strcmp(command, "clear") == 0)
+		{
+			dchip8_debugger_clear(debugger);
+		}
+		else if (dqnt_strcmp(command, "s") == 0 || dqnt_strcmp(command, "n") == 0)
+		{
+			u32 executed = 0;
+			if (command[0] == 's')
+				executed = dchip8_debugger_step(debugger, vm, controller);
+			else
+				executed = dchip8_debugger_step_over(debugger, vm, controller,
+				                                     cyclesPerFrame * 600);
+
+			frameCycles += executed;
+			for (; frameCycles >= cyclesPerFrame; frameCycles -= cyclesPerFrame)
+			{
+				dchip8_vm_tick_timers(vm);
+				numFrames++;
+			}
+			debug_print_stop(debugger, vm);
+		}
+		else if (dqnt_strcmp(command, "c") == 0)
+		{
+			u32 maxFrames = (numArgs >= 1) ? (u32)strtoul(arg0, NULL, 0) : 600;
+			for (u32 frame = 0; frame < maxFrames; frame++)
+			{
+				u32 cycles = cyclesPerFrame - frameCycles;
+				frameCycles +=
+				    dchip8_debugger_run(debugger, vm, controller, cycles);
+				if (debugger->stop != chip8debugstop_none) break;
+
+				// NOTE: Blocked on Fx0A or faulted, the frame still ends
+				if (vm->cpu.state == chip8state_fault) break;
+				frameCycles = 0;
+				dchip8_vm_tick_timers(vm);
+				numFrames++;
+			}
+
+			printf("frame %llu\n", (unsigned long long)numFrames);
+			debug_print_stop(debugger, vm);
+		}
+		else if (dqnt_strcmp(command, "keys") == 0 && numArgs >= 1)
+		{
+			controller =
+			    dchip8_controller_from_bitmask((u16)strtoul(arg0, NULL, 16));
+		}
+		else if (dqnt_strcmp(command, "regs") == 0)
+		{
+			debug_print_cpu(vm);
+		}
+		else if (dqnt_strcmp(command, "x") == 0 && numArgs >= 1)
+		{
+			u32 address = (u32)strtoul(arg0, NULL, 16);
+			u32 size    = (numArgs >= 2) ? (u32)strtoul(arg1, NULL, 16) : 16;
+			for (u32 i = 0; i < size && address + i < CHIP8_MEMORY_SIZE; i++)
+			{
+				if ((i % 16) == 0) printf("%s%03X:", i ? "\n" : "", address + i);
+				printf(" %02X", vm->memory[address + i]);
+			}
+			printf("\n");
+		}
+		else
+		{
+			printf("unknown command %s", line);
+		}
+	}
+
+	return 0;
+}
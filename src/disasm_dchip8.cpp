@@ -0,0 +1,118 @@
+// NOTE: Static disassembler, see dchip8_disasm.h.
+//
+// Usage: disasm_dchip8 [-dot | -summary] rom...
+//
+// The default output is a listing of every basic block with the data between
+// them, -dot writes the control flow graph for Graphviz instead. -summary
+// writes one line of statistics a ROM and the throughput at the end, for
+// sweeping a whole library.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "dchip8_disasm.cpp"
+#include "headless_dchip8.cpp"
+
+enum DisasmOutput
+{
+	disasmoutput_text,
+	disasmoutput_dot,
+	disasmoutput_summary,
+};
+
+int main(int argc, char **argv)
+{
+	enum DisasmOutput output = disasmoutput_text;
+
+	i32 argIndex = 1;
+	for (; argIndex < argc; argIndex++)
+	{
+		const char *arg = argv[argIndex];
+		if (arg[0] != '-') break;
+
+		if      (dqnt_strcmp(arg, "-dot") == 0)     output = disasmoutput_dot;
+		else if (dqnt_strcmp(arg, "-summary") == 0) output = disasmoutput_summary;
+		else
+		{
+			fprintf(stderr, "disasm: unknown option %s\n", arg);
+			return -1;
+		}
+	}
+
+	if (argIndex >= argc)
+	{
+		fprintf(stderr, "usage: disasm_dchip8 [-dot | -summary] rom...\n");
+		return -1;
+	}
+
+	Chip8Program *program = (Chip8Program *)malloc(sizeof(Chip8Program));
+	if (!program) return -1;
+
+	i32 result         = 0;
+	u32 numRoms        = 0;
+	u64 numBytes       = 0;
+	f64 analyseTimeInS = 0;
+	bool multipleRoms  = (argc - argIndex) > 1;
+	for (; argIndex < argc; argIndex++)
+	{
+		const char *path = argv[argIndex];
+		u32 romSize      = 0;
+		u8 *rom          = headless_read_entire_file(path, &romSize);
+		if (!rom)
+		{
+			fprintf(stderr, "disasm: could not read %s\n", path);
+			result = 1;
+			continue;
+		}
+
+		f64 startInS = dqnt_time_now_s();
+		bool valid   = dchip8_disasm_analyse(program, rom, romSize);
+		analyseTimeInS += dqnt_time_now_s() - startInS;
+		free(rom);
+
+		if (!valid)
+		{
+			fprintf(stderr, "disasm: %s is too big to load\n", path);
+			result = 1;
+			continue;
+		}
+
+		numRoms++;
+		numBytes += romSize;
+		if (output == disasmoutput_summary)
+		{
+			printf("%5u bytes %5u code %5u data %5u instructions %4u blocks "
+			       "%2u indirect  %s\n",
+			       romSize, program->numCodeBytes,
+			       romSize - program->numCodeBytes, program->numInstructions,
+			       program->numBlocks, program->numIndirectJumps, path);
+		}
+		else if (output == disasmoutput_dot)
+		{
+			if (multipleRoms) printf("// %s\n", path);
+			dchip8_disasm_print_dot(program, stdout);
+		}
+		else
+		{
+			if (multipleRoms) printf("; %s\n", path);
+			dchip8_disasm_print_text(program, stdout);
+			if (multipleRoms) printf("\n");
+		}
+	}
+
+	if (output == disasmoutput_summary && analyseTimeInS > 0)
+	{
+		printf("%u roms, %llu bytes analysed in %.3f ms, %.0f roms/s\n", numRoms,
+		       (unsigned long long)numBytes, analyseTimeInS * 1000.0,
+		       numRoms / analyseTimeInS);
+	}
+
+	free(program);
+	return result;
+}
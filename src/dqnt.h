@@ -22,7 +22,8 @@ typedef int32_t i64;
 typedef int32_t i32;
 typedef int64_t i16;
 
-typedef float f32;
+typedef float  f32;
+typedef double f64;
 
 #define DQNT_INVALID_CODE_PATH 0
 #define DQNT_ARRAY_COUNT(array) (sizeof(array) / sizeof(array[0]))
@@ -82,6 +83,62 @@ f32  dqnt_rnd_pcg_nextf(RandPCGState *pcg);
 // Returns a random integer N between [min, max]
 i32  dqnt_rnd_pcg_range(RandPCGState *pcg, i32 min, i32 max);
 
+////////////////////////////////////////////////////////////////////////////////
+// Threading, Atomics and Timing
+////////////////////////////////////////////////////////////////////////////////
+typedef u32 DqntThreadProc(void *userData);
+typedef struct DqntThread
+{
+	void *handle;
+} DqntThread;
+
+// Return true if the thread was started
+bool dqnt_thread_create(DqntThread *thread, DqntThreadProc *proc, void *userData);
+void dqnt_thread_join  (DqntThread *thread);
+// Number of logical cores, always at least 1
+u32  dqnt_num_cores    ();
+void dqnt_sleep_ms     (u32 milliseconds);
+
+// NOTE: A generation counter threads can block on until it changes. Waiters
+// keep the last generation they saw, whoever hands out work publishes the
+// next. Waiters spin briefly first since work often comes back to back, then
+// sleep in the OS until woken, so an idle waiter costs nothing.
+typedef struct DqntSignal
+{
+	volatile u32 generation;
+	void        *handle;
+} DqntSignal;
+
+// Return false if the OS objects couldn't be made. A signal that failed to
+// init still counts generations but can't be waited on.
+bool dqnt_signal_init   (DqntSignal *signal);
+void dqnt_signal_free   (DqntSignal *signal);
+// Bump the generation and wake every waiter, return the new generation
+u32  dqnt_signal_publish(DqntSignal *signal);
+// Block until the generation is not seenGeneration and return it
+u32  dqnt_signal_wait   (DqntSignal *signal, u32 seenGeneration);
+// Wait until *value is target, spinning then yielding the core. For a thread
+// waiting on work it handed out moments ago, longer waits want a DqntSignal.
+void dqnt_spin_until_u32(volatile u32 *value, u32 target);
+
+// NOTE: Sequentially consistent. add returns the value after the addition,
+// compare swap returns the value that was in dest before the operation.
+u32 dqnt_atomic_add_u32         (volatile u32 *dest, u32 value);
+u64 dqnt_atomic_add_u64         (volatile u64 *dest, u64 value);
+u32 dqnt_atomic_compare_swap_u32(volatile u32 *dest, u32 swapVal, u32 compareVal);
+u64 dqnt_atomic_compare_swap_u64(volatile u64 *dest, u64 swapVal, u64 compareVal);
+u32 dqnt_atomic_load_u32        (volatile u32 *src);
+void dqnt_atomic_store_u32      (volatile u32 *dest, u32 value);
+// Full barrier, no loads or stores move across it in either direction
+void dqnt_atomic_fence          ();
+
+// Monotonic wall clock time in seconds from an arbitrary starting point
+f64  dqnt_time_now_s();
+// Sleep until dqnt_time_now_s() reaches deadline, or close to it. Only as
+// precise as the OS scheduler, it may wake early but rarely late by more than
+// the timer resolution.
+void dqnt_sleep_until_s(f64 deadline);
+
 #endif  /* DQNT_H */
 
 #ifdef DQNT_IMPLEMENTATION
@@ -313,9 +370,10 @@ FILE_SCOPE f32 dqnt_rnd_f32_normalized_from_u32_internal(u32 value)
 {
 	u32 exponent = 127;
 	u32 mantissa = value >> 9;
-	u32 result   = (exponent << 23) | mantissa;
-	f32 fresult  = *(f32 *)(&result);
-	return fresult - 1.0f;
+	// NOTE: Pun through a union, casting the pointer breaks strict aliasing
+	union { u32 u; f32 f; } result;
+	result.u = (exponent << 23) | mantissa;
+	return result.f - 1.0f;
 }
 
 FILE_SCOPE u64 dqnt_rnd_murmur3_avalanche64_internal(u64 h)
@@ -361,4 +419,377 @@ i32 dqnt_rnd_pcg_range(RandPCGState *pcg, i32 min, i32 max)
 	return min + value;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Threading, Atomics and Timing
+////////////////////////////////////////////////////////////////////////////////
+// NOTE: Loads of the generation before a signal waiter blocks, a few
+// microseconds, about how long it takes to hand out the next piece of work
+#define DQNT_SIGNAL_SPINS 4096
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <Windows.h>
+
+typedef struct DqntThreadStartInternal
+{
+	DqntThreadProc *proc;
+	void           *userData;
+} DqntThreadStartInternal;
+
+FILE_SCOPE DWORD WINAPI dqnt_thread_entry_internal(LPVOID param)
+{
+	DqntThreadStartInternal start = *(DqntThreadStartInternal *)param;
+	HeapFree(GetProcessHeap(), 0, param);
+	return start.proc(start.userData);
+}
+
+bool dqnt_thread_create(DqntThread *thread, DqntThreadProc *proc, void *userData)
+{
+	DqntThreadStartInternal *start = (DqntThreadStartInternal *)HeapAlloc(
+	    GetProcessHeap(), 0, sizeof(DqntThreadStartInternal));
+	if (!start) return false;
+	start->proc     = proc;
+	start->userData = userData;
+
+	thread->handle =
+	    CreateThread(NULL, 0, dqnt_thread_entry_internal, start, 0, NULL);
+	if (!thread->handle)
+	{
+		HeapFree(GetProcessHeap(), 0, start);
+		return false;
+	}
+
+	return true;
+}
+
+void dqnt_thread_join(DqntThread *thread)
+{
+	WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+	CloseHandle((HANDLE)thread->handle);
+	thread->handle = NULL;
+}
+
+u32 dqnt_num_cores()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors > 0) ? info.dwNumberOfProcessors : 1;
+}
+
+void dqnt_sleep_ms(u32 milliseconds) { Sleep(milliseconds); }
+
+typedef struct DqntSignalInternal
+{
+	SRWLOCK            lock;
+	CONDITION_VARIABLE wake;
+} DqntSignalInternal;
+
+bool dqnt_signal_init(DqntSignal *signal)
+{
+	*signal                    = {};
+	DqntSignalInternal *handle = (DqntSignalInternal *)HeapAlloc(
+	    GetProcessHeap(), 0, sizeof(DqntSignalInternal));
+	if (!handle) return false;
+
+	InitializeSRWLock(&handle->lock);
+	InitializeConditionVariable(&handle->wake);
+	signal->handle = handle;
+	return true;
+}
+
+void dqnt_signal_free(DqntSignal *signal)
+{
+	if (signal->handle) HeapFree(GetProcessHeap(), 0, signal->handle);
+	signal->handle = NULL;
+}
+
+u32 dqnt_signal_publish(DqntSignal *signal)
+{
+	DqntSignalInternal *handle = (DqntSignalInternal *)signal->handle;
+	if (!handle) return dqnt_atomic_add_u32(&signal->generation, 1);
+
+	// NOTE: Bumped under the lock so a waiter can't check the old generation
+	// and go to sleep after the wake was sent
+	AcquireSRWLockExclusive(&handle->lock);
+	u32 result = dqnt_atomic_add_u32(&signal->generation, 1);
+	ReleaseSRWLockExclusive(&handle->lock);
+	WakeAllConditionVariable(&handle->wake);
+	return result;
+}
+
+u32 dqnt_signal_wait(DqntSignal *signal, u32 seenGeneration)
+{
+	u32 result;
+	for (u32 spins = 0; spins < DQNT_SIGNAL_SPINS; spins++)
+	{
+		result = dqnt_atomic_load_u32(&signal->generation);
+		if (result != seenGeneration) return result;
+	}
+
+	DqntSignalInternal *handle = (DqntSignalInternal *)signal->handle;
+	DQNT_ASSERT(handle);
+	AcquireSRWLockExclusive(&handle->lock);
+	while ((result = dqnt_atomic_load_u32(&signal->generation)) == seenGeneration)
+		SleepConditionVariableSRW(&handle->wake, &handle->lock, INFINITE, 0);
+	ReleaseSRWLockExclusive(&handle->lock);
+	return result;
+}
+
+u32 dqnt_atomic_add_u32(volatile u32 *dest, u32 value)
+{
+	return (u32)InterlockedAdd((volatile LONG *)dest, (LONG)value);
+}
+
+u64 dqnt_atomic_add_u64(volatile u64 *dest, u64 value)
+{
+	return (u64)InterlockedAdd64((volatile LONG64 *)dest, (LONG64)value);
+}
+
+u32 dqnt_atomic_compare_swap_u32(volatile u32 *dest, u32 swapVal, u32 compareVal)
+{
+	return (u32)InterlockedCompareExchange((volatile LONG *)dest, (LONG)swapVal,
+	                                       (LONG)compareVal);
+}
+
+u64 dqnt_atomic_compare_swap_u64(volatile u64 *dest, u64 swapVal, u64 compareVal)
+{
+	return (u64)InterlockedCompareExchange64(
+	    (volatile LONG64 *)dest, (LONG64)swapVal, (LONG64)compareVal);
+}
+
+u32 dqnt_atomic_load_u32(volatile u32 *src)
+{
+	return (u32)InterlockedCompareExchange((volatile LONG *)src, 0, 0);
+}
+
+void dqnt_atomic_store_u32(volatile u32 *dest, u32 value)
+{
+	InterlockedExchange((volatile LONG *)dest, (LONG)value);
+}
+
+void dqnt_atomic_fence() { MemoryBarrier(); }
+
+f64 dqnt_time_now_s()
+{
+	LOCAL_PERSIST LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (f64)counter.QuadPart / (f64)frequency.QuadPart;
+}
+
+void dqnt_sleep_until_s(f64 deadline)
+{
+	// NOTE: Truncating wakes up early rather than late, the caller is expected
+	// to finish the wait itself if it needs better than a millisecond
+	f64 remaining = deadline - dqnt_time_now_s();
+	if (remaining >= 0.001) Sleep((DWORD)(remaining * 1000));
+}
+
+#else
+	#include <errno.h>
+	#include <pthread.h>
+	#include <stdlib.h>
+	#include <time.h>
+	#include <unistd.h>
+
+typedef struct DqntThreadStartInternal
+{
+	DqntThreadProc *proc;
+	void           *userData;
+} DqntThreadStartInternal;
+
+FILE_SCOPE void *dqnt_thread_entry_internal(void *param)
+{
+	DqntThreadStartInternal start = *(DqntThreadStartInternal *)param;
+	free(param);
+	start.proc(start.userData);
+	return NULL;
+}
+
+bool dqnt_thread_create(DqntThread *thread, DqntThreadProc *proc, void *userData)
+{
+	DqntThreadStartInternal *start =
+	    (DqntThreadStartInternal *)malloc(sizeof(DqntThreadStartInternal));
+	pthread_t *handle = (pthread_t *)malloc(sizeof(pthread_t));
+	if (!start || !handle)
+	{
+		free(start);
+		free(handle);
+		return false;
+	}
+
+	start->proc     = proc;
+	start->userData = userData;
+	if (pthread_create(handle, NULL, dqnt_thread_entry_internal, start) != 0)
+	{
+		free(start);
+		free(handle);
+		return false;
+	}
+
+	thread->handle = (void *)handle;
+	return true;
+}
+
+void dqnt_thread_join(DqntThread *thread)
+{
+	pthread_t *handle = (pthread_t *)thread->handle;
+	pthread_join(*handle, NULL);
+	free(handle);
+	thread->handle = NULL;
+}
+
+u32 dqnt_num_cores()
+{
+	long result = sysconf(_SC_NPROCESSORS_ONLN);
+	return (result > 0) ? (u32)result : 1;
+}
+
+void dqnt_sleep_ms(u32 milliseconds) { usleep(milliseconds * 1000); }
+
+typedef struct DqntSignalInternal
+{
+	pthread_mutex_t lock;
+	pthread_cond_t  wake;
+} DqntSignalInternal;
+
+bool dqnt_signal_init(DqntSignal *signal)
+{
+	*signal = {};
+	DqntSignalInternal *handle =
+	    (DqntSignalInternal *)malloc(sizeof(DqntSignalInternal));
+	if (!handle) return false;
+
+	if (pthread_mutex_init(&handle->lock, NULL) != 0)
+	{
+		free(handle);
+		return false;
+	}
+
+	if (pthread_cond_init(&handle->wake, NULL) != 0)
+	{
+		pthread_mutex_destroy(&handle->lock);
+		free(handle);
+		return false;
+	}
+
+	signal->handle = handle;
+	return true;
+}
+
+void dqnt_signal_free(DqntSignal *signal)
+{
+	DqntSignalInternal *handle = (DqntSignalInternal *)signal->handle;
+	if (handle)
+	{
+		pthread_cond_destroy(&handle->wake);
+		pthread_mutex_destroy(&handle->lock);
+		free(handle);
+	}
+	signal->handle = NULL;
+}
+
+u32 dqnt_signal_publish(DqntSignal *signal)
+{
+	DqntSignalInternal *handle = (DqntSignalInternal *)signal->handle;
+	if (!handle) return dqnt_atomic_add_u32(&signal->generation, 1);
+
+	// NOTE: Bumped under the lock so a waiter can't check the old generation
+	// and go to sleep after the wake was sent
+	pthread_mutex_lock(&handle->lock);
+	u32 result = dqnt_atomic_add_u32(&signal->generation, 1);
+	pthread_mutex_unlock(&handle->lock);
+	pthread_cond_broadcast(&handle->wake);
+	return result;
+}
+
+u32 dqnt_signal_wait(DqntSignal *signal, u32 seenGeneration)
+{
+	u32 result;
+	for (u32 spins = 0; spins < DQNT_SIGNAL_SPINS; spins++)
+	{
+		result = dqnt_atomic_load_u32(&signal->generation);
+		if (result != seenGeneration) return result;
+	}
+
+	DqntSignalInternal *handle = (DqntSignalInternal *)signal->handle;
+	DQNT_ASSERT(handle);
+	pthread_mutex_lock(&handle->lock);
+	while ((result = dqnt_atomic_load_u32(&signal->generation)) == seenGeneration)
+		pthread_cond_wait(&handle->wake, &handle->lock);
+	pthread_mutex_unlock(&handle->lock);
+	return result;
+}
+
+u32 dqnt_atomic_add_u32(volatile u32 *dest, u32 value)
+{
+	return __atomic_add_fetch(dest, value, __ATOMIC_SEQ_CST);
+}
+
+u64 dqnt_atomic_add_u64(volatile u64 *dest, u64 value)
+{
+	return __atomic_add_fetch(dest, value, __ATOMIC_SEQ_CST);
+}
+
+u32 dqnt_atomic_compare_swap_u32(volatile u32 *dest, u32 swapVal, u32 compareVal)
+{
+	__atomic_compare_exchange_n(dest, &compareVal, swapVal, false,
+	                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return compareVal;
+}
+
+u64 dqnt_atomic_compare_swap_u64(volatile u64 *dest, u64 swapVal, u64 compareVal)
+{
+	__atomic_compare_exchange_n(dest, &compareVal, swapVal, false,
+	                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return compareVal;
+}
+
+u32 dqnt_atomic_load_u32(volatile u32 *src)
+{
+	return __atomic_load_n(src, __ATOMIC_SEQ_CST);
+}
+
+void dqnt_atomic_store_u32(volatile u32 *dest, u32 value)
+{
+	__atomic_store_n(dest, value, __ATOMIC_SEQ_CST);
+}
+
+void dqnt_atomic_fence() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+f64 dqnt_time_now_s()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (f64)now.tv_sec + ((f64)now.tv_nsec / 1000000000.0);
+}
+
+void dqnt_sleep_until_s(f64 deadline)
+{
+	// NOTE: An absolute deadline on the same clock dqnt_time_now_s reads, so
+	// the time spent getting here and any interruption don't add drift
+	if (deadline <= 0) return;
+
+	struct timespec wake;
+	wake.tv_sec  = (time_t)deadline;
+	wake.tv_nsec = (long)((deadline - (f64)wake.tv_sec) * 1000000000.0);
+	if (wake.tv_nsec >= 1000000000L) wake.tv_nsec = 999999999L;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR)
+		;
+}
+#endif
+
+void dqnt_spin_until_u32(volatile u32 *value, u32 target)
+{
+	u32 spins = 0;
+	while (dqnt_atomic_load_u32(value) != target)
+	{
+		if (++spins > DQNT_SIGNAL_SPINS) dqnt_sleep_ms(0);
+	}
+}
+
 #endif /* DQNT_IMPLEMENTATION */
@@ -0,0 +1,127 @@
+// NOTE: Throughput benchmark for the batched environment, steps a batch with
+// random actions and reports environment steps per second.
+//
+// Usage: env_bench_dchip8 [-batch N] [-threads N] [-steps N] [-cycles N]
+//                         [-frames N] [-max N] [-reward addr]
+//                         [-trace N] [-tracedump path] rom
+//
+// -trace keeps the last N instructions of every environment, -tracedump writes
+// them all to path at the end, and on a crash.
+
+#include "env_dchip8.cpp"
+
+int main(int argc, char **argv)
+{
+	Chip8EnvConfig config = {};
+	config.batchSize      = 256;
+	u32 numSteps          = 1000;
+	u32 rewardAddress     = 0;
+	const char *romPath   = NULL;
+	const char *tracePath = NULL;
+
+	for (i32 i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		bool hasValue   = (i + 1 < argc);
+		if      (hasValue && strcmp(arg, "-batch") == 0)   config.batchSize           = (u32)atoi(argv[++i]);
+		else if (hasValue && strcmp(arg, "-threads") == 0) config.numThreads          = (u32)atoi(argv[++i]);
+		else if (hasValue && strcmp(arg, "-steps") == 0)   numSteps                   = (u32)atoi(argv[++i]);
+		else if (hasValue && strcmp(arg, "-cycles") == 0)  config.cyclesPerFrame      = (u32)atoi(argv[++i]);
+		else if (hasValue && strcmp(arg, "-frames") == 0)  config.framesPerStep       = (u32)atoi(argv[++i]);
+		else if (hasValue && strcmp(arg, "-max") == 0)     config.maxFramesPerEpisode = (u32)atoi(argv[++i]);
+		else if (hasValue && strcmp(arg, "-reward") == 0)  rewardAddress              = (u32)strtoul(argv[++i], NULL, 0);
+		else if (hasValue && strcmp(arg, "-trace") == 0)   config.traceLength         = (u32)atoi(argv[++i]);
+		else if (hasValue && strcmp(arg, "-tracedump") == 0) tracePath                = argv[++i];
+		else romPath = arg;
+	}
+
+	if (!romPath || config.batchSize == 0)
+	{
+		fprintf(stderr, "Usage: env_bench_dchip8 [-batch N] [-threads N] "
+		                "[-steps N] [-cycles N] [-frames N] [-max N] "
+		                "[-reward addr] [-trace N] [-tracedump path] rom\n");
+		return 1;
+	}
+
+	config.traceCrashPath = tracePath;
+	if (rewardAddress)
+	{
+		config.rewardFunc     = dchip8_env_reward_u8_delta;
+		config.rewardUserData = (void *)(uintptr_t)rewardAddress;
+	}
+
+	u32 romSize = 0;
+	u8 *rom     = headless_read_entire_file(romPath, &romSize);
+	if (!rom)
+	{
+		fprintf(stderr, "Could not read rom: %s\n", romPath);
+		return 1;
+	}
+
+	Chip8Env *env = dchip8_env_create(&config, rom, romSize);
+	free(rom);
+	if (!env)
+	{
+		fprintf(stderr, "Could not create environment, rom too large?\n");
+		return 1;
+	}
+
+	u32 batchSize = config.batchSize;
+	u8 *observations =
+	    (u8 *)malloc((size_t)batchSize * DCHIP8_ENV_OBSERVATION_SIZE);
+	u16 *actions  = (u16 *)malloc(batchSize * sizeof(*actions));
+	f32 *rewards  = (f32 *)malloc(batchSize * sizeof(*rewards));
+	u8 *dones     = (u8 *)malloc(batchSize * sizeof(*dones));
+
+	RandPCGState pcg;
+	dqnt_rnd_pcg_seed(&pcg, 0x1234);
+	dchip8_env_reset(env, observations);
+
+	f64 totalReward = 0;
+	u32 numDones    = 0;
+	f64 startTime   = dqnt_time_now_s();
+	for (u32 step = 0; step < numSteps; step++)
+	{
+		for (u32 i = 0; i < batchSize; i++)
+			actions[i] = (u16)(1 << dqnt_rnd_pcg_range(&pcg, 0, 15));
+
+		dchip8_env_step(env, actions, observations, rewards, dones);
+		for (u32 i = 0; i < batchSize; i++)
+		{
+			totalReward += rewards[i];
+			numDones += dones[i];
+		}
+	}
+	f64 elapsed = dqnt_time_now_s() - startTime;
+
+	f64 envSteps = (f64)numSteps * batchSize;
+	printf("%.0f env steps in %.3fs, %.0f steps/s, %.0f frames/s\n", envSteps,
+	       elapsed, envSteps / elapsed,
+	       envSteps * (config.framesPerStep ? config.framesPerStep : 1) /
+	           elapsed);
+	printf("episodes finished: %u, total reward: %.1f\n", numDones,
+	       totalReward);
+
+	if (tracePath && config.traceLength)
+	{
+		// NOTE: The crash dump uses the same path, start from an empty file
+		FILE *file = fopen(tracePath, "wb");
+		if (file) fclose(file);
+
+		for (u32 i = 0; i < batchSize; i++)
+		{
+			if (!dchip8_env_write_trace(env, i, tracePath))
+			{
+				fprintf(stderr, "Could not write trace: %s\n", tracePath);
+				break;
+			}
+		}
+	}
+
+	dchip8_env_destroy(env);
+	free(observations);
+	free(actions);
+	free(rewards);
+	free(dones);
+	return 0;
+}
@@ -0,0 +1,15 @@
+// NOTE: Unity build for the batched environment shared library, see
+// dchip8_env.h for the interface.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "headless_dchip8.cpp"
+#include "dchip8_trace.cpp"
+#include "dchip8_env.cpp"
@@ -0,0 +1,614 @@
+// NOTE: State-space explorer. Starting from a machine, expand the successors of
+// each state under every configured key held for K frames, deduplicate states
+// by their hash and keep going breadth first, with a beam, or best first on a
+// score read from guest memory. Expansion runs across all cores.
+//
+// Usage: explore_dchip8 [-strategy bfs|beam|best] [-keys n,0,1,..,F]
+//                       [-frames K] [-cycles N] [-width W] [-depth D]
+//                       [-max-states N] [-threads N] [-score spec]
+//                       [-warmup N] [-out keys_file] (rom | -state file)
+//
+// -state loads a raw Chip8VM snapshot instead of booting a ROM. Score specs
+// are mem8:ADDR, mem16:ADDR (big endian), pixels or depth. -out writes the
+// key bitmask per frame that reaches the best state, in the format read by
+// lockstep_dchip8 -keys.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "headless_dchip8.cpp"
+
+enum ExploreStrategy
+{
+	explorestrategy_bfs,
+	explorestrategy_beam,
+	explorestrategy_best,
+};
+
+// NOTE: Score functions must be pure reads of the machine, they are called
+// concurrently from every worker.
+typedef f32 ExploreScoreFunc(const Chip8VM *vm, u32 depth, void *userData);
+
+#define EXPLORE_MAX_THREADS 64
+// NOTE: Frontiers with fewer nodes than this are expanded on the calling
+// thread, waking the workers costs more than a few nodes take to expand
+#define EXPLORE_MIN_PARALLEL_NODES 16
+
+#define EXPLORE_NO_PARENT 0xFFFFFFFF
+typedef struct ExploreNode
+{
+	Chip8VM vm;
+	u32     parent;
+	u32     depth;
+	u16     keyMask;
+	f32     score;
+} ExploreNode;
+
+typedef struct ExploreConfig
+{
+	enum ExploreStrategy strategy;
+	u16                  actions[CHIP8_NUM_KEYS + 1];
+	u32                  numActions;
+	u32                  framesPerAction;
+	u32                  cyclesPerFrame;
+	u32                  beamWidth;
+	u32                  maxDepth;
+	u32                  maxStates;
+	u32                  numThreads;
+
+	ExploreScoreFunc    *scoreFunc;
+	void                *scoreUserData;
+} ExploreConfig;
+
+typedef struct Explorer
+{
+	ExploreConfig config;
+
+	ExploreNode  *nodes;
+	volatile u32  nodeCount;
+
+	// NOTE: Open addressing set of state hashes, 0 marks an empty slot
+	volatile u64 *visited;
+	u64           visitedMask;
+
+	// NOTE: Nodes expanded this round, claimed by workers one at a time
+	u32          *frontier;
+	u32           frontierCount;
+	volatile u32  frontierNext;
+
+	volatile u64  numExpanded;
+	volatile u64  numDuplicates;
+	volatile u32  outOfSpace;
+
+	// NOTE: Workers live for the whole search. They wait on roundSignal,
+	// claim frontier nodes until there are none left and bump numFinished.
+	// The frontier is written before the signal is published.
+	DqntThread    workers[EXPLORE_MAX_THREADS - 1];
+	u32           numWorkers;
+	DqntSignal    roundSignal;
+	volatile u32  numFinished;
+	volatile u32  quit;
+	Chip8VM      *scratch;
+} Explorer;
+
+////////////////////////////////////////////////////////////////////////////////
+// Score Functions
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE f32 explore_score_mem8(const Chip8VM *vm, u32 depth, void *userData)
+{
+	u32 address = (u32)(size_t)userData;
+	return (f32)vm->memory[address];
+}
+
+FILE_SCOPE f32 explore_score_mem16(const Chip8VM *vm, u32 depth, void *userData)
+{
+	u32 address = (u32)(size_t)userData;
+	return (f32)((vm->memory[address] << 8) | vm->memory[address + 1]);
+}
+
+FILE_SCOPE f32 explore_score_pixels(const Chip8VM *vm, u32 depth, void *userData)
+{
+	u32 result = 0;
+	for (i32 row = 0; row < CHIP8_DISPLAY_HEIGHT; row++)
+	{
+		u64 bits = vm->display[row];
+		while (bits)
+		{
+			bits &= bits - 1;
+			result++;
+		}
+	}
+
+	return (f32)result;
+}
+
+FILE_SCOPE f32 explore_score_depth(const Chip8VM *vm, u32 depth, void *userData)
+{
+	return (f32)depth;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Expansion
+////////////////////////////////////////////////////////////////////////////////
+// Return true if hash was not in the set and has been added
+FILE_SCOPE bool explore_visit(Explorer *explorer, u64 hash)
+{
+	if (hash == 0) hash = 1;
+	u64 slot = hash & explorer->visitedMask;
+	for (;;)
+	{
+		u64 existing =
+		    dqnt_atomic_compare_swap_u64(&explorer->visited[slot], hash, 0);
+		if (existing == 0)    return true;
+		if (existing == hash) return false;
+		slot = (slot + 1) & explorer->visitedMask;
+	}
+}
+
+FILE_SCOPE void explore_expand_node(Explorer *explorer, u32 nodeIndex,
+                                    Chip8VM *scratch)
+{
+	const ExploreConfig *config = &explorer->config;
+	const ExploreNode *node     = &explorer->nodes[nodeIndex];
+
+	for (u32 actionIndex = 0; actionIndex < config->numActions; actionIndex++)
+	{
+		u16 keyMask = config->actions[actionIndex];
+		Chip8Controller controller = dchip8_controller_from_bitmask(keyMask);
+
+		memcpy(scratch, &node->vm, sizeof(*scratch));
+		for (u32 frame = 0; frame < config->framesPerAction; frame++)
+		{
+			dchip8_vm_run(scratch, controller, config->cyclesPerFrame);
+			dchip8_vm_tick_timers(scratch);
+		}
+		dqnt_atomic_add_u64(&explorer->numExpanded, 1);
+
+		if (!explore_visit(explorer, dchip8_vm_hash(scratch)))
+		{
+			dqnt_atomic_add_u64(&explorer->numDuplicates, 1);
+			continue;
+		}
+
+		u32 childIndex = dqnt_atomic_add_u32(&explorer->nodeCount, 1) - 1;
+		if (childIndex >= config->maxStates)
+		{
+			dqnt_atomic_store_u32(&explorer->outOfSpace, 1);
+			return;
+		}
+
+		ExploreNode *child = &explorer->nodes[childIndex];
+		memcpy(&child->vm, scratch, sizeof(child->vm));
+		child->parent  = nodeIndex;
+		child->depth   = node->depth + 1;
+		child->keyMask = keyMask;
+		child->score   = config->scoreFunc(scratch, child->depth,
+		                                   config->scoreUserData);
+	}
+}
+
+FILE_SCOPE void explore_claim_nodes(Explorer *explorer, Chip8VM *scratch)
+{
+	for (;;)
+	{
+		u32 index = dqnt_atomic_add_u32(&explorer->frontierNext, 1) - 1;
+		if (index >= explorer->frontierCount) break;
+		if (dqnt_atomic_load_u32(&explorer->outOfSpace)) break;
+
+		explore_expand_node(explorer, explorer->frontier[index], scratch);
+	}
+}
+
+FILE_SCOPE u32 explore_worker(void *userData)
+{
+	Explorer *explorer = (Explorer *)userData;
+	Chip8VM *scratch   = (Chip8VM *)malloc(sizeof(Chip8VM));
+
+	u32 seenGeneration = 0;
+	for (;;)
+	{
+		// NOTE: Blocked between rounds so the workers don't starve a caller
+		// expanding small frontiers alone
+		seenGeneration = dqnt_signal_wait(&explorer->roundSignal, seenGeneration);
+
+		if (dqnt_atomic_load_u32(&explorer->quit)) break;
+		if (scratch) explore_claim_nodes(explorer, scratch);
+		dqnt_atomic_add_u32(&explorer->numFinished, 1);
+	}
+
+	free(scratch);
+	return 0;
+}
+
+// Start numThreads - 1 workers, the calling thread is the last. Return false
+// if there's no memory for the caller's scratch machine.
+FILE_SCOPE bool explore_start_workers(Explorer *explorer)
+{
+	explorer->scratch = (Chip8VM *)malloc(sizeof(Chip8VM));
+	if (!explorer->scratch) return false;
+
+	// NOTE: Threads past the number of cores only time slice with the ones
+	// doing the work
+	u32 numThreads = DQNT_MATH_MIN(explorer->config.numThreads,
+	                               EXPLORE_MAX_THREADS);
+	numThreads     = DQNT_MATH_MIN(numThreads, DQNT_MATH_MAX(dqnt_num_cores(), 1));
+	if (numThreads <= 1 || !dqnt_signal_init(&explorer->roundSignal))
+		return true;
+
+	for (u32 i = 1; i < numThreads; i++)
+	{
+		if (dqnt_thread_create(&explorer->workers[explorer->numWorkers],
+		                       explore_worker, explorer))
+			explorer->numWorkers++;
+	}
+
+	return true;
+}
+
+FILE_SCOPE void explore_stop_workers(Explorer *explorer)
+{
+	dqnt_atomic_store_u32(&explorer->quit, 1);
+	dqnt_signal_publish(&explorer->roundSignal);
+	for (u32 i = 0; i < explorer->numWorkers; i++)
+		dqnt_thread_join(&explorer->workers[i]);
+
+	explorer->numWorkers = 0;
+	dqnt_signal_free(&explorer->roundSignal);
+	free(explorer->scratch);
+	explorer->scratch = NULL;
+}
+
+// Expand every node in the frontier, in parallel if it's large enough. Return
+// the index of the first node created, new nodes are
+// [result, explorer->nodeCount).
+FILE_SCOPE u32 explore_expand_frontier(Explorer *explorer)
+{
+	u32 result             = explorer->nodeCount;
+	explorer->frontierNext = 0;
+
+	if (explorer->numWorkers == 0 ||
+	    explorer->frontierCount < EXPLORE_MIN_PARALLEL_NODES)
+	{
+		explore_claim_nodes(explorer, explorer->scratch);
+	}
+	else
+	{
+		dqnt_atomic_store_u32(&explorer->numFinished, 0);
+		dqnt_signal_publish(&explorer->roundSignal);
+		explore_claim_nodes(explorer, explorer->scratch);
+		dqnt_spin_until_u32(&explorer->numFinished, explorer->numWorkers);
+	}
+
+	if (explorer->nodeCount > explorer->config.maxStates)
+		explorer->nodeCount = explorer->config.maxStates;
+	return result;
+}
+
+// NOTE: qsort has no user pointer, the node array is only ever read while
+// sorting on the main thread
+FILE_SCOPE const ExploreNode *exploreSortNodes;
+FILE_SCOPE int explore_compare_score_desc(const void *a, const void *b)
+{
+	u32 indexA = *(const u32 *)a;
+	u32 indexB = *(const u32 *)b;
+	f32 scoreA = exploreSortNodes[indexA].score;
+	f32 scoreB = exploreSortNodes[indexB].score;
+	if (scoreA > scoreB) return -1;
+	if (scoreA < scoreB) return 1;
+	return (indexA < indexB) ? -1 : 1;
+}
+
+FILE_SCOPE void explore_sort_by_score(Explorer *explorer, u32 *indexes, u32 count)
+{
+	exploreSortNodes = explorer->nodes;
+	qsort(indexes, count, sizeof(*indexes), explore_compare_score_desc);
+}
+
+// Return the index of the best scoring node found
+FILE_SCOPE u32 explore_run(Explorer *explorer)
+{
+	const ExploreConfig *config = &explorer->config;
+	u32 bestNode                = 0;
+
+	// NOTE: Unexpanded nodes for best first, kept sorted by score each round
+	u32 *open      = (u32 *)malloc(sizeof(u32) * config->maxStates);
+	u32 openCount  = 0;
+	if (!open) return bestNode;
+	if (!explore_start_workers(explorer))
+	{
+		free(open);
+		return bestNode;
+	}
+
+	explorer->frontier[0]   = 0;
+	explorer->frontierCount = 1;
+
+	f64 startTime = dqnt_time_now_s();
+	for (u32 round = 0; explorer->frontierCount > 0; round++)
+	{
+		u32 firstNew = explore_expand_frontier(explorer);
+		u32 lastNew  = explorer->nodeCount;
+
+		for (u32 i = firstNew; i < lastNew; i++)
+		{
+			if (explorer->nodes[i].score > explorer->nodes[bestNode].score)
+				bestNode = i;
+		}
+
+		f64 elapsedS = dqnt_time_now_s() - startTime;
+		printf("round %4u: expanded %llu unique %u dup %llu best %.1f "
+		       "(depth %u) %.0f states/s\n",
+		       round, (unsigned long long)explorer->numExpanded,
+		       explorer->nodeCount, (unsigned long long)explorer->numDuplicates,
+		       explorer->nodes[bestNode].score, explorer->nodes[bestNode].depth,
+		       (elapsedS > 0) ? explorer->numExpanded / elapsedS : 0.0);
+
+		if (explorer->outOfSpace)
+		{
+			printf("stopped: reached -max-states %u\n", config->maxStates);
+			break;
+		}
+
+		// NOTE: Choose the next frontier, never expand past the depth limit
+		explorer->frontierCount = 0;
+		switch (config->strategy)
+		{
+			case explorestrategy_bfs:
+			case explorestrategy_beam:
+			{
+				for (u32 i = firstNew; i < lastNew; i++)
+				{
+					if (explorer->nodes[i].depth < config->maxDepth)
+						explorer->frontier[explorer->frontierCount++] = i;
+				}
+
+				if (config->strategy == explorestrategy_beam)
+				{
+					explore_sort_by_score(explorer, explorer->frontier,
+					                      explorer->frontierCount);
+					explorer->frontierCount =
+					    DQNT_MATH_MIN(explorer->frontierCount, config->beamWidth);
+				}
+			}
+			break;
+
+			case explorestrategy_best:
+			{
+				for (u32 i = firstNew; i < lastNew; i++)
+				{
+					if (explorer->nodes[i].depth < config->maxDepth)
+						open[openCount++] = i;
+				}
+
+				// NOTE: Expand the best beamWidth open nodes per round so
+				// every core has work, rather than one node at a time
+				explore_sort_by_score(explorer, open, openCount);
+				u32 take = DQNT_MATH_MIN(openCount, config->beamWidth);
+				memcpy(explorer->frontier, open, sizeof(u32) * take);
+				explorer->frontierCount = take;
+
+				openCount -= take;
+				memmove(open, open + take, sizeof(u32) * openCount);
+			}
+			break;
+		}
+	}
+
+	explore_stop_workers(explorer);
+	free(open);
+	return bestNode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Entry Point
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE bool explore_parse_actions(ExploreConfig *config, const char *list)
+{
+	config->numActions = 0;
+	for (const char *c = list; *c; c++)
+	{
+		if (*c == ',') continue;
+
+		u16 keyMask;
+		if (*c == 'n' || *c == 'N')                       keyMask = 0;
+		else if (*c >= '0' && *c <= '9')                  keyMask = (u16)(1 << (*c - '0'));
+		else if (*c >= 'a' && *c <= 'f')                  keyMask = (u16)(1 << (*c - 'a' + 10));
+		else if (*c >= 'A' && *c <= 'F')                  keyMask = (u16)(1 << (*c - 'A' + 10));
+		else return false;
+
+		if (config->numActions >= DQNT_ARRAY_COUNT(config->actions)) return false;
+		config->actions[config->numActions++] = keyMask;
+	}
+
+	return (config->numActions > 0);
+}
+
+FILE_SCOPE bool explore_parse_score(ExploreConfig *config, const char *spec)
+{
+	if (dqnt_strcmp(spec, "pixels") == 0)
+	{
+		config->scoreFunc = explore_score_pixels;
+		return true;
+	}
+
+	if (dqnt_strcmp(spec, "depth") == 0)
+	{
+		config->scoreFunc = explore_score_depth;
+		return true;
+	}
+
+	const char *colon = strchr(spec, ':');
+	if (!colon) return false;
+
+	u32 address = (u32)strtoul(colon + 1, NULL, 0);
+	if (strncmp(spec, "mem8:", 5) == 0 && address < CHIP8_MEMORY_SIZE)
+		config->scoreFunc = explore_score_mem8;
+	else if (strncmp(spec, "mem16:", 6) == 0 && address + 1 < CHIP8_MEMORY_SIZE)
+		config->scoreFunc = explore_score_mem16;
+	else
+		return false;
+
+	config->scoreUserData = (void *)(size_t)address;
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	ExploreConfig config   = {};
+	config.strategy        = explorestrategy_bfs;
+	config.framesPerAction = 4;
+	config.cyclesPerFrame  = 15;
+	config.beamWidth       = 256;
+	config.maxDepth        = 0xFFFFFFFF;
+	config.maxStates       = 50000;
+	config.numThreads      = dqnt_num_cores();
+	config.scoreFunc       = explore_score_depth;
+	explore_parse_actions(&config, "0123456789ABCDEF");
+
+	const char *statePath = NULL;
+	const char *outPath   = NULL;
+	u32 warmupFrames      = 0;
+
+	i32 argIndex = 1;
+	for (; argIndex + 1 < argc; argIndex++)
+	{
+		const char *arg = argv[argIndex];
+		if (arg[0] != '-') break;
+
+		const char *value = argv[++argIndex];
+		bool valid        = true;
+		if (dqnt_strcmp(arg, "-strategy") == 0)
+		{
+			if      (dqnt_strcmp(value, "bfs") == 0)  config.strategy = explorestrategy_bfs;
+			else if (dqnt_strcmp(value, "beam") == 0) config.strategy = explorestrategy_beam;
+			else if (dqnt_strcmp(value, "best") == 0) config.strategy = explorestrategy_best;
+			else valid = false;
+		}
+		else if (dqnt_strcmp(arg, "-keys") == 0)       valid = explore_parse_actions(&config, value);
+		else if (dqnt_strcmp(arg, "-score") == 0)      valid = explore_parse_score(&config, value);
+		else if (dqnt_strcmp(arg, "-frames") == 0)     config.framesPerAction = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-cycles") == 0)     config.cyclesPerFrame  = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-width") == 0)      config.beamWidth       = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-depth") == 0)      config.maxDepth        = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-max-states") == 0) config.maxStates       = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-threads") == 0)    config.numThreads      = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-warmup") == 0)     warmupFrames           = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-out") == 0)        outPath                = value;
+		else if (dqnt_strcmp(arg, "-state") == 0)      statePath              = value;
+		else valid = false;
+
+		if (!valid)
+		{
+			fprintf(stderr, "explore: bad option %s %s\n", arg, value);
+			return -1;
+		}
+	}
+
+	if ((!statePath && argIndex >= argc) || config.maxStates == 0 ||
+	    config.beamWidth == 0 || config.numThreads == 0)
+	{
+		fprintf(stderr, "usage: explore_dchip8 [-strategy bfs|beam|best] "
+		                "[-keys n,0,..,F] [-frames K] [-cycles N] [-width W] "
+		                "[-depth D] [-max-states N] [-threads N] [-score spec] "
+		                "[-warmup N] [-out keys_file] (rom | -state file)\n");
+		return -1;
+	}
+
+	Explorer explorer  = {};
+	explorer.config    = config;
+	explorer.nodes     = (ExploreNode *)malloc(sizeof(ExploreNode) * config.maxStates);
+	explorer.frontier  = (u32 *)malloc(sizeof(u32) * config.maxStates);
+
+	u64 visitedCapacity = 1024;
+	while (visitedCapacity < (u64)config.maxStates * config.numActions * 2)
+		visitedCapacity *= 2;
+	explorer.visited     = (volatile u64 *)calloc(visitedCapacity, sizeof(u64));
+	explorer.visitedMask = visitedCapacity - 1;
+	if (!explorer.nodes || !explorer.frontier || !explorer.visited)
+	{
+		fprintf(stderr, "explore: out of memory for %u states\n", config.maxStates);
+		return -1;
+	}
+
+	ExploreNode *root = &explorer.nodes[0];
+	if (statePath)
+	{
+		u32 size  = 0;
+		u8 *state = headless_read_entire_file(statePath, &size);
+		if (!state || size != sizeof(Chip8VM))
+		{
+			fprintf(stderr, "explore: %s is not a %u byte machine snapshot\n",
+			        statePath, (u32)sizeof(Chip8VM));
+			return -1;
+		}
+		memcpy(&root->vm, state, sizeof(root->vm));
+		dchip8_vm_rehash(&root->vm);
+		free(state);
+	}
+	else
+	{
+		u32 romSize = 0;
+		u8 *rom     = headless_read_entire_file(argv[argIndex], &romSize);
+		if (!rom || !dchip8_vm_load_rom(&root->vm, rom, romSize))
+		{
+			fprintf(stderr, "explore: could not load %s\n", argv[argIndex]);
+			return -1;
+		}
+		free(rom);
+	}
+
+	Chip8Controller noKeys = {};
+	for (u32 frame = 0; frame < warmupFrames; frame++)
+	{
+		dchip8_vm_run(&root->vm, noKeys, config.cyclesPerFrame);
+		dchip8_vm_tick_timers(&root->vm);
+	}
+
+	root->parent       = EXPLORE_NO_PARENT;
+	root->depth        = 0;
+	root->keyMask      = 0;
+	root->score        = config.scoreFunc(&root->vm, 0, config.scoreUserData);
+	explorer.nodeCount = 1;
+	explore_visit(&explorer, dchip8_vm_hash(&root->vm));
+
+	printf("explore: %u actions x %u frames, %u threads, %u max states\n",
+	       config.numActions, config.framesPerAction, config.numThreads,
+	       config.maxStates);
+	u32 bestNode = explore_run(&explorer);
+
+	const ExploreNode *best = &explorer.nodes[bestNode];
+	printf("best: score %.1f depth %u hash %016llX\n", best->score, best->depth,
+	       (unsigned long long)dchip8_vm_hash(&best->vm));
+
+	if (outPath)
+	{
+		// NOTE: Walk back to the root, then write the keys root first, one
+		// entry per emulated frame. Warmup frames have no keys down.
+		u32 numFrames = warmupFrames + (best->depth * config.framesPerAction);
+		u8 *keys      = (u8 *)calloc((size_t)numFrames * 2 + 1, 1);
+		u32 frame     = numFrames;
+		for (u32 index = bestNode; explorer.nodes[index].parent != EXPLORE_NO_PARENT;
+		     index = explorer.nodes[index].parent)
+		{
+			u16 keyMask = explorer.nodes[index].keyMask;
+			for (u32 i = 0; i < config.framesPerAction; i++)
+			{
+				frame--;
+				keys[frame * 2]     = (u8)(keyMask & 0xFF);
+				keys[frame * 2 + 1] = (u8)(keyMask >> 8);
+			}
+		}
+
+		if (!headless_write_entire_file(outPath, keys, numFrames * 2))
+			fprintf(stderr, "explore: failed to write %s\n", outPath);
+		free(keys);
+	}
+
+	return 0;
+}
@@ -0,0 +1,531 @@
+// NOTE: In-process fuzzer for the interpreter. Each input is an arbitrary ROM
+// plus a scripted keypad sequence, executed for a bounded number of
+// instructions. Guest address coverage guides which mutations are kept.
+//
+// Input layout
+//   [u8 numFrames] [numFrames * u16 little endian key bitmask] [ROM bytes]
+//
+// Usage: fuzz_dchip8 [-runs N] [-seed N] [-out dir] [seed_rom ...]
+//
+// Define DCHIP8_LIBFUZZER to build LLVMFuzzerTestOneInput instead of main()
+// i.e. clang -fsanitize=fuzzer,address -DDCHIP8_LIBFUZZER fuzz_dchip8.cpp.
+// The guest coverage map is then also fed to libFuzzer as extra counters.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "headless_dchip8.cpp"
+
+#define FUZZ_MAX_FRAMES        255
+#define FUZZ_MAX_INPUT_SIZE    (1 + (FUZZ_MAX_FRAMES * 2) + CHIP8_MAX_ROM_SIZE)
+#define FUZZ_MAX_INSTRUCTIONS  8192
+#define FUZZ_CYCLES_PER_FRAME  15
+// NOTE: Frames run after the scripted input is exhausted, with no keys down
+#define FUZZ_TRAILING_FRAMES   8
+#define FUZZ_MAX_CORPUS        8192
+
+// NOTE: First half is hit counts per guest address, second half is hit counts
+// per (previous pc, pc) edge hashed into the same range.
+#define FUZZ_COVERAGE_SIZE     (CHIP8_MEMORY_SIZE * 2)
+// NOTE: Faulting addresses aren't bounded by memory, a Bnnn can land the pc
+// on anything up to 0xFFF + 0xFF, so faults are deduped over the whole u16
+#define FUZZ_FAULT_ADDRESS_RANGE 0x10000
+
+typedef struct FuzzInput
+{
+	u32 size;
+	u8  data[FUZZ_MAX_INPUT_SIZE];
+} FuzzInput;
+
+typedef struct FuzzResult
+{
+	u32             instructionsExecuted;
+	enum Chip8State state;
+	enum Chip8Fault fault;
+	u16             faultAddress;
+} FuzzResult;
+
+typedef struct FuzzState
+{
+	Chip8VM      bootVM;
+	Chip8VM      vm;
+	RandPCGState rng;
+
+	u8 coverage[FUZZ_COVERAGE_SIZE];
+	// NOTE: Bit set means that hit count bucket has not been seen yet
+	u8 virginMap[FUZZ_COVERAGE_SIZE];
+	u8 faultsSeen[chip8fault_count][FUZZ_FAULT_ADDRESS_RANGE / 8];
+
+	FuzzInput *corpus;
+	u32        corpusCount;
+	FuzzInput  candidate;
+
+	const char *outDir;
+	u64         numExecs;
+	u32         numFaults;
+	u32         numEdges;
+} FuzzState;
+
+FILE_SCOPE void fuzz_init(FuzzState *fuzz, u32 seed)
+{
+	dchip8_vm_init(&fuzz->bootVM);
+	dqnt_rnd_pcg_seed(&fuzz->rng, seed);
+	memset(fuzz->virginMap, 0xFF, sizeof(fuzz->virginMap));
+	memset(fuzz->faultsSeen, 0, sizeof(fuzz->faultsSeen));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Execution
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE FuzzResult fuzz_execute(FuzzState *fuzz, const u8 *data, u32 size)
+{
+	// NOTE: Empty inputs are executions too, count them before bailing
+	FuzzResult result = {};
+	fuzz->numExecs++;
+	if (size == 0) return result;
+
+	u32 numFrames = data[0];
+	if (numFrames * 2 > size - 1) numFrames = (size - 1) / 2;
+	const u8 *keyFrames = data + 1;
+
+	const u8 *rom = keyFrames + (numFrames * 2);
+	u32 romSize   = size - 1 - (numFrames * 2);
+	if (romSize > CHIP8_MAX_ROM_SIZE) romSize = CHIP8_MAX_ROM_SIZE;
+
+	// NOTE: Reset is a single copy of a pre-initialised machine, cheaper than
+	// re-running the font and cpu initialisation every execution.
+	Chip8VM *vm = &fuzz->vm;
+	memcpy(vm, &fuzz->bootVM, sizeof(*vm));
+	dchip8_vm_write_memory_block(vm, INIT_ADDRESS, rom, romSize);
+	vm->cpu.state = chip8state_running;
+
+	memset(fuzz->coverage, 0, sizeof(fuzz->coverage));
+	u16 prevPc = 0;
+
+	u32 maxFrames = numFrames + FUZZ_TRAILING_FRAMES;
+	for (u32 frame = 0; frame < maxFrames; frame++)
+	{
+		u16 keyMask = 0;
+		if (frame < numFrames)
+			keyMask = (u16)(keyFrames[frame * 2] | (keyFrames[frame * 2 + 1] << 8));
+		Chip8Controller controller = dchip8_controller_from_bitmask(keyMask);
+
+		for (u32 cycle = 0; cycle < FUZZ_CYCLES_PER_FRAME; cycle++)
+		{
+			u16 pc = vm->cpu.programCounter;
+			if (pc < CHIP8_MEMORY_SIZE)
+			{
+				u32 edge = CHIP8_MEMORY_SIZE +
+				           ((pc ^ (prevPc >> 1)) & (CHIP8_MEMORY_SIZE - 1));
+				fuzz->coverage[pc]++;
+				fuzz->coverage[edge]++;
+				prevPc = pc;
+			}
+
+			// NOTE: Stop the frame when blocked on Fx0A, the same as running
+			// the whole frame in one call would
+			if (dchip8_vm_run(vm, controller, 1) == 0) break;
+			result.instructionsExecuted++;
+			if (vm->cpu.state != chip8state_running) break;
+		}
+
+		if (vm->cpu.state == chip8state_fault) break;
+		if (vm->cpu.state == chip8state_await_input && frame >= numFrames) break;
+		if (result.instructionsExecuted >= FUZZ_MAX_INSTRUCTIONS) break;
+		dchip8_vm_tick_timers(vm);
+	}
+
+	// NOTE: Host side invariants, if these ever fire the interpreter touched
+	// something it should have faulted on instead.
+	Chip8CPU *cpu = &vm->cpu;
+	DQNT_ASSERT(cpu->stackPointer <= DQNT_ARRAY_COUNT(cpu->stack));
+	DQNT_ASSERT(cpu->state != chip8state_fault ||
+	            (cpu->fault > chip8fault_none && cpu->fault < chip8fault_count));
+	DQNT_ASSERT(cpu->storeKeyToRegisterIndex <
+	            DQNT_ARRAY_COUNT(cpu->registerArray));
+
+	// NOTE: Spot check the incremental hashes, recomputing is ~50x the cost
+	// of a typical execution
+	if ((fuzz->numExecs & 0x3FF) == 0)
+		DQNT_ASSERT(dchip8_vm_hash(vm) == dchip8_vm_hash_full(vm));
+
+	result.state        = cpu->state;
+	result.fault        = cpu->fault;
+	result.faultAddress = cpu->faultAddress;
+	return result;
+}
+
+// NOTE: Collapse hit counts into power of two buckets so that looping a little
+// more or less than before doesn't register as new behaviour.
+FILE_SCOPE inline u8 fuzz_count_class_internal(u8 count)
+{
+	if (count == 0)   return 0;
+	if (count == 1)   return 1;
+	if (count == 2)   return 2;
+	if (count == 3)   return 4;
+	if (count <= 7)   return 8;
+	if (count <= 15)  return 16;
+	if (count <= 31)  return 32;
+	if (count <= 127) return 64;
+	return 128;
+}
+
+// Return the number of new coverage buckets hit by the last execution.
+FILE_SCOPE u32 fuzz_update_virgin_map(FuzzState *fuzz)
+{
+	u32 result = 0;
+	const u64 *words = (const u64 *)fuzz->coverage;
+	for (u32 wordIndex = 0; wordIndex < sizeof(fuzz->coverage) / sizeof(u64);
+	     wordIndex++)
+	{
+		// NOTE: Most of the map is untouched, skip 8 entries at a time
+		if (!words[wordIndex]) continue;
+
+		for (u32 i = wordIndex * 8; i < (wordIndex + 1) * 8; i++)
+		{
+			u8 bucket = fuzz_count_class_internal(fuzz->coverage[i]);
+			if (fuzz->virginMap[i] & bucket)
+			{
+				if (fuzz->virginMap[i] == 0xFF) fuzz->numEdges++;
+				fuzz->virginMap[i] &= ~bucket;
+				result++;
+			}
+		}
+	}
+
+	return result;
+}
+
+FILE_SCOPE void fuzz_record_fault(FuzzState *fuzz, FuzzResult result,
+                                  const FuzzInput *input)
+{
+	if (result.state != chip8state_fault) return;
+
+	u8 *seen = &fuzz->faultsSeen[result.fault][result.faultAddress / 8];
+	u8 bit   = (u8)(1 << (result.faultAddress % 8));
+	if (*seen & bit) return;
+	*seen |= bit;
+	fuzz->numFaults++;
+
+	printf("fault: %-20s at 0x%03X (exec %llu)\n",
+	       dchip8_fault_string(result.fault), result.faultAddress,
+	       (unsigned long long)fuzz->numExecs);
+
+	if (fuzz->outDir)
+	{
+		char path[1024] = {};
+		snprintf(path, DQNT_ARRAY_COUNT(path), "%s/fault-%s-%03X.bin",
+		         fuzz->outDir, dchip8_fault_string(result.fault),
+		         result.faultAddress);
+		if (!headless_write_entire_file(path, input->data, input->size))
+			fprintf(stderr, "fuzz: failed to write %s\n", path);
+	}
+}
+
+FILE_SCOPE void fuzz_add_to_corpus(FuzzState *fuzz, const FuzzInput *input)
+{
+	// NOTE: Once full, replace a random entry so the search keeps moving
+	u32 index = fuzz->corpusCount;
+	if (index >= FUZZ_MAX_CORPUS)
+		index = dqnt_rnd_pcg_next(&fuzz->rng) % FUZZ_MAX_CORPUS;
+	else
+		fuzz->corpusCount++;
+
+	FuzzInput *entry = &fuzz->corpus[index];
+	entry->size      = input->size;
+	memcpy(entry->data, input->data, input->size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Mutation
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE inline u32 fuzz_rand_internal(FuzzState *fuzz, u32 max)
+{
+	u32 result = dqnt_rnd_pcg_next(&fuzz->rng) % max;
+	return result;
+}
+
+// NOTE: Write a plausible instruction so the fuzzer doesn't have to guess
+// every opcode family from random bytes.
+FILE_SCOPE void fuzz_write_random_opcode_internal(FuzzState *fuzz, u8 *dest)
+{
+	const u16 TEMPLATES[] = {
+	    0x00E0, 0x00EE, 0x1000, 0x2000, 0x3000, 0x4000, 0x5000, 0x6000,
+	    0x7000, 0x8000, 0x8001, 0x8002, 0x8003, 0x8004, 0x8005, 0x8006,
+	    0x8007, 0x800E, 0x9000, 0xA000, 0xB000, 0xC000, 0xD000, 0xE09E,
+	    0xE0A1, 0xF007, 0xF00A, 0xF015, 0xF018, 0xF01E, 0xF029, 0xF033,
+	    0xF055, 0xF065,
+	};
+
+	u16 opcode = TEMPLATES[fuzz_rand_internal(fuzz, DQNT_ARRAY_COUNT(TEMPLATES))];
+	u16 random = (u16)dqnt_rnd_pcg_next(&fuzz->rng);
+	switch (opcode & 0xF000)
+	{
+		// NOTE: nnn operand, bias jump targets into the ROM
+		case 0x1000:
+		case 0x2000:
+		case 0xA000:
+		case 0xB000: opcode |= (u16)((INIT_ADDRESS + (random % CHIP8_MAX_ROM_SIZE)) & 0x0FFF); break;
+
+		// NOTE: x and kk operands
+		case 0x3000:
+		case 0x4000:
+		case 0x6000:
+		case 0x7000:
+		case 0xC000: opcode |= (random & 0x0FFF); break;
+
+		// NOTE: x, y and n operands
+		case 0xD000: opcode |= (random & 0x0FFF); break;
+
+		// NOTE: x and y operands
+		case 0x5000:
+		case 0x8000:
+		case 0x9000: opcode |= (random & 0x0FF0); break;
+
+		// NOTE: x operand
+		case 0xE000:
+		case 0xF000: opcode |= (random & 0x0F00); break;
+
+		default: break;
+	}
+
+	dest[0] = (u8)(opcode >> 8);
+	dest[1] = (u8)(opcode & 0xFF);
+}
+
+FILE_SCOPE void fuzz_mutate(FuzzState *fuzz, FuzzInput *input)
+{
+	const u8 INTERESTING_BYTES[] = {0x00, 0x01, 0x0F, 0x10, 0x1F, 0x20,
+	                                0x3F, 0x40, 0x7F, 0x80, 0xE0, 0xEE,
+	                                0xF0, 0xFE, 0xFF};
+
+	u32 numMutations = 1 + fuzz_rand_internal(fuzz, 8);
+	for (u32 mutation = 0; mutation < numMutations; mutation++)
+	{
+		if (input->size == 0)
+		{
+			input->data[0] = 0;
+			input->size    = 1;
+		}
+
+		u32 pos = fuzz_rand_internal(fuzz, input->size);
+		switch (fuzz_rand_internal(fuzz, 9))
+		{
+			case 0: input->data[pos] ^= (u8)(1 << fuzz_rand_internal(fuzz, 8)); break;
+			case 1: input->data[pos] = (u8)dqnt_rnd_pcg_next(&fuzz->rng); break;
+			case 2:
+			{
+				input->data[pos] = INTERESTING_BYTES[fuzz_rand_internal(
+				    fuzz, DQNT_ARRAY_COUNT(INTERESTING_BYTES))];
+			}
+			break;
+
+			case 3:
+			{
+				if (pos + 2 <= input->size)
+					fuzz_write_random_opcode_internal(fuzz, &input->data[pos]);
+			}
+			break;
+
+			// NOTE: Delete a chunk
+			case 4:
+			{
+				u32 len = 1 + fuzz_rand_internal(fuzz, 16);
+				if (pos + len > input->size) len = input->size - pos;
+				memmove(&input->data[pos], &input->data[pos + len],
+				        input->size - pos - len);
+				input->size -= len;
+			}
+			break;
+
+			// NOTE: Duplicate a chunk in place
+			case 5:
+			{
+				u32 len = 1 + fuzz_rand_internal(fuzz, 16);
+				if (pos + len > input->size) len = input->size - pos;
+				if (input->size + len > FUZZ_MAX_INPUT_SIZE) break;
+				memmove(&input->data[pos + len], &input->data[pos],
+				        input->size - pos);
+				input->size += len;
+			}
+			break;
+
+			// NOTE: Change the number of scripted frames
+			case 6: input->data[0] = (u8)dqnt_rnd_pcg_next(&fuzz->rng); break;
+
+			// NOTE: Press a single key in a scripted frame
+			case 7:
+			{
+				u32 numFrames = input->data[0];
+				if (numFrames == 0 || input->size < 3) break;
+				u32 frame = fuzz_rand_internal(fuzz, numFrames);
+				u32 offset = 1 + (frame * 2);
+				if (offset + 2 > input->size) break;
+
+				u16 keyMask = (u16)(1 << fuzz_rand_internal(fuzz, CHIP8_NUM_KEYS));
+				input->data[offset]     = (u8)(keyMask & 0xFF);
+				input->data[offset + 1] = (u8)(keyMask >> 8);
+			}
+			break;
+
+			// NOTE: Splice the tail of another corpus entry
+			case 8:
+			{
+				if (fuzz->corpusCount == 0) break;
+				const FuzzInput *other =
+				    &fuzz->corpus[fuzz_rand_internal(fuzz, fuzz->corpusCount)];
+				if (other->size <= pos) break;
+
+				u32 len = other->size - pos;
+				memcpy(&input->data[pos], &other->data[pos], len);
+				input->size = pos + len;
+			}
+			break;
+		}
+	}
+}
+
+// Execute input and keep it if it found new coverage. Return true if it did.
+FILE_SCOPE bool fuzz_run_input(FuzzState *fuzz, const FuzzInput *input)
+{
+	FuzzResult result = fuzz_execute(fuzz, input->data, input->size);
+	fuzz_record_fault(fuzz, result, input);
+
+	bool isInteresting = (fuzz_update_virgin_map(fuzz) > 0);
+	if (isInteresting) fuzz_add_to_corpus(fuzz, input);
+	return isInteresting;
+}
+
+#ifdef DCHIP8_LIBFUZZER
+////////////////////////////////////////////////////////////////////////////////
+// libFuzzer Entry Point
+////////////////////////////////////////////////////////////////////////////////
+#ifdef __linux__
+__attribute__((section("__libfuzzer_extra_counters")))
+#endif
+FILE_SCOPE u8 fuzzExtraCounters[FUZZ_COVERAGE_SIZE];
+
+extern "C" int LLVMFuzzerTestOneInput(const u8 *data, size_t size)
+{
+	LOCAL_PERSIST FuzzState *fuzz = NULL;
+	if (!fuzz)
+	{
+		fuzz = (FuzzState *)calloc(1, sizeof(FuzzState));
+		fuzz_init(fuzz, 0x8293A8DE);
+	}
+
+	if (size > FUZZ_MAX_INPUT_SIZE) size = FUZZ_MAX_INPUT_SIZE;
+	fuzz_execute(fuzz, data, (u32)size);
+	memcpy(fuzzExtraCounters, fuzz->coverage, sizeof(fuzzExtraCounters));
+	return 0;
+}
+
+#else
+////////////////////////////////////////////////////////////////////////////////
+// Standalone Entry Point
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	u64 maxRuns = 0;
+	u32 seed    = (u32)time(NULL);
+
+	FuzzState *fuzz = (FuzzState *)calloc(1, sizeof(FuzzState));
+	if (!fuzz) return -1;
+	fuzz->corpus = (FuzzInput *)calloc(FUZZ_MAX_CORPUS, sizeof(FuzzInput));
+	if (!fuzz->corpus) return -1;
+
+	i32 argIndex = 1;
+	for (; argIndex < argc; argIndex++)
+	{
+		if (argIndex + 1 >= argc) break;
+		if (dqnt_strcmp(argv[argIndex], "-runs") == 0)
+			maxRuns = strtoull(argv[++argIndex], NULL, 10);
+		else if (dqnt_strcmp(argv[argIndex], "-seed") == 0)
+			seed = (u32)strtoul(argv[++argIndex], NULL, 10);
+		else if (dqnt_strcmp(argv[argIndex], "-out") == 0)
+			fuzz->outDir = argv[++argIndex];
+		else
+			break;
+	}
+
+	fuzz_init(fuzz, seed);
+	printf("fuzz: seed %u\n", seed);
+
+	// NOTE: Seed ROMs are run with no scripted input
+	for (; argIndex < argc; argIndex++)
+	{
+		u32 romSize = 0;
+		u8 *rom     = headless_read_entire_file(argv[argIndex], &romSize);
+		if (!rom)
+		{
+			fprintf(stderr, "fuzz: could not read %s\n", argv[argIndex]);
+			continue;
+		}
+
+		FuzzInput *input = &fuzz->candidate;
+		if (romSize > CHIP8_MAX_ROM_SIZE) romSize = CHIP8_MAX_ROM_SIZE;
+		input->data[0] = 0;
+		memcpy(input->data + 1, rom, romSize);
+		input->size = 1 + romSize;
+		free(rom);
+
+		// NOTE: Seeds always join the corpus even if they add nothing new
+		FuzzResult result = fuzz_execute(fuzz, input->data, input->size);
+		fuzz_record_fault(fuzz, result, input);
+		fuzz_update_virgin_map(fuzz);
+		fuzz_add_to_corpus(fuzz, input);
+	}
+
+	if (fuzz->corpusCount == 0)
+	{
+		FuzzInput *input = &fuzz->candidate;
+		input->data[0] = 0;
+		fuzz_write_random_opcode_internal(fuzz, &input->data[1]);
+		input->size = 3;
+		fuzz_run_input(fuzz, input);
+		fuzz_add_to_corpus(fuzz, input);
+	}
+
+	clock_t startTime     = clock();
+	clock_t lastPrintTime = startTime;
+	for (u64 run = 0; maxRuns == 0 || run < maxRuns; run++)
+	{
+		const FuzzInput *parent =
+		    &fuzz->corpus[fuzz_rand_internal(fuzz, fuzz->corpusCount)];
+
+		FuzzInput *input = &fuzz->candidate;
+		input->size      = parent->size;
+		memcpy(input->data, parent->data, parent->size);
+		fuzz_mutate(fuzz, input);
+		fuzz_run_input(fuzz, input);
+
+		if ((run & 0xFFF) == 0)
+		{
+			clock_t now = clock();
+			if ((now - lastPrintTime) >= CLOCKS_PER_SEC)
+			{
+				f32 elapsedS = (f32)(now - startTime) / CLOCKS_PER_SEC;
+				printf("#%llu cov: %u corpus: %u faults: %u exec/s: %.0f\n",
+				       (unsigned long long)fuzz->numExecs, fuzz->numEdges,
+				       fuzz->corpusCount, fuzz->numFaults,
+				       fuzz->numExecs / elapsedS);
+				lastPrintTime = now;
+			}
+		}
+	}
+
+	f32 elapsedS = (f32)(clock() - startTime) / CLOCKS_PER_SEC;
+	printf("done: %llu execs, cov: %u, corpus: %u, faults: %u, exec/s: %.0f\n",
+	       (unsigned long long)fuzz->numExecs, fuzz->numEdges,
+	       fuzz->corpusCount, fuzz->numFaults,
+	       (elapsedS > 0) ? fuzz->numExecs / elapsedS : 0.0f);
+	return 0;
+}
+#endif
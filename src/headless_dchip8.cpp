@@ -0,0 +1,180 @@
+#ifndef _CRT_SECURE_NO_WARNINGS
+	#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+// NOTE: Headless platform layer, implements the platform API with the C
+// runtime so the core can run in tools without a window. Include this into a
+// tool's unity build after the core.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "dchip8_platform.h"
+#include "dqnt.h"
+
+FILE_SCOPE FILE *headless_wfopen_internal(const wchar_t *const file)
+{
+#ifdef _WIN32
+	FILE *result = _wfopen(file, L"rb");
+#else
+	char path[1024] = {};
+	if (wcstombs(path, file, DQNT_ARRAY_COUNT(path) - 1) == (size_t)-1)
+		return NULL;
+	FILE *result = fopen(path, "rb");
+#endif
+	return result;
+}
+
+bool platform_open_file(const wchar_t *const file, PlatformFile *platformFile)
+{
+	FILE *handle = headless_wfopen_internal(file);
+	if (!handle) return false;
+
+	fseek(handle, 0, SEEK_END);
+	long size = ftell(handle);
+	fseek(handle, 0, SEEK_SET);
+	if (size < 0)
+	{
+		fclose(handle);
+		return false;
+	}
+
+	platformFile->handle = (void *)handle;
+	platformFile->size   = (u64)size;
+	return true;
+}
+
+u32 platform_read_file(PlatformFile file, void *buffer, u32 numBytesToRead)
+{
+	u32 numBytesRead = 0;
+	if (file.handle && buffer)
+		numBytesRead = (u32)fread(buffer, 1, numBytesToRead, (FILE *)file.handle);
+
+	return numBytesRead;
+}
+
+void platform_close_file(PlatformFile *file)
+{
+	if (file->handle) fclose((FILE *)file->handle);
+	file->handle = NULL;
+	file->size   = 0;
+}
+
+#ifdef _WIN32
+// NOTE: Headless tools on Windows don't need the speed, read the file into
+// memory instead of mapping it
+bool platform_map_file(const wchar_t *const file, PlatformMappedFile *mappedFile)
+{
+	*mappedFile         = {};
+	PlatformFile handle = {};
+	if (!platform_open_file(file, &handle)) return false;
+
+	bool result = false;
+	if (handle.size > 0 && handle.size <= 0xFFFFFFFF)
+	{
+		void *memory = malloc((size_t)handle.size);
+		if (memory && platform_read_file(handle, memory, (u32)handle.size) ==
+		                  handle.size)
+		{
+			mappedFile->mapping = memory;
+			mappedFile->memory  = memory;
+			mappedFile->size    = handle.size;
+			result              = true;
+		}
+		else
+		{
+			free(memory);
+		}
+	}
+
+	platform_close_file(&handle);
+	return result;
+}
+
+void platform_unmap_file(PlatformMappedFile *mappedFile)
+{
+	free(mappedFile->mapping);
+	*mappedFile = {};
+}
+#else
+bool platform_map_file(const wchar_t *const file, PlatformMappedFile *mappedFile)
+{
+	*mappedFile     = {};
+	char path[1024] = {};
+	if (wcstombs(path, file, DQNT_ARRAY_COUNT(path) - 1) == (size_t)-1)
+		return false;
+
+	i32 fd = open(path, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void *memory = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED) return false;
+
+	mappedFile->memory = memory;
+	mappedFile->size   = (u64)info.st_size;
+	return true;
+}
+
+void platform_unmap_file(PlatformMappedFile *mappedFile)
+{
+	if (mappedFile->memory)
+		munmap((void *)mappedFile->memory, (size_t)mappedFile->size);
+	*mappedFile = {};
+}
+#endif
+
+// Read the whole file into a malloc'ed buffer, return NULL if it could not be
+// read. Free the result with free().
+u8 *headless_read_entire_file(const char *const path, u32 *fileSize)
+{
+	FILE *handle = fopen(path, "rb");
+	if (!handle) return NULL;
+
+	fseek(handle, 0, SEEK_END);
+	long size = ftell(handle);
+	fseek(handle, 0, SEEK_SET);
+
+	u8 *result = NULL;
+	if (size >= 0)
+	{
+		// NOTE: Allocate at least a byte so empty files still return non-NULL
+		result = (u8 *)malloc((size_t)size + 1);
+		if (result && fread(result, 1, (size_t)size, handle) != (size_t)size)
+		{
+			free(result);
+			result = NULL;
+		}
+	}
+
+	fclose(handle);
+	if (result) *fileSize = (u32)size;
+	return result;
+}
+
+// Return true if all bytes were written
+bool headless_write_entire_file(const char *const path, const void *buffer,
+                                u32 size)
+{
+	FILE *handle = fopen(path, "wb");
+	if (!handle) return false;
+
+	bool result = (fwrite(buffer, 1, size, handle) == size);
+	fclose(handle);
+	return result;
+}
@@ -0,0 +1,347 @@
+// NOTE: Headless Linux platform layer. Runs a ROM in real time without a
+// window and optionally exports the framebuffer through shared memory so a
+// separate viewer process (see shmview_dchip8) can watch it.
+//
+// Usage: linux_dchip8 [-shm name | -memfd] [-capture file|-] [-cycles N]
+//                     [-fps N] [-frames N] [-keys file] [-romdb file]
+//                     [-pacing] [-metrics file] [-speculate N]
+//                     [-runahead N] rom
+//
+// -shm exports through shm_open(name), -memfd through an anonymous memfd whose
+// /proc path is printed on startup. -capture writes every frame as a delta
+// encoded stream (see dchip8_capture.h), "-" for stdout. -fps 0 runs as fast
+// as possible. -keys is a file of u16 little endian key bitmasks, one per
+// frame. Speed and quirks come from the ROM database (dchip8_roms.idx by
+// default), -cycles overrides the speed. -pacing prints a histogram of how late
+// each frame woke up against its deadline. -metrics exports frame time,
+// emulation rate and per phase histograms to file in the Prometheus text format
+// every few seconds (see dchip8_metrics.h). -speculate precomputes every key's
+// response while the ROM waits on Fx0A with N worker threads, 0 runs them on
+// the emulation thread (see Chip8Speculator). -runahead presents the frame N
+// frames ahead of the machine, the capture still records the machine itself.
+// The time spent in the core per frame is printed on exit, comparing it with
+// and without -runahead gives the cost of run-ahead.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "headless_dchip8.cpp"
+#include "dchip8_shm.cpp"
+#include "dchip8_capture.cpp"
+#include "dchip8_pacer.cpp"
+#include "dchip8_metrics.cpp"
+
+FILE_SCOPE volatile sig_atomic_t globalRunning = true;
+
+FILE_SCOPE void linux_handle_signal(i32 signal) { globalRunning = false; }
+
+// NOTE: Press the platform keys the ROM's keymap turns into the hex keys
+FILE_SCOPE void linux_set_keys_from_bitmask(PlatformInput *input,
+                                            const u8 *keymap, u16 keys)
+{
+	for (i32 hexKey = 0; hexKey < CHIP8_NUM_KEYS; hexKey++)
+	{
+		if (keymap[hexKey] >= key_count) continue;
+		KeyState *state  = &input->key[keymap[hexKey]];
+		state->endedDown = ((keys >> hexKey) & 1) != 0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *shmName     = NULL;
+	bool useMemfd           = false;
+	const char *capturePath = NULL;
+	u32 cyclesPerFrame      = 0;
+	u32 framesPerSecond     = 60;
+	u32 maxFrames           = 0;
+	const char *keysPath    = NULL;
+	const char *romDBPath   = "dchip8_roms.idx";
+	const char *romPath     = NULL;
+	bool printPacing        = false;
+	const char *metricsPath = NULL;
+	i32 speculateThreads    = -1;
+	u32 runAheadFrames      = 0;
+
+	for (i32 i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		bool hasValue   = (i + 1 < argc);
+		if      (hasValue && strcmp(arg, "-shm") == 0)       shmName          = argv[++i];
+		else if (strcmp(arg, "-memfd") == 0)                 useMemfd         = true;
+		else if (hasValue && strcmp(arg, "-capture") == 0)   capturePath      = argv[++i];
+		else if (hasValue && strcmp(arg, "-cycles") == 0)    cyclesPerFrame   = (u32)atoi(argv[++i]);
+		else if (hasValue && strcmp(arg, "-fps") == 0)       framesPerSecond  = (u32)atoi(argv[++i]);
+		else if (hasValue && strcmp(arg, "-frames") == 0)    maxFrames        = (u32)atoi(argv[++i]);
+		else if (hasValue && strcmp(arg, "-keys") == 0)      keysPath         = argv[++i];
+		else if (hasValue && strcmp(arg, "-romdb") == 0)     romDBPath        = argv[++i];
+		else if (strcmp(arg, "-pacing") == 0)                printPacing      = true;
+		else if (hasValue && strcmp(arg, "-metrics") == 0)   metricsPath      = argv[++i];
+		else if (hasValue && strcmp(arg, "-speculate") == 0) speculateThreads = atoi(argv[++i]);
+		else if (hasValue && strcmp(arg, "-runahead") == 0)  runAheadFrames   = (u32)atoi(argv[++i]);
+		else romPath = arg;
+	}
+
+	if (!romPath)
+	{
+		fprintf(stderr, "Usage: linux_dchip8 [-shm name | -memfd] "
+		                "[-capture file|-] [-cycles N] [-fps N] [-frames N] "
+		                "[-keys file] [-romdb file] [-pacing] "
+		                "[-metrics file] [-speculate N] [-runahead N] rom\n");
+		return 1;
+	}
+
+	u16 *keys   = NULL;
+	u32 numKeys = 0;
+	if (keysPath)
+	{
+		u32 keysSize = 0;
+		keys         = (u16 *)headless_read_entire_file(keysPath, &keysSize);
+		numKeys      = keysSize / sizeof(*keys);
+		if (!keys)
+		{
+			fprintf(stderr, "Could not read keys: %s\n", keysPath);
+			return 1;
+		}
+	}
+
+	// NOTE: Keep stdout clean for the capture stream if it's going there
+	bool captureToStdout = capturePath && strcmp(capturePath, "-") == 0;
+	FILE *log            = captureToStdout ? stderr : stdout;
+
+	Chip8CaptureWriter captureWriter = {};
+	FILE *captureFile                = NULL;
+	if (capturePath)
+	{
+		captureFile = captureToStdout ? stdout : fopen(capturePath, "wb");
+		if (!captureFile ||
+		    !dchip8_capture_writer_start(&captureWriter, captureFile, 4096))
+		{
+			fprintf(stderr, "Could not start capture: %s\n", capturePath);
+			return 1;
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////
+	// Initialise Render Target
+	////////////////////////////////////////////////////////////////////////////
+	// NOTE: With shared memory the core renders straight into the segment, so
+	// exporting costs two stores and two fences a frame, no syscalls or copies
+	Chip8SharedMemory shm       = {};
+	Chip8SharedFrame *frame     = NULL;
+	Chip8SharedFrame localFrame = {};
+	if (shmName || useMemfd)
+	{
+		if (!dchip8_shm_create(&shm, shmName))
+		{
+			fprintf(stderr, "Could not create shared memory: %s\n",
+			        shmName ? shmName : "memfd");
+			return 1;
+		}
+
+		frame = shm.frame;
+		fprintf(log, "Exporting framebuffer to %s\n", shm.path);
+		fflush(log);
+	}
+	else
+	{
+		frame = &localFrame;
+	}
+
+	PlatformRenderBuffer platformBuffer = {};
+	platformBuffer.memory               = frame->pixels;
+	platformBuffer.width                = CHIP8_DISPLAY_WIDTH;
+	platformBuffer.height               = CHIP8_DISPLAY_HEIGHT;
+	platformBuffer.bytesPerPixel        = sizeof(frame->pixels[0]);
+
+	PlatformMemory platformMemory   = {};
+	platformMemory.permanentMemSize = DCHIP8_MIN_PERMANENT_MEM_SIZE;
+	platformMemory.transientMemSize = DCHIP8_DEFAULT_TRANSIENT_MEM_SIZE;
+	platformMemory.permanentMem     = calloc(
+	    1, platformMemory.permanentMemSize + platformMemory.transientMemSize);
+	if (!platformMemory.permanentMem)
+	{
+		fprintf(stderr, "Could not allocate platform memory\n");
+		return 1;
+	}
+	platformMemory.transientMem =
+	    (u8 *)platformMemory.permanentMem + platformMemory.permanentMemSize;
+
+	Chip8Session *session = (Chip8Session *)platformMemory.permanentMem;
+	Chip8VM *vm           = &session->vm;
+
+	// NOTE: Load up front rather than through the command queue so the ROM's
+	// keymap is known before the first frame's keys are pressed
+	{
+		Chip8RomDB romDB        = {};
+		wchar_t romDBPathW[260] = {};
+		if (mbstowcs(romDBPathW, romDBPath,
+		             DQNT_ARRAY_COUNT(romDBPathW) - 1) != (size_t)-1)
+		{
+			dchip8_romdb_open(&romDB, romDBPathW);
+		}
+
+		u32 romSize = 0;
+		u8 *rom     = headless_read_entire_file(romPath, &romSize);
+		bool loaded =
+		    rom && dchip8_session_load_rom(session, &romDB, rom, romSize);
+		bool inRomDB = dchip8_romdb_find(&romDB, session->romHash) != NULL;
+		free(rom);
+		dchip8_romdb_close(&romDB);
+
+		if (!loaded)
+		{
+			fprintf(stderr, "Could not load rom: %s\n", romPath);
+			return 1;
+		}
+
+		if (cyclesPerFrame) session->settings.cyclesPerFrame = cyclesPerFrame;
+		session->runAheadFrames =
+		    DQNT_MATH_MIN(runAheadFrames, CHIP8_MAX_RUN_AHEAD_FRAMES);
+		fprintf(log, "Loaded %s (%016llX) with %s, %u cycles per frame, "
+		             "quirks 0x%X\n",
+		        romPath, (unsigned long long)session->romHash,
+		        inRomDB ? "rom database settings" : "default settings",
+		        session->settings.cyclesPerFrame, session->settings.quirks);
+	}
+
+	// NOTE: Holds a machine per key, too big for the stack
+	Chip8Speculator *speculator = NULL;
+	if (speculateThreads >= 0)
+	{
+		speculator = (Chip8Speculator *)calloc(1, sizeof(Chip8Speculator));
+		if (!speculator ||
+		    !dchip8_speculator_start(speculator, (u32)speculateThreads, NULL))
+		{
+			fprintf(stderr, "Could not start speculation\n");
+			return 1;
+		}
+		session->speculator = speculator;
+	}
+
+	signal(SIGINT, linux_handle_signal);
+	signal(SIGTERM, linux_handle_signal);
+
+	////////////////////////////////////////////////////////////////////////////
+	// Update Loop
+	////////////////////////////////////////////////////////////////////////////
+	Chip8Pacer pacer = {};
+	if (framesPerSecond) dchip8_pacer_init(&pacer, framesPerSecond, 0);
+	f32 frameTimeInS = 1 / 60.0f;
+	u64 frameNumber  = 0;
+
+	PlatformInput platformInput = {};
+
+	Chip8Metrics metrics          = {};
+	Chip8MetricsExporter exporter = {};
+	if (metricsPath &&
+	    !dchip8_metrics_exporter_start(&exporter, &metrics, metricsPath, 5.0))
+	{
+		fprintf(stderr, "Could not start metrics export: %s\n", metricsPath);
+		return 1;
+	}
+
+	Chip8FrameSample sample = {};
+	f64 phaseTime[chip8phase_count + 1];
+	f64 updateTimeInS = 0;
+	while (globalRunning && (maxFrames == 0 || frameNumber < maxFrames))
+	{
+		phaseTime[chip8phase_input] = dqnt_time_now_s();
+		platformInput.deltaForFrame = frameTimeInS;
+		if (frameNumber < numKeys)
+			linux_set_keys_from_bitmask(&platformInput, session->settings.keymap,
+			                            keys[frameNumber]);
+
+		u64 numInstructions          = session->numInstructions;
+		u64 numTimerTicks            = session->numTimerTicks;
+		phaseTime[chip8phase_update] = dqnt_time_now_s();
+		dchip8_shm_write_begin(frame);
+		{
+			dchip8_update(platformBuffer, &platformInput, platformMemory, NULL,
+			              NULL);
+			memcpy(frame->display, session->display, sizeof(frame->display));
+			frame->frameNumber = frameNumber;
+			frame->state       = (u32)vm->cpu.state;
+		}
+		dchip8_shm_write_end(frame);
+
+		phaseTime[chip8phase_present] = dqnt_time_now_s();
+		updateTimeInS +=
+		    phaseTime[chip8phase_present] - phaseTime[chip8phase_update];
+		if (capturePath) dchip8_capture_writer_push(&captureWriter, vm->display);
+
+		if (vm->cpu.state == chip8state_fault)
+		{
+			fprintf(stderr, "Fault at frame %llu: %s at 0x%03X\n",
+			        (unsigned long long)frameNumber,
+			        dchip8_fault_string(vm->cpu.fault), vm->cpu.faultAddress);
+			break;
+		}
+		frameNumber++;
+
+		////////////////////////////////////////////////////////////////////////
+		// Frame Limiting
+		////////////////////////////////////////////////////////////////////////
+		phaseTime[chip8phase_wait] = dqnt_time_now_s();
+		if (framesPerSecond) frameTimeInS = (f32)dchip8_pacer_wait(&pacer);
+		phaseTime[chip8phase_count] = dqnt_time_now_s();
+
+		if (metricsPath)
+		{
+			// NOTE: Unpaced frames have no deadline, their time is measured
+			sample.frameTimeInS =
+			    framesPerSecond
+			        ? frameTimeInS
+			        : phaseTime[chip8phase_count] - phaseTime[chip8phase_input];
+			sample.numInstructions =
+			    (u32)(session->numInstructions - numInstructions);
+			sample.numTimerTicks = (u32)(session->numTimerTicks - numTimerTicks);
+			for (u32 phase = 0; phase < chip8phase_count; phase++)
+			{
+				sample.phaseTimeInS[phase] =
+				    phaseTime[phase + 1] - phaseTime[phase];
+			}
+
+			dchip8_metrics_record(&metrics, &sample);
+		}
+	}
+
+	fprintf(log, "Ran %llu frames, %.2f us a frame in the core",
+	        (unsigned long long)frameNumber,
+	        frameNumber ? (updateTimeInS * 1000000.0) / frameNumber : 0.0);
+	if (session->runAheadFrames)
+		fprintf(log, " running %u frames ahead", session->runAheadFrames);
+	fprintf(log, "\n");
+	if (metricsPath) dchip8_metrics_exporter_stop(&exporter);
+	if (speculator)
+	{
+		dchip8_speculator_stop(speculator);
+		fprintf(log, "Speculated on %llu key waits, %llu committed, %llu "
+		             "missed\n",
+		        (unsigned long long)speculator->numForks,
+		        (unsigned long long)speculator->numCommits,
+		        (unsigned long long)speculator->numMisses);
+		free(speculator);
+	}
+	if (printPacing && framesPerSecond) dchip8_pacer_print(&pacer, log);
+	if (capturePath)
+	{
+		dchip8_capture_writer_stop(&captureWriter);
+		fprintf(log, "Captured %llu bytes, %u frames dropped as gaps%s\n",
+		        (unsigned long long)captureWriter.numBytesWritten,
+		        captureWriter.numDropped,
+		        captureWriter.ioError ? ", write failed" : "");
+		if (!captureToStdout) fclose(captureFile);
+	}
+
+	if (frame != &localFrame) dchip8_shm_close(&shm, true);
+	free(platformMemory.permanentMem);
+	free(keys);
+	return 0;
+}
@@ -0,0 +1,316 @@
+// NOTE: Differential lockstep runner. Runs the same ROM and input stream on two
+// engines, compares a hash of the whole machine after every block and reports
+// the first instruction where they disagree with a dump of both machines.
+//
+// Usage: lockstep_dchip8 [-a engine] [-b engine] [-frames N] [-cycles N]
+//                        [-block N] [-keys file | -seed N] [-quirks mask]
+//                        [-full] rom
+//
+// -keys is a file of u16 little endian key bitmasks, one per frame. Without it
+// keys are pressed at random from -seed. -block 1 compares after every
+// instruction, larger blocks are faster and re-step the failing block one
+// instruction at a time to find the divergence. -quirks is a Chip8Quirk mask
+// so every quirk combination can be cross checked.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "dchip8_reference.cpp"
+#include "headless_dchip8.cpp"
+
+FILE_SCOPE const Chip8Engine LOCKSTEP_ENGINES[] = {
+    {"interpreter", dchip8_vm_run},
+    {"reference",   dchip8_reference_run},
+};
+
+FILE_SCOPE const Chip8Engine *lockstep_find_engine(const char *name)
+{
+	for (i32 i = 0; i < DQNT_ARRAY_COUNT(LOCKSTEP_ENGINES); i++)
+	{
+		if (dqnt_strcmp(LOCKSTEP_ENGINES[i].name, name) == 0)
+			return &LOCKSTEP_ENGINES[i];
+	}
+
+	return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// State Dump
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE void lockstep_dump_cpu(const char *label, const Chip8VM *vm)
+{
+	const Chip8CPU *cpu = &vm->cpu;
+	printf("[%s] hash %016llX\n", label, (unsigned long long)dchip8_vm_hash(vm));
+	printf("  PC %03X  I %03X  SP %X  DT %02X  ST %02X  state %d  fault %s@%03X\n",
+	       cpu->programCounter, cpu->I, cpu->stackPointer, cpu->delayTimer,
+	       cpu->soundTimer, cpu->state, dchip8_fault_string(cpu->fault),
+	       cpu->faultAddress);
+
+	printf("  V ");
+	for (i32 i = 0; i < DQNT_ARRAY_COUNT(cpu->registerArray); i++)
+		printf("%02X ", cpu->registerArray[i]);
+	printf("\n  S ");
+	for (i32 i = 0; i < DQNT_ARRAY_COUNT(cpu->stack); i++)
+		printf("%03X ", cpu->stack[i]);
+	printf("\n  rng %016llX %016llX\n",
+	       (unsigned long long)vm->pcgState.state[0],
+	       (unsigned long long)vm->pcgState.state[1]);
+}
+
+FILE_SCOPE void lockstep_dump_diff(const Chip8VM *a, const Chip8VM *b,
+                                   bool fullDump)
+{
+	lockstep_dump_cpu("a", a);
+	lockstep_dump_cpu("b", b);
+
+	printf("memory (a / b)%s\n", fullDump ? "" : ", differing lines only");
+	const i32 BYTES_PER_LINE = 16;
+	for (i32 line = 0; line < CHIP8_MEMORY_SIZE; line += BYTES_PER_LINE)
+	{
+		bool differs = (memcmp(&a->memory[line], &b->memory[line],
+		                       BYTES_PER_LINE) != 0);
+		if (!differs && !fullDump) continue;
+
+		for (i32 machine = 0; machine < 2; machine++)
+		{
+			const Chip8VM *vm = (machine == 0) ? a : b;
+			printf("  %c %03X:", (machine == 0) ? 'a' : 'b', line);
+			for (i32 i = 0; i < BYTES_PER_LINE; i++)
+			{
+				bool byteDiffers = (a->memory[line + i] != b->memory[line + i]);
+				printf("%c%02X", byteDiffers ? '*' : ' ', vm->memory[line + i]);
+			}
+			printf("\n");
+		}
+	}
+
+	printf("display (a | b)\n");
+	for (i32 row = 0; row < CHIP8_DISPLAY_HEIGHT; row++)
+	{
+		char line[(CHIP8_DISPLAY_WIDTH * 2) + 4] = {};
+		i32 index = 0;
+		for (i32 machine = 0; machine < 2; machine++)
+		{
+			u64 bits = (machine == 0) ? a->display[row] : b->display[row];
+			for (i32 x = 0; x < CHIP8_DISPLAY_WIDTH; x++)
+				line[index++] = ((bits >> ((CHIP8_DISPLAY_WIDTH - 1) - x)) & 1) ? '@' : '-';
+			if (machine == 0) line[index++] = '|';
+		}
+
+		bool rowDiffers = (a->display[row] != b->display[row]);
+		printf("  %c%s\n", rowDiffers ? '*' : ' ', line);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Lockstep
+////////////////////////////////////////////////////////////////////////////////
+typedef struct LockstepMachine
+{
+	const Chip8Engine *engine;
+	Chip8VM            vm;
+	Chip8VM            blockStart;
+} LockstepMachine;
+
+FILE_SCOPE inline bool lockstep_machines_agree(const LockstepMachine *a, u32 executedA,
+                                               const LockstepMachine *b, u32 executedB)
+{
+	bool result = (executedA == executedB) &&
+	              (dchip8_vm_hash(&a->vm) == dchip8_vm_hash(&b->vm));
+	return result;
+}
+
+// Re-run the block that diverged one instruction at a time from its start and
+// report the first instruction the engines disagree on.
+FILE_SCOPE void lockstep_report_divergence(LockstepMachine *a, LockstepMachine *b,
+                                           Chip8Controller controller,
+                                           u32 blockLength, u64 blockStartIndex,
+                                           u32 frame, bool fullDump)
+{
+	memcpy(&a->vm, &a->blockStart, sizeof(a->vm));
+	memcpy(&b->vm, &b->blockStart, sizeof(b->vm));
+
+	for (u32 step = 0; step < blockLength; step++)
+	{
+		Chip8VM before = a->vm;
+		u32 executedA  = a->engine->run(&a->vm, controller, 1);
+		u32 executedB  = b->engine->run(&b->vm, controller, 1);
+
+		if (!lockstep_machines_agree(a, executedA, b, executedB))
+		{
+			u16 pc     = before.cpu.programCounter;
+			u16 opcode = 0;
+			if (pc < CHIP8_MEMORY_SIZE - 1)
+				opcode = (u16)((before.memory[pc] << 8) | before.memory[pc + 1]);
+
+			printf("DIVERGED at instruction %llu (frame %u): %04X at %03X, "
+			       "executed a=%u b=%u\n",
+			       (unsigned long long)(blockStartIndex + step), frame, opcode,
+			       pc, executedA, executedB);
+			printf("state before the instruction\n");
+			lockstep_dump_cpu("before", &before);
+			printf("state after the instruction\n");
+			lockstep_dump_diff(&a->vm, &b->vm, fullDump);
+			return;
+		}
+
+		if (a->vm.cpu.state != chip8state_running) break;
+	}
+
+	// NOTE: Only reachable if an engine is not deterministic
+	printf("DIVERGED in block starting at instruction %llu (frame %u) but "
+	       "single stepping agreed\n",
+	       (unsigned long long)blockStartIndex, frame);
+	lockstep_dump_diff(&a->vm, &b->vm, fullDump);
+}
+
+int main(int argc, char **argv)
+{
+	const char *engineNameA = "interpreter";
+	const char *engineNameB = "reference";
+	const char *keysPath    = NULL;
+	u32 numFrames           = 600;
+	u32 cyclesPerFrame      = 15;
+	u32 blockLength         = 1;
+	u32 seed                = 1;
+	u32 quirks              = 0;
+	bool fullDump           = false;
+
+	i32 argIndex = 1;
+	for (; argIndex < argc; argIndex++)
+	{
+		const char *arg = argv[argIndex];
+		if (dqnt_strcmp(arg, "-full") == 0)
+		{
+			fullDump = true;
+			continue;
+		}
+
+		if (arg[0] != '-' || argIndex + 1 >= argc) break;
+		const char *value = argv[++argIndex];
+		if      (dqnt_strcmp(arg, "-a") == 0)      engineNameA    = value;
+		else if (dqnt_strcmp(arg, "-b") == 0)      engineNameB    = value;
+		else if (dqnt_strcmp(arg, "-frames") == 0) numFrames      = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-cycles") == 0) cyclesPerFrame = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-block") == 0)  blockLength    = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-keys") == 0)   keysPath       = value;
+		else if (dqnt_strcmp(arg, "-seed") == 0)   seed           = (u32)atoi(value);
+		else if (dqnt_strcmp(arg, "-quirks") == 0) quirks         = (u32)strtoul(value, NULL, 0);
+		else
+		{
+			fprintf(stderr, "lockstep: unknown option %s\n", arg);
+			return -1;
+		}
+	}
+
+	if (argIndex >= argc || blockLength == 0)
+	{
+		fprintf(stderr, "usage: lockstep_dchip8 [-a engine] [-b engine] "
+		                "[-frames N] [-cycles N] [-block N] "
+		                "[-keys file | -seed N] [-quirks mask] [-full] rom\n");
+		return -1;
+	}
+
+	LockstepMachine *a = (LockstepMachine *)calloc(1, sizeof(LockstepMachine));
+	LockstepMachine *b = (LockstepMachine *)calloc(1, sizeof(LockstepMachine));
+	a->engine = lockstep_find_engine(engineNameA);
+	b->engine = lockstep_find_engine(engineNameB);
+	if (!a->engine || !b->engine)
+	{
+		fprintf(stderr, "lockstep: unknown engine, available:");
+		for (i32 i = 0; i < DQNT_ARRAY_COUNT(LOCKSTEP_ENGINES); i++)
+			fprintf(stderr, " %s", LOCKSTEP_ENGINES[i].name);
+		fprintf(stderr, "\n");
+		return -1;
+	}
+
+	u32 romSize = 0;
+	u8 *rom     = headless_read_entire_file(argv[argIndex], &romSize);
+	if (!rom || !dchip8_vm_load_rom(&a->vm, rom, romSize))
+	{
+		fprintf(stderr, "lockstep: could not load %s\n", argv[argIndex]);
+		return -1;
+	}
+	a->vm.cpu.quirks = quirks;
+	memcpy(&b->vm, &a->vm, sizeof(b->vm));
+
+	u32 numKeyFrames = 0;
+	u8 *keyFrames    = NULL;
+	if (keysPath)
+	{
+		keyFrames = headless_read_entire_file(keysPath, &numKeyFrames);
+		if (!keyFrames)
+		{
+			fprintf(stderr, "lockstep: could not read %s\n", keysPath);
+			return -1;
+		}
+		numKeyFrames /= 2;
+	}
+
+	RandPCGState keyRng;
+	dqnt_rnd_pcg_seed(&keyRng, seed);
+	u16 keyMask = 0;
+
+	u64 instructionIndex = 0;
+	for (u32 frame = 0; frame < numFrames; frame++)
+	{
+		if (keyFrames)
+		{
+			keyMask = 0;
+			if (frame < numKeyFrames)
+				keyMask = (u16)(keyFrames[frame * 2] | (keyFrames[frame * 2 + 1] << 8));
+		}
+		else if ((dqnt_rnd_pcg_next(&keyRng) & 0x7) == 0)
+		{
+			// NOTE: Hold a random key (or none) for a few frames at a time
+			u32 key = dqnt_rnd_pcg_next(&keyRng) % (CHIP8_NUM_KEYS + 1);
+			keyMask = (key == CHIP8_NUM_KEYS) ? 0 : (u16)(1 << key);
+		}
+		Chip8Controller controller = dchip8_controller_from_bitmask(keyMask);
+
+		u32 cyclesLeft = cyclesPerFrame;
+		while (cyclesLeft > 0)
+		{
+			u32 cycles = DQNT_MATH_MIN(blockLength, cyclesLeft);
+			memcpy(&a->blockStart, &a->vm, sizeof(a->vm));
+			memcpy(&b->blockStart, &b->vm, sizeof(b->vm));
+
+			u32 executedA = a->engine->run(&a->vm, controller, cycles);
+			u32 executedB = b->engine->run(&b->vm, controller, cycles);
+			if (!lockstep_machines_agree(a, executedA, b, executedB))
+			{
+				lockstep_report_divergence(a, b, controller, cycles,
+				                           instructionIndex, frame, fullDump);
+				return 1;
+			}
+
+			// NOTE: A frame ends early when the machine blocks on Fx0A, it
+			// must not be released until the next frame's input
+			instructionIndex += executedA;
+			cyclesLeft -= cycles;
+			if (a->vm.cpu.state != chip8state_running) break;
+		}
+
+		dchip8_vm_tick_timers(&a->vm);
+		dchip8_vm_tick_timers(&b->vm);
+
+		if (a->vm.cpu.state == chip8state_fault)
+		{
+			printf("both engines faulted with %s at %03X\n",
+			       dchip8_fault_string(a->vm.cpu.fault), a->vm.cpu.faultAddress);
+			break;
+		}
+	}
+
+	printf("agreed: %s vs %s, %llu instructions, final hash %016llX\n",
+	       a->engine->name, b->engine->name,
+	       (unsigned long long)instructionIndex,
+	       (unsigned long long)dchip8_vm_hash(&a->vm));
+	return 0;
+}
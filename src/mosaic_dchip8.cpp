@@ -0,0 +1,237 @@
+// NOTE: Benchmark for the mosaic compositor, see dchip8_mosaic.h. Runs a wall
+// of machines, composites their displays every frame and reports the time per
+// composite against redrawing every tile. At the end every tile is checked
+// against the scalar kernel drawing its machine's display, so a tile the dirty
+// check missed shows up as a mismatch.
+//
+// Usage: mosaic_dchip8 [-tiles N] [-columns N] [-scale N] [-gap N] [-labels]
+//                      [-frames N] [-ppm file] rom...
+//
+// Tile N runs rom N modulo the number of ROMs with its own random seed and
+// holds a different key for 8 frames every 16. -ppm writes the final image as
+// a binary PPM.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "headless_dchip8.cpp"
+#include "dchip8_scale.cpp"
+#include "dchip8_mosaic.cpp"
+
+#define MOSAIC_MAX_ROMS 64
+
+FILE_SCOPE bool mosaic_write_ppm(const char *path, const u32 *pixels, u32 width,
+                                 u32 height)
+{
+	FILE *file = fopen(path, "wb");
+	if (!file) return false;
+
+	fprintf(file, "P6\n%u %u\n255\n", width, height);
+	for (u32 i = 0; i < width * height; i++)
+	{
+		u8 rgb[3] = {(u8)(pixels[i] >> 16), (u8)(pixels[i] >> 8), (u8)pixels[i]};
+		fwrite(rgb, 1, sizeof(rgb), file);
+	}
+
+	bool result = (ferror(file) == 0);
+	fclose(file);
+	return result;
+}
+
+// NOTE: Return the number of tiles that don't match their machine's display
+FILE_SCOPE u32 mosaic_check(const Chip8Mosaic *mosaic, const Chip8VM *machines)
+{
+	u32 *reference = (u32 *)malloc((size_t)mosaic->tileWidth *
+	                               mosaic->tileHeight * sizeof(u32));
+	if (!reference) return mosaic->layout.numTiles;
+
+	Chip8ScaleTarget target = {};
+	target.memory           = reference;
+	target.pitch            = mosaic->tileWidth;
+	target.scaleX           = mosaic->layout.scale;
+	target.scaleY           = mosaic->layout.scale;
+	target.onColour         = mosaic->layout.onColour;
+	target.offColour        = mosaic->layout.offColour;
+
+	u32 result = 0;
+	for (u32 index = 0; index < mosaic->layout.numTiles; index++)
+	{
+		dchip8_scale_rows(machines[index].display, &target,
+		                  chip8scalekernel_scalar, 0, mosaic->tileHeight);
+
+		const u32 *tile = dchip8_mosaic_tile(mosaic, index);
+		for (u32 y = 0; y < mosaic->tileHeight; y++)
+		{
+			const u32 *row = tile + ((size_t)y * mosaic->width);
+			if (memcmp(row, reference + ((size_t)y * mosaic->tileWidth),
+			           mosaic->tileWidth * sizeof(u32)) != 0)
+			{
+				result++;
+				break;
+			}
+		}
+	}
+
+	free(reference);
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	Chip8MosaicLayout layout = {};
+	layout.numTiles          = 256;
+	layout.scale             = 2;
+	layout.gap               = 4;
+	layout.onColour          = 0xFFFFFFFF;
+	layout.offColour         = 0xFF000000;
+	layout.backgroundColour  = 0xFF303030;
+	layout.labelColour       = 0xFFFFC000;
+
+	u32 numFrames   = 600;
+	const char *ppm = NULL;
+	const char *roms[MOSAIC_MAX_ROMS];
+	u32 numRoms     = 0;
+
+	for (i32 i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		bool hasValue   = (i + 1 < argc);
+		if      (hasValue && dqnt_strcmp(arg, "-tiles") == 0)   layout.numTiles = (u32)atoi(argv[++i]);
+		else if (hasValue && dqnt_strcmp(arg, "-columns") == 0) layout.columns  = (u32)atoi(argv[++i]);
+		else if (hasValue && dqnt_strcmp(arg, "-scale") == 0)   layout.scale    = (u32)atoi(argv[++i]);
+		else if (hasValue && dqnt_strcmp(arg, "-gap") == 0)     layout.gap      = (u32)atoi(argv[++i]);
+		else if (hasValue && dqnt_strcmp(arg, "-frames") == 0)  numFrames       = (u32)atoi(argv[++i]);
+		else if (hasValue && dqnt_strcmp(arg, "-ppm") == 0)     ppm             = argv[++i];
+		else if (dqnt_strcmp(arg, "-labels") == 0)              layout.labels   = true;
+		else if (numRoms < MOSAIC_MAX_ROMS)                     roms[numRoms++] = arg;
+	}
+
+	size_t memorySize = dchip8_mosaic_memory_size(&layout);
+	if (numRoms == 0 || memorySize == 0)
+	{
+		fprintf(stderr, "Usage: mosaic_dchip8 [-tiles N] [-columns N] "
+		                "[-scale N] [-gap N] [-labels] [-frames N] "
+		                "[-ppm file] rom...\n");
+		return 1;
+	}
+
+	Chip8VM *bootVMs  = (Chip8VM *)calloc(numRoms, sizeof(Chip8VM));
+	Chip8VM *machines = (Chip8VM *)calloc(layout.numTiles, sizeof(Chip8VM));
+	const u64 **displays =
+	    (const u64 **)calloc(layout.numTiles, sizeof(*displays));
+	void *memory = malloc(memorySize);
+	if (!bootVMs || !machines || !displays || !memory) return 1;
+
+	for (u32 i = 0; i < numRoms; i++)
+	{
+		u32 romSize = 0;
+		u8 *romData = headless_read_entire_file(roms[i], &romSize);
+		if (!romData || !dchip8_vm_load_rom(&bootVMs[i], romData, romSize))
+		{
+			fprintf(stderr, "Could not load rom: %s\n", roms[i]);
+			return 1;
+		}
+		free(romData);
+	}
+
+	for (u32 index = 0; index < layout.numTiles; index++)
+	{
+		memcpy(&machines[index], &bootVMs[index % numRoms], sizeof(Chip8VM));
+		dqnt_rnd_pcg_seed(&machines[index].pcgState, index);
+		displays[index] = machines[index].display;
+	}
+
+	Chip8Arena arena = {};
+	dchip8_arena_init(&arena, memory, memorySize);
+	Chip8Mosaic mosaic = {};
+	if (!dchip8_mosaic_init(&mosaic, &layout, &arena))
+	{
+		fprintf(stderr, "Could not make the mosaic\n");
+		return 1;
+	}
+
+	printf("%u tiles, %ux%u grid at %ux, %ux%u image, kernel %s\n",
+	       layout.numTiles, mosaic.columns, mosaic.rows, layout.scale,
+	       mosaic.width, mosaic.height, dchip8_scale_kernel_string(mosaic.kernel));
+
+	// NOTE: Every tile is also drawn into an image of its own each frame, the
+	// cost the dirty check saves, without hiding anything from mosaic_check
+	size_t numPixels = (size_t)mosaic.width * mosaic.height;
+	u32 *everyTile   = (u32 *)malloc(numPixels * sizeof(u32));
+	if (!everyTile) return 1;
+
+	f64 compositeTimeInS      = 0;
+	f64 worstCompositeTimeInS = 0;
+	f64 everyTileTimeInS      = 0;
+	u64 numRedrawn            = 0;
+	for (u32 frame = 0; frame < numFrames; frame++)
+	{
+		for (u32 index = 0; index < layout.numTiles; index++)
+		{
+			Chip8VM *vm = &machines[index];
+			u16 keys = ((frame / 8) & 1) ? (u16)(1 << ((index + frame) % 16)) : 0;
+			dchip8_vm_run(vm, dchip8_controller_from_bitmask(keys),
+			              CHIP8_DEFAULT_CYCLES_PER_FRAME);
+			dchip8_vm_tick_timers(vm);
+		}
+
+		f64 startInS = dqnt_time_now_s();
+		numRedrawn += dchip8_mosaic_composite(&mosaic, displays);
+		f64 elapsedInS        = dqnt_time_now_s() - startInS;
+		compositeTimeInS     += elapsedInS;
+		worstCompositeTimeInS = DQNT_MATH_MAX(worstCompositeTimeInS, elapsedInS);
+
+		startInS = dqnt_time_now_s();
+		for (u32 index = 0; index < layout.numTiles; index++)
+		{
+			Chip8ScaleTarget target = {};
+			target.memory = everyTile + (dchip8_mosaic_tile(&mosaic, index) -
+			                             mosaic.pixels);
+			target.pitch     = mosaic.width;
+			target.scaleX    = layout.scale;
+			target.scaleY    = layout.scale;
+			target.onColour  = layout.onColour;
+			target.offColour = layout.offColour;
+			dchip8_scale_rows(displays[index], &target, mosaic.kernel, 0,
+			                  mosaic.tileHeight);
+		}
+		everyTileTimeInS += dqnt_time_now_s() - startInS;
+	}
+
+	if (numFrames > 0)
+	{
+		printf("composite   %.4f ms/frame avg  %.4f ms worst  %.1f tiles redrawn "
+		       "avg\n",
+		       compositeTimeInS * 1000.0 / numFrames,
+		       worstCompositeTimeInS * 1000.0, (f64)numRedrawn / numFrames);
+		printf("every tile  %.4f ms/frame avg\n",
+		       everyTileTimeInS * 1000.0 / numFrames);
+	}
+
+	i32 result        = 0;
+	u32 numMismatched = mosaic_check(&mosaic, machines);
+	if (numMismatched > 0)
+	{
+		fprintf(stderr, "%u tiles don't match their machine\n", numMismatched);
+		result = 1;
+	}
+
+	if (ppm && !mosaic_write_ppm(ppm, mosaic.pixels, mosaic.width, mosaic.height))
+	{
+		fprintf(stderr, "Could not write %s\n", ppm);
+		result = 1;
+	}
+
+	free(everyTile);
+	free(memory);
+	free(displays);
+	free(machines);
+	free(bootVMs);
+	return result;
+}
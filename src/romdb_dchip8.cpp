@@ -0,0 +1,399 @@
+// NOTE: Builds and inspects the ROM database index that the platform layers map
+// at startup, see Chip8RomDBHeader in dchip8.h.
+//
+// Usage: romdb_dchip8 build manifest out.idx
+//        romdb_dchip8 lookup index.idx rom...
+//        romdb_dchip8 dump index.idx
+//        romdb_dchip8 hash rom...
+//
+// The manifest is text, one ROM a line, '#' starts a comment
+//   <rom path | 0xHASH> [cycles=N] [quirks=q,q,..] [keys=KEYS] [name=text]
+//
+// quirks are Chip8Quirk names without the prefix (shift_vy, load_store_inc_i,
+// jump_vx, logic_vf_reset, clip_sprites), a profile (cosmac, schip, xochip) or
+// a number. keys is 16 characters, the keyboard key for hex keys 0 to F, from
+// 1234qwerasdfzxcv, ^_<> for the arrows or . for unmapped. The default layout
+// is x123qweasdzc4rfv. name takes the rest of the line.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "headless_dchip8.cpp"
+
+typedef struct RomDBQuirkName
+{
+	const char *name;
+	u32         quirks;
+} RomDBQuirkName;
+
+FILE_SCOPE const RomDBQuirkName ROMDB_QUIRK_NAMES[] = {
+    {"shift_vy",         chip8quirk_shift_vy},
+    {"load_store_inc_i", chip8quirk_load_store_inc_i},
+    {"jump_vx",          chip8quirk_jump_vx},
+    {"logic_vf_reset",   chip8quirk_logic_vf_reset},
+    {"clip_sprites",     chip8quirk_clip_sprites},
+
+    // NOTE: Profiles for the common interpreter families
+    {"cosmac", chip8quirk_shift_vy | chip8quirk_load_store_inc_i |
+               chip8quirk_logic_vf_reset | chip8quirk_clip_sprites},
+    {"schip",  chip8quirk_jump_vx | chip8quirk_clip_sprites},
+    {"xochip", chip8quirk_shift_vy | chip8quirk_load_store_inc_i},
+};
+
+typedef struct RomDBKeyName
+{
+	char     character;
+	enum Key key;
+} RomDBKeyName;
+
+FILE_SCOPE const RomDBKeyName ROMDB_KEY_NAMES[] = {
+    {'1', key_1}, {'2', key_2}, {'3', key_3}, {'4', key_4},
+    {'q', key_q}, {'w', key_w}, {'e', key_e}, {'r', key_r},
+    {'a', key_a}, {'s', key_s}, {'d', key_d}, {'f', key_f},
+    {'z', key_z}, {'x', key_x}, {'c', key_c}, {'v', key_v},
+    {'^', key_up}, {'_', key_down}, {'<', key_left}, {'>', key_right},
+};
+
+FILE_SCOPE bool romdb_parse_quirks(const char *text, u32 *quirks)
+{
+	*quirks = 0;
+	char buffer[256];
+	snprintf(buffer, sizeof(buffer), "%s", text);
+
+	for (char *token = strtok(buffer, ","); token; token = strtok(NULL, ","))
+	{
+		if (token[0] >= '0' && token[0] <= '9')
+		{
+			*quirks |= (u32)strtoul(token, NULL, 0);
+			continue;
+		}
+
+		bool found = false;
+		for (i32 i = 0; i < DQNT_ARRAY_COUNT(ROMDB_QUIRK_NAMES); i++)
+		{
+			if (dqnt_strcmp(token, ROMDB_QUIRK_NAMES[i].name) == 0)
+			{
+				*quirks |= ROMDB_QUIRK_NAMES[i].quirks;
+				found = true;
+				break;
+			}
+		}
+		if (!found) return false;
+	}
+
+	return (*quirks & ~chip8quirk_all) == 0;
+}
+
+FILE_SCOPE bool romdb_parse_keymap(const char *text, u8 *keymap)
+{
+	if (strlen(text) != CHIP8_NUM_KEYS) return false;
+
+	for (i32 hexKey = 0; hexKey < CHIP8_NUM_KEYS; hexKey++)
+	{
+		keymap[hexKey] = CHIP8_KEYMAP_UNMAPPED;
+		if (text[hexKey] == '.') continue;
+
+		for (i32 i = 0; i < DQNT_ARRAY_COUNT(ROMDB_KEY_NAMES); i++)
+		{
+			if (ROMDB_KEY_NAMES[i].character == text[hexKey])
+				keymap[hexKey] = (u8)ROMDB_KEY_NAMES[i].key;
+		}
+		if (keymap[hexKey] == CHIP8_KEYMAP_UNMAPPED) return false;
+	}
+
+	return true;
+}
+
+FILE_SCOPE void romdb_format_keymap(const u8 *keymap, char *out)
+{
+	for (i32 hexKey = 0; hexKey < CHIP8_NUM_KEYS; hexKey++)
+	{
+		out[hexKey] = '.';
+		for (i32 i = 0; i < DQNT_ARRAY_COUNT(ROMDB_KEY_NAMES); i++)
+		{
+			if ((u8)ROMDB_KEY_NAMES[i].key == keymap[hexKey])
+				out[hexKey] = ROMDB_KEY_NAMES[i].character;
+		}
+	}
+	out[CHIP8_NUM_KEYS] = 0;
+}
+
+FILE_SCOPE void romdb_print_entry(const Chip8RomDBEntry *entry)
+{
+	char keys[CHIP8_NUM_KEYS + 1];
+	romdb_format_keymap(entry->settings.keymap, keys);
+	printf("0x%016llX cycles=%u quirks=0x%X keys=%s name=%s\n",
+	       (unsigned long long)entry->romHash, entry->settings.cyclesPerFrame,
+	       entry->settings.quirks, keys, entry->name);
+}
+
+// NOTE: Names longer than the entry are truncated
+FILE_SCOPE void romdb_set_name(Chip8RomDBEntry *entry, const char *name)
+{
+	size_t length = DQNT_MATH_MIN(strlen(name), sizeof(entry->name) - 1);
+	memcpy(entry->name, name, length);
+	entry->name[length] = 0;
+}
+
+FILE_SCOPE bool romdb_hash_rom_file(const char *path, u64 *romHash)
+{
+	u32 romSize = 0;
+	u8 *rom     = headless_read_entire_file(path, &romSize);
+	if (!rom) return false;
+
+	*romHash = dchip8_rom_hash(rom, romSize);
+	free(rom);
+	return true;
+}
+
+FILE_SCOPE bool romdb_open_index(Chip8RomDB *db, const char *path)
+{
+	wchar_t pathW[260] = {};
+	if (mbstowcs(pathW, path, DQNT_ARRAY_COUNT(pathW) - 1) == (size_t)-1)
+		return false;
+
+	return dchip8_romdb_open(db, pathW);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Build
+////////////////////////////////////////////////////////////////////////////////
+FILE_SCOPE i32 romdb_build(const char *manifestPath, const char *outPath)
+{
+	FILE *manifest = fopen(manifestPath, "rb");
+	if (!manifest)
+	{
+		fprintf(stderr, "romdb: could not open %s\n", manifestPath);
+		return -1;
+	}
+
+	u32 numEntries = 0;
+	u32 maxEntries = 64;
+	Chip8RomDBEntry *entries =
+	    (Chip8RomDBEntry *)malloc(maxEntries * sizeof(Chip8RomDBEntry));
+
+	char line[1024];
+	i32 lineNum = 0;
+	while (fgets(line, sizeof(line), manifest))
+	{
+		lineNum++;
+		char *comment = strchr(line, '#');
+		if (comment) *comment = 0;
+
+		Chip8RomDBEntry entry = {};
+		entry.settings        = dchip8_rom_settings_default();
+
+		char *cursor = line;
+		bool hasRom  = false;
+		bool valid   = true;
+		while (valid)
+		{
+			while (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' ||
+			       *cursor == '\n')
+				cursor++;
+			if (*cursor == 0) break;
+
+			// NOTE: name takes the rest of the line, trailing space trimmed
+			if (strncmp(cursor, "name=", 5) == 0)
+			{
+				char *end = cursor + strlen(cursor);
+				while (end > cursor + 5 && (end[-1] == ' ' || end[-1] == '\t' ||
+				                            end[-1] == '\r' || end[-1] == '\n'))
+					*--end = 0;
+				romdb_set_name(&entry, cursor + 5);
+				break;
+			}
+
+			char *token = cursor;
+			while (*cursor && *cursor != ' ' && *cursor != '\t' &&
+			       *cursor != '\r' && *cursor != '\n')
+				cursor++;
+			if (*cursor) *cursor++ = 0;
+
+			bool isRomToken = !hasRom;
+			if (isRomToken)
+			{
+				hasRom = true;
+				if (token[0] == '0' && (token[1] == 'x' || token[1] == 'X'))
+					entry.romHash = strtoull(token, NULL, 16);
+				else if (!romdb_hash_rom_file(token, &entry.romHash))
+				{
+					fprintf(stderr, "romdb: %s:%d could not read rom %s\n",
+					        manifestPath, lineNum, token);
+					valid = false;
+				}
+				else if (entry.name[0] == 0)
+				{
+					// NOTE: Default the name to the file name
+					const char *fileName = token;
+					for (const char *c = token; *c; c++)
+						if (*c == '/' || *c == '\\') fileName = c + 1;
+					romdb_set_name(&entry, fileName);
+				}
+			}
+			else if (strncmp(token, "cycles=", 7) == 0)
+			{
+				entry.settings.cyclesPerFrame = (u32)atoi(token + 7);
+				valid = entry.settings.cyclesPerFrame > 0;
+			}
+			else if (strncmp(token, "quirks=", 7) == 0)
+			{
+				valid = romdb_parse_quirks(token + 7, &entry.settings.quirks);
+			}
+			else if (strncmp(token, "keys=", 5) == 0)
+			{
+				valid = romdb_parse_keymap(token + 5, entry.settings.keymap);
+			}
+			else
+			{
+				valid = false;
+			}
+
+			if (!valid && !isRomToken)
+				fprintf(stderr, "romdb: %s:%d invalid field %s\n", manifestPath,
+				        lineNum, token);
+		}
+
+		if (!valid)
+		{
+			fclose(manifest);
+			free(entries);
+			return -1;
+		}
+		if (!hasRom) continue;
+
+		if (entry.romHash == 0)
+		{
+			fprintf(stderr, "romdb: %s:%d hash can not be 0\n", manifestPath,
+			        lineNum);
+			fclose(manifest);
+			free(entries);
+			return -1;
+		}
+
+		if (numEntries == maxEntries)
+		{
+			maxEntries *= 2;
+			entries = (Chip8RomDBEntry *)realloc(
+			    entries, maxEntries * sizeof(Chip8RomDBEntry));
+		}
+		entries[numEntries++] = entry;
+	}
+	fclose(manifest);
+
+	// NOTE: Keep the table at most half full so probes stay short, and always
+	// leave an empty slot so a miss terminates
+	u32 numSlots = 16;
+	while (numSlots < numEntries * 2) numSlots *= 2;
+
+	u32 indexSize = sizeof(Chip8RomDBHeader) + (numSlots * sizeof(Chip8RomDBEntry));
+	u8 *index     = (u8 *)calloc(1, indexSize);
+	Chip8RomDBHeader *header = (Chip8RomDBHeader *)index;
+	Chip8RomDBEntry *slots   = (Chip8RomDBEntry *)(header + 1);
+	header->magic            = CHIP8_ROMDB_MAGIC;
+	header->version          = CHIP8_ROMDB_VERSION;
+	header->numSlots         = numSlots;
+
+	for (u32 i = 0; i < numEntries; i++)
+	{
+		const Chip8RomDBEntry *entry = &entries[i];
+		u32 mask = numSlots - 1;
+		u32 slot = (u32)entry->romHash & mask;
+		while (slots[slot].romHash != 0 && slots[slot].romHash != entry->romHash)
+			slot = (slot + 1) & mask;
+
+		if (slots[slot].romHash == entry->romHash)
+		{
+			fprintf(stderr, "romdb: 0x%016llX listed twice, using the last\n",
+			        (unsigned long long)entry->romHash);
+		}
+		else
+		{
+			header->numEntries++;
+		}
+		slots[slot] = *entry;
+	}
+
+	bool written = headless_write_entire_file(outPath, index, indexSize);
+	if (written)
+		printf("romdb: wrote %u roms in %u slots to %s\n", header->numEntries,
+		       numSlots, outPath);
+	else
+		fprintf(stderr, "romdb: could not write %s\n", outPath);
+
+	free(index);
+	free(entries);
+	return written ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *command = (argc >= 2) ? argv[1] : "";
+	if (dqnt_strcmp(command, "build") == 0 && argc == 4)
+	{
+		return romdb_build(argv[2], argv[3]);
+	}
+	else if (dqnt_strcmp(command, "hash") == 0 && argc >= 3)
+	{
+		for (i32 i = 2; i < argc; i++)
+		{
+			u64 romHash = 0;
+			if (!romdb_hash_rom_file(argv[i], &romHash))
+			{
+				fprintf(stderr, "romdb: could not read %s\n", argv[i]);
+				return -1;
+			}
+			printf("0x%016llX %s\n", (unsigned long long)romHash, argv[i]);
+		}
+		return 0;
+	}
+	else if ((dqnt_strcmp(command, "lookup") == 0 && argc >= 4) ||
+	         (dqnt_strcmp(command, "dump") == 0 && argc == 3))
+	{
+		Chip8RomDB db = {};
+		if (!romdb_open_index(&db, argv[2]))
+		{
+			fprintf(stderr, "romdb: %s is not a valid rom database\n", argv[2]);
+			return -1;
+		}
+
+		i32 result = 0;
+		if (dqnt_strcmp(command, "dump") == 0)
+		{
+			for (u32 slot = 0; slot < db.numSlots; slot++)
+				if (db.entries[slot].romHash) romdb_print_entry(&db.entries[slot]);
+		}
+		else
+		{
+			for (i32 i = 3; i < argc; i++)
+			{
+				u64 romHash = 0;
+				if (!romdb_hash_rom_file(argv[i], &romHash))
+				{
+					fprintf(stderr, "romdb: could not read %s\n", argv[i]);
+					result = -1;
+					continue;
+				}
+
+				const Chip8RomDBEntry *entry = dchip8_romdb_find(&db, romHash);
+				if (entry) romdb_print_entry(entry);
+				else       printf("0x%016llX not found\n", (unsigned long long)romHash);
+			}
+		}
+
+		dchip8_romdb_close(&db);
+		return result;
+	}
+
+	fprintf(stderr, "usage: romdb_dchip8 build manifest out.idx\n"
+	                "       romdb_dchip8 lookup index.idx rom...\n"
+	                "       romdb_dchip8 dump index.idx\n"
+	                "       romdb_dchip8 hash rom...\n");
+	return -1;
+}
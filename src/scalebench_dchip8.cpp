@@ -0,0 +1,215 @@
+// NOTE: Benchmark for the software scaler. Runs a ROM and presents every frame
+// at each scale through every kernel the CPU supports, checks the SIMD kernels
+// against the scalar one and reports the time per frame.
+//
+// Usage: scalebench_dchip8 [-scale N] [-threads N] [-frames N] [-cycles N]
+//                          [-phosphor ms] [-ppm file] rom
+//
+// -scale 0 runs 1x, what a window narrower than the display gets, and the
+// Video menu presets 4x, 8x, 12x and 16x. -phosphor runs the persistence
+// filter with the given half life before scaling, the time reported includes
+// it. -ppm writes the last frame at the last scale as a binary PPM.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "headless_dchip8.cpp"
+#include "dchip8_scale.cpp"
+#include "dchip8_phosphor.cpp"
+
+#define SCALEBENCH_MAX_FRAMES 4096
+// Pixels past the end of the output that must still hold their canary after
+// presenting, so a kernel writing past the image fails without a sanitizer
+#define SCALEBENCH_GUARD_PIXELS 16
+#define SCALEBENCH_CANARY       0xDEADBEEF
+
+FILE_SCOPE bool scalebench_write_ppm(const char *path, const u32 *pixels,
+                                     u32 width, u32 height)
+{
+	FILE *file = fopen(path, "wb");
+	if (!file) return false;
+
+	fprintf(file, "P6\n%u %u\n255\n", width, height);
+	for (u32 i = 0; i < width * height; i++)
+	{
+		u8 rgb[3] = {(u8)(pixels[i] >> 16), (u8)(pixels[i] >> 8), (u8)pixels[i]};
+		fwrite(rgb, 1, sizeof(rgb), file);
+	}
+
+	bool result = (ferror(file) == 0);
+	fclose(file);
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	u32 scale          = 0;
+	u32 numThreads     = 0;
+	u32 numFrames      = 600;
+	u32 cyclesPerFrame = CHIP8_DEFAULT_CYCLES_PER_FRAME;
+	u32 phosphorMs     = 0;
+	const char *ppm    = NULL;
+	const char *rom    = NULL;
+
+	for (i32 i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		bool hasValue   = (i + 1 < argc);
+		if      (hasValue && dqnt_strcmp(arg, "-scale") == 0)    scale          = (u32)atoi(argv[++i]);
+		else if (hasValue && dqnt_strcmp(arg, "-threads") == 0)  numThreads     = (u32)atoi(argv[++i]);
+		else if (hasValue && dqnt_strcmp(arg, "-frames") == 0)   numFrames      = (u32)atoi(argv[++i]);
+		else if (hasValue && dqnt_strcmp(arg, "-cycles") == 0)   cyclesPerFrame = (u32)atoi(argv[++i]);
+		else if (hasValue && dqnt_strcmp(arg, "-phosphor") == 0) phosphorMs     = (u32)atoi(argv[++i]);
+		else if (hasValue && dqnt_strcmp(arg, "-ppm") == 0)      ppm            = argv[++i];
+		else rom = arg;
+	}
+
+	if (!rom || numFrames == 0)
+	{
+		fprintf(stderr, "Usage: scalebench_dchip8 [-scale N] [-threads N] "
+		                "[-frames N] [-cycles N] [-phosphor ms] [-ppm file] "
+		                "rom\n");
+		return 1;
+	}
+	numFrames = DQNT_MATH_MIN(numFrames, SCALEBENCH_MAX_FRAMES);
+
+	u32 romSize = 0;
+	u8 *romData = headless_read_entire_file(rom, &romSize);
+	Chip8VM *vm = (Chip8VM *)calloc(1, sizeof(Chip8VM));
+	if (!romData || !vm || !dchip8_vm_load_rom(vm, romData, romSize))
+	{
+		fprintf(stderr, "Could not load rom: %s\n", rom);
+		return 1;
+	}
+	free(romData);
+
+	// NOTE: Record the frames up front so only presenting is timed
+	u64 *frames = (u64 *)malloc(numFrames * sizeof(vm->display));
+	if (!frames) return 1;
+	Chip8Controller controller = {};
+	for (u32 i = 0; i < numFrames; i++)
+	{
+		if (vm->cpu.state != chip8state_fault)
+		{
+			dchip8_vm_run(vm, controller, cyclesPerFrame);
+			dchip8_vm_update_timers(vm, 1 / 60.0f);
+		}
+		memcpy(frames + (i * CHIP8_DISPLAY_HEIGHT), vm->display,
+		       sizeof(vm->display));
+	}
+
+	Chip8Phosphor *phosphor = NULL;
+	if (phosphorMs)
+	{
+		phosphor = (Chip8Phosphor *)malloc(sizeof(Chip8Phosphor));
+		if (!phosphor) return 1;
+	}
+
+	Chip8Scaler scaler = {};
+	dchip8_scaler_start(&scaler, numThreads);
+	enum Chip8ScaleKernel bestKernel = scaler.kernel;
+	printf("%u frames, %u threads, best kernel %s\n", numFrames,
+	       scaler.numWorkers + 1, dchip8_scale_kernel_string(bestKernel));
+
+	const u32 PRESETS[] = {1, 4, 8, 12, 16};
+	u32 numScales       = scale ? 1 : DQNT_ARRAY_COUNT(PRESETS);
+
+	bool mismatch = false;
+	for (u32 scaleIndex = 0; scaleIndex < numScales; scaleIndex++)
+	{
+		u32 s      = scale ? scale : PRESETS[scaleIndex];
+		u32 width  = CHIP8_DISPLAY_WIDTH * s;
+		u32 height = CHIP8_DISPLAY_HEIGHT * s;
+
+		u32 *reference = (u32 *)malloc((size_t)width * height * sizeof(u32));
+		u32 *output    = (u32 *)malloc(
+		    ((size_t)width * height + SCALEBENCH_GUARD_PIXELS) * sizeof(u32));
+		if (!reference || !output) return 1;
+
+		u32 *guard = output + ((size_t)width * height);
+		for (u32 i = 0; i < SCALEBENCH_GUARD_PIXELS; i++)
+			guard[i] = SCALEBENCH_CANARY;
+
+		Chip8ScaleTarget target = {};
+		target.memory           = output;
+		target.pitch            = width;
+		target.scaleX           = s;
+		target.scaleY           = s;
+		target.onColour         = 0xFFFFFFFF;
+		target.offColour        = 0xFF000000;
+
+		Chip8ScaleTarget referenceTarget = target;
+		referenceTarget.memory           = reference;
+
+		for (u32 kernel = 0; kernel <= (u32)bestKernel; kernel++)
+		{
+			scaler.kernel = (enum Chip8ScaleKernel)kernel;
+			if (phosphor)
+				dchip8_phosphor_init(phosphor, phosphorMs / 1000.0f,
+				                     target.onColour, target.offColour);
+
+			f64 worstMs = 0;
+			f64 startS  = dqnt_time_now_s();
+			for (u32 i = 0; i < numFrames; i++)
+			{
+				f64 frameStartS    = dqnt_time_now_s();
+				const u64 *display = frames + (i * CHIP8_DISPLAY_HEIGHT);
+				if (phosphor)
+				{
+					dchip8_phosphor_update(phosphor, display, 1 / 60.0f);
+					dchip8_scaler_present_argb(&scaler, phosphor->pixels,
+					                           &target);
+				}
+				else
+				{
+					dchip8_scaler_present(&scaler, display, &target);
+				}
+				f64 frameMs = (dqnt_time_now_s() - frameStartS) * 1000.0;
+				if (frameMs > worstMs) worstMs = frameMs;
+			}
+			f64 totalMs = (dqnt_time_now_s() - startS) * 1000.0;
+
+			// NOTE: Only the last frame is compared, but every pixel of it
+			const u64 *last = frames + ((numFrames - 1) * CHIP8_DISPLAY_HEIGHT);
+			if (phosphor)
+				dchip8_scale_rows_argb(phosphor->pixels, &referenceTarget,
+				                       chip8scalekernel_scalar, 0, height);
+			else
+				dchip8_scale_rows(last, &referenceTarget,
+				                  chip8scalekernel_scalar, 0, height);
+			bool same = memcmp(reference, output,
+			                   (size_t)width * height * sizeof(u32)) == 0;
+			bool overrun = false;
+			for (u32 i = 0; i < SCALEBENCH_GUARD_PIXELS; i++)
+				overrun |= (guard[i] != SCALEBENCH_CANARY);
+			if (!same || overrun) mismatch = true;
+
+			printf("%2ux %4ux%-4u %-6s %7.4f ms/frame avg %7.4f ms worst%s%s\n",
+			       s, width, height,
+			       dchip8_scale_kernel_string((enum Chip8ScaleKernel)kernel),
+			       totalMs / numFrames, worstMs, same ? "" : " MISMATCH",
+			       overrun ? " OVERRUN" : "");
+		}
+
+		if (ppm && scaleIndex + 1 == numScales)
+		{
+			if (!scalebench_write_ppm(ppm, output, width, height))
+				fprintf(stderr, "Could not write ppm: %s\n", ppm);
+		}
+
+		free(reference);
+		free(output);
+	}
+
+	dchip8_scaler_stop(&scaler);
+	free(phosphor);
+	free(frames);
+	free(vm);
+	return mismatch ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+// NOTE: Viewer for a framebuffer exported by linux_dchip8 -shm/-memfd. Maps the
+// segment read only and draws every new frame to the terminal. The emulator is
+// never blocked, torn reads are detected by the seqlock and retried.
+//
+// Usage: shmview_dchip8 [-once] [-hz N] name|path
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8_shm.cpp"
+
+FILE_SCOPE void shmview_print_frame(const u64 *display, u64 frameNumber,
+                                    u32 state, u32 numRetries)
+{
+	// NOTE: Two rows per character cell using the half block glyphs
+	LOCAL_PERSIST const char *const GLYPHS[4] = {" ", "\xE2\x96\x80",
+	                                              "\xE2\x96\x84",
+	                                              "\xE2\x96\x88"};
+
+	printf("\x1B[H");
+	for (i32 y = 0; y < CHIP8_DISPLAY_HEIGHT; y += 2)
+	{
+		u64 top    = display[y];
+		u64 bottom = display[y + 1];
+		for (i32 x = CHIP8_DISPLAY_WIDTH - 1; x >= 0; x--)
+		{
+			u32 glyph = (u32)((top >> x) & 1) | ((u32)((bottom >> x) & 1) << 1);
+			fputs(GLYPHS[glyph], stdout);
+		}
+		fputc('\n', stdout);
+	}
+
+	printf("frame %llu | state %u | torn reads %u\x1B[K\n",
+	       (unsigned long long)frameNumber, state, numRetries);
+	fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+	bool once        = false;
+	u32 pollHz       = 60;
+	const char *name = NULL;
+
+	for (i32 i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		bool hasValue   = (i + 1 < argc);
+		if      (strcmp(arg, "-once") == 0)            once   = true;
+		else if (hasValue && strcmp(arg, "-hz") == 0)  pollHz = (u32)atoi(argv[++i]);
+		else name = arg;
+	}
+
+	if (!name)
+	{
+		fprintf(stderr, "Usage: shmview_dchip8 [-once] [-hz N] name|path\n");
+		return 1;
+	}
+
+	Chip8SharedMemory shm = {};
+	if (!dchip8_shm_open(&shm, name))
+	{
+		fprintf(stderr, "Could not open shared framebuffer: %s\n", name);
+		return 1;
+	}
+
+	if (!once) printf("\x1B[2J");
+
+	u32 sleepMs          = pollHz ? (1000 / pollHz) : 0;
+	u32 numRetries       = 0;
+	u32 lastSequence     = 0;
+	const Chip8SharedFrame *frame = shm.frame;
+	for (;;)
+	{
+		u64 display[CHIP8_DISPLAY_HEIGHT];
+		u64 frameNumber;
+		u32 state;
+		u32 sequence;
+		for (;;)
+		{
+			sequence = dchip8_shm_read_begin(frame);
+			memcpy(display, frame->display, sizeof(display));
+			frameNumber = frame->frameNumber;
+			state       = frame->state;
+			if (!dchip8_shm_read_retry(frame, sequence)) break;
+			numRetries++;
+		}
+
+		if (sequence != lastSequence)
+		{
+			shmview_print_frame(display, frameNumber, state, numRetries);
+			lastSequence = sequence;
+		}
+
+		if (once) break;
+		dqnt_sleep_ms(sleepMs);
+	}
+
+	dchip8_shm_close(&shm, false);
+	return 0;
+}
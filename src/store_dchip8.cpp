@@ -0,0 +1,214 @@
+// NOTE: Parks machines in and resumes them from a state store, see
+// dchip8_store.h.
+//
+// Usage: store_dchip8 park store rom count [frames]
+//        store_dchip8 resume store
+//        store_dchip8 list store
+//
+// park boots count machines of the ROM, each with its own random seed, runs
+// them frames frames (60 by default) with scripted input and suspends machine
+// N into slot N, creating the store with count slots if there is none. resume
+// copies every parked machine back out, checks each is intact and reports the
+// time taken. Both print a fingerprint of the machines so a resume can be
+// checked against the park before it. list prints every occupied slot.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "dchip8_store.cpp"
+#include "headless_dchip8.cpp"
+
+FILE_SCOPE u64 store_fingerprint(u64 fingerprint, const Chip8VM *vm)
+{
+	u64 result = (fingerprint * 0x100000001B3ULL) ^ dchip8_vm_hash(vm);
+	return result;
+}
+
+FILE_SCOPE i32 store_park(const char *storePath, const char *romPath,
+                          u32 numMachines, u32 numFrames)
+{
+	u32 romSize = 0;
+	u8 *rom     = headless_read_entire_file(romPath, &romSize);
+	if (!rom)
+	{
+		fprintf(stderr, "store: could not read %s\n", romPath);
+		return -1;
+	}
+
+	Chip8VM *bootVM = (Chip8VM *)malloc(sizeof(Chip8VM));
+	Chip8VM *vm     = (Chip8VM *)malloc(sizeof(Chip8VM));
+	bool loaded     = bootVM && vm && dchip8_vm_load_rom(bootVM, rom, romSize);
+	free(rom);
+	if (!loaded)
+	{
+		fprintf(stderr, "store: could not load %s\n", romPath);
+		return -1;
+	}
+
+	Chip8Store store = {};
+	if (!dchip8_store_open(&store, storePath, numMachines))
+	{
+		fprintf(stderr, "store: could not open %s\n", storePath);
+		return -1;
+	}
+
+	if (store.numSlots < numMachines)
+	{
+		fprintf(stderr, "store: %s only has %u slots\n", storePath,
+		        store.numSlots);
+		dchip8_store_close(&store);
+		return -1;
+	}
+
+	u64 fingerprint    = 0;
+	f64 suspendTimeInS = 0;
+	for (u32 index = 0; index < numMachines; index++)
+	{
+		memcpy(vm, bootVM, sizeof(*vm));
+		dqnt_rnd_pcg_seed(&vm->pcgState, index);
+
+		// NOTE: Hold a key for 8 frames every 16 so machines blocked on Fx0A
+		// get going and each machine sees different keys
+		for (u32 frame = 0; frame < numFrames; frame++)
+		{
+			u16 keys = ((frame / 8) & 1) ? (u16)(1 << ((index + frame) % 16)) : 0;
+			dchip8_vm_run(vm, dchip8_controller_from_bitmask(keys),
+			              CHIP8_DEFAULT_CYCLES_PER_FRAME);
+			dchip8_vm_tick_timers(vm);
+		}
+
+		f64 startInS = dqnt_time_now_s();
+		dchip8_store_suspend(&store, index, vm, index);
+		suspendTimeInS += dqnt_time_now_s() - startInS;
+		fingerprint = store_fingerprint(fingerprint, vm);
+	}
+
+	printf("Parked %u machines in %.3f ms, fingerprint 0x%016llX\n", numMachines,
+	       suspendTimeInS * 1000.0, (unsigned long long)fingerprint);
+
+	dchip8_store_close(&store);
+	free(vm);
+	free(bootVM);
+	return 0;
+}
+
+FILE_SCOPE i32 store_resume(const char *storePath)
+{
+	f64 openStartInS = dqnt_time_now_s();
+	Chip8Store store = {};
+	if (!dchip8_store_open(&store, storePath, 0))
+	{
+		fprintf(stderr, "store: %s is not a valid store\n", storePath);
+		return -1;
+	}
+	f64 openTimeInS = dqnt_time_now_s() - openStartInS;
+
+	Chip8VM *machines = (Chip8VM *)malloc(sizeof(Chip8VM) * store.numSlots);
+	if (!machines) return -1;
+
+	u32 numResumed = 0;
+	u32 numTorn    = 0;
+	f64 startInS   = dqnt_time_now_s();
+	for (u32 index = 0; index < store.numSlots; index++)
+	{
+		if (dchip8_store_resume(&store, index, &machines[numResumed], NULL))
+			numResumed++;
+		else if (dchip8_store_slot_torn(dchip8_store_slot(&store, index)))
+			numTorn++;
+	}
+	f64 resumeTimeInS = dqnt_time_now_s() - startInS;
+
+	// NOTE: The incremental hashes only match a recompute if memory and
+	// display came back exactly as they went in
+	i32 result      = 0;
+	u64 fingerprint = 0;
+	for (u32 i = 0; i < numResumed; i++)
+	{
+		if (dchip8_vm_hash(&machines[i]) != dchip8_vm_hash_full(&machines[i]))
+		{
+			fprintf(stderr, "store: machine %u is corrupt\n", i);
+			result = 1;
+		}
+		fingerprint = store_fingerprint(fingerprint, &machines[i]);
+	}
+
+	printf("Resumed %u machines in %.3f ms (%.3f ms to open), %u torn, "
+	       "fingerprint 0x%016llX\n",
+	       numResumed, resumeTimeInS * 1000.0, openTimeInS * 1000.0, numTorn,
+	       (unsigned long long)fingerprint);
+	if (numTorn > 0) result = 1;
+
+	free(machines);
+	dchip8_store_close(&store);
+	return result;
+}
+
+FILE_SCOPE i32 store_list(const char *storePath)
+{
+	Chip8Store store = {};
+	if (!dchip8_store_open(&store, storePath, 0))
+	{
+		fprintf(stderr, "store: %s is not a valid store\n", storePath);
+		return -1;
+	}
+
+	u32 numOccupied = 0;
+	for (u32 index = 0; index < store.numSlots; index++)
+	{
+		const Chip8StoreSlot *slot = dchip8_store_slot(&store, index);
+		if (dchip8_store_slot_torn(slot))
+		{
+			printf("%8u  torn\n", index);
+			continue;
+		}
+		if (!slot->occupied) continue;
+
+		const Chip8CPU *cpu = &slot->vm.cpu;
+		printf("%8u  key 0x%016llX  pc %03X  state %u", index,
+		       (unsigned long long)slot->key, cpu->programCounter, cpu->state);
+		if (cpu->state == chip8state_fault)
+			printf("  %s at %03X", dchip8_fault_string(cpu->fault),
+			       cpu->faultAddress);
+		printf("\n");
+		numOccupied++;
+	}
+
+	printf("%u of %u slots occupied\n", numOccupied, store.numSlots);
+	dchip8_store_close(&store);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *command = (argc >= 2) ? argv[1] : "";
+	if (dqnt_strcmp(command, "park") == 0 && (argc == 5 || argc == 6))
+	{
+		u32 numMachines = (u32)strtoul(argv[4], NULL, 0);
+		u32 numFrames   = (argc == 6) ? (u32)strtoul(argv[5], NULL, 0) : 60;
+		if (numMachines == 0)
+		{
+			fprintf(stderr, "store: count must be at least 1\n");
+			return -1;
+		}
+		return store_park(argv[2], argv[3], numMachines, numFrames);
+	}
+	else if (dqnt_strcmp(command, "resume") == 0 && argc == 3)
+	{
+		return store_resume(argv[2]);
+	}
+	else if (dqnt_strcmp(command, "list") == 0 && argc == 3)
+	{
+		return store_list(argv[2]);
+	}
+
+	fprintf(stderr, "usage: store_dchip8 park store rom count [frames]\n"
+	                "       store_dchip8 resume store\n"
+	                "       store_dchip8 list store\n");
+	return -1;
+}
@@ -0,0 +1,133 @@
+// NOTE: Prints an execution trace written by dchip8_trace with disassembly.
+//
+// Usage: tracedecode_dchip8 [-id N] [-last N] trace
+//
+// -id only prints the stream of that machine, -last only the last N records
+// of each stream. Each line is the instruction number, PC, opcode and mnemonic
+// followed by its effects, the register it wrote and VF and I when they
+// changed.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DQNT_IMPLEMENTATION
+#include "dqnt.h"
+
+#include "dchip8.cpp"
+#include "dchip8_disasm.cpp"
+#include "dchip8_trace.cpp"
+#include "headless_dchip8.cpp"
+
+FILE_SCOPE bool tracedecode_writes_vx(u16 opcode)
+{
+	u32 n  = opcode & 0x0F;
+	u32 kk = opcode & 0xFF;
+	switch (opcode & 0xF000)
+	{
+		case 0x6000:
+		case 0x7000:
+		case 0xC000: return true;
+		case 0x8000: return (n <= 0x07 || n == 0x0E);
+		case 0xF000: return (kk == 0x07 || kk == 0x0A || kk == 0x65);
+		default: return false;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	i64 onlyId  = -1;
+	u32 numLast = 0;
+
+	i32 argIndex = 1;
+	for (; argIndex < argc; argIndex++)
+	{
+		const char *arg = argv[argIndex];
+		if (arg[0] != '-' || argIndex + 1 >= argc) break;
+
+		const char *value = argv[++argIndex];
+		if      (dqnt_strcmp(arg, "-id") == 0)   onlyId  = (i64)strtoul(value, NULL, 0);
+		else if (dqnt_strcmp(arg, "-last") == 0) numLast = (u32)strtoul(value, NULL, 0);
+		else
+		{
+			fprintf(stderr, "tracedecode: unknown option %s\n", arg);
+			return -1;
+		}
+	}
+
+	if (argIndex >= argc)
+	{
+		fprintf(stderr, "usage: tracedecode_dchip8 [-id N] [-last N] trace\n");
+		return -1;
+	}
+
+	u32 fileSize = 0;
+	u8 *data     = headless_read_entire_file(argv[argIndex], &fileSize);
+	if (!data)
+	{
+		fprintf(stderr, "tracedecode: could not read %s\n", argv[argIndex]);
+		return -1;
+	}
+
+	char mnemonic[32];
+	u32 offset = 0;
+	while (offset < fileSize)
+	{
+		Chip8TraceHeader header;
+		if (fileSize - offset < sizeof(header))
+		{
+			fprintf(stderr, "tracedecode: truncated header at %u\n", offset);
+			return 1;
+		}
+		memcpy(&header, data + offset, sizeof(header));
+		offset += sizeof(header);
+
+		u64 streamSize = (u64)header.numRecords * sizeof(Chip8TraceRecord);
+		if (header.magic != CHIP8_TRACE_MAGIC ||
+		    header.version != CHIP8_TRACE_VERSION ||
+		    header.recordSize != sizeof(Chip8TraceRecord) ||
+		    streamSize > fileSize - offset)
+		{
+			fprintf(stderr, "tracedecode: invalid stream at %u\n",
+			        offset - (u32)sizeof(header));
+			return 1;
+		}
+
+		const Chip8TraceRecord *records =
+		    (const Chip8TraceRecord *)(data + offset);
+		offset += (u32)streamSize;
+		if (onlyId >= 0 && header.id != (u32)onlyId) continue;
+
+		u32 firstRecord = 0;
+		if (numLast && numLast < header.numRecords)
+			firstRecord = header.numRecords - numLast;
+
+		u64 firstNumber = header.numTraced - header.numRecords;
+		printf("machine %u, last %u of %llu instructions\n", header.id,
+		       header.numRecords - firstRecord,
+		       (unsigned long long)header.numTraced);
+
+		for (u32 i = firstRecord; i < header.numRecords; i++)
+		{
+			const Chip8TraceRecord *record = &records[i];
+			dchip8_disasm_instruction(record->opcode, mnemonic,
+			                          sizeof(mnemonic));
+			printf("%12llu  %03X  %04X  %-16s",
+			       (unsigned long long)(firstNumber + i), record->pc,
+			       record->opcode, mnemonic);
+
+			// NOTE: The first record has nothing to compare VF and I with
+			if (tracedecode_writes_vx(record->opcode))
+				printf(" V%X=%02X", (record->opcode >> 8) & 0x0F, record->vx);
+			if (i > firstRecord && record->vf != records[i - 1].vf)
+				printf(" VF=%02X", record->vf);
+			if (i > firstRecord && record->I != records[i - 1].I)
+				printf(" I=%03X", record->I);
+			printf("\n");
+		}
+	}
+
+	free(data);
+	return 0;
+}
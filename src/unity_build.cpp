@@ -1,7 +1,17 @@
 #define _CRT_SECURE_NO_WARNINGS
 
+// NOTE: dqnt's implementation includes Windows.h, so the character set has to
+// be chosen before it does
+#define UNICODE
+#define _UNICODE
+
 #define DQNT_IMPLEMENTATION
 #include "dqnt.h"
 
 #include "win32_dchip8.cpp"
 #include "dchip8.cpp"
+#include "dchip8_scale.cpp"
+#include "dchip8_phosphor.cpp"
+#include "dchip8_handoff.cpp"
+#include "dchip8_pacer.cpp"
+#include "dchip8_metrics.cpp"
@@ -7,62 +7,89 @@
 
 #include <Windows.h>
 #include <Commdlg.h>
+#include <mmsystem.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "dchip8.h"
+#include "dchip8_handoff.h"
+#include "dchip8_metrics.h"
+#include "dchip8_pacer.h"
+#include "dchip8_phosphor.h"
 #include "dchip8_platform.h"
+#include "dchip8_scale.h"
 #include "dqnt.h"
 
-typedef struct Win32RenderBitmap
+// NOTE: Client sized, top down bitmap the software scaler presents into. It is
+// copied to the window 1:1 so GDI never has to stretch anything.
+typedef struct Win32PresentBitmap
 {
 	BITMAPINFO  info;
-	HBITMAP     handle;
-	i32         width;
-	i32         height;
-	i32         bytesPerPixel;
-	void       *memory;
-} Win32RenderBitmap;
+	u32        *memory;
+	u32         capacity;
+} Win32PresentBitmap;
 
 #define MIN_WIDTH  256;
 #define MIN_HEIGHT 128;
 typedef struct Win32State
 {
 	bool useCorrectAspectRatio = true;
+	wchar_t currentRom[MAX_PATH];
+	// NOTE: Set by the menu, read by the emulation thread
+	volatile u32 usePhosphor;
+	volatile u32 useSpeculation;
 } Win32State;
 
+// NOTE: Everything the emulation thread owns. The window thread only talks to
+// it through the command queue, the input queue and the frame triple buffer.
+typedef struct Win32Emulation
+{
+	PlatformMemory        memory;
+	const Chip8RomDB     *romDB;
+	f32                   targetSecondsPerFrame;
+	Chip8Pacer            pacer;
+	Chip8Phosphor         phosphor;
+	// NOTE: Written by the emulation thread only, read by the exporter
+	Chip8Metrics          metrics;
+	Chip8MetricsExporter  exporter;
+	// NOTE: Only started while speculation is switched on
+	Chip8Speculator       speculator;
+	u32                   numSpeculatorThreads;
+	HWND                  window;
+	DqntThread            thread;
+	volatile u32          quit;
+} Win32Emulation;
+
 FILE_SCOPE bool              globalRunning = false;
-FILE_SCOPE Win32RenderBitmap globalRenderBitmap;
+FILE_SCOPE Win32PresentBitmap globalPresentBitmap;
+FILE_SCOPE Chip8Scaler       globalScaler;
+FILE_SCOPE Chip8TripleBuffer globalFrames;
+FILE_SCOPE Chip8InputQueue   globalInputQueue;
 FILE_SCOPE LARGE_INTEGER     globalQueryPerformanceFrequency;
 FILE_SCOPE Win32State        globalState;
+FILE_SCOPE Chip8CommandQueue globalCommandQueue;
+FILE_SCOPE Chip8RomLoader    globalRomLoader;
 #define win32_error_box(text, title) MessageBox(nullptr, text, title, MB_OK);
 
 enum Win32Menu
 {
 	win32menu_file_exit,
 	win32menu_file_open,
+	win32menu_file_reset,
 
 	win32menu_video_correct_aspect_ratio,
+	win32menu_video_phosphor,
 	win32menu_video_4x,
 	win32menu_video_8x,
 	win32menu_video_12x,
 	win32menu_video_16x,
-};
-
-FILE_SCOPE v2 constrain_to_aspect_ratio(u32 width, u32 height, f32 ratioX,
-                                        f32 ratioY)
-{
-	v2 result = {};
-	f32 numRatioIncrementsToWidth  = (f32)(width / ratioX);
-	f32 numRatioIncrementsToHeight = (f32)(height / ratioY);
-
-	f32 leastIncrementsToSide =
-	    DQNT_MATH_MIN(numRatioIncrementsToHeight, numRatioIncrementsToWidth);
 
-	result.w = (f32)(ratioX * leastIncrementsToSide);
-	result.h = (f32)(ratioY * leastIncrementsToSide);
-	return result;
-}
+	win32menu_emulation_speculate,
+	win32menu_emulation_run_ahead_off,
+	win32menu_emulation_run_ahead_1,
+	win32menu_emulation_run_ahead_2,
+};
 
 FILE_SCOPE void win32_create_menu(HWND window)
 {
@@ -71,6 +98,7 @@ FILE_SCOPE void win32_create_menu(HWND window)
 		HMENU menu = CreatePopupMenu();
 		AppendMenu(menuBar, MF_STRING | MF_POPUP, (UINT)menu, L"File");
 		AppendMenu(menu, MF_STRING, win32menu_file_open, L"Open ROM");
+		AppendMenu(menu, MF_STRING, win32menu_file_reset, L"Reset");
 		AppendMenu(menu, MF_STRING, win32menu_file_exit, L"Exit");
 	}
 
@@ -80,6 +108,8 @@ FILE_SCOPE void win32_create_menu(HWND window)
 		AppendMenu(menu, MF_STRING | MF_CHECKED,
 		           win32menu_video_correct_aspect_ratio,
 		           L"Use Correct Aspect Ratio");
+		AppendMenu(menu, MF_STRING, win32menu_video_phosphor,
+		           L"Phosphor Persistence");
 		AppendMenu(menu, MF_SEPARATOR, 0, nullptr);
 		AppendMenu(menu, MF_STRING, win32menu_video_4x, L"4x");
 		AppendMenu(menu, MF_STRING, win32menu_video_8x, L"8x");
@@ -87,6 +117,20 @@ FILE_SCOPE void win32_create_menu(HWND window)
 		AppendMenu(menu, MF_STRING, win32menu_video_16x, L"16x");
 	}
 
+	{ // Emulation Menu
+		HMENU menu = CreatePopupMenu();
+		AppendMenu(menuBar, MF_STRING | MF_POPUP, (UINT)menu, L"Emulation");
+		AppendMenu(menu, MF_STRING, win32menu_emulation_speculate,
+		           L"Speculate on Key Waits");
+		AppendMenu(menu, MF_SEPARATOR, 0, nullptr);
+		AppendMenu(menu, MF_STRING | MF_CHECKED,
+		           win32menu_emulation_run_ahead_off, L"No Run-Ahead");
+		AppendMenu(menu, MF_STRING, win32menu_emulation_run_ahead_1,
+		           L"Run Ahead 1 Frame");
+		AppendMenu(menu, MF_STRING, win32menu_emulation_run_ahead_2,
+		           L"Run Ahead 2 Frames");
+	}
+
 	SetMenu(window, menuBar);
 
 	/*
@@ -112,30 +156,68 @@ inline FILE_SCOPE void win32_get_client_dim(HWND window, LONG *width,
 	*height = clientRect.bottom - clientRect.top;
 }
 
-FILE_SCOPE void win32_display_render_bitmap(Win32RenderBitmap renderBitmap,
-                                            HDC deviceContext, LONG width,
+FILE_SCOPE void win32_display_render_bitmap(HDC deviceContext, LONG width,
                                             LONG height)
 {
-	HDC stretchDC = CreateCompatibleDC(deviceContext);
-	SelectObject(stretchDC, renderBitmap.handle);
-	StretchBlt(deviceContext, 0, 0, width, height, stretchDC, 0, 0,
-	           renderBitmap.width, renderBitmap.height, SRCCOPY);
-
-    // NOTE: Win32 AlphaBlend requires the RGB components to be premultiplied
-	// with alpha.
-#if 0
-	BLENDFUNCTION blend       = {};
-	blend.BlendOp             = AC_SRC_OVER;
-	blend.SourceConstantAlpha = 255;
-	blend.AlphaFormat         = AC_SRC_ALPHA;
-
-	if (!AlphaBlend(deviceContext, 0, 0, width, height, deviceContext, 0, 0,
-	                width, height, blend))
+	const Chip8PresentFrame *frame = dchip8_triple_buffer_front(&globalFrames);
+
+	// NOTE: Largest integer scale that fits, the same on both axes when keeping
+	// the aspect ratio
+	u32 scaleX = (u32)DQNT_MATH_MAX(width / CHIP8_DISPLAY_WIDTH, 1);
+	u32 scaleY = (u32)DQNT_MATH_MAX(height / CHIP8_DISPLAY_HEIGHT, 1);
+	if (globalState.useCorrectAspectRatio)
 	{
-		OutputDebugString(L"AlphaBlend() failed.");
+		scaleX = DQNT_MATH_MIN(scaleX, scaleY);
+		scaleY = scaleX;
 	}
-#endif
-	DeleteDC(stretchDC);
+
+	i32 presentWidth  = CHIP8_DISPLAY_WIDTH * scaleX;
+	i32 presentHeight = CHIP8_DISPLAY_HEIGHT * scaleY;
+	u32 numPixels     = (u32)(presentWidth * presentHeight);
+
+	Win32PresentBitmap *bitmap = &globalPresentBitmap;
+	if (numPixels > bitmap->capacity)
+	{
+		if (bitmap->memory) VirtualFree(bitmap->memory, 0, MEM_RELEASE);
+		bitmap->memory =
+		    (u32 *)VirtualAlloc(nullptr, numPixels * sizeof(u32),
+		                        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		bitmap->capacity = (bitmap->memory) ? numPixels : 0;
+		if (!bitmap->memory) return;
+	}
+
+	BITMAPINFOHEADER *header = &bitmap->info.bmiHeader;
+	header->biSize           = sizeof(BITMAPINFOHEADER);
+	header->biWidth          = presentWidth;
+	header->biHeight         = -presentHeight; // top down
+	header->biPlanes         = 1;
+	header->biBitCount       = 32;
+	header->biCompression    = BI_RGB;
+
+	Chip8ScaleTarget target = {};
+	target.memory           = bitmap->memory;
+	target.pitch            = presentWidth;
+	target.scaleX           = scaleX;
+	target.scaleY           = scaleY;
+	target.onColour         = 0xFFFFFFFF;
+	target.offColour        = 0xFF000000;
+	if (frame->hasPixels)
+		dchip8_scaler_present_argb(&globalScaler, frame->pixels, &target);
+	else
+		dchip8_scaler_present(&globalScaler, frame->display, &target);
+
+	SetDIBitsToDevice(deviceContext, 0, 0, presentWidth, presentHeight, 0, 0,
+	                  0, presentHeight, bitmap->memory, &bitmap->info,
+	                  DIB_RGB_COLORS);
+
+	// NOTE: Clear whatever the scaled image doesn't cover, it may hold a
+	// larger frame from before a resize
+	if (width > presentWidth)
+		PatBlt(deviceContext, presentWidth, 0, width - presentWidth, height,
+		       BLACKNESS);
+	if (height > presentHeight)
+		PatBlt(deviceContext, 0, presentHeight, presentWidth,
+		       height - presentHeight, BLACKNESS);
 }
 
 FILE_SCOPE LRESULT CALLBACK win32_main_proc_callback(HWND window, UINT msg,
@@ -165,19 +247,8 @@ FILE_SCOPE LRESULT CALLBACK win32_main_proc_callback(HWND window, UINT msg,
 
 			LONG renderWidth, renderHeight;
 			win32_get_client_dim(window, &renderWidth, &renderHeight);
-			if (globalState.useCorrectAspectRatio)
-			{
-				f32 ratioX = (f32)globalRenderBitmap.width;
-				f32 ratioY = (f32)globalRenderBitmap.height;
-				v2 newDim = constrain_to_aspect_ratio(renderWidth, renderHeight,
-				                                      ratioX, ratioY);
-
-				renderWidth  = (LONG)newDim.w;
-				renderHeight = (LONG)newDim.h;
-			}
-
-			win32_display_render_bitmap(globalRenderBitmap, deviceContext,
-			                            renderWidth, renderHeight);
+			win32_display_render_bitmap(deviceContext, renderWidth,
+			                            renderHeight);
 			EndPaint(window, &paint);
 			break;
 		}
@@ -222,17 +293,7 @@ inline FILE_SCOPE LARGE_INTEGER win32_query_perf_counter_time()
 	return result;
 }
 
-FILE_SCOPE inline void win32_update_key(KeyState *key, bool isDown)
-{
-	if (key->endedDown != isDown)
-	{
-		key->endedDown = isDown;
-		key->halfTransitionCount++;
-	}
-}
-
-FILE_SCOPE void win32_handle_menu_messages(HWND window, MSG msg,
-                                           PlatformInput *input)
+FILE_SCOPE void win32_handle_menu_messages(HWND window, MSG msg)
 {
 	switch (LOWORD(msg.wParam))
 	{
@@ -255,23 +316,29 @@ FILE_SCOPE void win32_handle_menu_messages(HWND window, MSG msg,
 			if (GetOpenFileName(&openDialogInfo) != 0)
 			{
 				wchar_t candidateRom[MAX_PATH] = {};
-				wchar_t currentRom[MAX_PATH]   = {};
 				GetFullPathName(fileBuffer, DQNT_ARRAY_COUNT(candidateRom),
 				                candidateRom, nullptr);
-				GetFullPathName(input->rom, DQNT_ARRAY_COUNT(currentRom),
-				                currentRom, nullptr);
 
-				if (dqnt_wstrcmp(candidateRom, currentRom) != 0)
+				// NOTE: The loader reads the file off thread and the core swaps
+				// it in on the next frame boundary it gets to
+				if (dqnt_wstrcmp(candidateRom, globalState.currentRom) != 0)
 				{
-					input->loadNewRom = true;
-
-					for (i32 i = 0; i < dqnt_wstrlen(candidateRom); i++)
-						input->rom[i] = candidateRom[i];
+					for (u32 i = 0; i < DQNT_ARRAY_COUNT(candidateRom); i++)
+						globalState.currentRom[i] = candidateRom[i];
+					dchip8_rom_loader_request(&globalRomLoader, candidateRom);
 				}
 			}
 		}
 		break;
 
+		case win32menu_file_reset:
+		{
+			Chip8Command command = {};
+			command.type         = chip8command_reset;
+			dchip8_command_queue_push(&globalCommandQueue, command);
+		}
+		break;
+
 		case win32menu_video_4x:
 		case win32menu_video_8x:
 		case win32menu_video_12x:
@@ -309,6 +376,45 @@ FILE_SCOPE void win32_handle_menu_messages(HWND window, MSG msg,
 		}
 		break;
 
+		case win32menu_video_phosphor:
+		{
+			u32 usePhosphor = (globalState.usePhosphor) ? 0 : 1;
+			dqnt_atomic_store_u32(&globalState.usePhosphor, usePhosphor);
+			CheckMenuItem(GetMenu(window), win32menu_video_phosphor,
+			              MF_BYCOMMAND |
+			                  (usePhosphor ? MF_CHECKED : MF_UNCHECKED));
+		}
+		break;
+
+		case win32menu_emulation_speculate:
+		{
+			u32 useSpeculation = (globalState.useSpeculation) ? 0 : 1;
+			dqnt_atomic_store_u32(&globalState.useSpeculation, useSpeculation);
+			CheckMenuItem(GetMenu(window), win32menu_emulation_speculate,
+			              MF_BYCOMMAND |
+			                  (useSpeculation ? MF_CHECKED : MF_UNCHECKED));
+		}
+		break;
+
+		case win32menu_emulation_run_ahead_off:
+		case win32menu_emulation_run_ahead_1:
+		case win32menu_emulation_run_ahead_2:
+		{
+			u32 item             = LOWORD(msg.wParam);
+			Chip8Command command = {};
+			command.type         = chip8command_set_run_ahead;
+			command.runAheadFrames =
+			    item - (u32)win32menu_emulation_run_ahead_off;
+			if (dchip8_command_queue_push(&globalCommandQueue, command))
+			{
+				CheckMenuRadioItem(GetMenu(window),
+				                   win32menu_emulation_run_ahead_off,
+				                   win32menu_emulation_run_ahead_2, item,
+				                   MF_BYCOMMAND);
+			}
+		}
+		break;
+
 		default:
 		{
 			DQNT_ASSERT(DQNT_INVALID_CODE_PATH);
@@ -317,7 +423,42 @@ FILE_SCOPE void win32_handle_menu_messages(HWND window, MSG msg,
 	}
 }
 
-FILE_SCOPE void win32_process_messages(HWND window, PlatformInput *input)
+// Return key_count for keys the emulator doesn't use
+FILE_SCOPE i32 win32_virtual_key_to_key(WPARAM virtualKey)
+{
+	switch (virtualKey)
+	{
+		case VK_UP:     return key_up;
+		case VK_DOWN:   return key_down;
+		case VK_LEFT:   return key_left;
+		case VK_RIGHT:  return key_right;
+		case VK_ESCAPE: return key_escape;
+
+		case '1': return key_1;
+		case '2': return key_2;
+		case '3': return key_3;
+		case '4': return key_4;
+
+		case 'Q': return key_q;
+		case 'W': return key_w;
+		case 'E': return key_e;
+		case 'R': return key_r;
+
+		case 'A': return key_a;
+		case 'S': return key_s;
+		case 'D': return key_d;
+		case 'F': return key_f;
+
+		case 'Z': return key_z;
+		case 'X': return key_x;
+		case 'C': return key_c;
+		case 'V': return key_v;
+
+		default: return key_count;
+	}
+}
+
+FILE_SCOPE void win32_process_messages(HWND window)
 {
 	MSG msg;
 	while (PeekMessage(&msg, window, 0, 0, PM_REMOVE))
@@ -326,7 +467,7 @@ FILE_SCOPE void win32_process_messages(HWND window, PlatformInput *input)
 		{
 			case WM_COMMAND:
 			{
-				win32_handle_menu_messages(window, msg, input);
+				win32_handle_menu_messages(window, msg);
 			}
 			break;
 
@@ -336,42 +477,19 @@ FILE_SCOPE void win32_process_messages(HWND window, PlatformInput *input)
 			case WM_KEYUP:
 			{
 				bool isDown = (msg.message == WM_KEYDOWN);
-				switch (msg.wParam)
-				{
-					case VK_UP: win32_update_key(&input->up, isDown); break;
-					case VK_DOWN: win32_update_key(&input->down, isDown); break;
-					case VK_LEFT: win32_update_key(&input->left, isDown); break;
-					case VK_RIGHT: win32_update_key(&input->right, isDown); break;
-
-					case '1': win32_update_key(&input->key_1, isDown); break;
-					case '2': win32_update_key(&input->key_2, isDown); break;
-					case '3': win32_update_key(&input->key_3, isDown); break;
-					case '4': win32_update_key(&input->key_4, isDown); break;
-
-					case 'Q': win32_update_key(&input->key_q, isDown); break;
-					case 'W': win32_update_key(&input->key_w, isDown); break;
-					case 'E': win32_update_key(&input->key_e, isDown); break;
-					case 'R': win32_update_key(&input->key_r, isDown); break;
-
-					case 'A': win32_update_key(&input->key_a, isDown); break;
-					case 'S': win32_update_key(&input->key_s, isDown); break;
-					case 'D': win32_update_key(&input->key_d, isDown); break;
-					case 'F': win32_update_key(&input->key_f, isDown); break;
-
-					case 'Z': win32_update_key(&input->key_z, isDown); break;
-					case 'X': win32_update_key(&input->key_x, isDown); break;
-					case 'C': win32_update_key(&input->key_c, isDown); break;
-					case 'V': win32_update_key(&input->key_v, isDown); break;
-
-					case VK_ESCAPE:
-					{
-						win32_update_key(&input->escape, isDown);
-						if (input->escape.endedDown) globalRunning = false;
-					}
-					break;
-
-					default: break;
-				}
+				i32 key     = win32_virtual_key_to_key(msg.wParam);
+				if (key == key_count) break;
+
+				if (key == key_escape && isDown) globalRunning = false;
+
+				// NOTE: Held keys auto repeat, only changes are worth sending
+				bool wasDown = (msg.lParam & (1 << 30)) != 0;
+				if (isDown && wasDown) break;
+
+				Chip8InputEvent event = {};
+				event.key             = (u8)key;
+				event.isDown          = isDown;
+				dchip8_input_queue_push(&globalInputQueue, event);
 			}
 			break;
 
@@ -384,6 +502,140 @@ FILE_SCOPE void win32_process_messages(HWND window, PlatformInput *input)
 	}
 }
 
+FILE_SCOPE u32 win32_emulation_thread(void *userData)
+{
+	Win32Emulation *emulation = (Win32Emulation *)userData;
+	const Chip8Session *session =
+	    (const Chip8Session *)emulation->memory.permanentMem;
+
+	PlatformInput platformInput = {};
+	bool phosphorActive         = false;
+	bool speculating            = false;
+	bool speculatorStarted      = false;
+	u64 frameNumber             = 0;
+	f32 frameTimeInS            = emulation->targetSecondsPerFrame;
+	dchip8_pacer_init(&emulation->pacer, 1.0 / emulation->targetSecondsPerFrame,
+	                  0);
+
+	Chip8FrameSample sample = {};
+	u64 numInstructions     = session->numInstructions;
+	u64 numTimerTicks       = session->numTimerTicks;
+	while (!dqnt_atomic_load_u32(&emulation->quit))
+	{
+		////////////////////////////////////////////////////////////////////////
+		// Update State
+		////////////////////////////////////////////////////////////////////////
+		LARGE_INTEGER phaseTime[chip8phase_count + 1];
+		phaseTime[chip8phase_input] = win32_query_perf_counter_time();
+		{
+			for (i32 i = 0; i < key_count; i++)
+				platformInput.key[i].halfTransitionCount = 0;
+			platformInput.deltaForFrame = frameTimeInS;
+			dchip8_input_queue_drain(&globalInputQueue, &platformInput);
+
+			// NOTE: The core owns the switch, hand it over on a frame boundary.
+			// If the speculator can't start, speculation stays switched off.
+			bool useSpeculation =
+			    dqnt_atomic_load_u32(&globalState.useSpeculation) != 0;
+			if (useSpeculation && !speculatorStarted)
+			{
+				speculatorStarted = dchip8_speculator_start(
+				    &emulation->speculator, emulation->numSpeculatorThreads,
+				    nullptr);
+				if (!speculatorStarted)
+				{
+					useSpeculation = false;
+					dqnt_atomic_store_u32(&globalState.useSpeculation, 0);
+					CheckMenuItem(GetMenu(emulation->window),
+					              win32menu_emulation_speculate,
+					              MF_BYCOMMAND | MF_UNCHECKED);
+				}
+			}
+
+			if (useSpeculation != speculating)
+			{
+				Chip8Command command = {};
+				command.type         = chip8command_set_speculator;
+				command.speculator =
+				    useSpeculation ? &emulation->speculator : nullptr;
+				if (dchip8_command_queue_push(&globalCommandQueue, command))
+					speculating = useSpeculation;
+			}
+
+			phaseTime[chip8phase_update] = win32_query_perf_counter_time();
+			// NOTE: Presented from the frame below, the core doesn't render
+			PlatformRenderBuffer noRenderBuffer = {};
+			dchip8_update(noRenderBuffer, &platformInput, emulation->memory,
+			              &globalCommandQueue, emulation->romDB);
+
+			// NOTE: Stopped once the core has let go of it
+			if (speculatorStarted && !speculating && !session->speculator)
+			{
+				dchip8_speculator_stop(&emulation->speculator);
+				speculatorStarted = false;
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////
+		// Publish Frame
+		////////////////////////////////////////////////////////////////////////
+		phaseTime[chip8phase_present] = win32_query_perf_counter_time();
+		{
+			Chip8PresentFrame *frame = dchip8_triple_buffer_back(&globalFrames);
+			memcpy(frame->display, session->display, sizeof(frame->display));
+			frame->state       = (u32)session->vm.cpu.state;
+			frame->frameNumber = frameNumber++;
+
+			// NOTE: The filter runs here rather than in the presenter so it
+			// sees every frame, including the ones the presenter skips
+			bool usePhosphor =
+			    dqnt_atomic_load_u32(&globalState.usePhosphor) != 0;
+			if (usePhosphor && !phosphorActive)
+				dchip8_phosphor_init(&emulation->phosphor, 0.05f, 0xFFFFFFFF,
+				                     0xFF000000);
+			phosphorActive   = usePhosphor;
+			frame->hasPixels = usePhosphor;
+			if (usePhosphor)
+			{
+				dchip8_phosphor_update(&emulation->phosphor, frame->display,
+				                       frameTimeInS);
+				memcpy(frame->pixels, emulation->phosphor.pixels,
+				       sizeof(frame->pixels));
+			}
+
+			dchip8_triple_buffer_publish(&globalFrames);
+		}
+
+		////////////////////////////////////////////////////////////////////////
+		// Frame Limiting
+		////////////////////////////////////////////////////////////////////////
+		phaseTime[chip8phase_wait]  = win32_query_perf_counter_time();
+		frameTimeInS                = (f32)dchip8_pacer_wait(&emulation->pacer);
+		phaseTime[chip8phase_count] = win32_query_perf_counter_time();
+
+		////////////////////////////////////////////////////////////////////////
+		// Metrics
+		////////////////////////////////////////////////////////////////////////
+		{
+			sample.frameTimeInS = frameTimeInS;
+			sample.numInstructions =
+			    (u32)(session->numInstructions - numInstructions);
+			sample.numTimerTicks = (u32)(session->numTimerTicks - numTimerTicks);
+			numInstructions      = session->numInstructions;
+			numTimerTicks        = session->numTimerTicks;
+			for (u32 phase = 0; phase < chip8phase_count; phase++)
+			{
+				sample.phaseTimeInS[phase] = win32_query_perf_counter_get_time(
+				    phaseTime[phase], phaseTime[phase + 1]);
+			}
+
+			dchip8_metrics_record(&emulation->metrics, &sample);
+		}
+	}
+
+	return 0;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
                    LPSTR lpCmdLine, int nShowCmd)
 {
@@ -436,122 +688,116 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 		return -1;
 	}
 
-	{ // Initialise the renderbitmap
-		BITMAPINFOHEADER header = {};
-		header.biSize           = sizeof(BITMAPINFOHEADER);
-		header.biWidth          = 64;
-		header.biHeight         = 32;
-		header.biPlanes         = 1;
-		header.biBitCount       = 32;
-		header.biCompression    = BI_RGB; // uncompressed bitmap
-		header.biSizeImage      = 0;
-		header.biXPelsPerMeter  = 0;
-		header.biYPelsPerMeter  = 0;
-		header.biClrUsed        = 0;
-		header.biClrImportant   = 0;
-
-		globalRenderBitmap.info.bmiHeader = header;
-		globalRenderBitmap.width          = header.biWidth;
-		globalRenderBitmap.height         = header.biHeight;
-		globalRenderBitmap.bytesPerPixel  = header.biBitCount / 8;
-		DQNT_ASSERT(globalRenderBitmap.bytesPerPixel >= 1);
-
-		HDC deviceContext = GetDC(mainWindow);
-		globalRenderBitmap.handle = CreateDIBSection(
-		    deviceContext, &globalRenderBitmap.info, DIB_RGB_COLORS,
-		    &globalRenderBitmap.memory, NULL, NULL);
-		ReleaseDC(mainWindow, deviceContext);
+	////////////////////////////////////////////////////////////////////////////
+	// Update Loop
+	////////////////////////////////////////////////////////////////////////////
+	PlatformMemory platformMemory   = {};
+	platformMemory.permanentMemSize = DCHIP8_MIN_PERMANENT_MEM_SIZE;
+	platformMemory.transientMemSize = DCHIP8_DEFAULT_TRANSIENT_MEM_SIZE;
+	platformMemory.permanentMem     = VirtualAlloc(
+	    nullptr,
+	    platformMemory.permanentMemSize + platformMemory.transientMemSize,
+	    MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (!platformMemory.permanentMem)
+	{
+		win32_error_box(L"VirtualAlloc() failed.", nullptr);
+		return -1;
 	}
+	platformMemory.transientMem =
+	    (u8 *)platformMemory.permanentMem + platformMemory.permanentMemSize;
+	dchip8_scaler_start(&globalScaler, 0);
 
-	if (!globalRenderBitmap.memory)
+	// NOTE: Optional, without it every ROM runs with the default settings
+	Chip8RomDB romDB = {};
+	dchip8_romdb_open(&romDB, L"dchip8_roms.idx");
+
+	dchip8_command_queue_init(&globalCommandQueue);
+	if (!dchip8_rom_loader_start(&globalRomLoader, &globalCommandQueue))
 	{
-		win32_error_box(L"CreateDIBSection() failed.", nullptr);
+		win32_error_box(L"Could not start the ROM loader thread.", nullptr);
 		return -1;
 	}
 
-	////////////////////////////////////////////////////////////////////////////
-	// Update Loop
-	////////////////////////////////////////////////////////////////////////////
-	u8 stackMemory[4096]            = {};
-	PlatformMemory platformMemory   = {};
-	platformMemory.permanentMem     = &stackMemory;
-	platformMemory.permanentMemSize = DQNT_ARRAY_COUNT(stackMemory);
-
 	QueryPerformanceFrequency(&globalQueryPerformanceFrequency);
+
+	// NOTE: Sleep() rounds to the scheduler tick, 15.6ms by default, far too
+	// coarse for the pacer to finish a wait from
+	bool raisedTimerResolution = (timeBeginPeriod(1) == TIMERR_NOERROR);
+
 	const f32 TARGET_FRAMES_PER_S = 30.0f;
-	f32 targetSecondsPerFrame     = 1 / TARGET_FRAMES_PER_S;
-	f32 frameTimeInS              = 0.0f;
 	globalRunning                 = true;
 
-	while (globalRunning)
-	{
-		////////////////////////////////////////////////////////////////////////
-		// Update State
-		////////////////////////////////////////////////////////////////////////
-		LARGE_INTEGER startFrameTime = win32_query_perf_counter_time();
-		{
-			PlatformInput platformInput = {};
-			platformInput.deltaForFrame = frameTimeInS;
-			win32_process_messages(mainWindow, &platformInput);
-
-			PlatformRenderBuffer platformBuffer = {};
-			platformBuffer.memory               = globalRenderBitmap.memory;
-			platformBuffer.height               = globalRenderBitmap.height;
-			platformBuffer.width                = globalRenderBitmap.width;
-			platformBuffer.bytesPerPixel = globalRenderBitmap.bytesPerPixel;
-			dchip8_update(platformBuffer, platformInput, platformMemory, 15);
-		}
-
-		////////////////////////////////////////////////////////////////////////
-		// Rendering
-		////////////////////////////////////////////////////////////////////////
-		{
-			LONG renderWidth, renderHeight;
-			win32_get_client_dim(mainWindow, &renderWidth, &renderHeight);
-			if (globalState.useCorrectAspectRatio)
-			{
-				f32 ratioX = (f32)globalRenderBitmap.width;
-				f32 ratioY = (f32)globalRenderBitmap.height;
-				v2 newDim = constrain_to_aspect_ratio(renderWidth, renderHeight,
-				                                      ratioX, ratioY);
+	////////////////////////////////////////////////////////////////////////////
+	// Start Emulation
+	////////////////////////////////////////////////////////////////////////////
+	dchip8_triple_buffer_init(&globalFrames);
 
-				renderWidth  = (LONG)newDim.w;
-				renderHeight = (LONG)newDim.h;
-			}
+	// NOTE: Holds a Chip8Phosphor, too big for the stack
+	Win32Emulation *emulation = (Win32Emulation *)VirtualAlloc(
+	    nullptr, sizeof(Win32Emulation), MEM_COMMIT | MEM_RESERVE,
+	    PAGE_READWRITE);
+	if (!emulation)
+	{
+		win32_error_box(L"VirtualAlloc() failed.", nullptr);
+		return -1;
+	}
 
-			HDC deviceContext = GetDC(mainWindow);
-			win32_display_render_bitmap(globalRenderBitmap, deviceContext,
-			                            renderWidth, renderHeight);
-			ReleaseDC(mainWindow, deviceContext);
-		}
+	emulation->memory                     = platformMemory;
+	emulation->romDB                      = &romDB;
+	emulation->targetSecondsPerFrame      = 1 / TARGET_FRAMES_PER_S;
+
+	// NOTE: Metrics are a diagnostic, carry on without them if the exporter
+	// can't start
+	const f64 METRICS_EXPORT_INTERVAL_IN_S = 5.0;
+	bool exportingMetrics                  = dchip8_metrics_exporter_start(
+	    &emulation->exporter, &emulation->metrics, "dchip8_metrics.prom",
+	    METRICS_EXPORT_INTERVAL_IN_S);
+
+	// NOTE: Branches only run ahead on cores the window and emulation threads
+	// leave free, otherwise they are run on the emulation thread at the fork
+	u32 numCores                    = dqnt_num_cores();
+	emulation->numSpeculatorThreads = (numCores > 2) ? numCores - 2 : 0;
+	emulation->window               = mainWindow;
+
+	if (!dqnt_thread_create(&emulation->thread, win32_emulation_thread,
+	                        emulation))
+	{
+		win32_error_box(L"Could not start the emulation thread.", nullptr);
+		return -1;
+	}
 
-		////////////////////////////////////////////////////////////////////////
-		// Frame Limiting
-		////////////////////////////////////////////////////////////////////////
+	////////////////////////////////////////////////////////////////////////////
+	// Present Loop
+	////////////////////////////////////////////////////////////////////////////
+	// NOTE: Present the newest frame as soon as it is published, otherwise
+	// sleep until the next message or the next millisecond tick
+	while (globalRunning)
+	{
+		win32_process_messages(mainWindow);
+		if (!dchip8_triple_buffer_acquire(&globalFrames))
 		{
-			LARGE_INTEGER endWorkTime = win32_query_perf_counter_time();
-			f32 workTimeInS =
-			    win32_query_perf_counter_get_time(startFrameTime, endWorkTime);
-			if (workTimeInS < targetSecondsPerFrame)
-			{
-				DWORD remainingTimeInMs =
-				    (DWORD)((targetSecondsPerFrame - workTimeInS) * 1000);
-				Sleep(remainingTimeInMs);
-			}
+			MsgWaitForMultipleObjects(0, nullptr, FALSE, 1, QS_ALLINPUT);
+			continue;
 		}
 
-		LARGE_INTEGER endFrameTime = win32_query_perf_counter_time();
-		frameTimeInS =
-		    win32_query_perf_counter_get_time(startFrameTime, endFrameTime);
-		f32 msPerFrame = 1000.0f * frameTimeInS;
+		LONG renderWidth, renderHeight;
+		win32_get_client_dim(mainWindow, &renderWidth, &renderHeight);
 
-		wchar_t windowTitleBuffer[128] = {};
-		_snwprintf_s(windowTitleBuffer, DQNT_ARRAY_COUNT(windowTitleBuffer),
-		             DQNT_ARRAY_COUNT(windowTitleBuffer),
-		             L"dchip-8 | %5.2f ms/f", msPerFrame);
-		SetWindowText(mainWindow, windowTitleBuffer);
+		HDC deviceContext = GetDC(mainWindow);
+		win32_display_render_bitmap(deviceContext, renderWidth, renderHeight);
+		ReleaseDC(mainWindow, deviceContext);
 	}
 
+	dqnt_atomic_store_u32(&emulation->quit, 1);
+	dqnt_thread_join(&emulation->thread);
+	dchip8_speculator_stop(&emulation->speculator);
+	if (exportingMetrics) dchip8_metrics_exporter_stop(&emulation->exporter);
+	if (raisedTimerResolution) timeEndPeriod(1);
+	VirtualFree(emulation, 0, MEM_RELEASE);
+
+	dchip8_rom_loader_stop(&globalRomLoader);
+	dchip8_scaler_stop(&globalScaler);
+	dchip8_romdb_close(&romDB);
 	return 0;
 }
 
@@ -605,3 +851,47 @@ bool platform_open_file(const wchar_t *const file, PlatformFile *platformFile)
 
 	return true;
 }
+
+bool platform_map_file(const wchar_t *const file, PlatformMappedFile *mappedFile)
+{
+	*mappedFile   = {};
+	HANDLE handle = CreateFile(file, GENERIC_READ, FILE_SHARE_READ, NULL,
+	                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(handle, &size) == 0 || size.QuadPart == 0)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMapping(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	void *memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!memory)
+	{
+		CloseHandle(mapping);
+		CloseHandle(handle);
+		return false;
+	}
+
+	mappedFile->handle  = handle;
+	mappedFile->mapping = mapping;
+	mappedFile->memory  = memory;
+	mappedFile->size    = size.QuadPart;
+	return true;
+}
+
+void platform_unmap_file(PlatformMappedFile *mappedFile)
+{
+	if (mappedFile->memory)  UnmapViewOfFile(mappedFile->memory);
+	if (mappedFile->mapping) CloseHandle(mappedFile->mapping);
+	if (mappedFile->handle)  CloseHandle(mappedFile->handle);
+	*mappedFile = {};
+}